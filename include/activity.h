@@ -0,0 +1,13 @@
+#ifndef ACTIVITY_H
+#define ACTIVITY_H
+
+#include <stdint.h>
+#include "brush_motion.h"
+
+// Where the session gets "is the user brushing right now" from.
+//   On the device this reads the IMU task's latest classification, in the
+//   native simulator it replays a recorded trace against virtual time.
+//   A NULL source means no sensing, and phases fall back to fixed timing.
+typedef BrushState (*ActivitySource)(uint32_t now_ms);
+
+#endif
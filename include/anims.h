@@ -1,1462 +1,1182 @@
 #ifndef ANIMS_H
 #define ANIMS_H
 
-#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "countdown.h"
 
+// How an animation carries on past its last frame
+enum AnimMode : uint8_t
+{
+    ANIM_ONCE = 0,  // stops on the last frame
+    ANIM_LOOP,      // starts again from the first
+    ANIM_PING_PONG, // plays backwards to the first, then forwards again
+};
+
+// Frames are 8 bytes each, one per row. Animations that are cheaper to draw
+//   than to store have no data and a render function instead. Each frame
+//   shows for one display tick, or for as many as holds gives it. Both
+//   eyes of a pair share the same frame count, mode and holds.
 typedef struct Anim
 {
-    const byte *anim;
+    const uint8_t *anim;
     const int num_frames;
+    void (*render)(int frame, uint8_t *rows);
+    uint8_t mode;         // AnimMode
+    const uint8_t *holds; // ticks per frame, NULL for one each
 } Anim;
 
-const byte data_eye_blink[64] = {
-    B00000000, B00000000, B00000000, B01111110, B00000000, B00000000, B00000000, B00000000,
-    B00000000, B00000000, B00111100, B01000010, B00000000, B00000000, B00000000, B00000000,
-    B00000000, B00011000, B00100100, B01000010, B00000000, B00000000, B00000000, B00000000,
-    B00000000, B00000000, B00111100, B01000010, B00000000, B00000000, B00000000, B00000000,
-    B00000000, B00000000, B00000000, B01111110, B00000000, B00000000, B00000000, B00000000,
-    B00000000, B00000000, B00000000, B01000010, B00111100, B00000000, B00000000, B00000000,
-    B00000000, B00000000, B00000000, B01000010, B00100100, B00011000, B00000000, B00000000,
-    B00000000, B00000000, B00000000, B01000010, B00111100, B00000000, B00000000, B00000000};
+// Inline so every file using one links to the same copy, rather than each
+//   getting its own
+inline constexpr uint8_t data_eye_blink[64] = {
+    0b00000000, 0b00000000, 0b00000000, 0b01111110, 0b00000000, 0b00000000, 0b00000000, 0b00000000,
+    0b00000000, 0b00000000, 0b00111100, 0b01000010, 0b00000000, 0b00000000, 0b00000000, 0b00000000,
+    0b00000000, 0b00011000, 0b00100100, 0b01000010, 0b00000000, 0b00000000, 0b00000000, 0b00000000,
+    0b00000000, 0b00000000, 0b00111100, 0b01000010, 0b00000000, 0b00000000, 0b00000000, 0b00000000,
+    0b00000000, 0b00000000, 0b00000000, 0b01111110, 0b00000000, 0b00000000, 0b00000000, 0b00000000,
+    0b00000000, 0b00000000, 0b00000000, 0b01000010, 0b00111100, 0b00000000, 0b00000000, 0b00000000,
+    0b00000000, 0b00000000, 0b00000000, 0b01000010, 0b00100100, 0b00011000, 0b00000000, 0b00000000,
+    0b00000000, 0b00000000, 0b00000000, 0b01000010, 0b00111100, 0b00000000, 0b00000000, 0b00000000};
 
-const Anim ANIM_EYE_BLINK = {data_eye_blink, 8};
+inline constexpr Anim ANIM_EYE_BLINK = {data_eye_blink, 8};
 
-const byte DATA_WAIT_LEFT[64] = {
-    B00000000, B00000000, B00000000, B01111110, B10001001, B10001111, B10001111, B01111110,
-    B00000000, B00000000, B01111110, B10000001, B10011001, B10011101, B10011101, B01111110,
-    B00000000, B01111110, B10000001, B10000001, B10110001, B10111001, B10111001, B01111110,
-    B01111110, B10000001, B10000001, B10000001, B10110001, B11110001, B11110001, B01111110,
-    B00000000, B01111110, B10000001, B10000001, B10011001, B10111001, B10111001, B01111110,
-    B01111110, B10000001, B10000001, B10000001, B10001101, B10011101, B10011101, B01111110,
-    B00000000, B00000000, B01111110, B10000001, B10110001, B11110001, B11110001, B01111110,
-    B01111110, B10000001, B10000001, B10000001, B10001101, B10011101, B10011101, B01111110};
+inline constexpr uint8_t DATA_WAIT_LEFT[64] = {
+    0b00000000, 0b00000000, 0b00000000, 0b01111110, 0b10001001, 0b10001111, 0b10001111, 0b01111110,
+    0b00000000, 0b00000000, 0b01111110, 0b10000001, 0b10011001, 0b10011101, 0b10011101, 0b01111110,
+    0b00000000, 0b01111110, 0b10000001, 0b10000001, 0b10110001, 0b10111001, 0b10111001, 0b01111110,
+    0b01111110, 0b10000001, 0b10000001, 0b10000001, 0b10110001, 0b11110001, 0b11110001, 0b01111110,
+    0b00000000, 0b01111110, 0b10000001, 0b10000001, 0b10011001, 0b10111001, 0b10111001, 0b01111110,
+    0b01111110, 0b10000001, 0b10000001, 0b10000001, 0b10001101, 0b10011101, 0b10011101, 0b01111110,
+    0b00000000, 0b00000000, 0b01111110, 0b10000001, 0b10110001, 0b11110001, 0b11110001, 0b01111110,
+    0b01111110, 0b10000001, 0b10000001, 0b10000001, 0b10001101, 0b10011101, 0b10011101, 0b01111110};
 
-const Anim ANIM_WAIT_LEFT = {DATA_WAIT_LEFT, 8};
+inline constexpr Anim ANIM_WAIT_LEFT = {DATA_WAIT_LEFT, 8, NULL, ANIM_PING_PONG};
 
-const byte DATA_WAIT_RIGHT[64] = {
-    B00000000,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10001001,
-    B10001111,
-    B10001111,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10011001,
-    B10011101,
-    B10011101,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10110001,
-    B10111001,
-    B10111001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10000001,
-    B10110001,
-    B11110001,
-    B11110001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10011001,
-    B10111001,
-    B10111001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10000001,
-    B10001101,
-    B10011101,
-    B10011101,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10110001,
-    B11110001,
-    B11110001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10000001,
-    B10001101,
-    B10011101,
-    B10011101,
-    B01111110,
+inline constexpr uint8_t DATA_WAIT_RIGHT[64] = {
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10001001,
+    0b10001111,
+    0b10001111,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10011001,
+    0b10011101,
+    0b10011101,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10110001,
+    0b10111001,
+    0b10111001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10000001,
+    0b10110001,
+    0b11110001,
+    0b11110001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10011001,
+    0b10111001,
+    0b10111001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10000001,
+    0b10001101,
+    0b10011101,
+    0b10011101,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10110001,
+    0b11110001,
+    0b11110001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10000001,
+    0b10001101,
+    0b10011101,
+    0b10011101,
+    0b01111110,
 };
 
-const Anim ANIM_WAIT_RIGHT = {DATA_WAIT_RIGHT, 8};
+inline constexpr Anim ANIM_WAIT_RIGHT = {DATA_WAIT_RIGHT, 8, NULL, ANIM_PING_PONG};
 
-const byte DATA_UPPER_LEFT_LEFT[96] = {
-    B01111110,
-    B11110001,
-    B10110001,
-    B11010001,
-    B11100001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B11111001,
-    B11011001,
-    B11101001,
-    B10110001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B11110001,
-    B10110001,
-    B11010001,
-    B11100001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B11111001,
-    B11011001,
-    B11101001,
-    B10110001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B11110001,
-    B10110001,
-    B11010001,
-    B11100001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B11111001,
-    B11011001,
-    B11101001,
-    B10110001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B11110001,
-    B10110001,
-    B11010001,
-    B11100001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B11111001,
-    B11011001,
-    B11101001,
-    B10110001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B11110001,
-    B10110001,
-    B11010001,
-    B11100001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B11111001,
-    B11011001,
-    B11101001,
-    B10110001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B11110001,
-    B10110001,
-    B11010001,
-    B11100001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B11111001,
-    B11011001,
-    B11101001,
-    B10110001,
-    B10000001,
-    B10000001,
-    B01111110,
+inline constexpr uint8_t DATA_UPPER_LEFT_LEFT[96] = {
+    0b01111110,
+    0b11110001,
+    0b10110001,
+    0b11010001,
+    0b11100001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b11111001,
+    0b11011001,
+    0b11101001,
+    0b10110001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b11110001,
+    0b10110001,
+    0b11010001,
+    0b11100001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b11111001,
+    0b11011001,
+    0b11101001,
+    0b10110001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b11110001,
+    0b10110001,
+    0b11010001,
+    0b11100001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b11111001,
+    0b11011001,
+    0b11101001,
+    0b10110001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b11110001,
+    0b10110001,
+    0b11010001,
+    0b11100001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b11111001,
+    0b11011001,
+    0b11101001,
+    0b10110001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b11110001,
+    0b10110001,
+    0b11010001,
+    0b11100001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b11111001,
+    0b11011001,
+    0b11101001,
+    0b10110001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b11110001,
+    0b10110001,
+    0b11010001,
+    0b11100001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b11111001,
+    0b11011001,
+    0b11101001,
+    0b10110001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
 };
 
-const Anim ANIM_UPPER_LEFT_LEFT = {DATA_UPPER_LEFT_LEFT, 12};
+inline constexpr Anim ANIM_UPPER_LEFT_LEFT = {DATA_UPPER_LEFT_LEFT, 12, NULL, ANIM_PING_PONG};
 
-const byte DATA_UPPER_LEFT_RIGHT[96] = {
-    B01111110,
-    B11110001,
-    B10110001,
-    B11010001,
-    B11100001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B11011001,
-    B11101001,
-    B10110001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B11010001,
-    B11100001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B11101001,
-    B10110001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B11110001,
-    B10110001,
-    B11010001,
-    B11100001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B11011001,
-    B11101001,
-    B10110001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B11110001,
-    B10110001,
-    B11010001,
-    B11100001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B11111001,
-    B11011001,
-    B11101001,
-    B10110001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B11110001,
-    B10110001,
-    B11010001,
-    B11100001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B11011001,
-    B11101001,
-    B10110001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B11010001,
-    B11100001,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B11011001,
-    B11101001,
-    B10110001,
-    B10000001,
-    B10000001,
-    B01111110,
+inline constexpr uint8_t DATA_UPPER_LEFT_RIGHT[96] = {
+    0b01111110,
+    0b11110001,
+    0b10110001,
+    0b11010001,
+    0b11100001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b11011001,
+    0b11101001,
+    0b10110001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b11010001,
+    0b11100001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b11101001,
+    0b10110001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b11110001,
+    0b10110001,
+    0b11010001,
+    0b11100001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b11011001,
+    0b11101001,
+    0b10110001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b11110001,
+    0b10110001,
+    0b11010001,
+    0b11100001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b11111001,
+    0b11011001,
+    0b11101001,
+    0b10110001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b11110001,
+    0b10110001,
+    0b11010001,
+    0b11100001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b11011001,
+    0b11101001,
+    0b10110001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b11010001,
+    0b11100001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b11011001,
+    0b11101001,
+    0b10110001,
+    0b10000001,
+    0b10000001,
+    0b01111110,
 };
 
-const Anim ANIM_UPPER_LEFT_RIGHT = {DATA_UPPER_LEFT_RIGHT, 12};
+inline constexpr Anim ANIM_UPPER_LEFT_RIGHT = {DATA_UPPER_LEFT_RIGHT, 12, NULL, ANIM_PING_PONG};
 
-const byte DATA_UPPER_RIGHT_LEFT[96] = {
-    B01111110,
-    B10001111,
-    B10001101,
-    B10001011,
-    B10000111,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10011011,
-    B10010111,
-    B10001101,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10001011,
-    B10000111,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10010111,
-    B10001101,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10001111,
-    B10001101,
-    B10001011,
-    B10000111,
-    B10000001,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10011011,
-    B10010111,
-    B10001101,
-    B10000001,
-    B01111110,
-    B01111110,
-    B10001111,
-    B10001101,
-    B10001011,
-    B10000111,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B10011111,
-    B10011011,
-    B10010111,
-    B10001101,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10001111,
-    B10001101,
-    B10001011,
-    B10000111,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10011011,
-    B10010111,
-    B10001101,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10001011,
-    B10000111,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10011011,
-    B10010111,
-    B10001101,
-    B10000001,
-    B10000001,
-    B01111110,
+inline constexpr uint8_t DATA_UPPER_RIGHT_LEFT[96] = {
+    0b01111110,
+    0b10001111,
+    0b10001101,
+    0b10001011,
+    0b10000111,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10011011,
+    0b10010111,
+    0b10001101,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10001011,
+    0b10000111,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10010111,
+    0b10001101,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10001111,
+    0b10001101,
+    0b10001011,
+    0b10000111,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10011011,
+    0b10010111,
+    0b10001101,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b10001111,
+    0b10001101,
+    0b10001011,
+    0b10000111,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b10011111,
+    0b10011011,
+    0b10010111,
+    0b10001101,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10001111,
+    0b10001101,
+    0b10001011,
+    0b10000111,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10011011,
+    0b10010111,
+    0b10001101,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10001011,
+    0b10000111,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10011011,
+    0b10010111,
+    0b10001101,
+    0b10000001,
+    0b10000001,
+    0b01111110,
 };
 
-const Anim ANIM_UPPER_RIGHT_LEFT = {DATA_UPPER_RIGHT_LEFT, 12};
+inline constexpr Anim ANIM_UPPER_RIGHT_LEFT = {DATA_UPPER_RIGHT_LEFT, 12, NULL, ANIM_PING_PONG};
 
-const byte DATA_UPPER_RIGHT_RIGHT[96] = {
-    B01111110,
-    B10001111,
-    B10001101,
-    B10001011,
-    B10000111,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B10011111,
-    B10011011,
-    B10010111,
-    B10001101,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B10001111,
-    B10001101,
-    B10001011,
-    B10000111,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B10011111,
-    B10011011,
-    B10010111,
-    B10001101,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10001111,
-    B10001101,
-    B10001011,
-    B10000111,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10011111,
-    B10011011,
-    B10010111,
-    B10001101,
-    B10000001,
-    B01111110,
-    B01111110,
-    B10001111,
-    B10001101,
-    B10001011,
-    B10000111,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B10011111,
-    B10011011,
-    B10010111,
-    B10001101,
-    B10000001,
-    B10000001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10001111,
-    B10001101,
-    B10001011,
-    B10000111,
-    B10000001,
-    B01111110,
-    B01111110,
-    B10011111,
-    B10011011,
-    B10010111,
-    B10001101,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B10001111,
-    B10001101,
-    B10001011,
-    B10000111,
-    B10000001,
-    B10000001,
-    B01111110,
-    B01111110,
-    B10011111,
-    B10011011,
-    B10010111,
-    B10001101,
-    B10000001,
-    B10000001,
-    B01111110,
+inline constexpr uint8_t DATA_UPPER_RIGHT_RIGHT[96] = {
+    0b01111110,
+    0b10001111,
+    0b10001101,
+    0b10001011,
+    0b10000111,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b10011111,
+    0b10011011,
+    0b10010111,
+    0b10001101,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b10001111,
+    0b10001101,
+    0b10001011,
+    0b10000111,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b10011111,
+    0b10011011,
+    0b10010111,
+    0b10001101,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10001111,
+    0b10001101,
+    0b10001011,
+    0b10000111,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10011111,
+    0b10011011,
+    0b10010111,
+    0b10001101,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b10001111,
+    0b10001101,
+    0b10001011,
+    0b10000111,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b10011111,
+    0b10011011,
+    0b10010111,
+    0b10001101,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10001111,
+    0b10001101,
+    0b10001011,
+    0b10000111,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b10011111,
+    0b10011011,
+    0b10010111,
+    0b10001101,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b10001111,
+    0b10001101,
+    0b10001011,
+    0b10000111,
+    0b10000001,
+    0b10000001,
+    0b01111110,
+    0b01111110,
+    0b10011111,
+    0b10011011,
+    0b10010111,
+    0b10001101,
+    0b10000001,
+    0b10000001,
+    0b01111110,
 
 };
 
-const Anim ANIM_UPPER_RIGHT_RIGHT = {DATA_UPPER_RIGHT_RIGHT, 12};
+inline constexpr Anim ANIM_UPPER_RIGHT_RIGHT = {DATA_UPPER_RIGHT_RIGHT, 12, NULL, ANIM_PING_PONG};
 
-const byte DATA_LOWER_LEFT_LEFT[104] = {
-    B01111110,
-    B10000001,
-    B10000001,
-    B11100001,
-    B11010001,
-    B10110001,
-    B11110001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B11100001,
-    B11010001,
-    B10110001,
-    B11110001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B11100001,
-    B11010001,
-    B10110001,
-    B11110001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B11100001,
-    B11010001,
-    B10110001,
-    B11110001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B11100001,
-    B11010001,
-    B10110001,
-    B11110001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B11100001,
-    B11010001,
-    B10110001,
-    B11110001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
+inline constexpr uint8_t DATA_LOWER_LEFT_LEFT[96] = {
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b11100001,
+    0b11010001,
+    0b10110001,
+    0b11110001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10110001,
+    0b11101001,
+    0b11011001,
+    0b11111001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b11100001,
+    0b11010001,
+    0b10110001,
+    0b11110001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10110001,
+    0b11101001,
+    0b11011001,
+    0b11111001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b11100001,
+    0b11010001,
+    0b10110001,
+    0b11110001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10110001,
+    0b11101001,
+    0b11011001,
+    0b11111001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b11100001,
+    0b11010001,
+    0b10110001,
+    0b11110001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10110001,
+    0b11101001,
+    0b11011001,
+    0b11111001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b11100001,
+    0b11010001,
+    0b10110001,
+    0b11110001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10110001,
+    0b11101001,
+    0b11011001,
+    0b11111001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b11100001,
+    0b11010001,
+    0b10110001,
+    0b11110001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10110001,
+    0b11101001,
+    0b11011001,
+    0b11111001,
+    0b01111110,
 };
 
-const Anim ANIM_LOWER_LEFT_LEFT = {DATA_LOWER_LEFT_LEFT, 13};
+// The second frame of each lower quadrant animation is held for two ticks
+inline constexpr uint8_t HOLDS_LOWER[12] = {1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
 
-const byte DATA_LOWER_LEFT_RIGHT[104] = {
-    B01111110,
-    B10000001,
-    B10000001,
-    B11100001,
-    B11010001,
-    B10110001,
-    B11110001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B11100001,
-    B11010001,
-    B10110001,
-    B11110001,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B11100001,
-    B11010001,
-    B10110001,
-    B11110001,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B11100001,
-    B11010001,
-    B10110001,
-    B11110001,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B11100001,
-    B11010001,
-    B10110001,
-    B11110001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B11100001,
-    B11010001,
-    B10110001,
-    B11110001,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10110001,
-    B11101001,
-    B11011001,
-    B11111001,
-    B01111110,
+inline constexpr Anim ANIM_LOWER_LEFT_LEFT = {DATA_LOWER_LEFT_LEFT, 12, NULL, ANIM_PING_PONG, HOLDS_LOWER};
+
+inline constexpr uint8_t DATA_LOWER_LEFT_RIGHT[96] = {
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b11100001,
+    0b11010001,
+    0b10110001,
+    0b11110001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10110001,
+    0b11101001,
+    0b11011001,
+    0b11111001,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b11100001,
+    0b11010001,
+    0b10110001,
+    0b11110001,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10110001,
+    0b11101001,
+    0b11011001,
+    0b11111001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b11100001,
+    0b11010001,
+    0b10110001,
+    0b11110001,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10110001,
+    0b11101001,
+    0b11011001,
+    0b11111001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b11100001,
+    0b11010001,
+    0b10110001,
+    0b11110001,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10110001,
+    0b11101001,
+    0b11011001,
+    0b11111001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b11100001,
+    0b11010001,
+    0b10110001,
+    0b11110001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10110001,
+    0b11101001,
+    0b11011001,
+    0b11111001,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b11100001,
+    0b11010001,
+    0b10110001,
+    0b11110001,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10110001,
+    0b11101001,
+    0b11011001,
+    0b11111001,
+    0b01111110,
 };
 
-const Anim ANIM_LOWER_LEFT_RIGHT = {DATA_LOWER_LEFT_RIGHT, 13};
+inline constexpr Anim ANIM_LOWER_LEFT_RIGHT = {DATA_LOWER_LEFT_RIGHT, 12, NULL, ANIM_PING_PONG, HOLDS_LOWER};
 
-const byte DATA_LOWER_RIGHT_LEFT[104] = {
-    B01111110,
-    B10000001,
-    B10000001,
-    B10000111,
-    B10001011,
-    B10001101,
-    B10001111,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10000111,
-    B10001011,
-    B10001101,
-    B10001111,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10000111,
-    B10001011,
-    B10001101,
-    B10001111,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10000111,
-    B10001011,
-    B10001101,
-    B10001111,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10000111,
-    B10001011,
-    B10001101,
-    B10001111,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10000111,
-    B10001011,
-    B10001101,
-    B10001111,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
+inline constexpr uint8_t DATA_LOWER_RIGHT_LEFT[96] = {
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10000111,
+    0b10001011,
+    0b10001101,
+    0b10001111,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10001101,
+    0b10010111,
+    0b10011011,
+    0b10011111,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10000111,
+    0b10001011,
+    0b10001101,
+    0b10001111,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10001101,
+    0b10010111,
+    0b10011011,
+    0b10011111,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10000111,
+    0b10001011,
+    0b10001101,
+    0b10001111,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10001101,
+    0b10010111,
+    0b10011011,
+    0b10011111,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10000111,
+    0b10001011,
+    0b10001101,
+    0b10001111,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10001101,
+    0b10010111,
+    0b10011011,
+    0b10011111,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10000111,
+    0b10001011,
+    0b10001101,
+    0b10001111,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10001101,
+    0b10010111,
+    0b10011011,
+    0b10011111,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10000111,
+    0b10001011,
+    0b10001101,
+    0b10001111,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10001101,
+    0b10010111,
+    0b10011011,
+    0b10011111,
+    0b01111110,
 };
 
-const Anim ANIM_LOWER_RIGHT_LEFT = {DATA_LOWER_RIGHT_LEFT, 8};
+inline constexpr Anim ANIM_LOWER_RIGHT_LEFT = {DATA_LOWER_RIGHT_LEFT, 12, NULL, ANIM_PING_PONG, HOLDS_LOWER};
 
-const byte DATA_LOWER_RIGHT_RIGHT[104] = {
-    B01111110,
-    B10000001,
-    B10000001,
-    B10000111,
-    B10001011,
-    B10001101,
-    B10001111,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10000111,
-    B10001011,
-    B10001101,
-    B10001111,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10000111,
-    B10001011,
-    B10001101,
-    B10001111,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10000111,
-    B10001011,
-    B10001101,
-    B10001111,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10000111,
-    B10001011,
-    B10001101,
-    B10001111,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10000111,
-    B10001011,
-    B10001101,
-    B10001111,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10001101,
-    B10010111,
-    B10011011,
-    B10011111,
-    B01111110,
+inline constexpr uint8_t DATA_LOWER_RIGHT_RIGHT[96] = {
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10000111,
+    0b10001011,
+    0b10001101,
+    0b10001111,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10001101,
+    0b10010111,
+    0b10011011,
+    0b10011111,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10000111,
+    0b10001011,
+    0b10001101,
+    0b10001111,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10001101,
+    0b10010111,
+    0b10011011,
+    0b10011111,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10000111,
+    0b10001011,
+    0b10001101,
+    0b10001111,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10001101,
+    0b10010111,
+    0b10011011,
+    0b10011111,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10000111,
+    0b10001011,
+    0b10001101,
+    0b10001111,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10001101,
+    0b10010111,
+    0b10011011,
+    0b10011111,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10000111,
+    0b10001011,
+    0b10001101,
+    0b10001111,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10001101,
+    0b10010111,
+    0b10011011,
+    0b10011111,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10000111,
+    0b10001011,
+    0b10001101,
+    0b10001111,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10001101,
+    0b10010111,
+    0b10011011,
+    0b10011111,
+    0b01111110,
 };
 
-const Anim ANIM_LOWER_RIGHT_RIGHT = {DATA_LOWER_RIGHT_RIGHT, 8};
+inline constexpr Anim ANIM_LOWER_RIGHT_RIGHT = {DATA_LOWER_RIGHT_RIGHT, 12, NULL, ANIM_PING_PONG, HOLDS_LOWER};
 
-const byte DATA_EXCITED_EYES[64] = {
-    B00000000,
-    B00111100,
-    B01000010,
-    B01011010,
-    B01110110,
-    B01101110,
-    B01111110,
-    B00111100,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10011001,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
-    B00000000,
-    B00111100,
-    B01000010,
-    B01011010,
-    B01110110,
-    B01101110,
-    B01111110,
-    B00111100,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10011001,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10011001,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10011001,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
-    B00000000,
-    B00111100,
-    B01000010,
-    B01011010,
-    B01110110,
-    B01101110,
-    B01111110,
-    B00111100,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10011001,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
+inline constexpr uint8_t DATA_EXCITED_EYES[64] = {
+    0b00000000,
+    0b00111100,
+    0b01000010,
+    0b01011010,
+    0b01110110,
+    0b01101110,
+    0b01111110,
+    0b00111100,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10011001,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b00111100,
+    0b01000010,
+    0b01011010,
+    0b01110110,
+    0b01101110,
+    0b01111110,
+    0b00111100,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10011001,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10011001,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10011001,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b00111100,
+    0b01000010,
+    0b01011010,
+    0b01110110,
+    0b01101110,
+    0b01111110,
+    0b00111100,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10011001,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
 };
 
-const Anim ANIM_EXCITED_EYES = {DATA_EXCITED_EYES, 8};
+inline constexpr Anim ANIM_EXCITED_EYES = {DATA_EXCITED_EYES, 8, NULL, ANIM_PING_PONG};
 
-const byte DATA_OPEN_EYES[56] = {
-    B00000000,
-    B00000000,
-    B00000000,
-    B00000000,
-    B00000000,
-    B00000000,
-    B01111110,
-    B11111111,
-    B00000000,
-    B00000000,
-    B00000000,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10111101,
-    B01111110,
-    B00000000,
-    B00000000,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10101101,
-    B10111101,
-    B01111110,
-    B00000000,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10011001,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10011001,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
-    B01111110,
-    B10000001,
-    B10000001,
-    B10011001,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
+inline constexpr uint8_t DATA_OPEN_EYES[56] = {
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b11111111,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10011001,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10011001,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10011001,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
 };
 
-const Anim ANIM_OPEN_EYES = {DATA_OPEN_EYES, 7};
+inline constexpr Anim ANIM_OPEN_EYES = {DATA_OPEN_EYES, 7};
 
-const byte DATA_CLOSE_EYES[56] = {
-    B01111110,
-    B10000001,
-    B10000001,
-    B10011001,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
-    B00000000,
-    B01111110,
-    B10000001,
-    B10011001,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10011001,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
-    B00000000,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10110101,
-    B10101101,
-    B10111101,
-    B01111110,
-    B00000000,
-    B00000000,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10101101,
-    B10111101,
-    B01111110,
-    B00000000,
-    B00000000,
-    B00000000,
-    B00000000,
-    B00000000,
-    B01111110,
-    B10111101,
-    B01111110,
-    B00000000,
-    B00000000,
-    B00000000,
-    B00000000,
-    B00000000,
-    B00000000,
-    B01111110,
-    B11111111,
+inline constexpr uint8_t DATA_CLOSE_EYES[56] = {
+    0b01111110,
+    0b10000001,
+    0b10000001,
+    0b10011001,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b01111110,
+    0b10000001,
+    0b10011001,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10011001,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10110101,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10101101,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b10111101,
+    0b01111110,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b00000000,
+    0b01111110,
+    0b11111111,
 };
 
-const Anim ANIM_CLOSE_EYES = {DATA_CLOSE_EYES, 7};
+inline constexpr Anim ANIM_CLOSE_EYES = {DATA_CLOSE_EYES, 7};
 
-const byte DATA_COUNTDOWN[320] = {
-    B01001110,
-    B11010001,
-    B01010001,
-    B01010001,
-    B01010001,
-    B01010001,
-    B01010001,
-    B01001110,
-    B01100110,
-    B10000001,
-    B10000001,
-    B00000000,
-    B00000000,
-    B10000001,
-    B10000001,
-    B01100110,
-    B01001110,
-    B11010001,
-    B01010001,
-    B01010001,
-    B01010001,
-    B01010001,
-    B01010001,
-    B01001110,
-    B01110010,
-    B10000001,
-    B00000001,
-    B00000001,
-    B10000000,
-    B10000000,
-    B10000001,
-    B01001110,
-    B00111100,
-    B00100100,
-    B00100100,
-    B00111100,
-    B00000100,
-    B00000100,
-    B00000100,
-    B00000100,
-    B01110010,
-    B10000001,
-    B00000001,
-    B00000001,
-    B10000000,
-    B10000000,
-    B10000001,
-    B01001110,
-    B00111100,
-    B00100100,
-    B00100100,
-    B00111100,
-    B00000100,
-    B00000100,
-    B00000100,
-    B00000100,
-    B01111000,
-    B00000001,
-    B00000001,
-    B10000001,
-    B10000001,
-    B10000000,
-    B10000000,
-    B00011110,
-    B00000000,
-    B00111000,
-    B01000100,
-    B01000100,
-    B00111000,
-    B01000100,
-    B01000100,
-    B00111000,
-    B01111000,
-    B00000001,
-    B00000001,
-    B10000001,
-    B10000001,
-    B10000000,
-    B10000000,
-    B00011110,
-    B00000000,
-    B00111000,
-    B01000100,
-    B01000100,
-    B00111000,
-    B01000100,
-    B01000100,
-    B00111000,
-    B00111100,
-    B00000000,
-    B10000001,
-    B10000001,
-    B10000001,
-    B10000001,
-    B00000000,
-    B00111100,
-    B00000000,
-    B11111100,
-    B00000100,
-    B00000100,
-    B00001000,
-    B00010000,
-    B00010000,
-    B00010000,
-    B00111100,
-    B00000000,
-    B10000001,
-    B10000001,
-    B10000001,
-    B10000001,
-    B00000000,
-    B00111100,
-    B00000000,
-    B11111100,
-    B00000100,
-    B00000100,
-    B00001000,
-    B00010000,
-    B00010000,
-    B00010000,
-    B00011110,
-    B10000000,
-    B10000000,
-    B10000001,
-    B10000001,
-    B00000001,
-    B00000001,
-    B01111000,
-    B00000000,
-    B00011100,
-    B00100000,
-    B00100000,
-    B00111100,
-    B00100010,
-    B00100010,
-    B00011100,
-    B01001110,
-    B10000001,
-    B10000000,
-    B10000000,
-    B00000001,
-    B00000001,
-    B10000001,
-    B01110010,
-    B00000000,
-    B00011100,
-    B00100000,
-    B00100000,
-    B00111100,
-    B00100010,
-    B00100010,
-    B00011100,
-    B01001110,
-    B10000001,
-    B10000000,
-    B10000000,
-    B00000001,
-    B00000001,
-    B10000001,
-    B01110010,
-    B00000000,
-    B00111110,
-    B00100000,
-    B00100000,
-    B00111100,
-    B00000010,
-    B00000010,
-    B00111100,
-    B01100110,
-    B10000001,
-    B10000001,
-    B00000000,
-    B00000000,
-    B10000001,
-    B10000001,
-    B01100110,
-    B00000000,
-    B00111110,
-    B00100000,
-    B00100000,
-    B00111100,
-    B00000010,
-    B00000010,
-    B00111100,
-    B01100110,
-    B10000001,
-    B10000001,
-    B00000000,
-    B00000000,
-    B10000001,
-    B10000001,
-    B01100110,
-    B00000000,
-    B01000100,
-    B01000100,
-    B01000100,
-    B01111100,
-    B00000100,
-    B00000100,
-    B00000100,
-    B01110010,
-    B10000001,
-    B00000001,
-    B00000001,
-    B10000000,
-    B10000000,
-    B10000001,
-    B01001110,
-    B00000000,
-    B01000100,
-    B01000100,
-    B01000100,
-    B01111100,
-    B00000100,
-    B00000100,
-    B00000100,
-    B01110010,
-    B10000001,
-    B00000001,
-    B00000001,
-    B10000000,
-    B10000000,
-    B10000001,
-    B01001110,
-    B00000000,
-    B01111100,
-    B00000010,
-    B00000010,
-    B00111100,
-    B00000010,
-    B00000010,
-    B01111100,
-    B01111000,
-    B00000001,
-    B00000001,
-    B10000001,
-    B10000001,
-    B10000000,
-    B10000000,
-    B00011110,
-    B00000000,
-    B01111100,
-    B00000010,
-    B00000010,
-    B00111100,
-    B00000010,
-    B00000010,
-    B01111100,
-    B01111000,
-    B00000001,
-    B00000001,
-    B10000001,
-    B10000001,
-    B10000000,
-    B10000000,
-    B00011110,
-    B00000000,
-    B00011100,
-    B00100010,
-    B00000010,
-    B00000100,
-    B00001000,
-    B00010000,
-    B00111110,
-    B00111100,
-    B00000000,
-    B10000001,
-    B10000001,
-    B10000001,
-    B10000001,
-    B00000000,
-    B00111100,
-    B00000000,
-    B00011100,
-    B00100010,
-    B00000010,
-    B00000100,
-    B00001000,
-    B00010000,
-    B00111110,
-    B00111100,
-    B00000000,
-    B10000001,
-    B10000001,
-    B10000001,
-    B10000001,
-    B00000000,
-    B00111100,
-    B00001000,
-    B00011000,
-    B00101000,
-    B00001000,
-    B00001000,
-    B00001000,
-    B00001000,
-    B00111110,
-    B01001110,
-    B10000001,
-    B10000000,
-    B10000000,
-    B00000001,
-    B00000001,
-    B10000001,
-    B01110010,
-    B00001000,
-    B00011000,
-    B00101000,
-    B00001000,
-    B00001000,
-    B00001000,
-    B00001000,
-    B00111110,
-    B01001110,
-    B10000001,
-    B10000000,
-    B10000000,
-    B00000001,
-    B00000001,
-    B10000001,
-    B01110010,
-};
+// An almost empty battery, blinking, when the charge is low (fuel_gauge.h)
+inline constexpr uint8_t DATA_LOW_BATTERY[32] = {
+    0b00000000, 0b11111110, 0b10000010, 0b11000011, 0b11000011, 0b10000010, 0b11111110, 0b00000000,
+    0b00000000, 0b11111110, 0b10000010, 0b10000011, 0b10000011, 0b10000010, 0b11111110, 0b00000000,
+    0b00000000, 0b11111110, 0b10000010, 0b11000011, 0b11000011, 0b10000010, 0b11111110, 0b00000000,
+    0b00000000, 0b11111110, 0b10000010, 0b10000011, 0b10000011, 0b10000010, 0b11111110, 0b00000000};
+
+inline constexpr uint8_t HOLDS_LOW_BATTERY[4] = {2, 2, 2, 2};
+
+inline constexpr Anim ANIM_LOW_BATTERY = {DATA_LOW_BATTERY, 4, NULL, ANIM_ONCE, HOLDS_LOW_BATTERY};
+
+// Drawn from the font at run time, see countdown.h
+inline constexpr Anim ANIM_COUNTDOWN = {NULL, COUNTDOWN_FRAMES, countdownFrame, ANIM_LOOP};
+
+// Pairs of animations by name, for playing one from the serial console
+typedef struct NamedAnim
+{
+    const char *name;
+    const Anim *left;
+    const Anim *right;
+} NamedAnim;
+
+extern const NamedAnim NAMED_ANIMS[];
+extern const size_t NAMED_ANIM_COUNT;
+
+// Index into NAMED_ANIMS, -1 if there's none called that
+int animByName(const char *name);
+
+// Ticks frame shows for
+uint8_t animHold(const Anim *anim, int frame);
+
+// Where an animation is up to, a tick at a time
+typedef struct AnimPlayer
+{
+    const Anim *anim;
+    uint8_t mode; // AnimMode, the anim's own unless started with another
+    int frame;    // the one to show next
+    int8_t step;  // 1 forwards, -1 backwards for ANIM_PING_PONG
+    uint8_t held; // ticks frame has been shown for already
+    bool done;    // ANIM_ONCE: the last frame has had its ticks
+} AnimPlayer;
+
+void animPlayerStart(AnimPlayer *player, const Anim *anim, uint8_t mode);
+
+// Rows of the frame to show this tick, rendered into rows if the anim is
+//   drawn rather than stored
+const uint8_t *animPlayerRows(const AnimPlayer *player, const Anim *anim, uint8_t *rows);
+
+// The frame was shown for a tick: move on if it's had its ticks. Returns
+//   true if the next tick shows a different frame.
+bool animPlayerTick(AnimPlayer *player);
 
-const Anim ANIM_COUNTDOWN = {DATA_COUNTDOWN, 40};
+// Ticks left until the end of an ANIM_ONCE play, counting this one's
+int animPlayerTicksLeft(const AnimPlayer *player);
 
-#endif
\ No newline at end of file
+#endif
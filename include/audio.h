@@ -0,0 +1,65 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdint.h>
+#include "latency_model.h"
+
+class Print;
+
+// *** DF Player Pins *** //
+#define RXD2 16
+#define TXD2 17
+// The BUSY pin goes low while a track is playing, which is how we measure
+//   how long the player takes to start making sound. It's pulled up, so
+//   if it isn't wired we simply never get onset measurements.
+#define DFPLAYER_BUSY_PIN 4
+
+// *** I2S Pins (esp32_i2s environment only) *** //
+#define I2S_BCLK 27
+#define I2S_LRCK 25
+#define I2S_DOUT 33
+
+// Comment this out to stop printing DFPlayer events in the serial monitor
+#define DEBUG_MUSIC
+
+// The player is owned by a background task that sends the phase cues
+//   ahead of time (see audio_cues.h). These calls just queue a message for
+//   that task, so they never block on the player's serial link.
+
+// Start the player and its task. Returns false if the player didn't answer,
+//   in which case the task keeps retrying it in the background (see
+//   supervisor.h) and everything else carries on without sound.
+//   The first time, the DFPlayer backend also measures the player's
+//   latency here, which takes a second or two: see latency_model.h. The
+//   statistics are kept in NVS across reboots and keep being updated from
+//   normal playback, and the cue lead time follows them.
+bool audioBegin();
+
+// true once the player has answered
+bool audioReady();
+
+// Which output is in use, e.g. "DFPlayer Mini"
+const char *audioName();
+
+// The first frame of `phase` was shown at at_ms, on clockMs32() (see clock.h)
+void audioPhaseStarted(int phase, uint32_t at_ms);
+
+// The next phase is expected to start at at_ms, or AUDIO_TIME_UNKNOWN
+void audioPredictNextPhase(uint32_t at_ms);
+
+void audioStop();
+
+// Change the volume now, 0..30
+void audioSetVolume(uint8_t level);
+
+// Where the background music should be right now, AUDIO_TIME_UNKNOWN if
+//   nothing is playing
+uint32_t audioPositionMs();
+
+// Copy of the current latency statistics (all empty for the I2S backend)
+LatencyModel audioLatency();
+
+// Latency statistics and the lead time in use, for diagnostics
+void audioPrintLatency(Print &out);
+
+#endif
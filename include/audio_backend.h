@@ -0,0 +1,27 @@
+#ifndef AUDIO_BACKEND_H
+#define AUDIO_BACKEND_H
+
+#include <stdint.h>
+#include "audio_sink.h"
+
+// What the audio task needs from whichever output is built in:
+//   audio_dfplayer.cpp (the external DFPlayer Mini, default) or
+//   audio_i2s.cpp (onboard decoding to I2S, the esp32_i2s environment).
+//   Everything here is called from the audio task, except
+//   audioBackendBegin() which runs from audioBegin().
+
+// Bring up the output. NULL if it isn't there.
+AudioSink *audioBackendBegin();
+
+// How far ahead of a deadline commands should be sent
+uint32_t audioBackendLeadMs();
+
+// Handle player events (finished tracks go to audioCuesTrackFinished)
+void audioBackendPoll(uint32_t now_ms);
+
+// The session ended and the audio was stopped
+void audioBackendSessionEnded();
+
+const char *audioBackendName();
+
+#endif
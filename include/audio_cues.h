@@ -0,0 +1,103 @@
+#ifndef AUDIO_CUES_H
+#define AUDIO_CUES_H
+
+#include <stdint.h>
+#include "audio_sink.h"
+
+// Audio cue scheduler.
+//   Each session phase can have cues (volume changes, background music,
+//   voice prompts) at an offset from the moment its first frame is shown.
+//   When the caller knows ahead of time when the next phase will start, its
+//   cues are sent early by the player's command latency so the sound starts
+//   together with the animation instead of after it.
+//
+// SD card layout:
+//   01/001.mp3 ...   background music playlist
+//   ADVERT/0001.mp3  voice prompts, see the VOICE_* ids below
+
+// How long before its deadline a command is sent, unless told otherwise
+#define AUDIO_DEFAULT_LEAD_MS 60
+
+// The DFPlayer reports a finished track twice. A track can't finish this
+//   soon after it started, so the second report is ignored.
+#define AUDIO_MIN_TRACK_MS 1000
+
+// Returned / accepted when a time isn't known
+#define AUDIO_TIME_UNKNOWN 0xFFFFFFFFUL
+
+enum AudioCueKind : uint8_t
+{
+    CUE_VOLUME = 0,   // value = volume level, or CUE_VOLUME_CONFIGURED
+    CUE_BACKGROUND,   // start the background playlist
+    CUE_VOICE,        // value = ADVERT track
+    CUE_STOP,         // stop everything
+};
+
+// Use the volume from the settings, see config.h
+#define CUE_VOLUME_CONFIGURED 0xFFFF
+
+// *** Voice prompts in the ADVERT folder *** //
+#define VOICE_UPPER_LEFT 1
+#define VOICE_UPPER_RIGHT 2
+#define VOICE_LOWER_LEFT 3
+#define VOICE_LOWER_RIGHT 4
+#define VOICE_GREAT_JOB 5
+
+typedef struct AudioCue
+{
+    uint8_t phase;
+    uint16_t offset_ms;
+    uint8_t kind;
+    uint16_t value;
+} AudioCue;
+
+typedef struct BackgroundTrack
+{
+    uint8_t folder;
+    uint8_t track;
+    // 0 if unknown: the first time through, the next track starts once
+    //   the player reports this one finished (with an audible gap), and
+    //   the time that took is used from then on
+    uint32_t duration_ms;
+} BackgroundTrack;
+
+// Called for every command the scheduler sends, with the time it was meant
+//   to be heard and the time it was sent. cue is NULL for background
+//   playlist changes.
+typedef void (*AudioCueTraceHook)(const AudioCue *cue, uint32_t deadline_ms, uint32_t sent_ms);
+
+void audioCuesBegin(AudioSink *sink, uint32_t lead_ms);
+void audioCuesSetTraceHook(AudioCueTraceHook hook);
+
+void audioCuesSetLead(uint32_t lead_ms);
+uint32_t audioCuesLead();
+
+// The first frame of `phase` was shown at at_ms
+void audioCuesPhaseStarted(int phase, uint32_t at_ms);
+
+// The next phase is expected to start at at_ms (AUDIO_TIME_UNKNOWN if it
+//   can't be predicted yet). Can be called repeatedly as the estimate changes.
+void audioCuesPredictNextPhase(uint32_t at_ms);
+
+// Send every command that is due. Call often, the error of the cue timing
+//   is at most the polling interval plus the player's latency jitter.
+void audioCuesPoll(uint32_t now_ms);
+
+// The player reported the background track finished
+void audioCuesTrackFinished(uint32_t now_ms);
+
+// The player lost what it was playing (its card was taken out and put
+//   back): start the background track again if one should be on
+void audioCuesPlayerReset(uint32_t now_ms);
+
+// Stop the background music and forget pending cues
+void audioCuesStop();
+
+// Set the volume outside of the cues, e.g. from the console
+void audioCuesSetVolume(uint8_t level);
+
+// Where in the current background track playback should be, or
+//   AUDIO_TIME_UNKNOWN if nothing is playing
+uint32_t audioCuesPositionMs(uint32_t now_ms);
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef AUDIO_ENGINE_H
+#define AUDIO_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <atomic>
+#include "audio_sink.h"
+#include "ring_buffer.h"
+
+// Software replacement for the DFPlayer: decodes WAV clips from a
+//   filesystem and mixes them into 16-bit mono PCM.
+//
+// Clips use the same layout as the DFPlayer's SD card, under `root`:
+//   <root>/01/001.wav      playFolder(1, 1)
+//   <root>/advert/0001.wav advertise(1)
+// and must be mono at AUDIO_ENGINE_RATE, either 16-bit PCM or IMA ADPCM
+//   (4:1, e.g. ffmpeg -i in.mp3 -ac 1 -ar 16000 -c:a adpcm_ima_wav 001.wav).
+//
+// Commands can come from any one task; render() belongs to the output task.
+
+#define AUDIO_ENGINE_RATE 16000
+
+// Largest ADPCM block we can decode, ffmpeg's default is 1024 at 16 kHz
+#define CLIP_MAX_BLOCK 1024
+#define CLIP_MAX_BLOCK_SAMPLES ((CLIP_MAX_BLOCK - 4) * 2 + 1)
+
+// Streams the samples of one WAV file
+class ClipDecoder
+{
+public:
+    ClipDecoder();
+    ~ClipDecoder();
+
+    bool open(const char *path);
+    void close();
+    bool isOpen() const { return file != NULL; }
+
+    // Decode up to `frames` samples. Fewer means the clip ended.
+    size_t read(int16_t *out, size_t frames);
+
+private:
+    bool parseHeader();
+    bool decodeBlock();
+
+    FILE *file;
+    uint16_t format;
+    uint16_t block_align;
+    uint16_t samples_per_block;
+    uint32_t data_left;
+
+    uint8_t block[CLIP_MAX_BLOCK];
+    int16_t pcm[CLIP_MAX_BLOCK_SAMPLES];
+    size_t pcm_pos;
+    size_t pcm_len;
+};
+
+class AudioEngine : public AudioSink
+{
+public:
+    explicit AudioEngine(const char *root);
+
+    // *** AudioSink, safe to call from the control task *** //
+    void playFolder(uint8_t folder, uint8_t track) override;
+    void advertise(uint16_t track) override;
+    void volume(uint8_t level) override;
+    void stop() override;
+
+    int readVolume() const { return vol.load(); }
+
+    // Fill `out` with the next `frames` samples. Output task only.
+    void render(int16_t *out, size_t frames);
+
+    // true once for every background track that played to the end
+    bool popFinished();
+
+    // Clips that couldn't be opened
+    uint32_t missingClips() const { return missing.load(); }
+
+private:
+    enum CommandType : uint8_t
+    {
+        CMD_PLAY_FOLDER,
+        CMD_ADVERTISE,
+        CMD_STOP,
+    };
+
+    typedef struct Command
+    {
+        uint8_t type;
+        uint8_t folder;
+        uint16_t track;
+    } Command;
+
+    void handle(const Command &cmd);
+    void openClip(ClipDecoder &decoder, const char *path);
+
+    const char *root;
+    RingBuffer<Command, 16> commands;
+    RingBuffer<uint8_t, 8> finished;
+
+    ClipDecoder background;
+    ClipDecoder advert;
+
+    std::atomic<uint8_t> vol;
+    std::atomic<uint32_t> missing;
+};
+
+#endif
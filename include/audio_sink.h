@@ -0,0 +1,26 @@
+#ifndef AUDIO_SINK_H
+#define AUDIO_SINK_H
+
+#include <stdint.h>
+
+// The handful of player commands the cue scheduler needs. On the device
+//   this wraps the DFPlayer, in the simulator it just records what was sent.
+class AudioSink
+{
+public:
+    virtual ~AudioSink() {}
+
+    // Play a track from a numbered folder (01/001.mp3 is folder 1, track 1)
+    virtual void playFolder(uint8_t folder, uint8_t track) = 0;
+
+    // Interrupt the current track with a clip from the ADVERT folder. The
+    //   player resumes the interrupted track by itself afterwards.
+    virtual void advertise(uint16_t track) = 0;
+
+    // 0 .. 30
+    virtual void volume(uint8_t level) = 0;
+
+    virtual void stop() = 0;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include <stdint.h>
+#include "fuel_gauge.h"
+
+// *** Battery *** //
+// The cell through a 100k / 100k divider to this pin, so the pin sees half
+//   its voltage. Must be an ADC1 pin, like the light sensor (see light.h).
+//   Uncomment this once the divider is fitted. Without it, e.g. running off
+//   USB, the unit stays at BATTERY_OK.
+// #define BATTERY_PIN 35
+#define BATTERY_DIVIDER 2
+
+// A first reading below this isn't a cell, it's a pin with nothing on it:
+//   batteryBegin() then reports no battery rather than a flat one
+#define BATTERY_MIN_PLAUSIBLE_MV 2500
+
+// Start sampling in the background. Takes a first reading before returning,
+//   so call it before the eyes and the player come on and it reads the cell
+//   at rest. false if there's no battery, or it reads as if there's none.
+bool batteryBegin();
+
+// BatteryLevel, and what to do about it, from any task
+uint8_t batteryLevel();
+const PowerPolicy *batteryPolicy();
+
+// Percent, and filtered resting voltage (0 if there's no battery)
+uint8_t batterySoc();
+uint16_t batteryMv();
+
+// What the unit is drawing at the moment, see gaugeLoadMa()
+void batterySetLoad(uint16_t load_ma);
+
+#endif
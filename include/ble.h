@@ -0,0 +1,48 @@
+#ifndef BLE_H
+#define BLE_H
+
+#include <stdint.h>
+#include "companion.h"
+
+// Companion service over BLE (NimBLE), see companion.h for what's in it.
+//
+// The BLE host and our task both run on core 0, away from the eye render
+//   loop on core 1. Session state reaches the task through a one slot
+//   mailbox, so the loop never waits on the radio.
+
+#define BLE_DEVICE_NAME "Brush-E Bot"
+#define BLE_SERVICE_UUID "6b1e0001-8f4a-4c1b-9a51-2f1d3c7b5e00"
+#define BLE_STATE_UUID "6b1e0002-8f4a-4c1b-9a51-2f1d3c7b5e00"
+#define BLE_HISTORY_UUID "6b1e0003-8f4a-4c1b-9a51-2f1d3c7b5e00"
+#define BLE_CONTROL_UUID "6b1e0004-8f4a-4c1b-9a51-2f1d3c7b5e00"
+// Firmware updates, write commands and get a status notification back,
+//   see ota_update.h
+#define BLE_OTA_UUID "6b1e0005-8f4a-4c1b-9a51-2f1d3c7b5e00"
+
+// Big enough for COMPANION_MAX_ENTRIES history entries per notification
+#define BLE_MTU 247
+
+// *** Connection parameters *** //
+// Intervals in 1.25 ms units, timeouts in 10 ms units. While sending
+//   history: 30-50 ms, every event. Otherwise 400-500 ms and the unit may
+//   skip 3 events in a row, within what phones accept (2 s between events).
+#define BLE_FAST_MIN_INTERVAL 24
+#define BLE_FAST_MAX_INTERVAL 40
+#define BLE_FAST_LATENCY 0
+#define BLE_SLOW_MIN_INTERVAL 320
+#define BLE_SLOW_MAX_INTERVAL 400
+#define BLE_SLOW_LATENCY 3
+#define BLE_SUPERVISION_TIMEOUT 600
+
+// Advertising interval, 0.625 ms units: 0.5-1 s
+#define BLE_ADV_MIN_INTERVAL 800
+#define BLE_ADV_MAX_INTERVAL 1600
+
+// Start advertising and the companion task. false if the stack didn't
+//   come up, the unit works the same without it.
+bool bleBegin();
+
+// Latest session state for the phone, call every tick. Doesn't block.
+void blePublishState(uint32_t now_ms, uint8_t status);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef BRIGHTNESS_H
+#define BRIGHTNESS_H
+
+#include <stdint.h>
+
+// Eye brightness from ambient light. The light sensor side filters raw ADC
+//   readings and picks a MAX7219 intensity for them; the display side ramps
+//   towards that intensity a step at a time. light.cpp reads the sensor,
+//   and main.cpp hands the ramp's intensity to the MAX7219s.
+
+// MAX7219 intensity steps, the duty cycle is (2 * step + 1) / 32
+#define BRIGHTNESS_STEPS 16
+#define BRIGHTNESS_MIN 0
+#define BRIGHTNESS_MAX 15
+
+// Before the first reading, and when there's no sensor
+#define BRIGHTNESS_DEFAULT 0
+
+// Sensor readings go from 0 (dark) to BRIGHTNESS_LEVEL_MAX (bright)
+#define BRIGHTNESS_LEVEL_MAX 4095
+
+// Smoothing of the readings, as a shift: each one moves the filtered level
+//   1/16 of the way, about 0.8 s to settle at 20 readings a second
+#define BRIGHTNESS_FILTER_SHIFT 4
+
+// Slowest the intensity may change, one step per this many ms
+#define BRIGHTNESS_RAMP_MS 200
+
+// Peak segment current set by the MAX7219's RSET resistor
+#define BRIGHTNESS_SEGMENT_MA 40
+
+// Owned by the sensor task
+typedef struct AmbientFilter
+{
+    uint32_t level_q; // filtered level << BRIGHTNESS_FILTER_SHIFT
+    uint8_t target;   // intensity for the filtered level
+    bool primed;      // had a reading yet
+} AmbientFilter;
+
+// Owned by whoever drives the display
+typedef struct BrightnessRamp
+{
+    uint8_t current;
+    uint32_t last_step_ms;
+} BrightnessRamp;
+
+void ambientFilterInit(AmbientFilter *filter);
+
+// Add a reading. Returns true if the target intensity changed.
+bool ambientFilterPush(AmbientFilter *filter, uint16_t raw);
+
+uint16_t ambientFilterLevel(const AmbientFilter *filter);
+
+// Intensity for a light level, through the gamma table
+uint8_t brightnessForLevel(uint16_t level);
+
+void brightnessRampInit(BrightnessRamp *ramp, uint8_t intensity, uint32_t now_ms);
+
+// Move at most one step towards target. Returns true if current changed
+//   and needs sending to the display.
+bool brightnessRampStep(BrightnessRamp *ramp, uint8_t target, uint32_t now_ms);
+
+// Average LED current in microamps for lit_pixels pixels at an intensity.
+//   Each of the 8 rows is lit 1/8 of the time, at the intensity's duty cycle.
+uint32_t brightnessCurrentUa(uint8_t intensity, uint16_t lit_pixels);
+
+#endif
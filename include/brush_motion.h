@@ -0,0 +1,93 @@
+#ifndef BRUSH_MOTION_H
+#define BRUSH_MOTION_H
+
+#include <stdint.h>
+
+// Streaming, fixed-point brushing detector.
+//   Raw IMU samples go in one at a time; every BRUSH_WINDOW samples the
+//   window's features (motion energy, dominant frequency, orientation) are
+//   computed and the brushing / quadrant classification is updated.
+//   Nothing in here touches hardware, so the same code runs on the ESP32
+//   and in the native simulator against recorded traces.
+
+// *** Sampling *** //
+#define BRUSH_SAMPLE_HZ 100
+#define BRUSH_WINDOW 64 // 0.64 s per window, 1.5625 Hz per frequency bin
+#define BRUSH_NUM_BINS 8 // Goertzel bins k = 1..8 (1.6 Hz .. 12.5 Hz)
+
+// *** Classification thresholds *** //
+// Energy is the mean of |accel - gravity|^2 + |gyro|^2 over a window, >> 8
+#define BRUSH_ENERGY_ON 6000
+#define BRUSH_ENERGY_OFF 3000
+// Brushing strokes are somewhere between ~1.5 and ~8 Hz
+#define BRUSH_BIN_MIN 1
+#define BRUSH_BIN_MAX 5
+// Number of consecutive windows needed to change the brushing state
+#define BRUSH_DEBOUNCE_WINDOWS 2
+// Gravity components smaller than this (LSB, 16384 = 1 g) are too close to
+// horizontal to decide which side of the mouth we're on
+#define BRUSH_ORIENTATION_DEADBAND 4096
+
+// *** Sensor mounting *** //
+// Which accelerometer axis points out of the bristles and which points
+// sideways across the brush head. Change these if the IMU is mounted
+// differently; negate with the _SIGN defines.
+#define BRUSH_AXIS_UP 2
+#define BRUSH_AXIS_UP_SIGN 1
+#define BRUSH_AXIS_SIDE 1
+#define BRUSH_AXIS_SIDE_SIGN 1
+
+// One raw IMU reading, in sensor LSBs (+-2 g and +-250 dps full scale)
+typedef struct ImuSample
+{
+    int16_t ax, ay, az;
+    int16_t gx, gy, gz;
+} ImuSample;
+
+// Mouth quadrants, in the order the session visits them
+enum Quadrant : uint8_t
+{
+    QUADRANT_UPPER_LEFT = 0,
+    QUADRANT_UPPER_RIGHT,
+    QUADRANT_LOWER_LEFT,
+    QUADRANT_LOWER_RIGHT,
+    QUADRANT_UNKNOWN,
+};
+
+// Result of the most recent window
+typedef struct BrushState
+{
+    bool brushing;
+    uint8_t quadrant;
+    uint32_t energy;
+    uint16_t freq_dhz; // dominant frequency in tenths of a Hz, 0 if none
+    int16_t gravity[3]; // low-passed acceleration, sensor LSBs
+    uint32_t windows;   // number of windows processed so far
+} BrushState;
+
+typedef struct BrushMotion
+{
+    // Gravity low-pass filter, Q8
+    int32_t gravity_q8[3];
+
+    // Goertzel state per axis and bin
+    int32_t s1[3][BRUSH_NUM_BINS];
+    int32_t s2[3][BRUSH_NUM_BINS];
+
+    uint32_t energy_acc;
+    uint16_t sample_idx;
+    uint8_t pending_count;
+    bool primed;
+
+    BrushState state;
+} BrushMotion;
+
+void brushMotionInit(BrushMotion *bm);
+
+// Feed one sample. Returns true when a window completed and bm->state was
+// updated.
+bool brushMotionPush(BrushMotion *bm, const ImuSample *sample);
+
+const char *quadrantName(uint8_t quadrant);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+// Time since boot, for everything that measures time. 64-bit microseconds,
+//   so it doesn't wrap in the life of the unit, where millis() wraps after
+//   49.7 days and micros() after 71 minutes. On the device it's esp_timer's
+//   clock. The simulator has a virtual one instead that only moves when
+//   it's told to (sim/sim_clock.h), so days go by in a moment.
+int64_t clockUs();
+
+inline int64_t clockMs()
+{
+    return clockUs() / 1000;
+}
+
+// For the portable modules, which take a 32-bit now_ms and only ever
+//   subtract two of them, so they carry on across its wrap
+inline uint32_t clockMs32()
+{
+    return (uint32_t)clockMs();
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef COMPANION_H
+#define COMPANION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "usage_export.h"
+
+// Companion service for a parent's phone, over BLE on the device and a
+//   mock link in the simulator. Everything here is transport independent:
+//   encoding, batching and deciding when to send. ble.cpp only moves bytes.
+//
+// Three characteristics:
+//   STATE    read/notify  the running session, COMPANION_STATE_SIZE bytes
+//   HISTORY  notify       sessions from the usage log, see below
+//   CONTROL  write        u32 seq to send history from, 0xFFFFFFFF to stop
+//
+// A HISTORY notification is a count byte and then that many
+//   COMPANION_ENTRY_SIZE byte entries, as many as fit in the link's payload
+//   size. A count of 0 means the history is all sent.
+//
+// The radio is the expensive part, so state only goes out when the phase or
+//   status changes or once every COMPANION_STATE_PERIOD_MS, and history is
+//   packed into as few notifications as the MTU allows. The link is asked
+//   for a short connection interval only while there's a lot to move.
+
+#define COMPANION_STATE_SIZE 12
+#define COMPANION_ENTRY_SIZE 16
+#define COMPANION_STATE_PERIOD_MS 1000
+
+// Entries in one HISTORY notification at most, what fits in the largest
+//   MTU we ask for (see ble.h)
+#define COMPANION_MAX_ENTRIES 15
+
+// Most history notifications queued per pump, a few per connection event
+#define COMPANION_BURST 4
+
+#define COMPANION_HISTORY_STOP 0xFFFFFFFF
+
+enum CompanionCharacteristic : uint8_t
+{
+    COMPANION_STATE = 0,
+    COMPANION_HISTORY,
+};
+
+enum CompanionStatus : uint8_t
+{
+    COMPANION_RUNNING = 0,
+    COMPANION_COMPLETED, // same order as UsageStatus from here on
+    COMPANION_STOPPED_SENSOR,
+    COMPANION_STOPPED_BATTERY,
+};
+
+typedef struct CompanionState
+{
+    uint8_t phase;
+    uint8_t phases;
+    uint8_t status;       // CompanionStatus
+    uint32_t elapsed_ms;
+    uint16_t progress;    // permille of the whole session
+    uint16_t brushing_ds; // brushing so far, in tenths of a second
+} CompanionState;
+
+// One session of history, a usage record cut down to what the app shows
+typedef struct CompanionEntry
+{
+    uint32_t seq;
+    uint8_t status; // UsageStatus
+    uint8_t wake_reason;
+    uint16_t duration_ds;
+    uint16_t brushing_ds[USAGE_QUADRANTS];
+} CompanionEntry;
+
+// The radio side. notify() returns false when the stack is out of buffers,
+//   the same notification is tried again on the next pump.
+class CompanionLink
+{
+public:
+    virtual ~CompanionLink() {}
+
+    // Bytes a notification can carry, the ATT MTU less 3
+    virtual uint16_t payloadSize() = 0;
+    virtual bool notify(uint8_t characteristic, const uint8_t *data, size_t len) = 0;
+    // Ask the central for a short connection interval, or a long one with
+    //   slave latency when there's little to send
+    virtual void setFast(bool fast) = 0;
+};
+
+typedef struct Companion
+{
+    CompanionLink *link;
+    UsageScanFunc scan;
+    bool connected;
+
+    CompanionState state;
+    bool state_urgent; // phase or status changed since the last one sent
+    bool state_stale;  // anything changed since the last one sent
+    uint32_t state_sent_ms;
+
+    bool history_active;
+    uint32_t history_next; // seq of the next entry to send
+    bool hold_fast;        // something else needs the short interval
+    bool fast;
+
+    uint32_t notifications;
+    uint32_t entries_sent;
+} Companion;
+
+size_t companionEncodeState(const CompanionState *state, uint8_t *out);
+bool companionDecodeState(const uint8_t *data, size_t len, CompanionState *state);
+size_t companionEncodeEntry(const UsageRecord *record, uint8_t *out);
+bool companionDecodeEntry(const uint8_t *data, size_t len, CompanionEntry *entry);
+
+// The state of the current session, see session.h
+void companionSessionState(CompanionState *state, uint32_t now_ms, uint8_t status);
+
+void companionInit(Companion *companion, CompanionLink *link, UsageScanFunc scan);
+void companionConnected(Companion *companion);
+void companionDisconnected(Companion *companion);
+
+// A new state from the session. Sent on the next pump if the phase or
+//   status changed, otherwise when the period is up.
+void companionSetState(Companion *companion, const CompanionState *state);
+
+// Keep the short connection interval for something other than history,
+//   e.g. a firmware update
+void companionHoldFast(Companion *companion, bool hold);
+
+// The phone wrote to CONTROL
+void companionControl(Companion *companion, const uint8_t *data, size_t len);
+
+// Send whatever is due. Call every few tens of ms while connected.
+void companionPump(Companion *companion, uint32_t now_ms);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "console.h"
+
+// Tunables, loaded once at boot into `config` and read straight from it
+//   everywhere else. Stored in NVS by config_store.cpp and changed from the
+//   serial console, which edits a copy and hands it to the render loop
+//   whole (diag.h), so nothing ever sees a half changed or reset `config`:
+//   config                   list every setting
+//   config <name>            show one
+//   config <name> <value>    change one, for now
+//   config save              keep the changes over sleep and reboots
+//   config reset             back to the defaults, saved
+//
+// The stored form is the schema version and then (id, type, count, values) per
+//   field, so fields can be added or dropped without invalidating what's
+//   already saved: unknown ids are skipped and missing ones keep their
+//   defaults. Bump CONFIG_VERSION when a field's meaning changes and
+//   convert the old value in convertOld() in config.cpp. A version outside
+//   CONFIG_VERSION_OLDEST .. CONFIG_VERSION isn't understood, and is
+//   thrown away for the defaults.
+
+#define CONFIG_VERSION 1
+#define CONFIG_VERSION_OLDEST 1
+#define CONFIG_PHASES 12
+
+// Biggest encoded config, and NVS blobs are small anyway
+#define CONFIG_MAX_ENCODED 256
+
+// Fields are ordered by size so the struct has no padding
+typedef struct Config
+{
+    uint16_t tick_ms;            // display tick
+    uint16_t pressure_threshold; // ADC reading above which the brush is in its holder
+    // How long each phase runs, see session.cpp: 0 to play its animation
+    //   once, otherwise this many seconds, the animation looping as its
+    //   mode says (anims.h). Negative is the same as positive.
+    int16_t phase_seconds[CONFIG_PHASES];
+    uint8_t volume;              // 0..30
+    uint8_t eye_intensity_max;   // 0..15, cap on the light-following brightness
+} Config;
+
+extern Config config;
+
+enum ConfigType : uint8_t
+{
+    CONFIG_U8 = 0,
+    CONFIG_U16,
+    CONFIG_I16,
+};
+
+typedef struct ConfigField
+{
+    uint8_t id; // never reused, it's what's stored
+    const char *name;
+    uint8_t type;
+    uint8_t count;
+    uint16_t offset;
+    int32_t min;
+    int32_t max;
+    int32_t def;
+    const char *help;
+} ConfigField;
+
+extern const ConfigField CONFIG_FIELDS[];
+extern const size_t CONFIG_FIELD_COUNT;
+
+// Every field at its default
+void configDefaults(Config *cfg);
+
+size_t configEncode(const Config *cfg, uint8_t *out, size_t max);
+
+// Starts from the defaults and takes every known field that's in range.
+//   false if the data is damaged, cfg then has the defaults.
+bool configDecode(const uint8_t *data, size_t len, Config *cfg);
+
+enum ConfigAction : uint8_t
+{
+    CONFIG_NONE = 0,
+    CONFIG_CHANGED, // in RAM only
+    CONFIG_SAVE,    // the caller should store cfg
+};
+
+// The "config" console command, on cfg rather than `config`. Returns what
+//   the caller should do next.
+uint8_t configCommand(int argc, char **argv, Config *cfg, ConsoleOut *out);
+
+#endif
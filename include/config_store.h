@@ -0,0 +1,18 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include "config.h"
+
+// *** NVS *** //
+#define CONFIG_NVS_NAMESPACE "config"
+#define CONFIG_NVS_KEY "settings"
+
+// Read the saved settings into config, once at boot before anything uses
+//   them. false if there weren't any (or they were damaged), config then
+//   has the defaults.
+bool configLoad();
+
+// Store cfg, to be loaded on the next boot
+bool configSave(const Config *cfg);
+
+#endif
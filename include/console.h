@@ -0,0 +1,68 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Text command shell for the serial port. Nothing is allocated: bytes are
+//   collected into a fixed line buffer, the line is split into words in
+//   place and the reply goes into a fixed buffer the caller prints.
+//
+// A command is a word and its arguments separated by spaces, e.g.
+//   phase 5
+//   config volume 20
+// "help" lists the commands in the table.
+
+#define CONSOLE_LINE_MAX 80
+#define CONSOLE_MAX_ARGS 8
+#define CONSOLE_REPLY_MAX 1024
+
+typedef struct ConsoleLine
+{
+    char buf[CONSOLE_LINE_MAX];
+    uint8_t len;
+    bool discard; // the line had binary or too many bytes, drop it
+    uint8_t frame;      // where we are in an export frame being skipped
+    uint16_t frame_len;
+    uint16_t frame_left;
+} ConsoleLine;
+
+void consoleLineInit(ConsoleLine *line);
+
+// Add a received byte. true when it finished a line, which is then in
+//   line->buf until the next push. Export frames (frame.h) on the same
+//   port are skipped whole by their length, any other byte that isn't
+//   printable text throws the line away.
+bool consoleLinePush(ConsoleLine *line, uint8_t c);
+
+typedef struct ConsoleOut
+{
+    char *buf;
+    size_t size;
+    size_t len;
+} ConsoleOut;
+
+void consoleOutInit(ConsoleOut *out, char *buf, size_t size);
+
+// Append to the reply, cut short if it doesn't fit
+void consolePrintf(ConsoleOut *out, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// argv[0] is the command's own name
+typedef void (*ConsoleHandler)(int argc, char **argv, ConsoleOut *out);
+
+typedef struct ConsoleCommand
+{
+    const char *name;
+    const char *args;
+    const char *help;
+    ConsoleHandler run;
+} ConsoleCommand;
+
+// Split the line in place and run its command. false if the line names no
+//   command in the table (an empty line is fine).
+bool consoleRun(const ConsoleCommand *commands, size_t count, char *line, ConsoleOut *out);
+
+// A whole decimal number in min..max
+bool consoleParseInt(const char *s, long min, long max, long *value);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef COUNTDOWN_H
+#define COUNTDOWN_H
+
+#include <stdint.h>
+
+// The countdown between brushing phases, drawn from the 4x7 font instead of
+//   stored: each number from 10 down to 1 shows as number, ring, number,
+//   ring, with the gaps in the ring stepping round every other ring.
+#define COUNTDOWN_FRAMES 40
+
+// Render frame 0..COUNTDOWN_FRAMES - 1 into 8 rows
+void countdownFrame(int frame, uint8_t *rows);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The usual CRC-32 (zlib, PNG, Ethernet). Start from 0 and feed the data in
+//   as many pieces as needed.
+uint32_t crc32Update(uint32_t crc, const void *data, size_t len);
+
+static inline uint32_t crc32(const void *data, size_t len)
+{
+    return crc32Update(0, data, len);
+}
+
+#endif
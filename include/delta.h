@@ -0,0 +1,98 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary delta patches, turning one firmware image into the next.
+//
+// A patch is a DeltaHeader and then ops, each an op byte followed by
+//   unsigned LEB128 varints:
+//   COPY   src len             len bytes of the source from src
+//   ADD    src len runs...     len bytes of the source from src, plus a delta
+//                              per byte: runs of [zeros] [count] [count
+//                              delta bytes], until len bytes are covered
+//   INSERT len bytes...        len new bytes
+// ADD is for code that moved: most bytes are the same at an offset and a
+//   few (addresses) differ, so the deltas are mostly zero runs.
+//
+// The applier is fed the patch in pieces of any size and writes the new
+//   image straight out, reading the source as it goes, so nothing the size
+//   of an image is ever held in RAM. The source and the result are both
+//   checked against the CRC-32s in the header.
+
+#define DELTA_MAGIC "BRDP"
+#define DELTA_VERSION 1
+#define DELTA_HEADER_SIZE 24
+
+enum DeltaOp : uint8_t
+{
+    DELTA_OP_COPY = 1,
+    DELTA_OP_ADD,
+    DELTA_OP_INSERT,
+};
+
+enum DeltaResult : uint8_t
+{
+    DELTA_MORE = 0,     // fine so far, keep pushing
+    DELTA_DONE,         // the whole target is written and its CRC matches
+    DELTA_BAD_HEADER,
+    DELTA_WRONG_SOURCE, // the patch is for a different image than this one
+    DELTA_BAD_OP,       // corrupt patch
+    DELTA_IO,           // reading the source or writing the target failed
+    DELTA_BAD_TARGET,   // the result's CRC doesn't match
+};
+
+typedef struct DeltaHeader
+{
+    uint32_t source_size;
+    uint32_t source_crc;
+    uint32_t target_size;
+    uint32_t target_crc;
+} DeltaHeader;
+
+typedef bool (*DeltaReadFunc)(uint32_t offset, void *buf, size_t len, void *ctx);
+typedef bool (*DeltaWriteFunc)(const uint8_t *data, size_t len, void *ctx);
+
+// Bytes buffered before each write, and read from the source at a time
+#define DELTA_CHUNK 256
+
+typedef struct DeltaApplier
+{
+    DeltaReadFunc read;
+    DeltaWriteFunc write;
+    void *ctx;
+
+    uint8_t header_buf[DELTA_HEADER_SIZE];
+    uint8_t header_len;
+    DeltaHeader header;
+
+    uint8_t state;
+    uint8_t op;
+    uint8_t field; // varint being read
+    uint32_t fields[2];
+    uint8_t shift;
+
+    uint32_t src;  // next source byte for the op
+    uint32_t left; // bytes of the op still to produce
+    uint32_t run;  // of delta bytes, in ADD
+
+    uint32_t written;
+    uint32_t crc;
+    uint8_t result;
+
+    uint8_t src_buf[DELTA_CHUNK];
+    uint8_t out[DELTA_CHUNK];
+    uint16_t out_len;
+} DeltaApplier;
+
+size_t deltaEncodeHeader(const DeltaHeader *header, uint8_t *out);
+bool deltaDecodeHeader(const uint8_t *data, size_t len, DeltaHeader *header);
+
+// read gets the source image, write takes the target in order
+void deltaApplierInit(DeltaApplier *applier, DeltaReadFunc read, DeltaWriteFunc write, void *ctx);
+
+// Once something other than DELTA_MORE comes back, it keeps coming back
+uint8_t deltaApplierPush(DeltaApplier *applier, const uint8_t *data, size_t len);
+
+#endif
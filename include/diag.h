@@ -0,0 +1,137 @@
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+#include "console.h"
+#include "latency_model.h"
+
+// Live diagnostics and tuning between the render loop and the serial
+//   console, which run in different tasks. Nothing the render loop does
+//   here can wait on the console:
+//   - it publishes a status snapshot each tick (a seqlock, see seqlock.h)
+//   - it adds events to a trace the console copies on demand (trace_log.h)
+//   - it picks up the console's requests from a lock-free queue
+//     (ring_buffer.h) at the start of each tick
+// The serial port is shell.cpp's, which runs the commands and prints
+//   their replies.
+
+// Entries kept in the trace
+#define DIAG_TRACE_SIZE 64
+
+// Tick timing histogram, bucket i counts times under 2^i microseconds
+#define DIAG_BUCKETS 20
+
+typedef struct TimingStats
+{
+    uint32_t count;
+    uint32_t total_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint16_t buckets[DIAG_BUCKETS];
+} TimingStats;
+
+void timingReset(TimingStats *stats);
+void timingAdd(TimingStats *stats, uint32_t us);
+
+// Upper bound of the bucket the pct'th percentile falls in
+uint32_t timingPercentile(const TimingStats *stats, uint8_t pct);
+
+// What the render loop is doing, filled in by it every tick
+typedef struct DiagStatus
+{
+    uint32_t now_ms;
+    int8_t phase;
+    uint8_t frame;
+    uint8_t frames;
+    uint8_t intensity;
+    int8_t intensity_override; // -1 following the light
+    uint8_t quadrant;
+    bool brushing;
+    bool paused;
+    uint16_t light;
+    uint16_t cpu_load_permille; // IMU task
+    uint16_t battery_mv;        // 0 if there's no battery
+    uint8_t battery_soc;        // percent
+    uint8_t battery_level;      // BatteryLevel
+    uint32_t effective_ms;
+    uint32_t quota_ms;
+    TimingStats work; // time spent in each tick
+    TimingStats late; // how far past its deadline each frame went out, in us
+} DiagStatus;
+
+enum DiagTraceKind : uint8_t
+{
+    DIAG_TRACE_PHASE = 0,  // arg = phase
+    DIAG_TRACE_LATE,       // value = ms behind
+    DIAG_TRACE_INTENSITY,  // value = new intensity
+    DIAG_TRACE_ANIM,       // arg = NAMED_ANIMS index
+    DIAG_TRACE_REQUEST,    // arg = DiagRequestType, value = its value
+    DIAG_TRACE_END,        // arg = UsageStatus
+    DIAG_TRACE_STALL,      // arg = HealthTask that missed its heartbeats
+    DIAG_TRACE_PERIPHERAL, // arg = HealthPeripheral, value = 1 up, 0 down
+    DIAG_TRACE_BATTERY,    // arg = BatteryLevel, value = percent
+    DIAG_TRACE_HEAP,       // value = bytes taken from the heap after setup(), see heap_guard.h
+};
+
+typedef struct DiagTrace
+{
+    uint32_t at_ms;
+    uint8_t kind;
+    uint8_t arg;
+    int16_t value;
+} DiagTrace;
+
+enum DiagRequestType : uint8_t
+{
+    DIAG_REQ_PHASE = 0,  // value = phase to jump to
+    DIAG_REQ_ANIM,       // value = NAMED_ANIMS index to play once
+    DIAG_REQ_INTENSITY,  // value = 0..15, -1 to follow the light again
+    DIAG_REQ_VOLUME,     // config.volume changed, send it to the player
+    DIAG_REQ_CONFIG,     // the console changed the settings, see diagTakeConfig()
+};
+
+typedef struct DiagRequest
+{
+    uint8_t type;
+    int16_t value;
+} DiagRequest;
+
+// *** Render loop side *** //
+
+// A frame went out late_us after its deadline, preparing one took work_us
+void diagTickTimes(uint32_t late_us, uint32_t work_us);
+
+// From any task: the supervisor and the tasks owning the peripherals
+//   trace too
+void diagTrace(uint32_t now_ms, uint8_t kind, uint8_t arg, int16_t value);
+
+// The tick's status, the timing statistics are filled in here
+void diagPublish(DiagStatus *status);
+
+// The next request from the console, false if there's none
+bool diagPollRequest(DiagRequest *request);
+
+// On DIAG_REQ_CONFIG: the console's settings, to be copied over `config`
+//   in one go. false if the console was changing them again, the next
+//   DIAG_REQ_CONFIG brings them.
+bool diagTakeConfig(Config *cfg);
+
+// *** Console side *** //
+
+extern const ConsoleCommand DIAG_COMMANDS[];
+extern const size_t DIAG_COMMAND_COUNT;
+
+// Where the "health" command gets its numbers, see supervisor.h
+struct Health;
+void diagSetHealth(const struct Health *health);
+
+// Where "stats" gets the audio player's latency statistics, see audio.h
+void diagSetLatencySource(LatencyModel (*latency)());
+
+// Stores the settings for "config save" and "config reset", in NVS on the
+//   device. Without one they only change RAM.
+void diagSetSaveHook(bool (*save)(const Config *cfg));
+
+#endif
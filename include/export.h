@@ -0,0 +1,23 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Answers usage log export requests from a host on the USB serial port,
+//   see usage_export.h and tools/usage_stats.cpp. The serial console task
+//   (shell.h) reads the port and passes everything it gets on.
+
+// How long to stay awake after an export, in case the host asks again
+#define EXPORT_LINGER_MS 5000
+
+void exportBegin();
+
+// Bytes from the serial port, answers any complete request in them
+void exportReceive(const uint8_t *data, size_t len);
+
+// true while an export is running or one finished in the last
+//   EXPORT_LINGER_MS, sleep should wait for it
+bool exportActive();
+
+#endif
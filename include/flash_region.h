@@ -0,0 +1,23 @@
+#ifndef FLASH_REGION_H
+#define FLASH_REGION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// A piece of NOR flash: erasing a sector sets every byte to 0xFF, writing
+//   can only clear bits. On the device this is a partition, in the
+//   simulator a block of memory that can also fake a power cut.
+class FlashRegion
+{
+public:
+    virtual ~FlashRegion() {}
+
+    virtual uint32_t size() const = 0;
+    virtual uint32_t sectorSize() const = 0;
+
+    virtual bool read(uint32_t offset, void *buf, size_t len) = 0;
+    virtual bool write(uint32_t offset, const void *buf, size_t len) = 0;
+    virtual bool eraseSector(uint32_t sector) = 0;
+};
+
+#endif
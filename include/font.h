@@ -0,0 +1,38 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <stdint.h>
+
+// Bitmap fonts for the LED matrices. Each glyph is packed into one
+//   uint32_t, row by row, so drawing a row of a glyph is a single shift:
+//   bits 28..31   width of this glyph in pixels (0 = not in the font)
+//   row r         bits [r * width, r * width + width) of the font's width,
+//                 leftmost pixel in the highest bit
+// Narrower glyphs are left-aligned within the font's width.
+typedef struct Font
+{
+    uint8_t width;   // widest glyph, at most 8
+    uint8_t height;  // rows, at most 8
+    uint8_t spacing; // blank columns after each glyph
+    char first;      // glyphs cover first..last
+    char last;
+    const uint32_t *glyphs;
+} Font;
+
+#define FONT_GLYPH_WIDTH(g) ((uint8_t)((g) >> 28))
+
+// Digits, capitals (lowercase is folded) and a little punctuation
+extern const Font FONT_3X5;
+// Digits only, tall enough to fill an eye
+extern const Font FONT_4X7;
+
+// 0 if the font has no glyph for c
+uint32_t fontGlyph(const Font *font, char c);
+
+// Bits of one row of a glyph, leftmost pixel in bit font->width - 1
+static inline uint8_t fontGlyphRow(const Font *font, uint32_t glyph, uint8_t row)
+{
+    return (glyph >> (row * font->width)) & ((1 << font->width) - 1);
+}
+
+#endif
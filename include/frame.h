@@ -0,0 +1,51 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary frames for talking to a host over a byte stream:
+//   0xB5 0x62   sync
+//   type        u8
+//   length      u16, little endian
+//   payload     length bytes
+//   crc         u32 little endian, CRC-32 of type, length and payload
+// The decoder hunts for the sync bytes, so text printed on the same serial
+//   port between frames is skipped over.
+
+#define FRAME_SYNC0 0xB5
+#define FRAME_SYNC1 0x62
+#define FRAME_HEADER_SIZE 5
+#define FRAME_CRC_SIZE 4
+#define FRAME_MAX_PAYLOAD 1024
+#define FRAME_MAX_SIZE (FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE)
+
+enum FrameResult : uint8_t
+{
+    FRAME_PENDING = 0, // need more bytes
+    FRAME_READY,       // a whole frame with a good CRC is in the decoder
+    FRAME_BAD,         // a frame was dropped, bad CRC or length
+};
+
+typedef struct FrameDecoder
+{
+    uint8_t state;
+    uint8_t type;
+    uint16_t len;
+    uint16_t pos;
+    uint32_t crc;
+    uint32_t bad; // frames dropped so far
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+} FrameDecoder;
+
+// Write a frame to out, which needs FRAME_HEADER_SIZE + len + FRAME_CRC_SIZE
+//   bytes. Returns the frame's size, 0 if the payload is too long.
+size_t frameEncode(uint8_t type, const void *payload, uint16_t len, uint8_t *out);
+
+void frameDecoderInit(FrameDecoder *decoder);
+
+// Feed one byte. After FRAME_READY the frame is in type, len and payload
+//   until the next byte is pushed.
+uint8_t frameDecoderPush(FrameDecoder *decoder, uint8_t byte);
+
+#endif
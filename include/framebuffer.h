@@ -0,0 +1,87 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Pixels for a chain of DEVICES 8x8 matrices laid out side by side, so
+//   the whole thing is DEVICES * 8 pixels wide and 8 tall. Device 0 is the
+//   leftmost and the first one after the ESP32 on the chain. Rows are stored
+//   the way the MAX7219 wants them: one byte per device per row, with the
+//   leftmost column in the top bit.
+//
+// Rows are only marked dirty when their contents actually change, so
+//   redrawing an identical frame costs nothing on the wire.
+template <uint8_t DEVICES>
+class Framebuffer
+{
+    static_assert(DEVICES > 0 && DEVICES <= 16, "Framebuffer supports 1 to 16 devices");
+
+public:
+    static const uint8_t NUM_DEVICES = DEVICES;
+    static const uint16_t WIDTH = DEVICES * 8;
+    static const uint8_t HEIGHT = 8;
+
+    Framebuffer() { clear(); }
+
+    void clear()
+    {
+        for (uint8_t r = 0; r < HEIGHT; r++)
+        {
+            for (uint8_t d = 0; d < DEVICES; d++)
+            {
+                setRow(d, r, 0);
+            }
+        }
+    }
+
+    void setRow(uint8_t device, uint8_t row, uint8_t value)
+    {
+        if (rows[row][device] != value)
+        {
+            rows[row][device] = value;
+            dirty |= 1 << row;
+        }
+    }
+
+    uint8_t getRow(uint8_t device, uint8_t row) const { return rows[row][device]; }
+
+    // Copy one 8x8 bitmap (8 row bytes, like the frames in anims.h)
+    void setDevice(uint8_t device, const uint8_t *bitmap)
+    {
+        for (uint8_t r = 0; r < HEIGHT; r++)
+        {
+            setRow(device, r, bitmap[r]);
+        }
+    }
+
+    void setPixel(uint16_t x, uint8_t y, bool on)
+    {
+        if (x >= WIDTH || y >= HEIGHT)
+        {
+            return;
+        }
+        uint8_t mask = 0x80 >> (x & 7);
+        uint8_t value = rows[y][x >> 3];
+        setRow(x >> 3, y, on ? (value | mask) : (value & ~mask));
+    }
+
+    bool getPixel(uint16_t x, uint8_t y) const
+    {
+        return x < WIDTH && y < HEIGHT && (rows[y][x >> 3] & (0x80 >> (x & 7)));
+    }
+
+    // The display driver takes the dirty rows and clears the flags
+    uint8_t dirtyRows() const { return dirty; }
+    void markClean() { dirty = 0; }
+    void markAllDirty() { dirty = 0xFF; }
+
+    // All of a row's bytes, device 0 first
+    const uint8_t *rowData(uint8_t row) const { return rows[row]; }
+
+private:
+    uint8_t rows[HEIGHT][DEVICES] = {};
+    uint8_t dirty = 0xFF;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef FUEL_GAUGE_H
+#define FUEL_GAUGE_H
+
+#include <stdint.h>
+
+// State of charge of the single Li-ion cell, and what the unit cuts back
+//   on as it runs down. The battery side measures the cell's voltage and
+//   estimates how much current the unit is drawing; the gauge adds back
+//   what the cell's internal resistance drops under that load, filters it,
+//   and looks the charge up on the cell's resting voltage curve.
+//   battery.cpp reads the cell through its divider and pushes it here.
+
+// Resting cell voltage at 0, 10, .. 100% charge, a typical LiCoO2 cell
+//   discharged at a few hundred mA
+#define GAUGE_CURVE_POINTS 11
+extern const uint16_t GAUGE_OCV_MV[GAUGE_CURVE_POINTS];
+
+// Cell, protection circuit and wiring
+#define GAUGE_RESISTANCE_MOHM 200
+
+// Smoothing of the compensated voltage, as a shift: each reading moves it
+//   1/8 of the way, about 8 s to settle at a reading a second
+#define GAUGE_FILTER_SHIFT 3
+
+// The charge only goes up again once the estimate is this far above it,
+//   so the gauge doesn't creep up while the cell recovers after a load
+#define GAUGE_RISE_PERCENT 5
+
+// Below each of these the unit saves more power, and goes back once the
+//   charge is GAUGE_HYSTERESIS_PERCENT above it again
+enum BatteryLevel : uint8_t
+{
+    BATTERY_OK = 0,
+    BATTERY_SAVE,     // dimmer, slower CPU
+    BATTERY_LOW,      // dimmest, slowest, shows the low battery glyph
+    BATTERY_CRITICAL, // no sessions, they could stop halfway
+    BATTERY_LEVELS,
+};
+
+#define GAUGE_SAVE_PERCENT 30
+#define GAUGE_LOW_PERCENT 15
+#define GAUGE_CRITICAL_PERCENT 5
+#define GAUGE_HYSTERESIS_PERCENT 5
+
+typedef struct FuelGauge
+{
+    uint32_t mv_q; // filtered resting voltage << GAUGE_FILTER_SHIFT
+    uint8_t soc;   // percent
+    uint8_t level; // BatteryLevel
+    bool primed;   // had a reading yet
+} FuelGauge;
+
+void fuelGaugeInit(FuelGauge *gauge);
+
+// A reading of the cell's voltage while the unit draws load_ma. Returns
+//   true if the level changed.
+bool fuelGaugePush(FuelGauge *gauge, uint16_t cell_mv, uint16_t load_ma);
+
+// Filtered resting voltage
+uint16_t fuelGaugeMv(const FuelGauge *gauge);
+
+// Charge for a resting voltage, along GAUGE_OCV_MV
+uint8_t gaugeSocForMv(uint16_t mv);
+
+// What the unit does at each level
+typedef struct PowerPolicy
+{
+    uint8_t intensity_max; // brightest the eyes get
+    uint16_t cpu_mhz;
+    // A phase with no brushing gives up after this many times its length,
+    //   see phase_timer.h
+    uint8_t phase_max_multiplier;
+    bool glyph;   // show the low battery glyph
+    bool session; // run a session at all
+} PowerPolicy;
+
+extern const PowerPolicy POWER_POLICIES[BATTERY_LEVELS];
+
+// Rough draw of the unit in mA, for the compensation: the CPU at a clock,
+//   the LEDs (brightnessCurrentUa()) and the audio output if it's on
+#define GAUGE_BASE_MA 20
+#define GAUGE_CPU_UA_PER_MHZ 180
+#define GAUGE_AUDIO_MA 60
+
+uint16_t gaugeLoadMa(uint16_t cpu_mhz, uint32_t led_ua, bool audio);
+
+#endif
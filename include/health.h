@@ -0,0 +1,112 @@
+#ifndef HEALTH_H
+#define HEALTH_H
+
+#include <stdint.h>
+#include "diag.h"
+#include "usage_log.h"
+
+// Task and peripheral health, for the supervisor (supervisor.h).
+//
+// Each watched task calls healthBeat() once per loop. A task that hasn't
+//   beaten for HEALTH_STALL_PERIODS of its period is counted as stalled
+//   (the task watchdog resets the chip if it stays stuck). Peripherals that
+//   fail are retried by the task that owns them, less and less often, and
+//   every failure and recovery is counted. At the end of a wake the counts
+//   go into the usage log if anything happened. The times come from the
+//   caller, supervisor.cpp on the device, which also feeds the task
+//   watchdog and writes the record.
+
+enum HealthTask : uint8_t
+{
+    HEALTH_TASK_RENDER = 0,
+    HEALTH_TASK_AUDIO,
+    HEALTH_TASK_IMU,
+    HEALTH_TASK_LIGHT,
+    HEALTH_TASK_I2S, // feeds the I2S output, esp32_i2s only
+    HEALTH_TASKS,
+};
+
+enum HealthPeripheral : uint8_t
+{
+    HEALTH_PLAYER = 0, // the audio output
+    HEALTH_IMU,
+    HEALTH_PERIPHERALS,
+};
+
+// The health record counts the I2S feeder's stalls as the audio task's
+static_assert(HEALTH_TASK_I2S == USAGE_HEALTH_TASKS, "health record has a slot per task but the I2S feeder");
+static_assert(HEALTH_PERIPHERALS == USAGE_HEALTH_PERIPHERALS, "health record has a slot per peripheral");
+
+// A task is stalled after missing this many of its heartbeats
+#define HEALTH_STALL_PERIODS 4
+
+// Retry backoff for failed peripherals: the first retry after
+//   HEALTH_RETRY_MIN_MS, doubling each time up to HEALTH_RETRY_MAX_MS
+#define HEALTH_RETRY_MIN_MS 1000
+#define HEALTH_RETRY_MAX_MS 60000
+
+typedef struct Backoff
+{
+    uint32_t next_ms;
+    uint32_t delay_ms;
+} Backoff;
+
+// Due straight away
+void backoffInit(Backoff *backoff, uint32_t now_ms);
+bool backoffDue(const Backoff *backoff, uint32_t now_ms);
+// Try again later, twice as long as last time
+void backoffFailed(Backoff *backoff, uint32_t now_ms);
+
+typedef struct TaskHealth
+{
+    uint32_t period_ms; // 0 if not watched
+    uint32_t last_ms;
+    uint32_t beats;
+    uint32_t max_gap_ms;
+    uint16_t stalls;
+    bool stalled;
+    TimingStats gaps; // between heartbeats, in us
+} TaskHealth;
+
+typedef struct PeripheralHealth
+{
+    bool up;
+    uint16_t failures;
+    uint16_t recoveries;
+    Backoff retry;
+} PeripheralHealth;
+
+typedef struct Health
+{
+    uint8_t reset_reason; // UsageReset
+    TaskHealth tasks[HEALTH_TASKS];
+    PeripheralHealth peripherals[HEALTH_PERIPHERALS];
+} Health;
+
+void healthInit(Health *health, uint8_t reset_reason);
+
+// Expect a heartbeat from the task every period_ms from now on
+void healthWatch(Health *health, uint8_t task, uint32_t period_ms, uint32_t now_ms);
+
+// From the task itself
+void healthBeat(Health *health, uint8_t task, uint32_t now_ms);
+
+// Look for stalled tasks. Returns a bit per task that stalled since the
+//   last check.
+uint8_t healthCheck(Health *health, uint32_t now_ms);
+
+// From the task that owns the peripheral, after trying it. A failure
+//   schedules the next retry.
+void healthPeripheralUp(Health *health, uint8_t peripheral);
+void healthPeripheralFailed(Health *health, uint8_t peripheral, uint32_t now_ms);
+
+// Time to try a peripheral that's down again
+bool healthRetryDue(const Health *health, uint8_t peripheral, uint32_t now_ms);
+
+// Anything worth a usage log record: a crash, a stall or a peripheral
+//   that failed
+bool healthNoteworthy(const Health *health);
+
+void healthRecord(const Health *health, uint32_t uptime_ms, UsageHealth *out);
+
+#endif
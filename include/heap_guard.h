@@ -0,0 +1,49 @@
+#ifndef HEAP_GUARD_H
+#define HEAP_GUARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Catches the heap being used once the unit is running. What the firmware
+//   keeps is static (see static_task.h) or made during setup(); something
+//   that allocates and frees on every tick or session after that chips at
+//   the heap, and months between reboots leave no block big enough for
+//   whatever needs one. Every malloc(), calloc() and realloc() is reported
+//   here: on the device they're linked through heap_wrap.cpp with
+//   -Wl,--wrap, the simulator replaces them in sim/sim_heap.cpp. Once
+//   armed at the end of setup() each one is counted, the latest kept for
+//   the supervisor to log.
+
+typedef struct HeapGuardStats
+{
+    uint32_t unexpected; // since armed
+    uint32_t unexpected_bytes;
+    uint32_t expected;   // inside heapGuardExpect()
+    uint32_t last_size;  // of the last unexpected one ..
+    uintptr_t last_from; // .. and where it was called from
+} HeapGuardStats;
+
+// From the end of setup()
+void heapGuardArm();
+bool heapGuardArmed();
+
+// Most tasks inside heapGuardExpect() at the same time. A task past
+//   that has its allocations counted as unexpected.
+#define HEAP_GUARD_TASKS 4
+
+// Around a call that allocates and can't be helped, e.g. opening a file
+//   through the filesystem or writing NVS. Nests. Only the calling task's
+//   allocations are let through, the others carry on being counted.
+void heapGuardExpect(bool expecting);
+
+// From the allocator. Mustn't allocate, or block.
+void heapGuardNote(size_t size, uintptr_t from);
+
+// The task that's running, as anything unique to it. Provided next to
+//   the allocator: heap_wrap.cpp on the device, sim/sim_heap.cpp in the
+//   simulator.
+uintptr_t heapGuardTask();
+
+HeapGuardStats heapGuardStats();
+
+#endif
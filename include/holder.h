@@ -0,0 +1,39 @@
+#ifndef HOLDER_H
+#define HOLDER_H
+
+#include <stdint.h>
+
+// Whether the brush is in its holder, from the pressure sensor's ADC
+//   readings, while the unit sleeps. The ULP coprocessor takes a reading
+//   every HOLDER_SAMPLE_MS and wakes the main CPU once the brush has been
+//   lifted out for HOLDER_CONFIRM_SAMPLES readings in a row, so a knock or
+//   a glitch on the line doesn't start a session. The program in
+//   holder_ulp.cpp takes the same steps as holderWatchSample(), and
+//   holderUlpArm() sets up the ADC and loads it before the unit sleeps.
+//
+// A reading above the threshold is the brush in the holder, as for the
+//   end of a session in main.cpp. It has to read below the threshold by
+//   HOLDER_HYSTERESIS to count as lifted.
+
+#define HOLDER_SAMPLE_MS 100
+#define HOLDER_CONFIRM_SAMPLES 3
+#define HOLDER_HYSTERESIS 300
+
+typedef struct HolderWatch
+{
+    uint16_t rest;    // in the holder above this
+    uint16_t lift;    // lifted below this
+    uint16_t confirm; // lifted readings in a row that wake
+    // A brush only counts as lifted once it's been seen in the holder, so
+    //   a session that ended with the brush still out doesn't wake the
+    //   unit straight back up
+    bool armed;
+    uint16_t count; // lifted readings in a row so far
+} HolderWatch;
+
+void holderWatchInit(HolderWatch *watch, uint16_t threshold);
+
+// A reading. Returns true when the unit should wake.
+bool holderWatchSample(HolderWatch *watch, uint16_t reading);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HOLDER_ULP_H
+#define HOLDER_ULP_H
+
+#include <stdint.h>
+
+// Watches the brush holder while the unit sleeps, on the ULP coprocessor,
+//   and wakes the unit when the brush is lifted out. See holder.h for how
+//   a lift is told from a knock.
+
+// The pressure sensor, on a pin the ULP can read
+#define HOLDER_PIN GPIO_NUM_26
+#define HOLDER_ADC2_CHANNEL 9 // HOLDER_PIN on SAR ADC2
+
+// Load the program, hand it the sensor's ADC and enable the ULP wakeup,
+//   just before esp_deep_sleep_start(). Readings above threshold are the
+//   brush in the holder. false if the program doesn't fit or load.
+bool holderUlpArm(uint16_t threshold);
+
+#endif
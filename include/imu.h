@@ -0,0 +1,30 @@
+#ifndef IMU_H
+#define IMU_H
+
+#include <stdint.h>
+#include "brush_motion.h"
+
+// *** IMU (MPU-6050) I2C pins *** //
+#define IMU_SDA 21
+#define IMU_SCL 22
+#define IMU_I2C_HZ 400000
+
+// Uncomment this to print every raw sample as a CSV trace line
+//   (t_ms,ax,ay,az,gx,gy,gz) that the native simulator can replay
+// #define DEBUG_IMU
+
+// Start the background sampling task. Returns false if no IMU answered,
+//   in which case imuGetState() keeps reporting "not brushing". One that
+//   stops answering later is set up again with backoff, see supervisor.h.
+bool imuBegin();
+
+// Latest classification, safe to call from any task
+BrushState imuGetState();
+
+// Samples lost because the processing side fell behind
+uint32_t imuDroppedSamples();
+
+// Time spent sampling and processing, in thousandths of one core
+uint16_t imuCpuLoadPermille();
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef LATENCY_MODEL_H
+#define LATENCY_MODEL_H
+
+#include <stdint.h>
+
+// Latency statistics for the audio player, and the lead time derived from
+//   them. Kept as a plain struct so it can be saved to flash as a blob.
+
+// Histogram buckets of LATENCY_BUCKET_MS each, the last one catches
+//   everything above
+#define LATENCY_BUCKET_MS 5
+#define LATENCY_BUCKETS 48
+
+// Percentile of the onset latency used as the lead time
+#define LATENCY_LEAD_PERCENTILE 90
+
+// Used in place of the onset latency before it has been measured:
+//   ACK latency plus a guess at how long the player takes to open and
+//   start decoding a file
+#define LATENCY_DECODE_ESTIMATE_MS 30
+
+// Onset samples needed before they're trusted over the estimate
+#define LATENCY_MIN_ONSET_SAMPLES 4
+
+// Bump when the layout of LatencyModel changes, so stale blobs are ignored
+#define LATENCY_MODEL_VERSION 1
+
+typedef struct LatencyStats
+{
+    uint32_t count;
+    uint32_t sum_ms;
+    uint16_t min_ms;
+    uint16_t max_ms;
+    // Halved whenever one fills up, which also makes old samples count less
+    uint16_t buckets[LATENCY_BUCKETS];
+} LatencyStats;
+
+typedef struct LatencyModel
+{
+    uint16_t version;
+    // Query sent -> reply received (readVolume)
+    LatencyStats rtt;
+    // Command sent -> ACK received
+    LatencyStats ack;
+    // Play command sent -> BUSY pin goes low, i.e. sound starts
+    LatencyStats onset;
+    // How long issuing one command blocked the audio task
+    LatencyStats block;
+} LatencyModel;
+
+void latencyStatsInit(LatencyStats *stats);
+void latencyStatsAdd(LatencyStats *stats, uint32_t ms);
+uint32_t latencyStatsMean(const LatencyStats *stats);
+// Upper edge of the bucket containing the given percentile (0..100)
+uint32_t latencyStatsPercentile(const LatencyStats *stats, uint8_t percentile);
+
+void latencyModelInit(LatencyModel *model);
+
+// false if the blob is from a different firmware layout
+bool latencyModelValid(const LatencyModel *model);
+
+// How far ahead of its deadline an audio command should be sent
+uint32_t latencyModelLeadMs(const LatencyModel *model, uint32_t fallback_ms);
+
+// Where the model is kept between wakes and how the player is measured.
+//   audio_dfplayer.cpp keeps it in NVS and times the DFPlayer, the
+//   simulator its emulated ones. load() and save() are let allocate, as
+//   NVS does, and are only called through the functions below.
+class LatencyPlayer
+{
+public:
+    virtual ~LatencyPlayer() {}
+
+    // false if nothing usable was stored
+    virtual bool load(LatencyModel *model) = 0;
+    virtual void save(const LatencyModel *model) = 0;
+
+    // Add samples for the round trip, ACK and onset
+    virtual void calibrate(LatencyModel *model) = 0;
+};
+
+// Each time the player is brought up: load the model, and only when there
+//   is none yet, or it has nothing the lead could come from, measure the
+//   player and save it. true if it was measured.
+bool latencyModelStart(LatencyModel *model, LatencyPlayer *player);
+
+// Keep what later playback added, e.g. after a session
+void latencyModelSave(const LatencyModel *model, LatencyPlayer *player);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef LIGHT_H
+#define LIGHT_H
+
+#include <stdint.h>
+#include "brightness.h"
+
+// *** Light sensor *** //
+// LDR from 3.3V to this pin, with 10k from the pin to ground, so brighter
+//   light reads higher. Must be an ADC1 pin, ADC2 (e.g. the wakeup pin)
+//   can't be read while the radio is on.
+//   Uncomment this once the sensor is fitted. A pin left floating reads
+//   noise, so without it the eyes stay at BRIGHTNESS_DEFAULT.
+// #define LIGHT_SENSOR_PIN 34
+
+// Start sampling in the background. Takes a first reading before returning
+//   so lightTargetIntensity() is right from the start.
+//   false if there's no sensor.
+bool lightBegin();
+
+// Intensity the eyes should be at for the current light, from any task
+uint8_t lightTargetIntensity();
+
+// Filtered sensor reading, 0 .. BRIGHTNESS_LEVEL_MAX
+uint16_t lightLevel();
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef MAX7219_H
+#define MAX7219_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "framebuffer.h"
+
+// *** MAX7219 registers *** //
+#define MAX7219_REG_DIGIT0 0x01
+#define MAX7219_REG_DECODE_MODE 0x09
+#define MAX7219_REG_INTENSITY 0x0A
+#define MAX7219_REG_SCAN_LIMIT 0x0B
+#define MAX7219_REG_SHUTDOWN 0x0C
+#define MAX7219_REG_DISPLAY_TEST 0x0F
+
+// The MAX7219 is good for 10 MHz
+#define MAX7219_SPI_HZ 8000000
+
+// Driver for a chain of DEVICES daisy-chained MAX7219s on hardware SPI.
+//   Every register write to the chain is one transaction that shifts a
+//   2-byte command through each device, so writing a row to all devices at
+//   once costs the same as writing it to one. A full frame is at most 8
+//   transactions no matter how long the chain is, instead of 8 per device.
+template <uint8_t DEVICES>
+class Max7219Chain
+{
+public:
+    Max7219Chain(uint8_t din, uint8_t clk, uint8_t cs) : din(din), clk(clk), cs(cs) {}
+
+    void begin(uint8_t intensity)
+    {
+        pinMode(cs, OUTPUT);
+        digitalWrite(cs, HIGH);
+        SPI.begin(clk, -1, din, -1);
+
+        writeAll(MAX7219_REG_DISPLAY_TEST, 0);
+        writeAll(MAX7219_REG_SCAN_LIMIT, 7);
+        writeAll(MAX7219_REG_DECODE_MODE, 0);
+        setIntensity(intensity);
+        for (uint8_t r = 0; r < 8; r++)
+        {
+            writeAll(MAX7219_REG_DIGIT0 + r, 0);
+        }
+        setShutdown(false);
+    }
+
+    // 0 .. 15, same for every device
+    void setIntensity(uint8_t level) { writeAll(MAX7219_REG_INTENSITY, level & 0x0F); }
+
+    void setShutdown(bool shutdown) { writeAll(MAX7219_REG_SHUTDOWN, shutdown ? 0 : 1); }
+
+    // Send the framebuffer's dirty rows, one transaction per row
+    void flush(Framebuffer<DEVICES> &fb)
+    {
+        uint8_t dirty = fb.dirtyRows();
+        for (uint8_t r = 0; r < 8; r++)
+        {
+            if (dirty & (1 << r))
+            {
+                writeRow(r, fb.rowData(r));
+            }
+        }
+        fb.markClean();
+    }
+
+private:
+    // The first bytes shifted in end up in the last device of the chain,
+    //   so the command for the highest device goes first
+    void writeRow(uint8_t row, const uint8_t *data)
+    {
+        uint8_t buf[DEVICES * 2];
+        for (uint8_t d = 0; d < DEVICES; d++)
+        {
+            uint8_t slot = DEVICES - 1 - d;
+            buf[slot * 2] = MAX7219_REG_DIGIT0 + row;
+            buf[slot * 2 + 1] = data[d];
+        }
+        transfer(buf);
+    }
+
+    void writeAll(uint8_t reg, uint8_t value)
+    {
+        uint8_t buf[DEVICES * 2];
+        for (uint8_t d = 0; d < DEVICES; d++)
+        {
+            buf[d * 2] = reg;
+            buf[d * 2 + 1] = value;
+        }
+        transfer(buf);
+    }
+
+    void transfer(const uint8_t *buf)
+    {
+        SPI.beginTransaction(SPISettings(MAX7219_SPI_HZ, MSBFIRST, SPI_MODE0));
+        digitalWrite(cs, LOW);
+        SPI.writeBytes(buf, DEVICES * 2);
+        digitalWrite(cs, HIGH);
+        SPI.endTransaction();
+    }
+
+    uint8_t din;
+    uint8_t clk;
+    uint8_t cs;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef OTA_H
+#define OTA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ota_update.h"
+
+// Firmware updates into the other app slot (see partitions.csv), from delta
+//   patches sent over BLE. See ota_update.h for the commands and
+//   tools/delta_patch.cpp for making patches.
+//
+// A new image boots on probation: if it resets or sleeps before
+//   otaConfirmBoot(), the bootloader goes back to the old one.
+
+// Set up for an update. false if there's no slot to write to.
+bool otaBegin();
+
+// Handle a command from the phone, write the status to out
+size_t otaCommand(const uint8_t *data, size_t len, uint8_t *out);
+
+// true while a patch is coming in, sleep should wait for it
+bool otaActive();
+
+// true once an update is in, restart to run it
+bool otaRestartPending();
+
+// This image works, keep it. Call once the unit has got going.
+void otaConfirmBoot();
+
+#endif
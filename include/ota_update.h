@@ -0,0 +1,85 @@
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "delta.h"
+#include "flash_region.h"
+
+// Receiving a delta patch (see delta.h) into the other app slot, the
+//   transport independent part. Commands start with a command byte:
+//   BEGIN  u32 patch size, u32 CRC-32 of the patch
+//   DATA   u32 offset into the patch, bytes
+//   END    check everything and boot the new image next time
+//   ABORT
+// Every command is answered with a status, OTA_STATUS_SIZE bytes:
+//   u8 OtaState, u8 error, u32 patch bytes received, u32 image bytes written
+//
+// DATA has to carry on exactly where the last one ended, anything else is
+//   dropped and the status says where to resume from. The patch is applied
+//   as it arrives, so a transfer that breaks off just starts again with
+//   BEGIN; nothing is switched over until END has checked the patch CRC
+//   and the new image's CRC.
+
+#define OTA_STATUS_SIZE 10
+
+enum OtaCommand : uint8_t
+{
+    OTA_BEGIN = 1,
+    OTA_DATA,
+    OTA_END,
+    OTA_ABORT,
+};
+
+enum OtaState : uint8_t
+{
+    OTA_IDLE = 0,
+    OTA_RECEIVING,
+    OTA_READY,  // the new image boots after a restart
+    OTA_FAILED,
+};
+
+// Errors other than the DeltaResults
+enum OtaError : uint8_t
+{
+    OTA_ERROR_SLOT = 16,  // couldn't start or finish writing the slot
+    OTA_ERROR_PATCH_CRC,  // the patch didn't arrive intact
+    OTA_ERROR_INCOMPLETE, // END before the whole patch
+    OTA_ERROR_COMMAND,
+};
+
+// The app slot being written. finish() checks the image and makes it the
+//   one to boot, abort() throws it away.
+class OtaSlot
+{
+public:
+    virtual ~OtaSlot() {}
+
+    virtual bool begin() = 0;
+    virtual bool write(const uint8_t *data, size_t len) = 0;
+    virtual bool finish() = 0;
+    virtual void abort() = 0;
+};
+
+typedef struct OtaUpdate
+{
+    OtaSlot *slot;
+    FlashRegion *source; // the running image
+    DeltaApplier applier;
+
+    uint8_t state;
+    uint8_t error;
+    uint32_t size;
+    uint32_t crc;
+    uint32_t received;
+    uint32_t received_crc;
+} OtaUpdate;
+
+void otaUpdateInit(OtaUpdate *update, OtaSlot *slot, FlashRegion *source);
+
+// Handle one command and write the status to out. Returns its size.
+size_t otaUpdateCommand(OtaUpdate *update, const uint8_t *data, size_t len, uint8_t *out);
+
+size_t otaUpdateStatus(const OtaUpdate *update, uint8_t *out);
+
+#endif
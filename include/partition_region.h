@@ -0,0 +1,39 @@
+#ifndef PARTITION_REGION_H
+#define PARTITION_REGION_H
+
+#include "esp_partition.h"
+#include "flash_region.h"
+
+// A flash partition as a FlashRegion
+class PartitionRegion : public FlashRegion
+{
+public:
+    explicit PartitionRegion(const esp_partition_t *part = NULL) : part(part) {}
+
+    // For a region kept static and pointed at its partition once found
+    void setPartition(const esp_partition_t *p) { part = p; }
+    const esp_partition_t *partition() const { return part; }
+
+    uint32_t size() const override { return part->size; }
+    uint32_t sectorSize() const override { return SPI_FLASH_SEC_SIZE; }
+
+    bool read(uint32_t offset, void *buf, size_t len) override
+    {
+        return esp_partition_read(part, offset, buf, len) == ESP_OK;
+    }
+
+    bool write(uint32_t offset, const void *buf, size_t len) override
+    {
+        return esp_partition_write(part, offset, buf, len) == ESP_OK;
+    }
+
+    bool eraseSector(uint32_t sector) override
+    {
+        return esp_partition_erase_range(part, sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK;
+    }
+
+private:
+    const esp_partition_t *part;
+};
+
+#endif
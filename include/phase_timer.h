@@ -0,0 +1,46 @@
+#ifndef PHASE_TIMER_H
+#define PHASE_TIMER_H
+
+#include <stdint.h>
+#include "brush_motion.h"
+
+// *** Adaptive phase timing *** //
+// A brushing phase is done once this much of its nominal duration has been
+//   spent actually brushing, so a good brusher finishes a little early
+#define PHASE_QUOTA_PERCENT 75
+// Brushing the wrong quadrant still counts, but only at this rate
+#define PHASE_WRONG_QUADRANT_PERCENT 50
+// Give up and move on after this many times the nominal duration, so a
+//   session can't stall forever if the brush is put down. Less on a low
+//   battery, see fuel_gauge.h.
+#define PHASE_MAX_MULTIPLIER 3
+
+// Tracks how much "effective brushing time" a phase has accumulated.
+//   Without activity readings it degrades to a plain wall-clock timer.
+typedef struct PhaseTimer
+{
+    uint32_t start_ms;
+    uint32_t last_ms;
+    uint32_t nominal_ms;
+    uint32_t quota_ms;
+    uint32_t max_ms;
+    uint32_t effective_ms;
+    uint8_t quadrant; // QUADRANT_UNKNOWN if any brushing counts
+    bool adaptive;
+    bool paused;
+} PhaseTimer;
+
+// Start a fixed-length phase
+void phaseTimerStartFixed(PhaseTimer *pt, uint32_t now_ms, uint32_t duration_ms);
+
+// Start a brushing phase for the given quadrant with a nominal duration,
+//   giving up after max_multiplier times that
+void phaseTimerStartBrushing(PhaseTimer *pt, uint32_t now_ms, uint32_t nominal_ms, uint8_t quadrant,
+                             uint8_t max_multiplier);
+
+// Account for the time since the last update. activity is NULL when there is
+//   no sensing, in which case all elapsed time counts. Returns true once the
+//   phase is complete.
+bool phaseTimerUpdate(PhaseTimer *pt, uint32_t now_ms, const BrushState *activity);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef PRESENT_H
+#define PRESENT_H
+
+#include <stdint.h>
+#include <atomic>
+#include "framebuffer.h"
+
+// Double buffer between the render loop and whatever puts frames on the
+//   eyes at their deadlines. The loop draws the next tick's frame into
+//   back() while the current one is showing and publishes it; at the
+//   deadline the presenting side takes it into front() and sends the rows
+//   that changed. The loop doesn't touch back() again until it's been
+//   taken, so neither side waits on the other and a frame is never shown
+//   half drawn. One task on each side.
+template <uint8_t DEVICES>
+class FramePresenter
+{
+public:
+    FramePresenter() : intensity(0), intensity_changed(false), next_intensity(0), pending(false) {}
+
+    // *** Render side *** //
+
+    // Nothing waiting to be shown, back() can be drawn into
+    bool ready() const { return !pending.load(std::memory_order_acquire); }
+
+    // The frame being prepared. It keeps what was drawn into it last, so a
+    //   frame that doesn't change needn't be drawn again.
+    Framebuffer<DEVICES> &back() { return next; }
+
+    void setIntensity(uint8_t level) { next_intensity = level; }
+
+    // Hand back() over, it's shown at the next take()
+    void publish() { pending.store(true, std::memory_order_release); }
+
+    // *** Presenting side *** //
+
+    // Bring the published frame into front(), marking the rows that differ
+    //   from what's showing dirty. false if nothing was published, front()
+    //   then still has the last frame.
+    bool take()
+    {
+        if (!pending.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        for (uint8_t r = 0; r < Framebuffer<DEVICES>::HEIGHT; r++)
+        {
+            for (uint8_t d = 0; d < DEVICES; d++)
+            {
+                shown.setRow(d, r, next.getRow(d, r));
+            }
+        }
+        intensity_changed = next_intensity != intensity;
+        intensity = next_intensity;
+        pending.store(false, std::memory_order_release);
+        return true;
+    }
+
+    // What's on the eyes once the dirty rows have been sent
+    Framebuffer<DEVICES> &front() { return shown; }
+
+    // Of the frame in front(), and whether it's different from the one before
+    uint8_t intensity;
+    bool intensity_changed;
+
+private:
+    Framebuffer<DEVICES> next;
+    Framebuffer<DEVICES> shown;
+    uint8_t next_intensity;
+    std::atomic<bool> pending;
+};
+
+#endif
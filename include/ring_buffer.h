@@ -0,0 +1,58 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free single-producer / single-consumer ring buffer.
+//   One task may push() and one (possibly on the other core) may pop().
+//   SIZE must be a power of two; one slot is never used so that
+//   head == tail always means "empty".
+template <typename T, uint16_t SIZE>
+class RingBuffer
+{
+    static_assert((SIZE & (SIZE - 1)) == 0, "RingBuffer SIZE must be a power of two");
+
+public:
+    RingBuffer() : head(0), tail(0) {}
+
+    // Returns false (and drops the item) when the buffer is full
+    bool push(const T &item)
+    {
+        uint16_t h = head.load(std::memory_order_relaxed);
+        uint16_t next = (h + 1) & (SIZE - 1);
+        if (next == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        items[h] = item;
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        uint16_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = items[t];
+        tail.store((t + 1) & (SIZE - 1), std::memory_order_release);
+        return true;
+    }
+
+    uint16_t count() const
+    {
+        return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) & (SIZE - 1);
+    }
+
+    uint16_t capacity() const { return SIZE - 1; }
+
+private:
+    T items[SIZE];
+    std::atomic<uint16_t> head;
+    std::atomic<uint16_t> tail;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <coroutine>
+
+// A routine written as straight-line code that waits on steps lasting
+//   several ticks, e.g.
+//
+//     static Script<128> routine()
+//     {
+//         co_await play(0, ANIM_OPEN_EYES, ANIM_OPEN_EYES);
+//         co_await brush(3, QUADRANT_UPPER_LEFT, ANIM_UPPER_LEFT_LEFT, ANIM_UPPER_LEFT_RIGHT);
+//         ...
+//     }
+//
+//   It's a C++20 coroutine, stackless: what it keeps across a co_await
+//   lives in its frame, which comes out of a static buffer of FRAME_BYTES
+//   rather than the heap, so only one script of a size runs at a time.
+//   Nothing runs it on its own. The owner resume()s it when the step it's
+//   waiting on is over, and it carries on to the next co_await, where
+//   the step's awaiter starts the next step and suspends it again. Between
+//   steps it costs nothing per tick. Every co_await keeps its awaiter in
+//   the frame, so awaiters should be empty or nearly.
+template <size_t FRAME_BYTES>
+class Script
+{
+public:
+    struct promise_type
+    {
+        // The compiler asks for the frame's size when the script is
+        //   called, NULL makes the call return a script that's done()
+        static void *operator new(size_t size) noexcept
+        {
+            frame_needed = size;
+            if (size > FRAME_BYTES || frame_used)
+            {
+                return NULL;
+            }
+            frame_used = true;
+            return frame;
+        }
+
+        static void operator delete(void *, size_t) noexcept { frame_used = false; }
+
+        static Script get_return_object_on_allocation_failure() { return Script(); }
+
+        Script get_return_object() { return Script(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+        // Doesn't start until the first resume(), and stays around once
+        //   finished until the Script goes
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { abort(); }
+    };
+
+    Script() : handle(NULL) {}
+    Script(const Script &) = delete;
+    Script(Script &&other) : handle(other.handle) { other.handle = NULL; }
+    ~Script() { destroy(); }
+
+    Script &operator=(Script &&other)
+    {
+        if (this != &other)
+        {
+            destroy();
+            handle = other.handle;
+            other.handle = NULL;
+        }
+        return *this;
+    }
+
+    // Run up to the next co_await that suspends. false once the script has
+    //   returned, or if it never got a frame.
+    bool resume()
+    {
+        if (done())
+        {
+            return false;
+        }
+        handle.resume();
+        return !handle.done();
+    }
+
+    bool done() const { return !handle || handle.done(); }
+
+    // Give the frame back, wherever the script had got to
+    void destroy()
+    {
+        if (handle)
+        {
+            handle.destroy();
+            handle = NULL;
+        }
+    }
+
+    // What the last script of this size asked for, to tune FRAME_BYTES
+    static size_t frameNeeded() { return frame_needed; }
+
+private:
+    explicit Script(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+
+    alignas(max_align_t) static inline uint8_t frame[FRAME_BYTES];
+    static inline bool frame_used = false;
+    static inline size_t frame_needed = 0;
+};
+
+#endif
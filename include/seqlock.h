@@ -0,0 +1,53 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <atomic>
+
+// A value one task keeps replacing and others take copies of. The writer
+//   never waits: a reader that overlapped a write sees the sequence number
+//   change and copies again. T should be small and plain, it's copied
+//   whole on every write and read.
+template <typename T>
+class Seqlock
+{
+public:
+    Seqlock() : seq(0) {}
+
+    // One writer only
+    void write(const T &v)
+    {
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        value = v;
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    // false if nothing has been written yet or every try overlapped a
+    //   write, out is then unusable
+    bool read(T &out, int tries = 8) const
+    {
+        for (int i = 0; i < tries; i++)
+        {
+            uint32_t s = seq.load(std::memory_order_acquire);
+            if (s & 1)
+            {
+                continue;
+            }
+            out = value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == s)
+            {
+                return s != 0;
+            }
+        }
+        return false;
+    }
+
+private:
+    T value;
+    std::atomic<uint32_t> seq;
+};
+
+#endif
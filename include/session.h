@@ -0,0 +1,84 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stdint.h>
+#include "activity.h"
+#include "phase_timer.h"
+
+// The brushing routine: a fixed sequence of phases, each playing a pair of
+//   eye animations, written out in order as a script (routine() in
+//   session.cpp, see script.h). sessionTick() is called once per display
+//   tick and says what to draw. No hardware access, so it also runs in the
+//   simulator.
+
+// As many as routine() has
+const int NUM_PHASES = 12;
+
+// The brushing phases, one per quadrant
+#define SESSION_PHASE_UPPER_LEFT 3
+#define SESSION_PHASE_UPPER_RIGHT 5
+#define SESSION_PHASE_LOWER_LEFT 7
+#define SESSION_PHASE_LOWER_RIGHT 9
+
+// Rows to send to each eye this tick, 8 bytes each. NULL if nothing changes.
+typedef struct SessionFrame
+{
+    const uint8_t *left;
+    const uint8_t *right;
+} SessionFrame;
+
+enum SessionEvent : uint8_t
+{
+    SESSION_RUNNING = 0,
+    SESSION_NEW_PHASE, // first tick of a new phase
+    SESSION_FINISHED,  // the last phase has completed
+};
+
+// What happened in a session so far, for the usage log
+typedef struct SessionStats
+{
+    uint32_t start_ms;
+    uint32_t duration_ms;
+    uint16_t phase_ms[NUM_PHASES]; // how long each completed phase ran
+    uint16_t brushing_ms[4];       // brushing counted in each quadrant's phase
+    uint8_t phases_done;
+} SessionStats;
+
+void sessionBegin(uint32_t now_ms);
+
+// NULL (the default) means no sensing: every phase uses its fixed duration
+void sessionSetActivitySource(ActivitySource source);
+
+// How many times its length a brushing phase waits for brushing before
+//   moving on, from the next phase. PHASE_MAX_MULTIPLIER by default.
+void sessionSetPhaseLimit(uint8_t multiplier);
+
+// Start `phase` on the next tick, which reports SESSION_NEW_PHASE as usual.
+//   For trying out phases from the console; false if there's no such phase
+//   or the session has finished.
+bool sessionJumpToPhase(int phase);
+
+// Once the last phase completes this returns SESSION_FINISHED on every
+//   tick, with nothing to draw, until sessionBegin() is called again. A
+//   frame held for several ticks (see anims.h) is only handed out on the
+//   first.
+uint8_t sessionTick(uint32_t now_ms, SessionFrame *frame);
+
+// Hand out the current frame on the next tick even if it's held, after
+//   something else has been drawn over the eyes
+void sessionRedraw();
+
+// How long until the next phase's first frame is shown, assuming
+//   sessionTick() keeps being called every tick_ms starting at now_ms.
+//   -1 if that depends on what the user does.
+int32_t sessionMsUntilNextPhase(uint32_t now_ms, uint32_t tick_ms);
+
+int sessionPhase();
+int sessionFrameCounter();
+int sessionFrameCount();
+const PhaseTimer *sessionPhaseTimer();
+
+// Stats of the current session, or the one that just finished
+const SessionStats *sessionStats(uint32_t now_ms);
+
+#endif
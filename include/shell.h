@@ -0,0 +1,11 @@
+#ifndef SHELL_H
+#define SHELL_H
+
+// Serial console: a low priority task on core 0 reads the USB serial port,
+//   passes everything to the usage exporter (export.h) and runs lines of
+//   text as console commands (diag.h). Type "help" in the serial monitor.
+
+// Start the task. Call exportBegin() first.
+bool shellBegin();
+
+#endif
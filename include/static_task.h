@@ -0,0 +1,51 @@
+#ifndef STATIC_TASK_H
+#define STATIC_TASK_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+// FreeRTOS objects whose memory is part of the firmware's statics rather
+//   than taken from the heap when they're created, so what the tasks need
+//   is fixed at build time and shows in the map file under the module
+//   that owns it. Each is created once, during setup().
+
+// A task's stack and control block. ESP-IDF counts stacks in bytes.
+template <uint32_t STACK_BYTES>
+class StaticTask
+{
+public:
+    bool start(TaskFunction_t task, const char *name, UBaseType_t priority, BaseType_t core)
+    {
+        return xTaskCreateStaticPinnedToCore(task, name, STACK_BYTES, NULL, priority, stack, &tcb, core) != NULL;
+    }
+
+private:
+    StackType_t stack[STACK_BYTES / sizeof(StackType_t)];
+    StaticTask_t tcb;
+};
+
+// A queue of LENGTH items of T
+template <typename T, UBaseType_t LENGTH>
+class StaticQueue
+{
+public:
+    QueueHandle_t create() { return xQueueCreateStatic(LENGTH, sizeof(T), storage, &queue); }
+
+private:
+    uint8_t storage[LENGTH * sizeof(T)];
+    StaticQueue_t queue;
+};
+
+class StaticMutex
+{
+public:
+    SemaphoreHandle_t create() { return xSemaphoreCreateMutexStatic(&mutex); }
+
+private:
+    StaticSemaphore_t mutex;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <stdint.h>
+#include "health.h"
+
+// Keeps the unit going when parts of it don't. The render, audio and
+//   sensor tasks are registered with the ESP32 task watchdog, which resets
+//   the chip if one of them stops running for SUPERVISOR_WDT_TIMEOUT_MS,
+//   and send heartbeats the supervisor task checks for shorter stalls.
+//   A peripheral that fails leaves the rest running (the eyes carry on
+//   without sound) and its owning task retries it with backoff. See
+//   health.h for what's counted and recorded.
+
+// Long enough for the DFPlayer to start and calibrate
+#define SUPERVISOR_WDT_TIMEOUT_MS 15000
+#define SUPERVISOR_CHECK_MS 250
+
+// Set up the task watchdog and start checking. Call first in setup(),
+//   before anything reports a failure.
+bool supervisorBegin();
+
+// From a task before its loop: watch it with the task watchdog, and
+//   expect a supervisorBeat() at least every period_ms
+void supervisorWatch(uint8_t task, uint32_t period_ms);
+
+// From a watched task, once per loop
+void supervisorBeat(uint8_t task);
+
+// From the task that owns the peripheral
+void supervisorPeripheralUp(uint8_t peripheral);
+void supervisorPeripheralFailed(uint8_t peripheral);
+bool supervisorRetryDue(uint8_t peripheral);
+
+// Queue a health record for the usage log if anything went wrong during
+//   this wake, at the end of a session
+void supervisorRecord();
+
+#endif
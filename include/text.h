@@ -0,0 +1,54 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <stdint.h>
+#include "font.h"
+#include "framebuffer.h"
+
+// Text is drawn into 1-bit bitmaps laid out like the framebuffer's rows:
+//   `stride` bytes per row, leftmost pixel in the top bit of the first
+//   byte. A glyph row lands in at most two bytes, so drawing and scrolling
+//   are shifts and ORs of whole bytes, never single pixels.
+
+// Width of s in pixels, not counting the spacing after the last glyph
+uint16_t textWidth(const Font *font, const char *s);
+
+// OR s into the bitmap with its top left corner at (x, y), clipped to
+//   stride * 8 by height pixels. Returns the x after the last glyph.
+int16_t textDraw(const Font *font, const char *s, int16_t x, int16_t y, uint8_t *rows, uint8_t stride, uint8_t height);
+
+// The 8 pixels of a bitmap row starting at pixel x, blank past either end
+uint8_t textWindow(const uint8_t *row, uint8_t stride, int16_t x);
+
+// *** Scrolling *** //
+// Longest message that can be scrolled, in pixels
+#define TEXT_SCROLL_MAX_WIDTH 256
+
+// A message rendered once, then scrolled right to left across a display
+//   by reading a moving 8 pixel window out of each row
+typedef struct TextScroller
+{
+    uint8_t rows[8][TEXT_SCROLL_MAX_WIDTH / 8];
+    uint16_t width; // of the message
+    int16_t x;      // message pixel at the left edge of the display
+} TextScroller;
+
+// The message starts just off the right edge of a display view_width wide
+void textScrollBegin(TextScroller *scroller, const Font *font, const char *s, int16_t y, uint16_t view_width);
+
+// Move one pixel left. false once the message is off the left edge.
+bool textScrollStep(TextScroller *scroller);
+
+template <uint8_t DEVICES>
+void textScrollDraw(const TextScroller *scroller, Framebuffer<DEVICES> &fb)
+{
+    for (uint8_t r = 0; r < 8; r++)
+    {
+        for (uint8_t d = 0; d < DEVICES; d++)
+        {
+            fb.setRow(d, r, textWindow(scroller->rows[r], sizeof(scroller->rows[r]), scroller->x + d * 8));
+        }
+    }
+}
+
+#endif
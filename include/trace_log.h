@@ -0,0 +1,81 @@
+#ifndef TRACE_LOG_H
+#define TRACE_LOG_H
+
+#include <stdint.h>
+#include <atomic>
+
+// The last SIZE things that happened, for looking at after the fact.
+//   Unlike RingBuffer a writer never finds it full: it overwrites the
+//   oldest entry. Any number of writers and readers, no locks: a writer
+//   claims its slot by counting the head up and marks it with a sequence
+//   number while it's writing, and a reader copying at the same time drops
+//   the entries still being written or overwritten under it. SIZE must be a
+//   power of two, and big enough that no slot comes round again while a
+//   writer is still filling it.
+template <typename T, uint16_t SIZE>
+class TraceLog
+{
+    static_assert((SIZE & (SIZE - 1)) == 0, "TraceLog SIZE must be a power of two");
+
+public:
+    TraceLog() : head(0)
+    {
+        for (uint16_t i = 0; i < SIZE; i++)
+        {
+            slots[i].seq.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void add(const T &item)
+    {
+        uint32_t h = head.fetch_add(1, std::memory_order_relaxed);
+        Slot &slot = slots[h & (SIZE - 1)];
+        // Odd while it's being written, then the entry's number after
+        //   that: entry h is complete when seq is 2 * h + 2
+        slot.seq.store(2 * h + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.item = item;
+        slot.seq.store(2 * h + 2, std::memory_order_release);
+    }
+
+    // Copy up to max of the newest complete entries into out, oldest
+    //   first. Returns how many.
+    uint16_t recent(T *out, uint16_t max) const
+    {
+        uint32_t h = head.load(std::memory_order_acquire);
+        uint32_t n = h < SIZE ? h : SIZE;
+        n = n < max ? n : max;
+        uint16_t copied = 0;
+        for (uint32_t i = h - n; i != h; i++)
+        {
+            const Slot &slot = slots[i & (SIZE - 1)];
+            uint32_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq != 2 * i + 2)
+            {
+                continue;
+            }
+            out[copied] = slot.item;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == seq)
+            {
+                copied++;
+            }
+        }
+        return copied;
+    }
+
+    // Everything ever added, including what's been overwritten
+    uint32_t total() const { return head.load(std::memory_order_acquire); }
+
+private:
+    typedef struct Slot
+    {
+        std::atomic<uint32_t> seq;
+        T item;
+    } Slot;
+
+    Slot slots[SIZE];
+    std::atomic<uint32_t> head;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef USAGE_H
+#define USAGE_H
+
+#include <stdint.h>
+#include "session.h"
+#include "usage_log.h"
+
+// *** Usage log partition *** //
+// See partitions.csv. 32 sectors of 64 records, so at least 1984 records.
+#define USAGE_PARTITION_LABEL "usagelog"
+#define USAGE_PARTITION_SUBTYPE 0x40
+
+// Find the end of the log and start the writer task. false if there's no
+//   usage log partition, records are then dropped.
+bool usageBegin();
+
+// Queue a record of the session for the writer task, doesn't wait for flash
+void usageRecordSession(uint8_t status, const SessionStats *stats);
+
+// Queue a health record, see health.h
+void usageRecordHealth(const UsageHealth *health);
+
+// Wait for queued records to be written, e.g. before going to sleep.
+//   false if they weren't done in time.
+bool usageFlush(uint32_t timeout_ms);
+
+// usageLogScan() on the device's log, safe to call from any task while
+//   records are being written
+uint32_t usageScan(uint32_t from_seq, UsageLogVisitor visit, void *ctx);
+
+// Why this wakeup happened, as a UsageWake
+uint8_t usageWakeReason();
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef USAGE_EXPORT_H
+#define USAGE_EXPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame.h"
+#include "usage_log.h"
+
+// Pulling the usage log off a unit over serial, in frames (see frame.h).
+//
+//   host                         device
+//   EXPORT from_seq, count ->
+//                        <-      HELLO unit id, record format, first seq
+//                        <-      RECORDS up to EXPORT_BATCH whole records
+//                        <-      ...
+//                        <-      END first seq not sent, more to come?
+//
+// Log seqs have no holes past the oldest record, which the HELLO names,
+//   so the host can tell exactly which records it missed when a frame is
+//   corrupted or never seen at all, and asks for the next window starting
+//   from the first one missing. That also resumes a transfer that was cut
+//   off, or one from an earlier connection. The window doubles after a
+//   clean one and halves after a loss, so a noisy link costs retries of
+//   small windows rather than of the whole log.
+
+#define EXPORT_BATCH 8
+#define EXPORT_MIN_WINDOW EXPORT_BATCH
+#define EXPORT_MAX_WINDOW 256
+
+enum ExportFrameType : uint8_t
+{
+    EXPORT_FRAME_EXPORT = 0x01, // host: u32 from_seq, u16 most records to send
+    EXPORT_FRAME_HELLO = 0x81,  // device: ExportHello
+    EXPORT_FRAME_RECORDS = 0x82,
+    EXPORT_FRAME_END = 0x83, // device: u32 first seq not sent, u8 1 if there are more
+};
+
+typedef struct ExportHello
+{
+    uint64_t unit_id;
+    uint16_t record_size;
+    uint8_t record_version;
+    uint8_t reserved;
+    uint32_t first_seq; // first record this answer will have, later than
+                        //   from_seq if older ones were dropped
+} ExportHello;
+
+// *** Device side *** //
+
+typedef uint32_t (*UsageScanFunc)(uint32_t from_seq, UsageLogVisitor visit, void *ctx);
+typedef void (*ExportWriteFunc)(const uint8_t *data, size_t len);
+
+typedef struct UsageExporter
+{
+    uint64_t unit_id;
+    UsageScanFunc scan;
+    ExportWriteFunc write;
+    FrameDecoder decoder;
+
+    UsageRecord batch[EXPORT_BATCH];
+    uint8_t batched;
+    uint16_t left;  // records still to send in this window
+    bool more;      // stopped with records left over
+    uint32_t next_seq;
+    uint8_t frame[FRAME_MAX_SIZE];
+} UsageExporter;
+
+void usageExporterInit(UsageExporter *exporter, uint64_t unit_id, UsageScanFunc scan, ExportWriteFunc write);
+
+// Feed bytes from the host. An EXPORT request is answered right away,
+//   blocking until the last frame is written. Returns true if one was.
+bool usageExporterReceive(UsageExporter *exporter, const uint8_t *data, size_t len);
+
+// *** Host side *** //
+
+typedef struct UsageImporter
+{
+    FrameDecoder decoder;
+    ExportHello hello;
+    bool have_hello;
+
+    uint32_t expected; // next seq wanted
+    uint16_t window;   // records asked for at a time
+    bool lost;         // records were missed in this answer
+    bool ended;        // the END for the last request came in
+    bool done;         // everything up to the device's newest record is in
+
+    uint32_t records;  // taken so far
+    uint32_t requests;
+    UsageLogVisitor visit;
+    void *ctx;
+} UsageImporter;
+
+// Records from from_seq on are passed to visit, once each, in seq order
+void usageImporterBegin(UsageImporter *importer, uint32_t from_seq, UsageLogVisitor visit, void *ctx);
+
+void usageImporterPush(UsageImporter *importer, const uint8_t *data, size_t len);
+
+// The EXPORT frame for the next window, from the first missing seq. Send
+//   it, push what comes back until the END or a timeout, and repeat until
+//   done. out needs FRAME_MAX_SIZE bytes.
+size_t usageImporterRequest(UsageImporter *importer, uint8_t *out);
+
+#endif
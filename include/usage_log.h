@@ -0,0 +1,152 @@
+#ifndef USAGE_LOG_H
+#define USAGE_LOG_H
+
+#include <stdint.h>
+#include "flash_region.h"
+
+// Append-only log of fixed-size records in a flash region.
+//
+// The region is used as a ring of sectors. Records fill a sector slot by
+//   slot; when it's full the next sector is erased and the oldest records in
+//   it are dropped. Every sector is erased once per trip round the ring, so
+//   wear is spread evenly.
+//
+// A record is written in two steps, everything but the CRC and then the
+//   CRC, so a record is only valid once its last 4 bytes are in. After a
+//   power cut a torn record fails its CRC and is skipped, and the next one
+//   goes in the slot after it.
+
+#define USAGE_RECORD_SIZE 64
+#define USAGE_RECORD_PAYLOAD 52
+#define USAGE_RECORD_VERSION 1
+
+// Phases in a session record, fixed so the format doesn't change with
+//   the session
+#define USAGE_PHASES 12
+#define USAGE_QUADRANTS 4
+
+// Most sectors the log keeps track of
+#define USAGE_LOG_MAX_SECTORS 64
+
+enum UsageRecordType : uint8_t
+{
+    USAGE_RECORD_SESSION = 1,
+    USAGE_RECORD_HEALTH,
+};
+
+// How a session ended
+enum UsageStatus : uint8_t
+{
+    USAGE_COMPLETED = 0,    // ran through every phase
+    USAGE_STOPPED_SENSOR,   // the pressure sensor sent it to sleep early
+    USAGE_STOPPED_BATTERY,  // the battery ran too low to carry on
+};
+
+// Why the unit was awake for the session
+enum UsageWake : uint8_t
+{
+    USAGE_WAKE_POWER_ON = 0,
+    USAGE_WAKE_SENSOR,
+    USAGE_WAKE_OTHER,
+};
+
+typedef struct UsageSession
+{
+    uint8_t status;      // UsageStatus
+    uint8_t wake_reason; // UsageWake
+    uint8_t phases_done;
+    uint8_t reserved;
+    uint32_t start_ms;   // since wakeup, there's no clock
+    uint32_t duration_ms;
+    uint16_t phase_ms[USAGE_PHASES];
+    uint16_t brushing_ms[USAGE_QUADRANTS];
+} UsageSession;
+
+// Tasks and peripherals in a health record, see health.h
+#define USAGE_HEALTH_TASKS 4
+#define USAGE_HEALTH_PERIPHERALS 2
+
+// What the last reset was, from the chip
+enum UsageReset : uint8_t
+{
+    USAGE_RESET_POWER_ON = 0,
+    USAGE_RESET_DEEP_SLEEP, // the usual wakeup
+    USAGE_RESET_SOFTWARE,   // e.g. restarting into an update
+    USAGE_RESET_WATCHDOG,
+    USAGE_RESET_PANIC,
+    USAGE_RESET_BROWNOUT,
+    USAGE_RESET_OTHER,
+};
+
+// Written alongside a session record when something went wrong during the
+//   wake, or the wake itself came from a crash
+typedef struct UsageHealth
+{
+    uint8_t reset_reason;   // UsageReset
+    uint8_t down;           // bit per peripheral still not working at the end
+    uint16_t reserved;
+    uint32_t uptime_ms;
+    uint16_t failures[USAGE_HEALTH_PERIPHERALS];   // times it stopped working
+    uint16_t recoveries[USAGE_HEALTH_PERIPHERALS]; // times it came back
+    uint16_t stalls[USAGE_HEALTH_TASKS];           // heartbeats missed
+    uint16_t max_gap_ms[USAGE_HEALTH_TASKS];       // longest between heartbeats
+} UsageHealth;
+
+typedef struct UsageRecord
+{
+    uint32_t seq; // counts up from 1 over the life of the log
+    uint8_t type; // UsageRecordType
+    uint8_t version;
+    uint16_t reserved;
+    union
+    {
+        UsageSession session;
+        UsageHealth health;
+        uint8_t payload[USAGE_RECORD_PAYLOAD];
+    };
+    uint32_t crc; // over everything before it
+} UsageRecord;
+
+static_assert(sizeof(UsageSession) <= USAGE_RECORD_PAYLOAD, "session record too big");
+static_assert(sizeof(UsageHealth) <= USAGE_RECORD_PAYLOAD, "health record too big");
+static_assert(sizeof(UsageRecord) == USAGE_RECORD_SIZE, "records must be USAGE_RECORD_SIZE bytes");
+
+typedef struct UsageLog
+{
+    FlashRegion *flash;
+    uint16_t sectors;
+    uint16_t slots; // per sector
+
+    uint16_t head_sector; // sector being written
+    uint16_t head_slot;   // next free slot in it, == slots when full
+    uint32_t next_seq;
+
+    // Lowest seq in each sector, 0 if it has no records. Lets a scan skip
+    //   straight to the sector holding a given seq.
+    uint32_t first_seq[USAGE_LOG_MAX_SECTORS];
+} UsageLog;
+
+// Called for each record in seq order. Return false to stop the scan.
+typedef bool (*UsageLogVisitor)(const UsageRecord *record, void *ctx);
+
+// Find where the log left off. Reads a few slots per sector plus the
+//   newest sector. false if the region is too small.
+bool usageLogBegin(UsageLog *log, FlashRegion *flash);
+
+// Set the record's seq and CRC and write it. May erase a sector first.
+bool usageLogAppend(UsageLog *log, UsageRecord *record);
+
+// Visit the valid records with seq >= from_seq, oldest first. Returns how
+//   many were visited.
+uint32_t usageLogScan(UsageLog *log, uint32_t from_seq, UsageLogVisitor visit, void *ctx);
+
+// The seq the next record will get, one past the newest
+uint32_t usageLogNextSeq(const UsageLog *log);
+
+// Most records the log is sure to hold, of any type, the oldest sector is
+//   dropped to make room when the newest fills up
+uint32_t usageLogCapacity(const UsageLog *log);
+
+bool usageRecordValid(const UsageRecord *record);
+
+#endif
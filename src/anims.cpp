@@ -0,0 +1,107 @@
+#include <string.h>
+#include "anims.h"
+
+const NamedAnim NAMED_ANIMS[] = {
+    {"blink", &ANIM_EYE_BLINK, &ANIM_EYE_BLINK},
+    {"open", &ANIM_OPEN_EYES, &ANIM_OPEN_EYES},
+    {"close", &ANIM_CLOSE_EYES, &ANIM_CLOSE_EYES},
+    {"wait", &ANIM_WAIT_LEFT, &ANIM_WAIT_RIGHT},
+    {"countdown", &ANIM_COUNTDOWN, &ANIM_COUNTDOWN},
+    {"upper_left", &ANIM_UPPER_LEFT_LEFT, &ANIM_UPPER_LEFT_RIGHT},
+    {"upper_right", &ANIM_UPPER_RIGHT_LEFT, &ANIM_UPPER_RIGHT_RIGHT},
+    {"lower_left", &ANIM_LOWER_LEFT_LEFT, &ANIM_LOWER_LEFT_RIGHT},
+    {"lower_right", &ANIM_LOWER_RIGHT_LEFT, &ANIM_LOWER_RIGHT_RIGHT},
+    {"excited", &ANIM_EXCITED_EYES, &ANIM_EXCITED_EYES},
+    {"battery", &ANIM_LOW_BATTERY, &ANIM_LOW_BATTERY},
+};
+
+const size_t NAMED_ANIM_COUNT = sizeof(NAMED_ANIMS) / sizeof(NAMED_ANIMS[0]);
+
+int animByName(const char *name)
+{
+    for (size_t i = 0; i < NAMED_ANIM_COUNT; i++)
+    {
+        if (strcmp(NAMED_ANIMS[i].name, name) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint8_t animHold(const Anim *anim, int frame)
+{
+    return anim->holds != NULL ? anim->holds[frame] : 1;
+}
+
+void animPlayerStart(AnimPlayer *player, const Anim *anim, uint8_t mode)
+{
+    player->anim = anim;
+    player->mode = mode;
+    player->frame = 0;
+    player->step = 1;
+    player->held = 0;
+    player->done = false;
+}
+
+const uint8_t *animPlayerRows(const AnimPlayer *player, const Anim *anim, uint8_t *rows)
+{
+    if (anim->render != NULL)
+    {
+        anim->render(player->frame, rows);
+        return rows;
+    }
+    return &anim->anim[player->frame * 8];
+}
+
+bool animPlayerTick(AnimPlayer *player)
+{
+    const Anim *anim = player->anim;
+    if (player->done || ++player->held < animHold(anim, player->frame))
+    {
+        return false;
+    }
+
+    int last = anim->num_frames - 1;
+    int from = player->frame;
+    player->held = 0;
+    switch (player->mode)
+    {
+    case ANIM_LOOP:
+        player->frame = from < last ? from + 1 : 0;
+        break;
+    case ANIM_PING_PONG:
+        // Turn round at either end, showing the end frame once
+        if ((player->step > 0 && from == last) || (player->step < 0 && from == 0))
+        {
+            player->step = -player->step;
+        }
+        player->frame = last > 0 ? from + player->step : 0;
+        break;
+    default:
+        if (from < last)
+        {
+            player->frame++;
+        }
+        else
+        {
+            player->done = true;
+        }
+        break;
+    }
+    return player->frame != from;
+}
+
+int animPlayerTicksLeft(const AnimPlayer *player)
+{
+    if (player->done)
+    {
+        return 0;
+    }
+    int ticks = animHold(player->anim, player->frame) - player->held;
+    for (int f = player->frame + 1; f < player->anim->num_frames; f++)
+    {
+        ticks += animHold(player->anim, f);
+    }
+    return ticks;
+}
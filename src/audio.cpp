@@ -0,0 +1,178 @@
+#include <Arduino.h>
+#include "freertos/queue.h"
+#include "audio.h"
+#include "audio_backend.h"
+#include "audio_cues.h"
+#include "config.h"
+#include "diag.h"
+#include "supervisor.h"
+#include "clock.h"
+#include "static_task.h"
+
+// *** Audio task *** //
+#define AUDIO_TASK_STACK 4096
+#define AUDIO_TASK_PRIORITY 2
+#define AUDIO_TASK_CORE 0
+// How often due cues are checked for
+#define AUDIO_POLL_MS 5
+// Longest the task may go between heartbeats. Starting the player again
+//   takes a second or two.
+#define AUDIO_HEARTBEAT_MS 1000
+
+enum AudioMessageType : uint8_t
+{
+    AUDIO_MSG_PHASE_STARTED,
+    AUDIO_MSG_PREDICT_NEXT,
+    AUDIO_MSG_STOP,
+    AUDIO_MSG_VOLUME,
+};
+
+typedef struct AudioMessage
+{
+    uint8_t type;
+    int8_t phase; // or the level, for AUDIO_MSG_VOLUME
+    uint32_t at_ms;
+} AudioMessage;
+
+static QueueHandle_t audio_queue = NULL;
+static StaticQueue<AudioMessage, 8> audio_queue_mem;
+static StaticTask<AUDIO_TASK_STACK> audio_task;
+// Until the player answers, messages are dropped and it's retried
+static volatile bool audio_up = false;
+static volatile uint32_t audio_position_ms = AUDIO_TIME_UNKNOWN;
+
+static void handleMessage(const AudioMessage *msg)
+{
+    if (!audio_up)
+    {
+        return;
+    }
+
+    switch (msg->type)
+    {
+    case AUDIO_MSG_PHASE_STARTED:
+        audioCuesPhaseStarted(msg->phase, msg->at_ms);
+        break;
+    case AUDIO_MSG_PREDICT_NEXT:
+        audioCuesPredictNextPhase(msg->at_ms);
+        break;
+    case AUDIO_MSG_STOP:
+        audioCuesStop();
+        audioBackendSessionEnded();
+        break;
+    case AUDIO_MSG_VOLUME:
+        audioCuesSetVolume(msg->phase);
+        break;
+    default:
+        break;
+    }
+}
+
+static bool startPlayer()
+{
+    AudioSink *sink = audioBackendBegin();
+    if (sink == NULL)
+    {
+        supervisorPeripheralFailed(HEALTH_PLAYER);
+        return false;
+    }
+    audioCuesBegin(sink, audioBackendLeadMs());
+    // Back in the middle of a session, the volume cue may have gone by
+    audioCuesSetVolume(config.volume);
+    audio_up = true;
+    supervisorPeripheralUp(HEALTH_PLAYER);
+    return true;
+}
+
+static void audioTask(void *arg)
+{
+    supervisorWatch(HEALTH_TASK_AUDIO, AUDIO_HEARTBEAT_MS);
+    while (true)
+    {
+        supervisorBeat(HEALTH_TASK_AUDIO);
+        AudioMessage msg;
+        if (xQueueReceive(audio_queue, &msg, pdMS_TO_TICKS(AUDIO_POLL_MS)) == pdTRUE)
+        {
+            handleMessage(&msg);
+            while (xQueueReceive(audio_queue, &msg, 0) == pdTRUE)
+            {
+                handleMessage(&msg);
+            }
+        }
+
+        // Sound comes back from the next phase that has cues
+        if (!audio_up)
+        {
+            if (supervisorRetryDue(HEALTH_PLAYER))
+            {
+                startPlayer();
+            }
+            continue;
+        }
+
+        uint32_t now = clockMs32();
+
+        audioBackendPoll(now);
+        audioCuesPoll(now);
+        audio_position_ms = audioCuesPositionMs(now);
+    }
+}
+
+static void post(uint8_t type, int phase, uint32_t at_ms)
+{
+    if (audio_queue == NULL)
+    {
+        return;
+    }
+
+    AudioMessage msg = {type, (int8_t)phase, at_ms};
+    xQueueSend(audio_queue, &msg, 0);
+}
+
+bool audioBegin()
+{
+    // The first try is here so a working player is ready before the
+    //   session starts
+    bool started = startPlayer();
+    diagSetLatencySource(audioLatency);
+
+    audio_queue = audio_queue_mem.create();
+    audio_task.start(audioTask, "audio", AUDIO_TASK_PRIORITY, AUDIO_TASK_CORE);
+    return started;
+}
+
+bool audioReady()
+{
+    return audio_up;
+}
+
+const char *audioName()
+{
+    return audioBackendName();
+}
+
+void audioPhaseStarted(int phase, uint32_t at_ms)
+{
+    post(AUDIO_MSG_PHASE_STARTED, phase, at_ms);
+}
+
+void audioPredictNextPhase(uint32_t at_ms)
+{
+    post(AUDIO_MSG_PREDICT_NEXT, 0, at_ms);
+}
+
+void audioStop()
+{
+    post(AUDIO_MSG_STOP, 0, 0);
+}
+
+void audioSetVolume(uint8_t level)
+{
+    post(AUDIO_MSG_VOLUME, level, 0);
+}
+
+uint32_t audioPositionMs()
+{
+    return audio_position_ms;
+}
+
@@ -0,0 +1,262 @@
+#include <stddef.h>
+#include "audio_cues.h"
+#include "config.h"
+
+// What to play in each phase, in the order it should be sent
+static const AudioCue AUDIO_CUES[] = {
+    {3, 0, CUE_VOLUME, CUE_VOLUME_CONFIGURED},
+    {3, 0, CUE_BACKGROUND, 0},
+    // The player needs the background track running before it can
+    //   interrupt it with a voice prompt
+    {3, 500, CUE_VOICE, VOICE_UPPER_LEFT},
+    {5, 0, CUE_VOICE, VOICE_UPPER_RIGHT},
+    {7, 0, CUE_VOICE, VOICE_LOWER_LEFT},
+    {9, 0, CUE_VOICE, VOICE_LOWER_RIGHT},
+    {11, 0, CUE_VOICE, VOICE_GREAT_JOB},
+};
+
+#define NUM_CUES (sizeof(AUDIO_CUES) / sizeof(AUDIO_CUES[0]))
+
+// Background music, played in order and looped. The length of what's on
+//   the card isn't known here: each track's is measured the first time it
+//   plays through, from then on the next one is sent ahead of its end.
+static const BackgroundTrack BACKGROUND_PLAYLIST[] = {
+    {1, 1, 0},
+};
+
+#define NUM_BACKGROUND_TRACKS (sizeof(BACKGROUND_PLAYLIST) / sizeof(BACKGROUND_PLAYLIST[0]))
+
+// Measured lengths, 0 until a track has played through. Kept across
+//   sessions, forgotten when the card may have changed.
+static uint32_t measured_ms[NUM_BACKGROUND_TRACKS];
+
+static AudioSink *audio_sink = NULL;
+static uint32_t lead_ms = AUDIO_DEFAULT_LEAD_MS;
+static AudioCueTraceHook trace_hook = NULL;
+
+static int current_phase = -1;
+static uint32_t current_start_ms = 0;
+static uint32_t next_start_ms = AUDIO_TIME_UNKNOWN;
+
+// Which cues have already been sent for the current / next phase
+static bool cue_issued[NUM_CUES];
+
+static bool background_playing = false;
+static uint8_t background_idx = 0;
+static uint32_t background_start_ms = 0;
+
+// true if `deadline` is within the lead time of `now`, or already past.
+//   Signed difference so this survives now_ms wrapping (clockMs32()).
+static bool isDue(uint32_t now_ms, uint32_t deadline_ms)
+{
+    return (int32_t)(now_ms + lead_ms - deadline_ms) >= 0;
+}
+
+static uint32_t trackDuration(uint8_t idx)
+{
+    uint32_t listed = BACKGROUND_PLAYLIST[idx].duration_ms;
+    return listed > 0 ? listed : measured_ms[idx];
+}
+
+static void startBackgroundTrack(uint8_t idx, uint32_t start_ms)
+{
+    const BackgroundTrack *track = &BACKGROUND_PLAYLIST[idx];
+    background_idx = idx;
+    background_start_ms = start_ms;
+    background_playing = true;
+    audio_sink->playFolder(track->folder, track->track);
+}
+
+// Move on to the next track of the playlist
+static void nextBackgroundTrack(uint32_t start_ms, uint32_t now_ms)
+{
+    if (trace_hook != NULL)
+    {
+        trace_hook(NULL, start_ms, now_ms);
+    }
+    startBackgroundTrack((background_idx + 1) % NUM_BACKGROUND_TRACKS, start_ms);
+}
+
+static void issueCue(const AudioCue *cue, uint32_t deadline_ms, uint32_t now_ms)
+{
+    if (trace_hook != NULL)
+    {
+        trace_hook(cue, deadline_ms, now_ms);
+    }
+
+    switch (cue->kind)
+    {
+    case CUE_VOLUME:
+        audio_sink->volume(cue->value == CUE_VOLUME_CONFIGURED ? config.volume : (uint8_t)cue->value);
+        break;
+    case CUE_BACKGROUND:
+        startBackgroundTrack(0, deadline_ms);
+        break;
+    case CUE_VOICE:
+        audio_sink->advertise(cue->value);
+        break;
+    case CUE_STOP:
+        background_playing = false;
+        audio_sink->stop();
+        break;
+    default:
+        break;
+    }
+}
+
+void audioCuesBegin(AudioSink *sink, uint32_t lead)
+{
+    audio_sink = sink;
+    lead_ms = lead;
+    current_phase = -1;
+    next_start_ms = AUDIO_TIME_UNKNOWN;
+    background_playing = false;
+
+    for (size_t i = 0; i < NUM_CUES; i++)
+    {
+        cue_issued[i] = false;
+    }
+}
+
+void audioCuesSetTraceHook(AudioCueTraceHook hook)
+{
+    trace_hook = hook;
+}
+
+void audioCuesSetLead(uint32_t lead)
+{
+    lead_ms = lead;
+}
+
+uint32_t audioCuesLead()
+{
+    return lead_ms;
+}
+
+void audioCuesPhaseStarted(int phase, uint32_t at_ms)
+{
+    // Keep the flags of cues that were already sent early for this phase,
+    //   everything else is fair game again
+    for (size_t i = 0; i < NUM_CUES; i++)
+    {
+        if (AUDIO_CUES[i].phase != phase)
+        {
+            cue_issued[i] = false;
+        }
+    }
+
+    current_phase = phase;
+    current_start_ms = at_ms;
+    next_start_ms = AUDIO_TIME_UNKNOWN;
+}
+
+void audioCuesPredictNextPhase(uint32_t at_ms)
+{
+    next_start_ms = at_ms;
+}
+
+void audioCuesPoll(uint32_t now_ms)
+{
+    if (audio_sink == NULL || current_phase < 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < NUM_CUES; i++)
+    {
+        const AudioCue *cue = &AUDIO_CUES[i];
+        if (cue_issued[i])
+        {
+            continue;
+        }
+
+        uint32_t base_ms;
+        if (cue->phase == current_phase)
+        {
+            base_ms = current_start_ms;
+        }
+        else if (cue->phase == current_phase + 1 && next_start_ms != AUDIO_TIME_UNKNOWN)
+        {
+            base_ms = next_start_ms;
+        }
+        else
+        {
+            continue;
+        }
+
+        uint32_t deadline_ms = base_ms + cue->offset_ms;
+        if (isDue(now_ms, deadline_ms))
+        {
+            issueCue(cue, deadline_ms, now_ms);
+            cue_issued[i] = true;
+        }
+    }
+
+    // Start the next background track just as the current one ends, so
+    //   the player never goes quiet between them
+    if (background_playing)
+    {
+        uint32_t duration_ms = trackDuration(background_idx);
+        uint32_t end_ms = background_start_ms + duration_ms;
+        if (duration_ms > 0 && isDue(now_ms, end_ms))
+        {
+            nextBackgroundTrack(end_ms, now_ms);
+        }
+    }
+}
+
+void audioCuesTrackFinished(uint32_t now_ms)
+{
+    // Tracks with a known length were already followed up in audioCuesPoll().
+    //   One that isn't known has now played through, which is its length:
+    //   only this time is there a gap before the next.
+    if (background_playing && trackDuration(background_idx) == 0 &&
+        (int32_t)(now_ms - background_start_ms) >= AUDIO_MIN_TRACK_MS)
+    {
+        measured_ms[background_idx] = now_ms - background_start_ms;
+        nextBackgroundTrack(now_ms, now_ms);
+    }
+}
+
+void audioCuesPlayerReset(uint32_t now_ms)
+{
+    // Maybe a different card
+    for (size_t i = 0; i < NUM_BACKGROUND_TRACKS; i++)
+    {
+        measured_ms[i] = 0;
+    }
+    if (audio_sink != NULL && background_playing)
+    {
+        startBackgroundTrack(background_idx, now_ms);
+    }
+}
+
+void audioCuesStop()
+{
+    if (audio_sink != NULL && background_playing)
+    {
+        audio_sink->stop();
+    }
+    background_playing = false;
+    current_phase = -1;
+    next_start_ms = AUDIO_TIME_UNKNOWN;
+}
+
+void audioCuesSetVolume(uint8_t level)
+{
+    if (audio_sink != NULL)
+    {
+        audio_sink->volume(level);
+    }
+}
+
+uint32_t audioCuesPositionMs(uint32_t now_ms)
+{
+    if (!background_playing)
+    {
+        return AUDIO_TIME_UNKNOWN;
+    }
+
+    int32_t pos = (int32_t)(now_ms - background_start_ms);
+    return pos < 0 ? 0 : (uint32_t)pos;
+}
@@ -0,0 +1,375 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include "DFRobotDFPlayerMini.h"
+#include "audio.h"
+#include "audio_backend.h"
+#include "audio_cues.h"
+#include "config.h"
+#include "clock.h"
+
+// *** Latency calibration *** //
+#define CALIBRATION_ROUNDS 4
+// Give up waiting for the BUSY pin after this long
+#define ONSET_TIMEOUT_MS 1000
+// Where the statistics are kept in NVS
+#define LATENCY_NVS_NAMESPACE "dfplayer"
+#define LATENCY_NVS_KEY "latency"
+
+// *** DF Player Serial *** //
+static DFRobotDFPlayerMini music;
+
+static portMUX_TYPE latency_mux = portMUX_INITIALIZER_UNLOCKED;
+static LatencyModel latency;
+static bool latency_dirty = false;
+
+// When the last play command went out while the player was idle, and when
+//   the BUSY pin last fell, the low 32 bits of clockUs() so the interrupt's
+//   write is a single store. Only ever subtracted. 0 = nothing pending.
+static volatile uint32_t onset_sent_us = 0;
+static volatile uint32_t busy_fell_us = 0;
+
+static void IRAM_ATTR busyFell()
+{
+    busy_fell_us = (uint32_t)clockUs();
+}
+
+static bool playerBusy()
+{
+    return digitalRead(DFPLAYER_BUSY_PIN) == LOW;
+}
+
+static void addSample(LatencyStats *stats, uint32_t ms)
+{
+    portENTER_CRITICAL(&latency_mux);
+    latencyStatsAdd(stats, ms);
+    latency_dirty = true;
+    portEXIT_CRITICAL(&latency_mux);
+}
+
+static void updateLead()
+{
+    audioCuesSetLead(audioBackendLeadMs());
+}
+
+// Sends the scheduler's commands straight to the DFPlayer, timing each one
+class DFPlayerSink : public AudioSink
+{
+public:
+    void playFolder(uint8_t folder, uint8_t track) override
+    {
+        // Only a player that was idle gives a clean BUSY edge
+        bool idle = !playerBusy();
+        if (idle)
+        {
+            busy_fell_us = 0;
+        }
+
+        int64_t t0 = clockUs();
+        music.playFolder(folder, track);
+        finish(t0);
+
+        // The library returns once the previous command's ACK is in and
+        //   this one is on the wire, the onset counts from there
+        if (idle)
+        {
+            onset_sent_us = (uint32_t)clockUs();
+        }
+    }
+    void advertise(uint16_t track) override
+    {
+        int64_t t0 = clockUs();
+        music.advertise(track);
+        finish(t0);
+    }
+    void volume(uint8_t level) override
+    {
+        int64_t t0 = clockUs();
+        music.volume(level);
+        finish(t0);
+    }
+    void stop() override
+    {
+        int64_t t0 = clockUs();
+        music.stop();
+        finish(t0);
+    }
+
+private:
+    // With ACKs on, the library waits for the previous command's ACK
+    //   before sending, so this is how long the audio task was held up
+    void finish(int64_t t0) { addSample(&latency.block, (clockUs() - t0) / 1000); }
+};
+
+static DFPlayerSink dfplayer_sink;
+
+static void printDetail(uint8_t type, int value)
+{
+    switch (type) {
+      case TimeOut:
+        Serial.println(F("Time Out!"));
+        break;
+      case WrongStack:
+        Serial.println(F("Stack Wrong!"));
+        break;
+      case DFPlayerCardInserted:
+        Serial.println(F("Card Inserted!"));
+        break;
+      case DFPlayerCardRemoved:
+        Serial.println(F("Card Removed!"));
+        break;
+      case DFPlayerCardOnline:
+        Serial.println(F("Card Online!"));
+        break;
+      case DFPlayerUSBInserted:
+        Serial.println("USB Inserted!");
+        break;
+      case DFPlayerUSBRemoved:
+        Serial.println("USB Removed!");
+        break;
+      case DFPlayerPlayFinished:
+        Serial.print(F("Number:"));
+        Serial.print(value);
+        Serial.println(F(" Play Finished!"));
+        break;
+      case DFPlayerError:
+        Serial.print(F("DFPlayerError:"));
+        switch (value) {
+          case Busy:
+            Serial.println(F("Card not found"));
+            break;
+          case Sleeping:
+            Serial.println(F("Sleeping"));
+            break;
+          case SerialWrongStack:
+            Serial.println(F("Get Wrong Stack"));
+            break;
+          case CheckSumNotMatch:
+            Serial.println(F("Check Sum Not Match"));
+            break;
+          case FileIndexOut:
+            Serial.println(F("File Index Out of Bound"));
+            break;
+          case FileMismatch:
+            Serial.println(F("Cannot Find File"));
+            break;
+          case Advertise:
+            Serial.println(F("In Advertise"));
+            break;
+          default:
+            break;
+        }
+        break;
+      default:
+        break;
+    }
+}
+
+static bool waitForBusy(bool busy, uint32_t timeout_ms)
+{
+    int64_t start = clockMs();
+    while (playerBusy() != busy)
+    {
+        if (clockMs() - start > timeout_ms)
+        {
+            return false;
+        }
+        delay(1);
+    }
+    return true;
+}
+
+// Keeps the latency model in NVS and measures the DFPlayer for
+//   latencyModelStart()
+class DFPlayerLatency : public LatencyPlayer
+{
+public:
+    bool load(LatencyModel *model) override
+    {
+        Preferences prefs;
+        prefs.begin(LATENCY_NVS_NAMESPACE, true);
+        size_t len = prefs.getBytes(LATENCY_NVS_KEY, model, sizeof(*model));
+        prefs.end();
+        return len == sizeof(*model);
+    }
+
+    void save(const LatencyModel *model) override
+    {
+        Preferences prefs;
+        prefs.begin(LATENCY_NVS_NAMESPACE, false);
+        prefs.putBytes(LATENCY_NVS_KEY, model, sizeof(*model));
+        prefs.end();
+    }
+
+    // Before anything else talks to the player
+    void calibrate(LatencyModel *model) override
+    {
+        // Round trip: a query blocks until the reply has arrived
+        int vol = 0;
+        for (int i = 0; i < CALIBRATION_ROUNDS; i++)
+        {
+            int64_t t0 = clockUs();
+            vol = music.readVolume();
+            addSample(&model->rtt, (clockUs() - t0) / 1000);
+        }
+        if (vol < 0)
+        {
+            vol = config.volume;
+        }
+
+        // ACK: the second of two back-to-back commands is only sent once the
+        //   first one has been acknowledged
+        for (int i = 0; i < CALIBRATION_ROUNDS; i++)
+        {
+            music.volume(vol);
+            int64_t t1 = clockUs();
+            music.volume(vol);
+            addSample(&model->ack, (clockUs() - t1) / 1000);
+        }
+
+        // Onset: start the first track silently and wait for the BUSY pin.
+        //   One timeout is enough to tell it isn't wired up.
+        music.volume(0);
+        for (int i = 0; i < CALIBRATION_ROUNDS; i++)
+        {
+            if (!waitForBusy(false, ONSET_TIMEOUT_MS))
+            {
+                break;
+            }
+
+            // Timed from when the command is on the wire, not from waiting
+            //   for the previous one's ACK
+            music.playFolder(1, 1);
+            int64_t t0 = clockUs();
+            bool heard = waitForBusy(true, ONSET_TIMEOUT_MS);
+            if (heard)
+            {
+                addSample(&model->onset, (clockUs() - t0) / 1000);
+            }
+            music.stop();
+            if (!heard)
+            {
+                break;
+            }
+        }
+        music.volume(vol);
+    }
+};
+
+static DFPlayerLatency dfplayer_latency;
+
+// After a session, with what it measured
+static void saveLatency()
+{
+    LatencyModel copy;
+    portENTER_CRITICAL(&latency_mux);
+    copy = latency;
+    latency_dirty = false;
+    portEXIT_CRITICAL(&latency_mux);
+    latencyModelSave(&copy, &dfplayer_latency);
+}
+
+// Turn a BUSY edge after a play command into an onset sample
+static void checkOnset()
+{
+    uint32_t sent = onset_sent_us;
+    if (sent == 0)
+    {
+        return;
+    }
+
+    uint32_t fell = busy_fell_us;
+    if (fell != 0 && (int32_t)(fell - sent) >= 0)
+    {
+        addSample(&latency.onset, (fell - sent) / 1000);
+        onset_sent_us = 0;
+        updateLead();
+    }
+    else if ((uint32_t)clockUs() - sent > ONSET_TIMEOUT_MS * 1000UL)
+    {
+        onset_sent_us = 0;
+    }
+}
+
+AudioSink *audioBackendBegin()
+{
+    Serial2.begin(9600, SERIAL_8N1, RXD2, TXD2);
+    if (!music.begin(Serial2, true, true)) {  //Use serial to communicate with mp3.
+      return NULL;
+    }
+
+    pinMode(DFPLAYER_BUSY_PIN, INPUT_PULLUP);
+
+    latencyModelStart(&latency, &dfplayer_latency);
+    latency_dirty = false;
+
+    attachInterrupt(digitalPinToInterrupt(DFPLAYER_BUSY_PIN), busyFell, FALLING);
+    return &dfplayer_sink;
+}
+
+uint32_t audioBackendLeadMs()
+{
+    return latencyModelLeadMs(&latency, AUDIO_DEFAULT_LEAD_MS);
+}
+
+void audioBackendPoll(uint32_t now_ms)
+{
+    if (music.available()) {
+      uint8_t type = music.readType();
+      int value = music.read();
+#ifdef DEBUG_MUSIC
+      printDetail(type, value); //Print the detail message from DFPlayer to handle different errors and states.
+#endif
+      if (type == DFPlayerPlayFinished) {
+        audioCuesTrackFinished(now_ms);
+      } else if (type == DFPlayerCardInserted || type == DFPlayerCardOnline) {
+        audioCuesPlayerReset(now_ms);
+      }
+    }
+
+    checkOnset();
+}
+
+void audioBackendSessionEnded()
+{
+    // A good time for the flash write
+    if (latency_dirty)
+    {
+        saveLatency();
+    }
+}
+
+const char *audioBackendName()
+{
+    return "DFPlayer Mini";
+}
+
+LatencyModel audioLatency()
+{
+    portENTER_CRITICAL(&latency_mux);
+    LatencyModel copy = latency;
+    portEXIT_CRITICAL(&latency_mux);
+    return copy;
+}
+
+static void printStats(Print &out, const char *name, const LatencyStats *stats)
+{
+    if (stats->count == 0)
+    {
+        out.printf("  %-6s no samples\n", name);
+        return;
+    }
+    out.printf("  %-6s n=%lu min=%u mean=%lu p90=%lu max=%u ms\n", name, (unsigned long)stats->count,
+               stats->min_ms, (unsigned long)latencyStatsMean(stats),
+               (unsigned long)latencyStatsPercentile(stats, 90), stats->max_ms);
+}
+
+void audioPrintLatency(Print &out)
+{
+    LatencyModel copy = audioLatency();
+    out.println(F("DFPlayer latency:"));
+    printStats(out, "rtt", &copy.rtt);
+    printStats(out, "ack", &copy.ack);
+    printStats(out, "onset", &copy.onset);
+    printStats(out, "block", &copy.block);
+    out.printf("  lead   %lu ms\n", (unsigned long)audioCuesLead());
+}
@@ -0,0 +1,370 @@
+#include <string.h>
+#include "audio_engine.h"
+#include "heap_guard.h"
+
+#define WAV_FORMAT_PCM 0x0001
+#define WAV_FORMAT_IMA_ADPCM 0x0011
+
+// DFPlayer volume 0..30 to a Q15 gain, 1.5 dB per step
+static const uint16_t VOLUME_GAIN_Q15[31] = {
+    0, 219, 260, 309, 368, 437, 519, 617, 734, 872, 1036,
+    1232, 1464, 1740, 2067, 2457, 2920, 3471, 4125, 4903, 5827,
+    6925, 8231, 9782, 11626, 13818, 16422, 19518, 23197, 27570, 32767};
+
+// *** IMA ADPCM tables *** //
+static const int8_t IMA_INDEX_TABLE[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8};
+
+static const int16_t IMA_STEP_TABLE[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+static uint16_t le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+ClipDecoder::ClipDecoder() : file(NULL), format(0), block_align(0), samples_per_block(0), data_left(0), pcm_pos(0), pcm_len(0)
+{
+}
+
+ClipDecoder::~ClipDecoder()
+{
+    close();
+}
+
+bool ClipDecoder::open(const char *path)
+{
+    close();
+
+    // The filesystem takes memory for each open file. stdio's buffer is
+    //   left out, the blocks are read whole into block[] anyway.
+    heapGuardExpect(true);
+    file = fopen(path, "rb");
+    if (file != NULL)
+    {
+        setvbuf(file, NULL, _IONBF, 0);
+    }
+    heapGuardExpect(false);
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    if (!parseHeader())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ClipDecoder::close()
+{
+    if (file != NULL)
+    {
+        fclose(file);
+        file = NULL;
+    }
+    pcm_pos = 0;
+    pcm_len = 0;
+    data_left = 0;
+}
+
+// Walk the RIFF chunks up to the start of the sample data
+bool ClipDecoder::parseHeader()
+{
+    uint8_t hdr[12];
+    if (fread(hdr, 1, 12, file) != 12 || memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0)
+    {
+        return false;
+    }
+
+    bool have_fmt = false;
+    while (true)
+    {
+        uint8_t chunk[8];
+        if (fread(chunk, 1, 8, file) != 8)
+        {
+            return false;
+        }
+        uint32_t size = le32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0)
+        {
+            uint8_t fmt[20];
+            size_t want = size < sizeof(fmt) ? size : sizeof(fmt);
+            if (want < 16 || fread(fmt, 1, want, file) != want)
+            {
+                return false;
+            }
+            format = le16(fmt);
+            uint16_t channels = le16(fmt + 2);
+            uint32_t rate = le32(fmt + 4);
+            block_align = le16(fmt + 12);
+            uint16_t bits = le16(fmt + 14);
+
+            if (channels != 1 || rate != AUDIO_ENGINE_RATE)
+            {
+                return false;
+            }
+            if (format == WAV_FORMAT_PCM && bits == 16)
+            {
+                samples_per_block = CLIP_MAX_BLOCK / 2;
+                block_align = CLIP_MAX_BLOCK;
+            }
+            else if (format == WAV_FORMAT_IMA_ADPCM && bits == 4 && block_align <= CLIP_MAX_BLOCK && block_align > 4)
+            {
+                samples_per_block = (block_align - 4) * 2 + 1;
+            }
+            else
+            {
+                return false;
+            }
+
+            // Skip whatever is left of the chunk, chunks are word aligned
+            if (fseek(file, (long)(size - want + (size & 1)), SEEK_CUR) != 0)
+            {
+                return false;
+            }
+            have_fmt = true;
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            data_left = size;
+            return have_fmt;
+        }
+        else if (fseek(file, (long)(size + (size & 1)), SEEK_CUR) != 0)
+        {
+            return false;
+        }
+    }
+}
+
+bool ClipDecoder::decodeBlock()
+{
+    size_t want = data_left < block_align ? data_left : block_align;
+    if (want == 0)
+    {
+        return false;
+    }
+    size_t got = fread(block, 1, want, file);
+    data_left -= want;
+    pcm_pos = 0;
+
+    if (format == WAV_FORMAT_PCM)
+    {
+        pcm_len = got / 2;
+        for (size_t i = 0; i < pcm_len; i++)
+        {
+            pcm[i] = (int16_t)le16(block + 2 * i);
+        }
+        return pcm_len > 0;
+    }
+
+    // IMA ADPCM: a header with the first sample and step index, then two
+    //   samples per byte, low nibble first
+    if (got < 4)
+    {
+        pcm_len = 0;
+        return false;
+    }
+    int32_t predictor = (int16_t)le16(block);
+    int index = block[2];
+    if (index > 88)
+    {
+        index = 88;
+    }
+
+    pcm[0] = (int16_t)predictor;
+    pcm_len = 1;
+    for (size_t i = 4; i < got; i++)
+    {
+        for (int shift = 0; shift <= 4; shift += 4)
+        {
+            uint8_t nibble = (block[i] >> shift) & 0x0F;
+            int32_t step = IMA_STEP_TABLE[index];
+
+            int32_t diff = step >> 3;
+            if (nibble & 4)
+            {
+                diff += step;
+            }
+            if (nibble & 2)
+            {
+                diff += step >> 1;
+            }
+            if (nibble & 1)
+            {
+                diff += step >> 2;
+            }
+            predictor += (nibble & 8) ? -diff : diff;
+            if (predictor > 32767)
+            {
+                predictor = 32767;
+            }
+            else if (predictor < -32768)
+            {
+                predictor = -32768;
+            }
+
+            index += IMA_INDEX_TABLE[nibble];
+            if (index < 0)
+            {
+                index = 0;
+            }
+            else if (index > 88)
+            {
+                index = 88;
+            }
+
+            pcm[pcm_len++] = (int16_t)predictor;
+        }
+    }
+    return true;
+}
+
+size_t ClipDecoder::read(int16_t *out, size_t frames)
+{
+    size_t done = 0;
+    while (done < frames && file != NULL)
+    {
+        if (pcm_pos >= pcm_len && !decodeBlock())
+        {
+            break;
+        }
+
+        size_t n = pcm_len - pcm_pos;
+        if (n > frames - done)
+        {
+            n = frames - done;
+        }
+        memcpy(out + done, pcm + pcm_pos, n * sizeof(int16_t));
+        pcm_pos += n;
+        done += n;
+    }
+    return done;
+}
+
+AudioEngine::AudioEngine(const char *root) : root(root), vol(10), missing(0)
+{
+}
+
+void AudioEngine::playFolder(uint8_t folder, uint8_t track)
+{
+    Command cmd = {CMD_PLAY_FOLDER, folder, track};
+    commands.push(cmd);
+}
+
+void AudioEngine::advertise(uint16_t track)
+{
+    Command cmd = {CMD_ADVERTISE, 0, track};
+    commands.push(cmd);
+}
+
+void AudioEngine::volume(uint8_t level)
+{
+    // Takes effect on the next rendered block, no need to queue it
+    vol.store(level > 30 ? 30 : level);
+}
+
+void AudioEngine::stop()
+{
+    Command cmd = {CMD_STOP, 0, 0};
+    commands.push(cmd);
+}
+
+bool AudioEngine::popFinished()
+{
+    uint8_t dummy;
+    return finished.pop(dummy);
+}
+
+void AudioEngine::openClip(ClipDecoder &decoder, const char *path)
+{
+    if (!decoder.open(path))
+    {
+        missing++;
+    }
+}
+
+void AudioEngine::handle(const Command &cmd)
+{
+    char path[64];
+    switch (cmd.type)
+    {
+    case CMD_PLAY_FOLDER:
+        snprintf(path, sizeof(path), "%s/%02u/%03u.wav", root, cmd.folder, cmd.track);
+        advert.close();
+        openClip(background, path);
+        break;
+    case CMD_ADVERTISE:
+        // Like the DFPlayer, adverts only interrupt a playing track
+        if (background.isOpen())
+        {
+            snprintf(path, sizeof(path), "%s/advert/%04u.wav", root, cmd.track);
+            openClip(advert, path);
+        }
+        break;
+    case CMD_STOP:
+        advert.close();
+        background.close();
+        break;
+    default:
+        break;
+    }
+}
+
+void AudioEngine::render(int16_t *out, size_t frames)
+{
+    Command cmd;
+    while (commands.pop(cmd))
+    {
+        handle(cmd);
+    }
+
+    size_t done = 0;
+
+    // An advert plays instead of the background, which picks up where it
+    //   left off once the advert is over
+    if (advert.isOpen())
+    {
+        done = advert.read(out, frames);
+        if (done < frames)
+        {
+            advert.close();
+        }
+    }
+
+    if (done < frames && background.isOpen())
+    {
+        size_t n = background.read(out + done, frames - done);
+        done += n;
+        if (done < frames)
+        {
+            background.close();
+            finished.push(1);
+        }
+    }
+
+    memset(out + done, 0, (frames - done) * sizeof(int16_t));
+
+    int32_t gain = VOLUME_GAIN_Q15[vol.load()];
+    for (size_t i = 0; i < done; i++)
+    {
+        out[i] = (int16_t)((out[i] * gain) >> 15);
+    }
+}
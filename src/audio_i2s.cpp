@@ -0,0 +1,141 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "driver/i2s_std.h"
+#include "audio.h"
+#include "audio_backend.h"
+#include "audio_cues.h"
+#include "audio_engine.h"
+#include "clock.h"
+#include "supervisor.h"
+#include "static_task.h"
+
+// *** I2S output *** //
+// Two DMA buffers: one is being played while the task renders the other
+#define I2S_DMA_BUFFERS 2
+#define I2S_DMA_FRAMES 128 // 8 ms at 16 kHz
+#define I2S_TASK_STACK 3072
+#define I2S_TASK_PRIORITY 5
+#define I2S_TASK_CORE 0
+// Longest the task may go between heartbeats, a dozen buffers
+#define I2S_HEARTBEAT_MS 100
+
+// A command is picked up by the next render() and then waits behind the
+//   buffers already queued for DMA
+#define I2S_LEAD_MS ((I2S_DMA_BUFFERS + 1) * I2S_DMA_FRAMES * 1000 / AUDIO_ENGINE_RATE)
+
+// Clips live in the LittleFS partition, see audio_engine.h for the layout.
+//   Upload them from data/ with: pio run -e esp32_i2s -t uploadfs
+static AudioEngine engine("/littlefs");
+
+static StaticTask<I2S_TASK_STACK> i2s_task;
+static i2s_chan_handle_t tx_chan = NULL;
+static int16_t render_buf[I2S_DMA_FRAMES];
+static volatile uint32_t render_us_max = 0;
+
+static void i2sTask(void *arg)
+{
+    supervisorWatch(HEALTH_TASK_I2S, I2S_HEARTBEAT_MS);
+    while (true)
+    {
+        supervisorBeat(HEALTH_TASK_I2S);
+        int64_t t0 = clockUs();
+        engine.render(render_buf, I2S_DMA_FRAMES);
+        uint32_t spent = clockUs() - t0;
+        if (spent > render_us_max)
+        {
+            render_us_max = spent;
+        }
+
+        // Blocks until DMA has a free buffer, which paces the task
+        size_t written = 0;
+        i2s_channel_write(tx_chan, render_buf, sizeof(render_buf), &written, portMAX_DELAY);
+    }
+}
+
+AudioSink *audioBackendBegin()
+{
+    if (!LittleFS.begin(false))
+    {
+        return NULL;
+    }
+
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
+    chan_cfg.dma_desc_num = I2S_DMA_BUFFERS;
+    chan_cfg.dma_frame_num = I2S_DMA_FRAMES;
+    chan_cfg.auto_clear = true; // play silence rather than stale data on underrun
+    if (i2s_new_channel(&chan_cfg, &tx_chan, NULL) != ESP_OK)
+    {
+        return NULL;
+    }
+
+    i2s_std_config_t std_cfg = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(AUDIO_ENGINE_RATE),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_MONO),
+        .gpio_cfg = {
+            .mclk = I2S_GPIO_UNUSED,
+            .bclk = (gpio_num_t)I2S_BCLK,
+            .ws = (gpio_num_t)I2S_LRCK,
+            .dout = (gpio_num_t)I2S_DOUT,
+            .din = I2S_GPIO_UNUSED,
+            .invert_flags = {
+                .mclk_inv = false,
+                .bclk_inv = false,
+                .ws_inv = false,
+            },
+        },
+    };
+    if (i2s_channel_init_std_mode(tx_chan, &std_cfg) != ESP_OK || i2s_channel_enable(tx_chan) != ESP_OK)
+    {
+        // Free the channel so the next try can have it
+        i2s_del_channel(tx_chan);
+        tx_chan = NULL;
+        return NULL;
+    }
+
+    if (!i2s_task.start(i2sTask, "i2s", I2S_TASK_PRIORITY, I2S_TASK_CORE))
+    {
+        i2s_channel_disable(tx_chan);
+        i2s_del_channel(tx_chan);
+        tx_chan = NULL;
+        return NULL;
+    }
+    return &engine;
+}
+
+uint32_t audioBackendLeadMs()
+{
+    return I2S_LEAD_MS;
+}
+
+void audioBackendPoll(uint32_t now_ms)
+{
+    while (engine.popFinished())
+    {
+        audioCuesTrackFinished(now_ms);
+    }
+}
+
+void audioBackendSessionEnded()
+{
+}
+
+const char *audioBackendName()
+{
+    return "I2S engine";
+}
+
+LatencyModel audioLatency()
+{
+    // Nothing to measure, the latency is fixed by the DMA buffering
+    LatencyModel model;
+    latencyModelInit(&model);
+    return model;
+}
+
+void audioPrintLatency(Print &out)
+{
+    out.println(F("I2S engine:"));
+    out.printf("  lead   %lu ms\n", (unsigned long)audioCuesLead());
+    out.printf("  render max %lu us per %u frames\n", (unsigned long)render_us_max, I2S_DMA_FRAMES);
+    out.printf("  missing clips %lu\n", (unsigned long)engine.missingClips());
+}
@@ -0,0 +1,98 @@
+#include <Arduino.h>
+#include "battery.h"
+#include "static_task.h"
+
+// *** Sampling task *** //
+#define BATTERY_TASK_STACK 2048
+#define BATTERY_TASK_PRIORITY 1
+#define BATTERY_TASK_CORE 0
+#define BATTERY_SAMPLE_MS 1000
+// Readings averaged per sample
+#define BATTERY_BURST 8
+
+static StaticTask<BATTERY_TASK_STACK> battery_task;
+static FuelGauge gauge;
+static volatile uint8_t battery_level = BATTERY_OK;
+static volatile uint8_t battery_soc = 100;
+static volatile uint16_t battery_mv = 0;
+static volatile uint16_t battery_load_ma = GAUGE_BASE_MA;
+
+#ifdef BATTERY_PIN
+
+static uint16_t readCell()
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < BATTERY_BURST; i++)
+    {
+        sum += analogReadMilliVolts(BATTERY_PIN);
+    }
+    return sum * BATTERY_DIVIDER / BATTERY_BURST;
+}
+
+static void sample()
+{
+    fuelGaugePush(&gauge, readCell(), battery_load_ma);
+    battery_mv = fuelGaugeMv(&gauge);
+    battery_soc = gauge.soc;
+    battery_level = gauge.level;
+}
+
+static void batteryTask(void *arg)
+{
+    const TickType_t period = pdMS_TO_TICKS(BATTERY_SAMPLE_MS);
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (true)
+    {
+        vTaskDelayUntil(&last_wake, period);
+        sample();
+    }
+}
+
+bool batteryBegin()
+{
+    fuelGaugeInit(&gauge);
+    analogSetPinAttenuation(BATTERY_PIN, ADC_11db);
+    if (readCell() < BATTERY_MIN_PLAUSIBLE_MV)
+    {
+        return false;
+    }
+    battery_load_ma = gaugeLoadMa(getCpuFrequencyMhz(), 0, false);
+    sample();
+
+    return battery_task.start(batteryTask, "battery", BATTERY_TASK_PRIORITY, BATTERY_TASK_CORE);
+}
+
+#else
+
+bool batteryBegin()
+{
+    return false;
+}
+
+#endif
+
+uint8_t batteryLevel()
+{
+    return battery_level;
+}
+
+const PowerPolicy *batteryPolicy()
+{
+    return &POWER_POLICIES[battery_level];
+}
+
+uint8_t batterySoc()
+{
+    return battery_soc;
+}
+
+uint16_t batteryMv()
+{
+    return battery_mv;
+}
+
+void batterySetLoad(uint16_t load_ma)
+{
+    battery_load_ma = load_ma;
+}
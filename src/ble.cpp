@@ -0,0 +1,250 @@
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include "freertos/queue.h"
+#include "ble.h"
+#include "ota.h"
+#include "usage.h"
+#include "clock.h"
+#include "heap_guard.h"
+#include "static_task.h"
+
+// *** Companion task *** //
+#define BLE_TASK_STACK 4096
+#define BLE_TASK_PRIORITY 1
+#define BLE_TASK_CORE 0
+#define BLE_PUMP_MS 50
+#define BLE_EVENT_QUEUE_LENGTH 8
+
+enum BleEventType : uint8_t
+{
+    BLE_EVENT_CONNECTED = 0,
+    BLE_EVENT_DISCONNECTED,
+    BLE_EVENT_MTU,
+    BLE_EVENT_CONTROL,
+    BLE_EVENT_OTA, // value is 1 while an update is coming in
+};
+
+// From the NimBLE host task to ours, which owns the Companion
+typedef struct BleEvent
+{
+    uint8_t type;
+    uint16_t conn_handle;
+    uint32_t value;
+} BleEvent;
+
+static QueueHandle_t ble_events = NULL;
+static QueueHandle_t ble_state = NULL;
+static StaticQueue<BleEvent, BLE_EVENT_QUEUE_LENGTH> ble_events_mem;
+static StaticQueue<CompanionState, 1> ble_state_mem;
+static StaticTask<BLE_TASK_STACK> ble_task;
+
+static NimBLEServer *ble_server = NULL;
+static NimBLECharacteristic *ble_chars[2] = {NULL, NULL};
+
+class NimBleLink : public CompanionLink
+{
+public:
+    uint16_t payloadSize() override { return mtu - 3; }
+
+    bool notify(uint8_t characteristic, const uint8_t *data, size_t len) override
+    {
+        NimBLECharacteristic *c = ble_chars[characteristic];
+        if (characteristic == COMPANION_STATE)
+        {
+            c->setValue(data, len);
+        }
+        return c->notify(data, len, conn_handle);
+    }
+
+    void setFast(bool fast) override
+    {
+        if (fast)
+        {
+            ble_server->updateConnParams(conn_handle, BLE_FAST_MIN_INTERVAL, BLE_FAST_MAX_INTERVAL, BLE_FAST_LATENCY,
+                                         BLE_SUPERVISION_TIMEOUT);
+        }
+        else
+        {
+            ble_server->updateConnParams(conn_handle, BLE_SLOW_MIN_INTERVAL, BLE_SLOW_MAX_INTERVAL, BLE_SLOW_LATENCY,
+                                         BLE_SUPERVISION_TIMEOUT);
+        }
+    }
+
+    uint16_t mtu = 23;
+    uint16_t conn_handle = 0;
+};
+
+static NimBleLink ble_link;
+static Companion companion;
+
+static void postEvent(uint8_t type, uint16_t conn_handle, uint32_t value)
+{
+    BleEvent event = {type, conn_handle, value};
+    xQueueSend(ble_events, &event, 0);
+}
+
+class ServerCallbacks : public NimBLEServerCallbacks
+{
+    void onConnect(NimBLEServer *server, NimBLEConnInfo &info) override
+    {
+        postEvent(BLE_EVENT_CONNECTED, info.getConnHandle(), info.getMTU());
+    }
+
+    void onDisconnect(NimBLEServer *server, NimBLEConnInfo &info, int reason) override
+    {
+        postEvent(BLE_EVENT_DISCONNECTED, info.getConnHandle(), reason);
+    }
+
+    void onMTUChange(uint16_t mtu, NimBLEConnInfo &info) override
+    {
+        postEvent(BLE_EVENT_MTU, info.getConnHandle(), mtu);
+    }
+};
+
+class ControlCallbacks : public NimBLECharacteristicCallbacks
+{
+    void onWrite(NimBLECharacteristic *c, NimBLEConnInfo &info) override
+    {
+        // The value comes out as a copy on the heap
+        heapGuardExpect(true);
+        NimBLEAttValue value = c->getValue();
+        if (value.size() >= 4)
+        {
+            const uint8_t *p = value.data();
+            postEvent(BLE_EVENT_CONTROL, info.getConnHandle(),
+                      (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        }
+        heapGuardExpect(false);
+    }
+};
+
+// Updates are handled right here in the host task, so each write is done
+//   with before the next is taken and the phone is paced by the responses
+class OtaCallbacks : public NimBLECharacteristicCallbacks
+{
+    void onWrite(NimBLECharacteristic *c, NimBLEConnInfo &info) override
+    {
+        // So does the value here, and starting an update takes a handle
+        //   from esp_ota_begin()
+        heapGuardExpect(true);
+        NimBLEAttValue value = c->getValue();
+        uint8_t status[OTA_STATUS_SIZE];
+        size_t len = otaCommand(value.data(), value.size(), status);
+        c->notify(status, len, info.getConnHandle());
+        postEvent(BLE_EVENT_OTA, info.getConnHandle(), status[0] == OTA_RECEIVING);
+        heapGuardExpect(false);
+    }
+};
+
+static ServerCallbacks server_callbacks;
+static ControlCallbacks control_callbacks;
+static OtaCallbacks ota_callbacks;
+
+static void handleEvent(const BleEvent *event)
+{
+    switch (event->type)
+    {
+    case BLE_EVENT_CONNECTED:
+        ble_link.conn_handle = event->conn_handle;
+        ble_link.mtu = event->value;
+        companionConnected(&companion);
+        ble_link.setFast(false);
+        break;
+    case BLE_EVENT_DISCONNECTED:
+        companionDisconnected(&companion);
+        break;
+    case BLE_EVENT_MTU:
+        ble_link.mtu = event->value;
+        break;
+    case BLE_EVENT_CONTROL:
+    {
+        uint8_t from[4] = {(uint8_t)event->value, (uint8_t)(event->value >> 8), (uint8_t)(event->value >> 16),
+                           (uint8_t)(event->value >> 24)};
+        companionControl(&companion, from, sizeof(from));
+        break;
+    }
+    case BLE_EVENT_OTA:
+        companionHoldFast(&companion, event->value != 0);
+        break;
+    default:
+        break;
+    }
+}
+
+static void bleTask(void *arg)
+{
+    while (true)
+    {
+        BleEvent event;
+        while (xQueueReceive(ble_events, &event, 0) == pdTRUE)
+        {
+            handleEvent(&event);
+        }
+
+        CompanionState state;
+        if (xQueueReceive(ble_state, &state, 0) == pdTRUE)
+        {
+            companionSetState(&companion, &state);
+        }
+
+        companionPump(&companion, clockMs32());
+        vTaskDelay(pdMS_TO_TICKS(BLE_PUMP_MS));
+    }
+}
+
+bool bleBegin()
+{
+    if (!NimBLEDevice::init(BLE_DEVICE_NAME))
+    {
+        return false;
+    }
+    NimBLEDevice::setMTU(BLE_MTU);
+
+    ble_events = ble_events_mem.create();
+    ble_state = ble_state_mem.create();
+    companionInit(&companion, &ble_link, usageScan);
+
+    ble_server = NimBLEDevice::createServer();
+    // Static, so NimBLE mustn't delete them
+    ble_server->setCallbacks(&server_callbacks, false);
+    ble_server->advertiseOnDisconnect(true);
+
+    NimBLEService *service = ble_server->createService(BLE_SERVICE_UUID);
+    ble_chars[COMPANION_STATE] =
+        service->createCharacteristic(BLE_STATE_UUID, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+    ble_chars[COMPANION_HISTORY] = service->createCharacteristic(BLE_HISTORY_UUID, NIMBLE_PROPERTY::NOTIFY);
+    NimBLECharacteristic *control =
+        service->createCharacteristic(BLE_CONTROL_UUID, NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR);
+    control->setCallbacks(&control_callbacks);
+    if (otaBegin())
+    {
+        NimBLECharacteristic *ota =
+            service->createCharacteristic(BLE_OTA_UUID, NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::NOTIFY);
+        ota->setCallbacks(&ota_callbacks);
+    }
+    service->start();
+
+    NimBLEAdvertising *advertising = NimBLEDevice::getAdvertising();
+    advertising->setName(BLE_DEVICE_NAME);
+    advertising->addServiceUUID(BLE_SERVICE_UUID);
+    advertising->setMinInterval(BLE_ADV_MIN_INTERVAL);
+    advertising->setMaxInterval(BLE_ADV_MAX_INTERVAL);
+
+    if (!ble_task.start(bleTask, "ble", BLE_TASK_PRIORITY, BLE_TASK_CORE))
+    {
+        return false;
+    }
+    return advertising->start();
+}
+
+void blePublishState(uint32_t now_ms, uint8_t status)
+{
+    if (ble_state == NULL)
+    {
+        return;
+    }
+
+    CompanionState state;
+    companionSessionState(&state, now_ms, status);
+    xQueueOverwrite(ble_state, &state);
+}
@@ -0,0 +1,114 @@
+#include "brightness.h"
+
+// Lowest level for each intensity step. Eyes judge brightness roughly on a
+//   power law, so the steps are spaced as level = 4095 * (step / 16)^2.2:
+//   close together in the dark, far apart in daylight.
+static const uint16_t BRIGHTNESS_GAMMA[BRIGHTNESS_STEPS] = {
+    0, 9, 42, 103, 194, 317, 473, 664,
+    891, 1155, 1456, 1796, 2175, 2593, 3053, 3553};
+
+// How far past a step boundary the level must go before the target moves,
+//   proportional so it scales with the steps
+static uint16_t hysteresis(uint16_t level)
+{
+    return level / 8 + 8;
+}
+
+uint8_t brightnessForLevel(uint16_t level)
+{
+    uint8_t step = BRIGHTNESS_STEPS - 1;
+    while (step > 0 && level < BRIGHTNESS_GAMMA[step])
+    {
+        step--;
+    }
+
+    if (step < BRIGHTNESS_MIN)
+    {
+        return BRIGHTNESS_MIN;
+    }
+    if (step > BRIGHTNESS_MAX)
+    {
+        return BRIGHTNESS_MAX;
+    }
+    return step;
+}
+
+void ambientFilterInit(AmbientFilter *filter)
+{
+    filter->level_q = 0;
+    filter->target = BRIGHTNESS_DEFAULT;
+    filter->primed = false;
+}
+
+uint16_t ambientFilterLevel(const AmbientFilter *filter)
+{
+    return filter->level_q >> BRIGHTNESS_FILTER_SHIFT;
+}
+
+bool ambientFilterPush(AmbientFilter *filter, uint16_t raw)
+{
+    if (raw > BRIGHTNESS_LEVEL_MAX)
+    {
+        raw = BRIGHTNESS_LEVEL_MAX;
+    }
+
+    uint8_t old_target = filter->target;
+
+    // Start from the first reading rather than ramping up from dark
+    if (!filter->primed)
+    {
+        filter->level_q = (uint32_t)raw << BRIGHTNESS_FILTER_SHIFT;
+        filter->target = brightnessForLevel(raw);
+        filter->primed = true;
+        return filter->target != old_target;
+    }
+
+    filter->level_q -= filter->level_q >> BRIGHTNESS_FILTER_SHIFT;
+    filter->level_q += raw;
+
+    uint16_t level = ambientFilterLevel(filter);
+    uint16_t margin = hysteresis(level);
+
+    uint8_t brighter = brightnessForLevel(level > margin ? level - margin : 0);
+    uint8_t darker = brightnessForLevel(level + margin);
+    if (brighter > filter->target)
+    {
+        filter->target = brighter;
+    }
+    else if (darker < filter->target)
+    {
+        filter->target = darker;
+    }
+
+    return filter->target != old_target;
+}
+
+void brightnessRampInit(BrightnessRamp *ramp, uint8_t intensity, uint32_t now_ms)
+{
+    ramp->current = intensity;
+    ramp->last_step_ms = now_ms;
+}
+
+bool brightnessRampStep(BrightnessRamp *ramp, uint8_t target, uint32_t now_ms)
+{
+    if (ramp->current == target)
+    {
+        // So the first step of the next change happens straight away
+        ramp->last_step_ms = now_ms - BRIGHTNESS_RAMP_MS;
+        return false;
+    }
+    if (now_ms - ramp->last_step_ms < BRIGHTNESS_RAMP_MS)
+    {
+        return false;
+    }
+
+    ramp->current += ramp->current < target ? 1 : -1;
+    ramp->last_step_ms = now_ms;
+    return true;
+}
+
+uint32_t brightnessCurrentUa(uint8_t intensity, uint16_t lit_pixels)
+{
+    // mA * 1000 * duty / 8 rows
+    return (uint32_t)lit_pixels * BRIGHTNESS_SEGMENT_MA * 1000 * (2 * intensity + 1) / (32 * 8);
+}
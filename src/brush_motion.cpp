@@ -0,0 +1,191 @@
+#include <string.h>
+#include "brush_motion.h"
+
+// Goertzel coefficients 2 * cos(2 * pi * k / BRUSH_WINDOW) in Q14, k = 1..8
+static const int32_t GOERTZEL_COEFF_Q14[BRUSH_NUM_BINS] = {
+    32610,
+    32138,
+    31357,
+    30274,
+    28899,
+    27246,
+    25330,
+    23170,
+};
+
+// Gravity filter time constant is 2^GRAVITY_SHIFT samples (~0.3 s at 100 Hz)
+#define GRAVITY_SHIFT 5
+
+// Goertzel input is scaled down so the resonators can't overflow 32 bits
+#define GOERTZEL_INPUT_SHIFT 2
+
+static int32_t clamp16(int32_t v)
+{
+    if (v > 32767)
+    {
+        return 32767;
+    }
+    if (v < -32767)
+    {
+        return -32767;
+    }
+    return v;
+}
+
+void brushMotionInit(BrushMotion *bm)
+{
+    memset(bm, 0, sizeof(*bm));
+    bm->state.quadrant = QUADRANT_UNKNOWN;
+}
+
+const char *quadrantName(uint8_t quadrant)
+{
+    switch (quadrant)
+    {
+    case QUADRANT_UPPER_LEFT:
+        return "upper-left";
+    case QUADRANT_UPPER_RIGHT:
+        return "upper-right";
+    case QUADRANT_LOWER_LEFT:
+        return "lower-left";
+    case QUADRANT_LOWER_RIGHT:
+        return "lower-right";
+    default:
+        return "unknown";
+    }
+}
+
+// Decide which quadrant the brush head is in from the direction of gravity.
+//   Bristles facing up means we're brushing the upper teeth, and the
+//   brush head rolls towards the side of the mouth being brushed.
+static uint8_t classifyQuadrant(const int16_t gravity[3], uint8_t previous)
+{
+    int32_t up = gravity[BRUSH_AXIS_UP] * BRUSH_AXIS_UP_SIGN;
+    int32_t side = gravity[BRUSH_AXIS_SIDE] * BRUSH_AXIS_SIDE_SIGN;
+
+    if ((up > -BRUSH_ORIENTATION_DEADBAND && up < BRUSH_ORIENTATION_DEADBAND) ||
+        (side > -BRUSH_ORIENTATION_DEADBAND && side < BRUSH_ORIENTATION_DEADBAND))
+    {
+        // Too close to horizontal to tell, keep what we had
+        return previous;
+    }
+
+    if (up > 0)
+    {
+        return side > 0 ? QUADRANT_UPPER_LEFT : QUADRANT_UPPER_RIGHT;
+    }
+    return side > 0 ? QUADRANT_LOWER_LEFT : QUADRANT_LOWER_RIGHT;
+}
+
+static void finishWindow(BrushMotion *bm)
+{
+    BrushState *st = &bm->state;
+
+    // Find the frequency bin with the most power, summed over the three axes
+    int64_t best_power = 0;
+    int best_bin = -1;
+    for (int k = 0; k < BRUSH_NUM_BINS; k++)
+    {
+        int64_t power = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int64_t s1 = bm->s1[axis][k];
+            int64_t s2 = bm->s2[axis][k];
+            power += s1 * s1 + s2 * s2 - ((GOERTZEL_COEFF_Q14[k] * s1 * s2) >> 14);
+        }
+        if (power > best_power)
+        {
+            best_power = power;
+            best_bin = k;
+        }
+    }
+    memset(bm->s1, 0, sizeof(bm->s1));
+    memset(bm->s2, 0, sizeof(bm->s2));
+
+    st->energy = bm->energy_acc / BRUSH_WINDOW;
+    bm->energy_acc = 0;
+
+    // Bin index k corresponds to (k + 1) * BRUSH_SAMPLE_HZ / BRUSH_WINDOW Hz
+    int bin = best_bin + 1;
+    st->freq_dhz = best_bin < 0 ? 0 : (uint16_t)(bin * BRUSH_SAMPLE_HZ * 10 / BRUSH_WINDOW);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        st->gravity[axis] = (int16_t)(bm->gravity_q8[axis] >> 8);
+    }
+
+    // Brushing needs enough movement and a stroke rate in the brushing band.
+    //   The energy thresholds have some hysteresis, and the state only
+    //   changes after BRUSH_DEBOUNCE_WINDOWS windows agree.
+    bool in_band = bin >= BRUSH_BIN_MIN && bin <= BRUSH_BIN_MAX;
+    uint32_t threshold = st->brushing ? BRUSH_ENERGY_OFF : BRUSH_ENERGY_ON;
+    bool candidate = in_band && st->energy > threshold;
+
+    if (candidate != st->brushing)
+    {
+        if (++bm->pending_count >= BRUSH_DEBOUNCE_WINDOWS)
+        {
+            st->brushing = candidate;
+            bm->pending_count = 0;
+        }
+    }
+    else
+    {
+        bm->pending_count = 0;
+    }
+
+    if (st->brushing)
+    {
+        st->quadrant = classifyQuadrant(st->gravity, st->quadrant);
+    }
+
+    st->windows++;
+}
+
+bool brushMotionPush(BrushMotion *bm, const ImuSample *sample)
+{
+    const int16_t accel[3] = {sample->ax, sample->ay, sample->az};
+    const int16_t gyro[3] = {sample->gx, sample->gy, sample->gz};
+
+    if (!bm->primed)
+    {
+        // Start the gravity estimate at the first reading instead of zero
+        for (int axis = 0; axis < 3; axis++)
+        {
+            bm->gravity_q8[axis] = (int32_t)accel[axis] << 8;
+        }
+        bm->primed = true;
+    }
+
+    uint32_t energy = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        // Track gravity with a slow low-pass, what's left over is motion
+        bm->gravity_q8[axis] += (((int32_t)accel[axis] << 8) - bm->gravity_q8[axis]) >> GRAVITY_SHIFT;
+        int32_t motion = clamp16(accel[axis] - (bm->gravity_q8[axis] >> 8));
+
+        uint32_t m = (uint32_t)(motion < 0 ? -motion : motion);
+        uint32_t g = (uint32_t)(gyro[axis] < 0 ? -(int32_t)gyro[axis] : gyro[axis]);
+        energy += (m * m) >> 8;
+        energy += (g * g) >> 8;
+
+        int32_t x = motion >> GOERTZEL_INPUT_SHIFT;
+        int32_t *s1 = bm->s1[axis];
+        int32_t *s2 = bm->s2[axis];
+        for (int k = 0; k < BRUSH_NUM_BINS; k++)
+        {
+            int32_t s = x + (int32_t)(((int64_t)GOERTZEL_COEFF_Q14[k] * s1[k]) >> 14) - s2[k];
+            s2[k] = s1[k];
+            s1[k] = s;
+        }
+    }
+    bm->energy_acc += energy;
+
+    if (++bm->sample_idx < BRUSH_WINDOW)
+    {
+        return false;
+    }
+    bm->sample_idx = 0;
+    finishWindow(bm);
+    return true;
+}
@@ -0,0 +1,9 @@
+#include <Arduino.h>
+#include "clock.h"
+#include "esp_timer.h"
+
+// In IRAM, interrupt handlers read it too
+int64_t IRAM_ATTR clockUs()
+{
+    return esp_timer_get_time();
+}
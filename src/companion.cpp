@@ -0,0 +1,272 @@
+#include <string.h>
+#include "companion.h"
+#include "session.h"
+
+static void putLe16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void putLe32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static uint16_t le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t deciseconds(uint32_t ms)
+{
+    uint32_t ds = ms / 100;
+    return ds > 0xFFFF ? 0xFFFF : ds;
+}
+
+// *** Encoding *** //
+
+size_t companionEncodeState(const CompanionState *state, uint8_t *out)
+{
+    out[0] = state->phase;
+    out[1] = state->phases;
+    out[2] = state->status;
+    out[3] = 0;
+    putLe32(out + 4, state->elapsed_ms);
+    putLe16(out + 8, state->progress);
+    putLe16(out + 10, state->brushing_ds);
+    return COMPANION_STATE_SIZE;
+}
+
+bool companionDecodeState(const uint8_t *data, size_t len, CompanionState *state)
+{
+    if (len < COMPANION_STATE_SIZE)
+    {
+        return false;
+    }
+    state->phase = data[0];
+    state->phases = data[1];
+    state->status = data[2];
+    state->elapsed_ms = le32(data + 4);
+    state->progress = le16(data + 8);
+    state->brushing_ds = le16(data + 10);
+    return true;
+}
+
+size_t companionEncodeEntry(const UsageRecord *record, uint8_t *out)
+{
+    const UsageSession *session = &record->session;
+    putLe32(out, record->seq);
+    out[4] = session->status;
+    out[5] = session->wake_reason;
+    putLe16(out + 6, deciseconds(session->duration_ms));
+    for (int q = 0; q < USAGE_QUADRANTS; q++)
+    {
+        putLe16(out + 8 + 2 * q, deciseconds(session->brushing_ms[q]));
+    }
+    return COMPANION_ENTRY_SIZE;
+}
+
+bool companionDecodeEntry(const uint8_t *data, size_t len, CompanionEntry *entry)
+{
+    if (len < COMPANION_ENTRY_SIZE)
+    {
+        return false;
+    }
+    entry->seq = le32(data);
+    entry->status = data[4];
+    entry->wake_reason = data[5];
+    entry->duration_ds = le16(data + 6);
+    for (int q = 0; q < USAGE_QUADRANTS; q++)
+    {
+        entry->brushing_ds[q] = le16(data + 8 + 2 * q);
+    }
+    return true;
+}
+
+void companionSessionState(CompanionState *state, uint32_t now_ms, uint8_t status)
+{
+    const SessionStats *stats = sessionStats(now_ms);
+    const PhaseTimer *timer = sessionPhaseTimer();
+
+    int phase = sessionPhase();
+    state->phase = phase < NUM_PHASES ? phase : NUM_PHASES - 1;
+    state->phases = NUM_PHASES;
+    state->status = status;
+    state->elapsed_ms = stats->duration_ms;
+
+    uint32_t brushing_ms = 0;
+    for (int q = 0; q < 4; q++)
+    {
+        brushing_ms += stats->brushing_ms[q];
+    }
+    state->brushing_ds = deciseconds(brushing_ms);
+
+    // Whole phases done, plus how far the current one has got
+    uint32_t progress = (uint32_t)stats->phases_done * 1000;
+    if (status == COMPANION_RUNNING && stats->phases_done < NUM_PHASES && timer->quota_ms > 0)
+    {
+        uint32_t done = timer->effective_ms < timer->quota_ms ? timer->effective_ms : timer->quota_ms;
+        progress += (uint64_t)done * 1000 / timer->quota_ms;
+    }
+    state->progress = progress / NUM_PHASES;
+}
+
+// *** Service *** //
+
+void companionInit(Companion *companion, CompanionLink *link, UsageScanFunc scan)
+{
+    memset(companion, 0, sizeof(*companion));
+    companion->link = link;
+    companion->scan = scan;
+}
+
+void companionConnected(Companion *companion)
+{
+    companion->connected = true;
+    companion->state_urgent = true;
+    companion->history_active = false;
+    companion->hold_fast = false;
+    companion->fast = false;
+}
+
+void companionDisconnected(Companion *companion)
+{
+    companion->connected = false;
+    companion->history_active = false;
+}
+
+void companionSetState(Companion *companion, const CompanionState *state)
+{
+    CompanionState *current = &companion->state;
+    if (state->phase != current->phase || state->status != current->status || state->phases != current->phases)
+    {
+        companion->state_urgent = true;
+    }
+    if (state->elapsed_ms != current->elapsed_ms || state->progress != current->progress ||
+        state->brushing_ds != current->brushing_ds)
+    {
+        companion->state_stale = true;
+    }
+    *current = *state;
+}
+
+static void setFast(Companion *companion, bool fast)
+{
+    fast |= companion->hold_fast;
+    if (companion->fast != fast)
+    {
+        companion->fast = fast;
+        companion->link->setFast(fast);
+    }
+}
+
+void companionHoldFast(Companion *companion, bool hold)
+{
+    companion->hold_fast = hold;
+    setFast(companion, companion->history_active);
+}
+
+void companionControl(Companion *companion, const uint8_t *data, size_t len)
+{
+    if (len < 4)
+    {
+        return;
+    }
+
+    uint32_t from = le32(data);
+    companion->history_active = from != COMPANION_HISTORY_STOP;
+    companion->history_next = from;
+    setFast(companion, companion->history_active);
+}
+
+typedef struct HistoryBatch
+{
+    uint8_t *out;
+    uint8_t count;
+    uint8_t max;
+    uint32_t next_seq;
+} HistoryBatch;
+
+static bool batchEntry(const UsageRecord *record, void *ctx)
+{
+    HistoryBatch *batch = (HistoryBatch *)ctx;
+    if (record->type != USAGE_RECORD_SESSION)
+    {
+        batch->next_seq = record->seq + 1;
+        return true;
+    }
+    companionEncodeEntry(record, batch->out + 1 + batch->count * COMPANION_ENTRY_SIZE);
+    batch->count++;
+    batch->next_seq = record->seq + 1;
+    return batch->count < batch->max;
+}
+
+// One notification's worth of history. false if the link is busy.
+static bool sendHistory(Companion *companion)
+{
+    uint8_t buf[1 + COMPANION_MAX_ENTRIES * COMPANION_ENTRY_SIZE];
+    uint16_t payload = companion->link->payloadSize();
+    size_t max = payload > 1 ? (payload - 1) / COMPANION_ENTRY_SIZE : 0;
+
+    HistoryBatch batch;
+    batch.out = buf;
+    batch.count = 0;
+    batch.max = max > COMPANION_MAX_ENTRIES ? COMPANION_MAX_ENTRIES : (max < 1 ? 1 : max);
+    batch.next_seq = companion->history_next;
+    companion->scan(companion->history_next, batchEntry, &batch);
+
+    buf[0] = batch.count;
+    if (!companion->link->notify(COMPANION_HISTORY, buf, 1 + batch.count * COMPANION_ENTRY_SIZE))
+    {
+        return false;
+    }
+
+    companion->notifications++;
+    companion->entries_sent += batch.count;
+    companion->history_next = batch.next_seq;
+    if (batch.count == 0)
+    {
+        companion->history_active = false;
+        setFast(companion, false);
+    }
+    return true;
+}
+
+void companionPump(Companion *companion, uint32_t now_ms)
+{
+    if (!companion->connected)
+    {
+        return;
+    }
+
+    bool due = now_ms - companion->state_sent_ms >= COMPANION_STATE_PERIOD_MS;
+    if (companion->state_urgent || (companion->state_stale && due))
+    {
+        uint8_t buf[COMPANION_STATE_SIZE];
+        size_t len = companionEncodeState(&companion->state, buf);
+        if (companion->link->notify(COMPANION_STATE, buf, len))
+        {
+            companion->notifications++;
+            companion->state_urgent = false;
+            companion->state_stale = false;
+            companion->state_sent_ms = now_ms;
+        }
+    }
+
+    for (int i = 0; i < COMPANION_BURST && companion->history_active; i++)
+    {
+        if (!sendHistory(companion))
+        {
+            break;
+        }
+    }
+}
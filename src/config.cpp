@@ -0,0 +1,287 @@
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "crc32.h"
+
+Config config;
+
+#define FIELD(id, name, type, count, min, max, def, help) \
+    {id, #name, type, count, (uint16_t)offsetof(Config, name), min, max, def, help}
+
+const ConfigField CONFIG_FIELDS[] = {
+    FIELD(1, tick_ms, CONFIG_U16, 1, 50, 1000, 250, "display tick, ms"),
+    FIELD(2, pressure_threshold, CONFIG_U16, 1, 0, 4095, 4000, "sensor reading with the brush in its holder"),
+    FIELD(3, phase_seconds, CONFIG_I16, CONFIG_PHASES, -600, 600, 0, "per phase: 0 play once, else s"),
+    FIELD(4, volume, CONFIG_U8, 1, 0, 30, 10, "audio volume"),
+    FIELD(5, eye_intensity_max, CONFIG_U8, 1, 0, 15, 15, "brightest the eyes get"),
+};
+
+const size_t CONFIG_FIELD_COUNT = sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]);
+
+// Defaults for the arrays, where one value for every element won't do
+static const int16_t DEFAULT_PHASE_SECONDS[CONFIG_PHASES] = {0, 10, 10, 20, 10, 20, 10, 20, 10, 20, 10, 10};
+
+static uint8_t typeSize(uint8_t type)
+{
+    return type == CONFIG_U8 ? 1 : 2;
+}
+
+static int32_t getValue(const Config *cfg, const ConfigField *field, uint8_t i)
+{
+    const uint8_t *p = (const uint8_t *)cfg + field->offset;
+    switch (field->type)
+    {
+    case CONFIG_U8:
+        return p[i];
+    case CONFIG_U16:
+        return ((const uint16_t *)p)[i];
+    default:
+        return ((const int16_t *)p)[i];
+    }
+}
+
+static void setValue(Config *cfg, const ConfigField *field, uint8_t i, int32_t value)
+{
+    uint8_t *p = (uint8_t *)cfg + field->offset;
+    switch (field->type)
+    {
+    case CONFIG_U8:
+        p[i] = value;
+        break;
+    case CONFIG_U16:
+        ((uint16_t *)p)[i] = value;
+        break;
+    default:
+        ((int16_t *)p)[i] = value;
+        break;
+    }
+}
+
+void configDefaults(Config *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    for (size_t f = 0; f < CONFIG_FIELD_COUNT; f++)
+    {
+        for (uint8_t i = 0; i < CONFIG_FIELDS[f].count; i++)
+        {
+            setValue(cfg, &CONFIG_FIELDS[f], i, CONFIG_FIELDS[f].def);
+        }
+    }
+    memcpy(cfg->phase_seconds, DEFAULT_PHASE_SECONDS, sizeof(cfg->phase_seconds));
+}
+
+// config holds the defaults before anything is loaded, so code that runs
+//   without a store (the simulator) sees them too
+static struct ConfigInit
+{
+    ConfigInit() { configDefaults(&config); }
+} config_init;
+
+static const ConfigField *findId(uint8_t id)
+{
+    for (size_t f = 0; f < CONFIG_FIELD_COUNT; f++)
+    {
+        if (CONFIG_FIELDS[f].id == id)
+        {
+            return &CONFIG_FIELDS[f];
+        }
+    }
+    return NULL;
+}
+
+// *** Stored form *** //
+
+size_t configEncode(const Config *cfg, uint8_t *out, size_t max)
+{
+    size_t n = 0;
+    out[n++] = CONFIG_VERSION & 0xFF;
+    out[n++] = CONFIG_VERSION >> 8;
+    for (size_t f = 0; f < CONFIG_FIELD_COUNT; f++)
+    {
+        const ConfigField *field = &CONFIG_FIELDS[f];
+        if (n + 3 + field->count * typeSize(field->type) + 4 > max)
+        {
+            return 0;
+        }
+        out[n++] = field->id;
+        out[n++] = field->type;
+        out[n++] = field->count;
+        for (uint8_t i = 0; i < field->count; i++)
+        {
+            uint16_t v = getValue(cfg, field, i);
+            out[n++] = v & 0xFF;
+            if (typeSize(field->type) == 2)
+            {
+                out[n++] = v >> 8;
+            }
+        }
+    }
+
+    uint32_t crc = crc32(out, n);
+    for (int i = 0; i < 4; i++)
+    {
+        out[n++] = (crc >> (8 * i)) & 0xFF;
+    }
+    return n;
+}
+
+// A value as a version before CONFIG_VERSION stored it, in this version's
+//   terms. None so far, every version means the same thing by each id.
+static int32_t convertOld(uint16_t version, uint8_t id, int32_t v)
+{
+    return v;
+}
+
+bool configDecode(const uint8_t *data, size_t len, Config *cfg)
+{
+    configDefaults(cfg);
+    if (len < 6)
+    {
+        return false;
+    }
+    uint32_t crc = (uint32_t)data[len - 4] | ((uint32_t)data[len - 3] << 8) | ((uint32_t)data[len - 2] << 16) |
+                   ((uint32_t)data[len - 1] << 24);
+    if (crc != crc32(data, len - 4))
+    {
+        return false;
+    }
+
+    uint16_t version = data[0] | (data[1] << 8);
+    if (version < CONFIG_VERSION_OLDEST || version > CONFIG_VERSION)
+    {
+        return false;
+    }
+
+    size_t n = 2;
+    size_t end = len - 4;
+    while (n + 3 <= end)
+    {
+        uint8_t id = data[n];
+        uint8_t type = data[n + 1];
+        uint8_t count = data[n + 2];
+        n += 3;
+        if (type > CONFIG_I16 || n + count * typeSize(type) > end)
+        {
+            configDefaults(cfg);
+            return false;
+        }
+
+        const ConfigField *field = findId(id);
+        for (uint8_t i = 0; i < count; i++)
+        {
+            int32_t v = data[n];
+            if (typeSize(type) == 2)
+            {
+                v |= data[n + 1] << 8;
+                v = type == CONFIG_I16 ? (int16_t)v : v;
+            }
+            n += typeSize(type);
+            v = convertOld(version, id, v);
+
+            if (field != NULL && field->type == type && i < field->count && v >= field->min && v <= field->max)
+            {
+                setValue(cfg, field, i, v);
+            }
+        }
+    }
+    return n == end;
+}
+
+// *** Console *** //
+
+static const ConfigField *findName(const char *name, size_t len)
+{
+    for (size_t f = 0; f < CONFIG_FIELD_COUNT; f++)
+    {
+        if (strlen(CONFIG_FIELDS[f].name) == len && strncmp(CONFIG_FIELDS[f].name, name, len) == 0)
+        {
+            return &CONFIG_FIELDS[f];
+        }
+    }
+    return NULL;
+}
+
+static void printField(const Config *cfg, const ConfigField *field, ConsoleOut *out)
+{
+    consolePrintf(out, "%s =", field->name);
+    for (uint8_t i = 0; i < field->count; i++)
+    {
+        consolePrintf(out, "%s%ld", i == 0 ? " " : ",", (long)getValue(cfg, field, i));
+    }
+    consolePrintf(out, "  (%ld..%ld, %s)\n", (long)field->min, (long)field->max, field->help);
+}
+
+// "name [value]" or "name[i] [value]"
+static uint8_t setField(Config *cfg, const char *arg, const char *value_arg, ConsoleOut *out)
+{
+    const char *name_end = arg + strcspn(arg, "[");
+    const ConfigField *field = findName(arg, name_end - arg);
+    if (field == NULL)
+    {
+        consolePrintf(out, "no setting called %.*s\n", (int)(name_end - arg), arg);
+        return CONFIG_NONE;
+    }
+
+    long index = -1;
+    if (*name_end == '[')
+    {
+        char *p;
+        index = strtol(name_end + 1, &p, 10);
+        if (p == name_end + 1 || p[0] != ']' || p[1] != '\0' || index < 0 || index >= field->count)
+        {
+            consolePrintf(out, "%s has elements 0..%u\n", field->name, field->count - 1);
+            return CONFIG_NONE;
+        }
+    }
+    if (value_arg == NULL)
+    {
+        printField(cfg, field, out);
+        return CONFIG_NONE;
+    }
+
+    long value;
+    if (!consoleParseInt(value_arg, field->min, field->max, &value))
+    {
+        consolePrintf(out, "%s takes %ld..%ld\n", field->name, (long)field->min, (long)field->max);
+        return CONFIG_NONE;
+    }
+
+    for (uint8_t i = 0; i < field->count; i++)
+    {
+        if (index < 0 || i == index)
+        {
+            setValue(cfg, field, i, value);
+        }
+    }
+    printField(cfg, field, out);
+    return CONFIG_CHANGED;
+}
+
+uint8_t configCommand(int argc, char **argv, Config *cfg, ConsoleOut *out)
+{
+    if (argc == 1)
+    {
+        for (size_t f = 0; f < CONFIG_FIELD_COUNT; f++)
+        {
+            printField(cfg, &CONFIG_FIELDS[f], out);
+        }
+        return CONFIG_NONE;
+    }
+    if (argc == 2 && strcmp(argv[1], "save") == 0)
+    {
+        consolePrintf(out, "saved\n");
+        return CONFIG_SAVE;
+    }
+    if (argc == 2 && strcmp(argv[1], "reset") == 0)
+    {
+        configDefaults(cfg);
+        consolePrintf(out, "defaults restored and saved\n");
+        return CONFIG_SAVE;
+    }
+    if (argc > 3)
+    {
+        consolePrintf(out, "usage: config [name[index] [value]] | save | reset\n");
+        return CONFIG_NONE;
+    }
+    return setField(cfg, argv[1], argc == 3 ? argv[2] : NULL, out);
+}
@@ -0,0 +1,34 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config_store.h"
+#include "heap_guard.h"
+
+bool configLoad()
+{
+    uint8_t buf[CONFIG_MAX_ENCODED];
+    Preferences prefs;
+    prefs.begin(CONFIG_NVS_NAMESPACE, true);
+    size_t len = prefs.getBytes(CONFIG_NVS_KEY, buf, sizeof(buf));
+    prefs.end();
+
+    return configDecode(buf, len, &config);
+}
+
+bool configSave(const Config *cfg)
+{
+    uint8_t buf[CONFIG_MAX_ENCODED];
+    size_t len = configEncode(cfg, buf, sizeof(buf));
+    if (len == 0)
+    {
+        return false;
+    }
+
+    // NVS allocates its handle and the entries it writes
+    heapGuardExpect(true);
+    Preferences prefs;
+    prefs.begin(CONFIG_NVS_NAMESPACE, false);
+    bool ok = prefs.putBytes(CONFIG_NVS_KEY, buf, len) == len;
+    prefs.end();
+    heapGuardExpect(false);
+    return ok;
+}
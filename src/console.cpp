@@ -0,0 +1,187 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "console.h"
+#include "frame.h"
+
+enum LineFrame : uint8_t
+{
+    LINE_TEXT = 0,
+    LINE_SYNC1,  // had FRAME_SYNC0
+    LINE_HEADER, // type and length
+    LINE_BODY,   // payload and CRC
+};
+
+void consoleLineInit(ConsoleLine *line)
+{
+    line->len = 0;
+    line->discard = false;
+    line->frame = LINE_TEXT;
+}
+
+// true if c belongs to an export frame
+static bool skipFrame(ConsoleLine *line, uint8_t c)
+{
+    switch (line->frame)
+    {
+    case LINE_SYNC1:
+        if (c != FRAME_SYNC1)
+        {
+            // A stray byte, not a frame after all
+            line->frame = LINE_TEXT;
+            line->discard = true;
+            return false;
+        }
+        line->frame = LINE_HEADER;
+        line->frame_left = FRAME_HEADER_SIZE - 2;
+        return true;
+    case LINE_HEADER:
+        line->frame_left--;
+        if (line->frame_left == 1)
+        {
+            line->frame_len = c;
+        }
+        else if (line->frame_left == 0)
+        {
+            line->frame_len |= c << 8;
+            line->frame = line->frame_len <= FRAME_MAX_PAYLOAD ? LINE_BODY : LINE_TEXT;
+            line->frame_left = line->frame_len + FRAME_CRC_SIZE;
+        }
+        return true;
+    case LINE_BODY:
+        if (--line->frame_left == 0)
+        {
+            line->frame = LINE_TEXT;
+        }
+        return true;
+    default:
+        if (c == FRAME_SYNC0)
+        {
+            line->frame = LINE_SYNC1;
+            return true;
+        }
+        return false;
+    }
+}
+
+bool consoleLinePush(ConsoleLine *line, uint8_t c)
+{
+    if (skipFrame(line, c))
+    {
+        return false;
+    }
+
+    if (c == '\n' || c == '\r')
+    {
+        bool done = line->len > 0 && !line->discard;
+        line->buf[line->len] = '\0';
+        line->len = 0;
+        line->discard = false;
+        return done;
+    }
+
+    if (c < ' ' || c > '~' || line->len >= CONSOLE_LINE_MAX - 1)
+    {
+        line->discard = true;
+    }
+    else if (!line->discard)
+    {
+        line->buf[line->len++] = c;
+    }
+    return false;
+}
+
+void consoleOutInit(ConsoleOut *out, char *buf, size_t size)
+{
+    out->buf = buf;
+    out->size = size;
+    out->len = 0;
+    buf[0] = '\0';
+}
+
+void consolePrintf(ConsoleOut *out, const char *fmt, ...)
+{
+    if (out->len + 1 >= out->size)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(out->buf + out->len, out->size - out->len, fmt, args);
+    va_end(args);
+
+    if (n > 0)
+    {
+        out->len += (size_t)n < out->size - out->len ? (size_t)n : out->size - out->len - 1;
+    }
+}
+
+static void help(const ConsoleCommand *commands, size_t count, ConsoleOut *out)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        consolePrintf(out, "%-8s %-20s %s\n", commands[i].name, commands[i].args, commands[i].help);
+    }
+}
+
+bool consoleRun(const ConsoleCommand *commands, size_t count, char *line, ConsoleOut *out)
+{
+    char *argv[CONSOLE_MAX_ARGS];
+    int argc = 0;
+    char *p = line;
+    while (*p != '\0')
+    {
+        while (*p == ' ')
+        {
+            *p++ = '\0';
+        }
+        if (*p == '\0')
+        {
+            break;
+        }
+        if (argc == CONSOLE_MAX_ARGS)
+        {
+            consolePrintf(out, "too many words\n");
+            return true;
+        }
+        argv[argc++] = p;
+        while (*p != ' ' && *p != '\0')
+        {
+            p++;
+        }
+    }
+
+    if (argc == 0)
+    {
+        return true;
+    }
+    if (strcmp(argv[0], "help") == 0)
+    {
+        help(commands, count, out);
+        return true;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (strcmp(argv[0], commands[i].name) == 0)
+        {
+            commands[i].run(argc, argv, out);
+            return true;
+        }
+    }
+    consolePrintf(out, "unknown command %s, try help\n", argv[0]);
+    return false;
+}
+
+bool consoleParseInt(const char *s, long min, long max, long *value)
+{
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || v < min || v > max)
+    {
+        return false;
+    }
+    *value = v;
+    return true;
+}
@@ -0,0 +1,82 @@
+#include <string.h>
+#include "countdown.h"
+#include "font.h"
+#include "text.h"
+
+// The ring runs clockwise round the edge of the matrix from the top left,
+//   6 pixels per side with the corners left out. Every RING_PERIOD pixels
+//   there is a gap of RING_GAP.
+#define RING_SIDE 6
+#define RING_PERIOD 6
+#define RING_GAP 2
+
+static void drawNumber(int number, uint8_t *rows)
+{
+    char text[3];
+    if (number >= 10)
+    {
+        text[0] = '0' + number / 10;
+        text[1] = '0' + number % 10;
+        text[2] = '\0';
+    }
+    else
+    {
+        text[0] = '0' + number;
+        text[1] = '\0';
+    }
+
+    // Centred across, one row down from the top
+    int16_t x = (8 - textWidth(&FONT_4X7, text)) / 2;
+    textDraw(&FONT_4X7, text, x, 1, rows, 1, 8);
+}
+
+static void drawRing(int step, uint8_t *rows)
+{
+    int offset = RING_PERIOD - step % RING_PERIOD + RING_GAP;
+
+    for (int i = 0; i < 4 * RING_SIDE; i++)
+    {
+        if ((i + offset) % RING_PERIOD >= RING_PERIOD - RING_GAP)
+        {
+            continue;
+        }
+
+        int pos = i % RING_SIDE;
+        int x, y;
+        switch (i / RING_SIDE)
+        {
+        case 0: // top, left to right
+            x = 1 + pos;
+            y = 0;
+            break;
+        case 1: // right, top to bottom
+            x = 7;
+            y = 1 + pos;
+            break;
+        case 2: // bottom, right to left
+            x = 6 - pos;
+            y = 7;
+            break;
+        default: // left, bottom to top
+            x = 0;
+            y = 6 - pos;
+            break;
+        }
+        rows[y] |= 0x80 >> x;
+    }
+}
+
+void countdownFrame(int frame, uint8_t *rows)
+{
+    memset(rows, 0, 8);
+
+    if (frame % 2 == 0)
+    {
+        drawNumber(10 - frame / 4, rows);
+    }
+    else
+    {
+        // The ring moves on halfway through each number
+        drawRing((frame + 1) / 4, rows);
+    }
+}
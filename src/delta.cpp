@@ -0,0 +1,368 @@
+#include <string.h>
+#include "crc32.h"
+#include "delta.h"
+
+enum DeltaState : uint8_t
+{
+    DELTA_STATE_HEADER = 0,
+    DELTA_STATE_OP,
+    DELTA_STATE_FIELD,
+    DELTA_STATE_INSERT,
+    DELTA_STATE_ZEROS,  // ADD: varint of the next zero run
+    DELTA_STATE_COUNT,  // ADD: varint of the delta bytes after it
+    DELTA_STATE_DELTAS, // ADD: the delta bytes
+    DELTA_STATE_END,
+};
+
+static void putLe32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+size_t deltaEncodeHeader(const DeltaHeader *header, uint8_t *out)
+{
+    memcpy(out, DELTA_MAGIC, 4);
+    out[4] = DELTA_VERSION;
+    out[5] = out[6] = out[7] = 0;
+    putLe32(out + 8, header->source_size);
+    putLe32(out + 12, header->source_crc);
+    putLe32(out + 16, header->target_size);
+    putLe32(out + 20, header->target_crc);
+    return DELTA_HEADER_SIZE;
+}
+
+bool deltaDecodeHeader(const uint8_t *data, size_t len, DeltaHeader *header)
+{
+    if (len < DELTA_HEADER_SIZE || memcmp(data, DELTA_MAGIC, 4) != 0 || data[4] != DELTA_VERSION)
+    {
+        return false;
+    }
+    header->source_size = le32(data + 8);
+    header->source_crc = le32(data + 12);
+    header->target_size = le32(data + 16);
+    header->target_crc = le32(data + 20);
+    return true;
+}
+
+void deltaApplierInit(DeltaApplier *applier, DeltaReadFunc read, DeltaWriteFunc write, void *ctx)
+{
+    memset(applier, 0, sizeof(*applier));
+    applier->read = read;
+    applier->write = write;
+    applier->ctx = ctx;
+    applier->state = DELTA_STATE_HEADER;
+    applier->result = DELTA_MORE;
+}
+
+// *** Output *** //
+
+static bool flushOut(DeltaApplier *applier)
+{
+    if (applier->out_len == 0)
+    {
+        return true;
+    }
+    applier->crc = crc32Update(applier->crc, applier->out, applier->out_len);
+    bool ok = applier->write(applier->out, applier->out_len, applier->ctx);
+    applier->written += applier->out_len;
+    applier->out_len = 0;
+    return ok;
+}
+
+static bool putOut(DeltaApplier *applier, const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        size_t n = DELTA_CHUNK - applier->out_len;
+        if (n > len)
+        {
+            n = len;
+        }
+        memcpy(applier->out + applier->out_len, data, n);
+        applier->out_len += n;
+        data += n;
+        len -= n;
+        if (applier->out_len == DELTA_CHUNK && !flushOut(applier))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copy n source bytes unchanged
+static bool copySource(DeltaApplier *applier, uint32_t n)
+{
+    while (n > 0)
+    {
+        uint32_t chunk = n < DELTA_CHUNK ? n : DELTA_CHUNK;
+        if (!applier->read(applier->src, applier->src_buf, chunk, applier->ctx) ||
+            !putOut(applier, applier->src_buf, chunk))
+        {
+            return false;
+        }
+        applier->src += chunk;
+        applier->left -= chunk;
+        n -= chunk;
+    }
+    return true;
+}
+
+// *** Parsing *** //
+
+static uint8_t fail(DeltaApplier *applier, uint8_t result)
+{
+    applier->result = result;
+    return result;
+}
+
+static uint8_t checkSource(DeltaApplier *applier)
+{
+    uint32_t crc = 0;
+    for (uint32_t off = 0; off < applier->header.source_size; off += DELTA_CHUNK)
+    {
+        uint32_t n = applier->header.source_size - off;
+        if (n > DELTA_CHUNK)
+        {
+            n = DELTA_CHUNK;
+        }
+        if (!applier->read(off, applier->src_buf, n, applier->ctx))
+        {
+            return DELTA_WRONG_SOURCE;
+        }
+        crc = crc32Update(crc, applier->src_buf, n);
+    }
+    return crc == applier->header.source_crc ? DELTA_MORE : DELTA_WRONG_SOURCE;
+}
+
+// After an op, the next op or the end of the target
+static uint8_t nextOp(DeltaApplier *applier)
+{
+    if (applier->written + applier->out_len < applier->header.target_size)
+    {
+        applier->state = DELTA_STATE_OP;
+        return DELTA_MORE;
+    }
+    if (!flushOut(applier))
+    {
+        return fail(applier, DELTA_IO);
+    }
+    applier->state = DELTA_STATE_END;
+    return fail(applier, applier->crc == applier->header.target_crc ? DELTA_DONE : DELTA_BAD_TARGET);
+}
+
+// All of an op's varints are in
+static uint8_t startOp(DeltaApplier *applier)
+{
+    uint32_t produced = applier->written + applier->out_len;
+    uint32_t len = applier->op == DELTA_OP_INSERT ? applier->fields[0] : applier->fields[1];
+    if (len == 0 || len > applier->header.target_size - produced)
+    {
+        return fail(applier, DELTA_BAD_OP);
+    }
+    applier->left = len;
+
+    if (applier->op == DELTA_OP_INSERT)
+    {
+        applier->state = DELTA_STATE_INSERT;
+        return DELTA_MORE;
+    }
+
+    applier->src = applier->fields[0];
+    if (applier->src > applier->header.source_size || len > applier->header.source_size - applier->src)
+    {
+        return fail(applier, DELTA_BAD_OP);
+    }
+
+    if (applier->op == DELTA_OP_COPY)
+    {
+        if (!copySource(applier, len))
+        {
+            return fail(applier, DELTA_IO);
+        }
+        return nextOp(applier);
+    }
+
+    applier->state = DELTA_STATE_ZEROS;
+    return DELTA_MORE;
+}
+
+// Reads one varint byte into *value, true when it's complete
+static bool varintByte(DeltaApplier *applier, uint8_t byte, uint32_t *value, bool *bad)
+{
+    if (applier->shift == 0)
+    {
+        *value = 0;
+    }
+    if (applier->shift > 28)
+    {
+        *bad = true;
+        return false;
+    }
+    *value |= (uint32_t)(byte & 0x7F) << applier->shift;
+    if (byte & 0x80)
+    {
+        applier->shift += 7;
+        return false;
+    }
+    applier->shift = 0;
+    return true;
+}
+
+uint8_t deltaApplierPush(DeltaApplier *applier, const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len && applier->result == DELTA_MORE)
+    {
+        bool bad = false;
+        switch (applier->state)
+        {
+        case DELTA_STATE_HEADER:
+            applier->header_buf[applier->header_len++] = data[i++];
+            if (applier->header_len == DELTA_HEADER_SIZE)
+            {
+                if (!deltaDecodeHeader(applier->header_buf, DELTA_HEADER_SIZE, &applier->header) ||
+                    applier->header.target_size == 0)
+                {
+                    return fail(applier, DELTA_BAD_HEADER);
+                }
+                if (checkSource(applier) != DELTA_MORE)
+                {
+                    return fail(applier, DELTA_WRONG_SOURCE);
+                }
+                applier->state = DELTA_STATE_OP;
+            }
+            break;
+
+        case DELTA_STATE_OP:
+            applier->op = data[i++];
+            if (applier->op < DELTA_OP_COPY || applier->op > DELTA_OP_INSERT)
+            {
+                return fail(applier, DELTA_BAD_OP);
+            }
+            applier->field = 0;
+            applier->shift = 0;
+            applier->state = DELTA_STATE_FIELD;
+            break;
+
+        case DELTA_STATE_FIELD:
+            if (varintByte(applier, data[i++], &applier->fields[applier->field], &bad))
+            {
+                applier->field++;
+                if (applier->field == (applier->op == DELTA_OP_INSERT ? 1 : 2))
+                {
+                    startOp(applier);
+                }
+            }
+            break;
+
+        case DELTA_STATE_INSERT:
+        {
+            size_t n = len - i < applier->left ? len - i : applier->left;
+            if (!putOut(applier, data + i, n))
+            {
+                return fail(applier, DELTA_IO);
+            }
+            i += n;
+            applier->left -= n;
+            if (applier->left == 0)
+            {
+                nextOp(applier);
+            }
+            break;
+        }
+
+        case DELTA_STATE_ZEROS:
+        {
+            uint32_t zeros;
+            if (varintByte(applier, data[i++], &applier->run, &bad))
+            {
+                zeros = applier->run;
+                if (zeros > applier->left)
+                {
+                    return fail(applier, DELTA_BAD_OP);
+                }
+                if (!copySource(applier, zeros))
+                {
+                    return fail(applier, DELTA_IO);
+                }
+                if (applier->left == 0)
+                {
+                    nextOp(applier);
+                }
+                else
+                {
+                    applier->state = DELTA_STATE_COUNT;
+                }
+            }
+            break;
+        }
+
+        case DELTA_STATE_COUNT:
+            if (varintByte(applier, data[i++], &applier->run, &bad))
+            {
+                if (applier->run == 0 || applier->run > applier->left)
+                {
+                    return fail(applier, DELTA_BAD_OP);
+                }
+                applier->state = DELTA_STATE_DELTAS;
+            }
+            break;
+
+        case DELTA_STATE_DELTAS:
+        {
+            size_t n = len - i < applier->run ? len - i : applier->run;
+            if (n > DELTA_CHUNK)
+            {
+                n = DELTA_CHUNK;
+            }
+            if (!applier->read(applier->src, applier->src_buf, n, applier->ctx))
+            {
+                return fail(applier, DELTA_IO);
+            }
+            for (size_t k = 0; k < n; k++)
+            {
+                applier->src_buf[k] += data[i + k];
+            }
+            if (!putOut(applier, applier->src_buf, n))
+            {
+                return fail(applier, DELTA_IO);
+            }
+            i += n;
+            applier->src += n;
+            applier->left -= n;
+            applier->run -= n;
+            if (applier->run == 0)
+            {
+                if (applier->left == 0)
+                {
+                    nextOp(applier);
+                }
+                else
+                {
+                    applier->state = DELTA_STATE_ZEROS;
+                }
+            }
+            break;
+        }
+
+        default:
+            // Anything after the end
+            return fail(applier, DELTA_BAD_OP);
+        }
+
+        if (bad)
+        {
+            return fail(applier, DELTA_BAD_OP);
+        }
+    }
+    return applier->result;
+}
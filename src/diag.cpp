@@ -0,0 +1,415 @@
+#include <string.h>
+#include <atomic>
+#include "diag.h"
+#include "anims.h"
+#include "config.h"
+#include "fuel_gauge.h"
+#include "health.h"
+#include "heap_guard.h"
+#include "ring_buffer.h"
+#include "seqlock.h"
+#include "session.h"
+#include "trace_log.h"
+
+// Requests waiting for the render loop, more than a person types in a tick
+#define DIAG_QUEUE_SIZE 8
+// Trace entries shown when no count is given
+#define DIAG_TRACE_DEFAULT 20
+
+static Seqlock<DiagStatus> status_lock;
+static TraceLog<DiagTrace, DIAG_TRACE_SIZE> trace_log;
+static RingBuffer<DiagRequest, DIAG_QUEUE_SIZE> requests;
+
+// Only the render loop touches these, the console asks for a reset
+static TimingStats work_stats;
+static TimingStats late_stats;
+static std::atomic<bool> stats_reset(true);
+
+// The console's copy of config: it edits this one and hands it over
+//   whole through config_lock
+static Config console_config;
+static bool console_config_copied = false;
+static Seqlock<Config> config_lock;
+
+static bool (*save_hook)(const Config *cfg) = NULL;
+static const Health *health = NULL;
+static LatencyModel (*latency_source)() = NULL;
+
+// *** Timing statistics *** //
+
+void timingReset(TimingStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->min_us = 0xFFFFFFFF;
+}
+
+void timingAdd(TimingStats *stats, uint32_t us)
+{
+    stats->count++;
+    stats->total_us += us;
+    stats->min_us = us < stats->min_us ? us : stats->min_us;
+    stats->max_us = us > stats->max_us ? us : stats->max_us;
+
+    uint8_t bucket = 0;
+    while (bucket < DIAG_BUCKETS - 1 && us >= (1UL << bucket))
+    {
+        bucket++;
+    }
+    if (stats->buckets[bucket] < 0xFFFF)
+    {
+        stats->buckets[bucket]++;
+    }
+}
+
+uint32_t timingPercentile(const TimingStats *stats, uint8_t pct)
+{
+    uint32_t total = 0;
+    for (int i = 0; i < DIAG_BUCKETS; i++)
+    {
+        total += stats->buckets[i];
+    }
+    uint32_t want = (total * pct + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < DIAG_BUCKETS; i++)
+    {
+        seen += stats->buckets[i];
+        if (seen >= want && seen > 0)
+        {
+            return 1UL << i;
+        }
+    }
+    return 0;
+}
+
+// *** Render loop side *** //
+
+void diagTickTimes(uint32_t late_us, uint32_t work_us)
+{
+    if (stats_reset.exchange(false, std::memory_order_acquire))
+    {
+        timingReset(&work_stats);
+        timingReset(&late_stats);
+    }
+    timingAdd(&work_stats, work_us);
+    timingAdd(&late_stats, late_us);
+}
+
+void diagTrace(uint32_t now_ms, uint8_t kind, uint8_t arg, int16_t value)
+{
+    DiagTrace entry = {now_ms, kind, arg, value};
+    trace_log.add(entry);
+}
+
+void diagPublish(DiagStatus *status)
+{
+    status->work = work_stats;
+    status->late = late_stats;
+    status_lock.write(*status);
+}
+
+bool diagPollRequest(DiagRequest *request)
+{
+    return requests.pop(*request);
+}
+
+// *** Console side *** //
+
+bool diagTakeConfig(Config *cfg)
+{
+    return config_lock.read(*cfg);
+}
+
+void diagSetSaveHook(bool (*save)(const Config *cfg))
+{
+    save_hook = save;
+}
+
+void diagSetHealth(const Health *h)
+{
+    health = h;
+}
+
+void diagSetLatencySource(LatencyModel (*latency)())
+{
+    latency_source = latency;
+}
+
+static bool readStatus(DiagStatus *status, ConsoleOut *out)
+{
+    if (!status_lock.read(*status))
+    {
+        consolePrintf(out, "no status from the render loop yet\n");
+        return false;
+    }
+    return true;
+}
+
+static bool request(uint8_t type, int16_t value, ConsoleOut *out)
+{
+    DiagRequest req = {type, value};
+    if (!requests.push(req))
+    {
+        consolePrintf(out, "render loop is busy, try again\n");
+        return false;
+    }
+    return true;
+}
+
+static const char *const BATTERY_LEVEL_NAMES[BATTERY_LEVELS] = {"ok", "saving power", "low", "critical"};
+
+static void cmdStatus(int argc, char **argv, ConsoleOut *out)
+{
+    DiagStatus s;
+    if (!readStatus(&s, out))
+    {
+        return;
+    }
+    consolePrintf(out, "at %lu ms: phase %d/%d frame %u/%u\n", (unsigned long)s.now_ms, s.phase, NUM_PHASES,
+                  s.frame, s.frames);
+    consolePrintf(out, "brushing %s quadrant %u, %lu of %lu ms%s\n", s.brushing ? "yes" : "no", s.quadrant,
+                  (unsigned long)s.effective_ms, (unsigned long)s.quota_ms, s.paused ? " (paused)" : "");
+    consolePrintf(out, "intensity %u (%s), light %u, tick %u ms, volume %u, imu load %u.%u%%\n", s.intensity,
+                  s.intensity_override < 0 ? "following the light" : "fixed", s.light, config.tick_ms,
+                  config.volume, s.cpu_load_permille / 10, s.cpu_load_permille % 10);
+    if (s.battery_mv == 0)
+    {
+        consolePrintf(out, "no battery\n");
+        return;
+    }
+    consolePrintf(out, "battery %u%%, %u mV, %s\n", s.battery_soc, s.battery_mv,
+                  s.battery_level < BATTERY_LEVELS ? BATTERY_LEVEL_NAMES[s.battery_level] : "?");
+}
+
+static void cmdPhase(int argc, char **argv, ConsoleOut *out)
+{
+    long phase;
+    if (argc != 2 || !consoleParseInt(argv[1], 0, NUM_PHASES - 1, &phase))
+    {
+        consolePrintf(out, "usage: phase 0..%d\n", NUM_PHASES - 1);
+        return;
+    }
+    if (request(DIAG_REQ_PHASE, phase, out))
+    {
+        consolePrintf(out, "phase %ld from the next tick\n", phase);
+    }
+}
+
+// Run a config command on the console's copy, and hand it to the render
+//   loop if it changed
+static uint8_t editConfig(int argc, char **argv, ConsoleOut *out)
+{
+    if (!console_config_copied)
+    {
+        // Nothing but the console changes config after setup()
+        console_config = config;
+        console_config_copied = true;
+    }
+    uint8_t action = configCommand(argc, argv, &console_config, out);
+    if (action != CONFIG_NONE)
+    {
+        config_lock.write(console_config);
+        request(DIAG_REQ_CONFIG, 0, out);
+    }
+    return action;
+}
+
+// "tick" and "volume" are shorthands for their config settings
+static uint8_t setting(const char *name, int argc, char **argv, ConsoleOut *out)
+{
+    char config_word[] = "config";
+    char *config_argv[3] = {config_word, (char *)name, argc > 1 ? argv[1] : NULL};
+    return editConfig(argc > 1 ? 3 : 2, config_argv, out);
+}
+
+static void cmdTick(int argc, char **argv, ConsoleOut *out)
+{
+    setting("tick_ms", argc, argv, out);
+}
+
+static void cmdVolume(int argc, char **argv, ConsoleOut *out)
+{
+    if (setting("volume", argc, argv, out) == CONFIG_CHANGED)
+    {
+        request(DIAG_REQ_VOLUME, console_config.volume, out);
+    }
+}
+
+static void cmdBright(int argc, char **argv, ConsoleOut *out)
+{
+    long intensity;
+    if (argc == 2 && strcmp(argv[1], "auto") == 0)
+    {
+        if (request(DIAG_REQ_INTENSITY, -1, out))
+        {
+            consolePrintf(out, "following the light\n");
+        }
+    }
+    else if (argc == 2 && consoleParseInt(argv[1], 0, 15, &intensity))
+    {
+        if (request(DIAG_REQ_INTENSITY, intensity, out))
+        {
+            consolePrintf(out, "intensity fixed at %ld\n", intensity);
+        }
+    }
+    else
+    {
+        consolePrintf(out, "usage: bright 0..15 | auto\n");
+    }
+}
+
+static void cmdAnim(int argc, char **argv, ConsoleOut *out)
+{
+    int index = argc == 2 ? animByName(argv[1]) : -1;
+    if (index < 0)
+    {
+        consolePrintf(out, "animations:");
+        for (size_t i = 0; i < NAMED_ANIM_COUNT; i++)
+        {
+            consolePrintf(out, " %s", NAMED_ANIMS[i].name);
+        }
+        consolePrintf(out, "\n");
+        return;
+    }
+    if (request(DIAG_REQ_ANIM, index, out))
+    {
+        consolePrintf(out, "playing %s\n", NAMED_ANIMS[index].name);
+    }
+}
+
+static const char *const TRACE_NAMES[] = {"phase", "late", "intensity", "anim", "request", "end", "stall", "device", "battery", "heap"};
+
+static void cmdTrace(int argc, char **argv, ConsoleOut *out)
+{
+    long count = DIAG_TRACE_DEFAULT;
+    if (argc == 2 && !consoleParseInt(argv[1], 1, DIAG_TRACE_SIZE, &count))
+    {
+        consolePrintf(out, "usage: trace [1..%d]\n", DIAG_TRACE_SIZE);
+        return;
+    }
+
+    DiagTrace entries[DIAG_TRACE_SIZE];
+    uint16_t n = trace_log.recent(entries, count);
+    consolePrintf(out, "%u of %lu events\n", n, (unsigned long)trace_log.total());
+    for (uint16_t i = 0; i < n; i++)
+    {
+        const DiagTrace *e = &entries[i];
+        const char *name = e->kind < sizeof(TRACE_NAMES) / sizeof(TRACE_NAMES[0]) ? TRACE_NAMES[e->kind] : "?";
+        consolePrintf(out, "%10lu %-9s %3u %6d\n", (unsigned long)e->at_ms, name, e->arg, e->value);
+    }
+}
+
+static void printTiming(const char *name, const TimingStats *t, ConsoleOut *out)
+{
+    if (t->count == 0)
+    {
+        consolePrintf(out, "%-5s no ticks yet\n", name);
+        return;
+    }
+    consolePrintf(out, "%-5s %lu ticks, mean %lu us, min %lu, max %lu, p50 < %lu, p99 < %lu\n", name,
+                  (unsigned long)t->count, (unsigned long)(t->total_us / t->count), (unsigned long)t->min_us,
+                  (unsigned long)t->max_us, (unsigned long)timingPercentile(t, 50),
+                  (unsigned long)timingPercentile(t, 99));
+}
+
+static void printLatency(const char *name, const LatencyStats *l, ConsoleOut *out)
+{
+    if (l->count == 0)
+    {
+        consolePrintf(out, "%-5s no samples\n", name);
+        return;
+    }
+    consolePrintf(out, "%-5s %lu samples, mean %lu ms, min %u, max %u, p90 < %lu\n", name, (unsigned long)l->count,
+                  (unsigned long)latencyStatsMean(l), l->min_ms, l->max_ms,
+                  (unsigned long)latencyStatsPercentile(l, 90));
+}
+
+static void cmdStats(int argc, char **argv, ConsoleOut *out)
+{
+    if (argc == 2 && strcmp(argv[1], "reset") == 0)
+    {
+        stats_reset.store(true, std::memory_order_release);
+        consolePrintf(out, "cleared\n");
+        return;
+    }
+
+    DiagStatus s;
+    if (readStatus(&s, out))
+    {
+        printTiming("work", &s.work, out);
+        printTiming("late", &s.late, out);
+    }
+
+    // The player's, kept by the audio task
+    if (latency_source != NULL)
+    {
+        LatencyModel m = latency_source();
+        printLatency("rtt", &m.rtt, out);
+        printLatency("ack", &m.ack, out);
+        printLatency("onset", &m.onset, out);
+        printLatency("block", &m.block, out);
+    }
+}
+
+static const char *const TASK_NAMES[HEALTH_TASKS] = {"render", "audio", "imu", "light", "i2s"};
+static const char *const PERIPHERAL_NAMES[HEALTH_PERIPHERALS] = {"player", "imu"};
+
+static void cmdHealth(int argc, char **argv, ConsoleOut *out)
+{
+    if (health == NULL)
+    {
+        consolePrintf(out, "not supervised\n");
+        return;
+    }
+    consolePrintf(out, "last reset: %u\n", health->reset_reason);
+    for (int t = 0; t < HEALTH_TASKS; t++)
+    {
+        const TaskHealth *th = &health->tasks[t];
+        if (th->period_ms == 0)
+        {
+            continue;
+        }
+        consolePrintf(out, "%-7s %8lu beats, gap mean %lu ms, max %lu, p99 < %lu, %u stalls%s\n", TASK_NAMES[t],
+                      (unsigned long)th->beats,
+                      (unsigned long)(th->gaps.count > 0 ? th->gaps.total_us / th->gaps.count / 1000 : 0),
+                      (unsigned long)th->max_gap_ms, (unsigned long)timingPercentile(&th->gaps, 99) / 1000,
+                      th->stalls, th->stalled ? " STALLED" : "");
+    }
+    for (int p = 0; p < HEALTH_PERIPHERALS; p++)
+    {
+        const PeripheralHealth *ph = &health->peripherals[p];
+        consolePrintf(out, "%-7s %s, %u failures, %u recoveries\n", PERIPHERAL_NAMES[p], ph->up ? "up" : "down",
+                      ph->failures, ph->recoveries);
+    }
+
+    HeapGuardStats heap = heapGuardStats();
+    consolePrintf(out, "heap    %lu allocations after setup, %lu bytes", (unsigned long)heap.unexpected,
+                  (unsigned long)heap.unexpected_bytes);
+    if (heap.unexpected > 0)
+    {
+        consolePrintf(out, ", last %lu from 0x%08lx", (unsigned long)heap.last_size, (unsigned long)heap.last_from);
+    }
+    consolePrintf(out, ", %lu expected\n", (unsigned long)heap.expected);
+}
+
+static void cmdConfig(int argc, char **argv, ConsoleOut *out)
+{
+    if (editConfig(argc, argv, out) == CONFIG_SAVE && (save_hook == NULL || !save_hook(&console_config)))
+    {
+        consolePrintf(out, "not stored, only changed for now\n");
+    }
+}
+
+const ConsoleCommand DIAG_COMMANDS[] = {
+    {"status", "", "what the session and the eyes are doing", cmdStatus},
+    {"phase", "<n>", "jump to a phase", cmdPhase},
+    {"tick", "[ms]", "show or set the frame time", cmdTick},
+    {"bright", "<0..15|auto>", "fix the eye brightness or follow the light", cmdBright},
+    {"volume", "[0..30]", "show or set the volume", cmdVolume},
+    {"anim", "[name]", "play an animation once, or list them", cmdAnim},
+    {"trace", "[n]", "the last n events", cmdTrace},
+    {"stats", "[reset]", "tick timing and player latency", cmdStats},
+    {"health", "", "heartbeats, stalls and failed peripherals", cmdHealth},
+    {"config", "[name [value]]", "settings, see config.h", cmdConfig},
+};
+
+const size_t DIAG_COMMAND_COUNT = sizeof(DIAG_COMMANDS) / sizeof(DIAG_COMMANDS[0]);
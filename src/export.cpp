@@ -0,0 +1,37 @@
+#include <Arduino.h>
+#include "export.h"
+#include "usage.h"
+#include "usage_export.h"
+#include "clock.h"
+
+static UsageExporter exporter;
+static volatile bool export_running = false;
+static volatile uint32_t export_last_ms = 0;
+static volatile bool export_ever = false;
+
+static void writeSerial(const uint8_t *data, size_t len)
+{
+    Serial.write(data, len);
+}
+
+void exportBegin()
+{
+    usageExporterInit(&exporter, ESP.getEfuseMac(), usageScan, writeSerial);
+}
+
+void exportReceive(const uint8_t *data, size_t len)
+{
+    export_running = true;
+    if (usageExporterReceive(&exporter, data, len))
+    {
+        Serial.flush();
+        export_last_ms = clockMs32();
+        export_ever = true;
+    }
+    export_running = false;
+}
+
+bool exportActive()
+{
+    return export_running || (export_ever && clockMs32() - export_last_ms < EXPORT_LINGER_MS);
+}
@@ -0,0 +1,101 @@
+#include "font.h"
+
+// Pack a glyph from its rows, written left to right like the frames in
+//   anims.h. Glyphs narrower than the font are left-aligned.
+#define GLYPH_3X5(w, r0, r1, r2, r3, r4) \
+    ((uint32_t)(w) << 28 | (uint32_t)(r0) | (uint32_t)(r1) << 3 | (uint32_t)(r2) << 6 | (uint32_t)(r3) << 9 | (uint32_t)(r4) << 12)
+#define GLYPH_4X7(w, r0, r1, r2, r3, r4, r5, r6) \
+    ((uint32_t)(w) << 28 | (uint32_t)(r0) | (uint32_t)(r1) << 4 | (uint32_t)(r2) << 8 | (uint32_t)(r3) << 12 | \
+     (uint32_t)(r4) << 16 | (uint32_t)(r5) << 20 | (uint32_t)(r6) << 24)
+
+// ' ' to 'Z', 0 where there's no glyph
+static const uint32_t GLYPHS_3X5[59] = {
+    GLYPH_3X5(2, 0b000, 0b000, 0b000, 0b000, 0b000), // space
+    GLYPH_3X5(1, 0b100, 0b100, 0b100, 0b000, 0b100), // !
+    GLYPH_3X5(3, 0b101, 0b101, 0b000, 0b000, 0b000), // "
+    0, // #
+    0, // $
+    0, // %
+    0, // &
+    GLYPH_3X5(1, 0b100, 0b100, 0b000, 0b000, 0b000), // '
+    GLYPH_3X5(2, 0b010, 0b100, 0b100, 0b100, 0b010), // (
+    GLYPH_3X5(2, 0b100, 0b010, 0b010, 0b010, 0b100), // )
+    0, // *
+    GLYPH_3X5(3, 0b000, 0b010, 0b111, 0b010, 0b000), // +
+    GLYPH_3X5(2, 0b000, 0b000, 0b000, 0b010, 0b100), // ,
+    GLYPH_3X5(3, 0b000, 0b000, 0b111, 0b000, 0b000), // -
+    GLYPH_3X5(1, 0b000, 0b000, 0b000, 0b000, 0b100), // .
+    GLYPH_3X5(3, 0b001, 0b001, 0b010, 0b100, 0b100), // /
+    GLYPH_3X5(3, 0b111, 0b101, 0b101, 0b101, 0b111), // 0
+    GLYPH_3X5(3, 0b010, 0b110, 0b010, 0b010, 0b111), // 1
+    GLYPH_3X5(3, 0b111, 0b001, 0b111, 0b100, 0b111), // 2
+    GLYPH_3X5(3, 0b111, 0b001, 0b111, 0b001, 0b111), // 3
+    GLYPH_3X5(3, 0b101, 0b101, 0b111, 0b001, 0b001), // 4
+    GLYPH_3X5(3, 0b111, 0b100, 0b111, 0b001, 0b111), // 5
+    GLYPH_3X5(3, 0b111, 0b100, 0b111, 0b101, 0b111), // 6
+    GLYPH_3X5(3, 0b111, 0b001, 0b001, 0b010, 0b010), // 7
+    GLYPH_3X5(3, 0b111, 0b101, 0b111, 0b101, 0b111), // 8
+    GLYPH_3X5(3, 0b111, 0b101, 0b111, 0b001, 0b111), // 9
+    GLYPH_3X5(1, 0b000, 0b100, 0b000, 0b100, 0b000), // :
+    0, // ;
+    0, // <
+    GLYPH_3X5(3, 0b000, 0b111, 0b000, 0b111, 0b000), // =
+    0, // >
+    GLYPH_3X5(3, 0b111, 0b001, 0b011, 0b000, 0b010), // ?
+    0, // @
+    GLYPH_3X5(3, 0b010, 0b101, 0b111, 0b101, 0b101), // A
+    GLYPH_3X5(3, 0b110, 0b101, 0b110, 0b101, 0b110), // B
+    GLYPH_3X5(3, 0b011, 0b100, 0b100, 0b100, 0b011), // C
+    GLYPH_3X5(3, 0b110, 0b101, 0b101, 0b101, 0b110), // D
+    GLYPH_3X5(3, 0b111, 0b100, 0b110, 0b100, 0b111), // E
+    GLYPH_3X5(3, 0b111, 0b100, 0b110, 0b100, 0b100), // F
+    GLYPH_3X5(3, 0b011, 0b100, 0b101, 0b101, 0b011), // G
+    GLYPH_3X5(3, 0b101, 0b101, 0b111, 0b101, 0b101), // H
+    GLYPH_3X5(3, 0b111, 0b010, 0b010, 0b010, 0b111), // I
+    GLYPH_3X5(3, 0b001, 0b001, 0b001, 0b101, 0b010), // J
+    GLYPH_3X5(3, 0b101, 0b101, 0b110, 0b101, 0b101), // K
+    GLYPH_3X5(3, 0b100, 0b100, 0b100, 0b100, 0b111), // L
+    GLYPH_3X5(3, 0b101, 0b111, 0b111, 0b101, 0b101), // M
+    GLYPH_3X5(3, 0b110, 0b101, 0b101, 0b101, 0b101), // N
+    GLYPH_3X5(3, 0b010, 0b101, 0b101, 0b101, 0b010), // O
+    GLYPH_3X5(3, 0b110, 0b101, 0b110, 0b100, 0b100), // P
+    GLYPH_3X5(3, 0b010, 0b101, 0b101, 0b110, 0b011), // Q
+    GLYPH_3X5(3, 0b110, 0b101, 0b110, 0b101, 0b101), // R
+    GLYPH_3X5(3, 0b011, 0b100, 0b010, 0b001, 0b110), // S
+    GLYPH_3X5(3, 0b111, 0b010, 0b010, 0b010, 0b010), // T
+    GLYPH_3X5(3, 0b101, 0b101, 0b101, 0b101, 0b111), // U
+    GLYPH_3X5(3, 0b101, 0b101, 0b101, 0b101, 0b010), // V
+    GLYPH_3X5(3, 0b101, 0b101, 0b111, 0b111, 0b101), // W
+    GLYPH_3X5(3, 0b101, 0b101, 0b010, 0b101, 0b101), // X
+    GLYPH_3X5(3, 0b101, 0b101, 0b010, 0b010, 0b010), // Y
+    GLYPH_3X5(3, 0b111, 0b001, 0b010, 0b100, 0b111), // Z
+};
+
+static const uint32_t GLYPHS_4X7[10] = {
+    GLYPH_4X7(4, 0b0110, 0b1001, 0b1001, 0b1001, 0b1001, 0b1001, 0b0110), // 0
+    GLYPH_4X7(3, 0b0100, 0b1100, 0b0100, 0b0100, 0b0100, 0b0100, 0b1110), // 1
+    GLYPH_4X7(4, 0b0110, 0b1001, 0b0001, 0b0010, 0b0100, 0b1000, 0b1111), // 2
+    GLYPH_4X7(4, 0b1110, 0b0001, 0b0001, 0b0110, 0b0001, 0b0001, 0b1110), // 3
+    GLYPH_4X7(4, 0b1001, 0b1001, 0b1001, 0b1111, 0b0001, 0b0001, 0b0001), // 4
+    GLYPH_4X7(4, 0b1111, 0b1000, 0b1000, 0b1110, 0b0001, 0b0001, 0b1110), // 5
+    GLYPH_4X7(4, 0b0110, 0b1000, 0b1000, 0b1110, 0b1001, 0b1001, 0b0110), // 6
+    GLYPH_4X7(4, 0b1111, 0b0001, 0b0001, 0b0010, 0b0100, 0b0100, 0b0100), // 7
+    GLYPH_4X7(4, 0b0110, 0b1001, 0b1001, 0b0110, 0b1001, 0b1001, 0b0110), // 8
+    GLYPH_4X7(4, 0b0110, 0b1001, 0b1001, 0b0111, 0b0001, 0b0001, 0b0110), // 9
+};
+
+const Font FONT_3X5 = {3, 5, 1, ' ', 'Z', GLYPHS_3X5};
+const Font FONT_4X7 = {4, 7, 1, '0', '9', GLYPHS_4X7};
+
+uint32_t fontGlyph(const Font *font, char c)
+{
+    if (c >= 'a' && c <= 'z' && font->last < 'a')
+    {
+        c -= 'a' - 'A';
+    }
+    if (c < font->first || c > font->last)
+    {
+        return 0;
+    }
+    return font->glyphs[c - font->first];
+}
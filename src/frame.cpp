@@ -0,0 +1,119 @@
+#include <string.h>
+#include "frame.h"
+#include "crc32.h"
+
+enum FrameState : uint8_t
+{
+    STATE_SYNC0 = 0,
+    STATE_SYNC1,
+    STATE_TYPE,
+    STATE_LEN_LO,
+    STATE_LEN_HI,
+    STATE_PAYLOAD,
+    STATE_CRC,
+};
+
+size_t frameEncode(uint8_t type, const void *payload, uint16_t len, uint8_t *out)
+{
+    if (len > FRAME_MAX_PAYLOAD)
+    {
+        return 0;
+    }
+
+    out[0] = FRAME_SYNC0;
+    out[1] = FRAME_SYNC1;
+    out[2] = type;
+    out[3] = len & 0xFF;
+    out[4] = len >> 8;
+    memcpy(out + FRAME_HEADER_SIZE, payload, len);
+
+    uint32_t crc = crc32(out + 2, 3 + len);
+    uint8_t *tail = out + FRAME_HEADER_SIZE + len;
+    tail[0] = crc & 0xFF;
+    tail[1] = (crc >> 8) & 0xFF;
+    tail[2] = (crc >> 16) & 0xFF;
+    tail[3] = crc >> 24;
+    return FRAME_HEADER_SIZE + len + FRAME_CRC_SIZE;
+}
+
+void frameDecoderInit(FrameDecoder *decoder)
+{
+    decoder->state = STATE_SYNC0;
+    decoder->type = 0;
+    decoder->len = 0;
+    decoder->pos = 0;
+    decoder->crc = 0;
+    decoder->bad = 0;
+}
+
+uint8_t frameDecoderPush(FrameDecoder *decoder, uint8_t byte)
+{
+    switch (decoder->state)
+    {
+    case STATE_SYNC0:
+        if (byte == FRAME_SYNC0)
+        {
+            decoder->state = STATE_SYNC1;
+        }
+        return FRAME_PENDING;
+
+    case STATE_SYNC1:
+        decoder->state = byte == FRAME_SYNC1 ? STATE_TYPE : byte == FRAME_SYNC0 ? STATE_SYNC1 : STATE_SYNC0;
+        return FRAME_PENDING;
+
+    case STATE_TYPE:
+        decoder->type = byte;
+        decoder->state = STATE_LEN_LO;
+        return FRAME_PENDING;
+
+    case STATE_LEN_LO:
+        decoder->len = byte;
+        decoder->state = STATE_LEN_HI;
+        return FRAME_PENDING;
+
+    case STATE_LEN_HI:
+        decoder->len |= byte << 8;
+        decoder->pos = 0;
+        if (decoder->len > FRAME_MAX_PAYLOAD)
+        {
+            decoder->state = STATE_SYNC0;
+            decoder->bad++;
+            return FRAME_BAD;
+        }
+        decoder->state = decoder->len > 0 ? STATE_PAYLOAD : STATE_CRC;
+        decoder->crc = 0;
+        return FRAME_PENDING;
+
+    case STATE_PAYLOAD:
+        decoder->payload[decoder->pos++] = byte;
+        if (decoder->pos == decoder->len)
+        {
+            decoder->pos = 0;
+            decoder->crc = 0;
+            decoder->state = STATE_CRC;
+        }
+        return FRAME_PENDING;
+
+    case STATE_CRC:
+        decoder->crc |= (uint32_t)byte << (8 * decoder->pos);
+        if (++decoder->pos < FRAME_CRC_SIZE)
+        {
+            return FRAME_PENDING;
+        }
+        decoder->state = STATE_SYNC0;
+        {
+            uint8_t header[3] = {decoder->type, (uint8_t)(decoder->len & 0xFF), (uint8_t)(decoder->len >> 8)};
+            uint32_t crc = crc32Update(crc32(header, 3), decoder->payload, decoder->len);
+            if (crc != decoder->crc)
+            {
+                decoder->bad++;
+                return FRAME_BAD;
+            }
+        }
+        return FRAME_READY;
+
+    default:
+        decoder->state = STATE_SYNC0;
+        return FRAME_PENDING;
+    }
+}
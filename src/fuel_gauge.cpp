@@ -0,0 +1,96 @@
+#include "fuel_gauge.h"
+
+const uint16_t GAUGE_OCV_MV[GAUGE_CURVE_POINTS] = {
+    3300, 3680, 3740, 3770, 3790, 3820, 3870, 3920, 3980, 4060, 4200};
+
+const PowerPolicy POWER_POLICIES[BATTERY_LEVELS] = {
+    {15, 240, 3, false, true}, // BATTERY_OK
+    {8, 160, 2, false, true},  // BATTERY_SAVE
+    {3, 80, 1, true, true},    // BATTERY_LOW
+    {1, 80, 1, true, false},   // BATTERY_CRITICAL
+};
+
+// The charge each level starts below
+static const uint8_t LEVEL_BELOW[BATTERY_LEVELS] = {
+    101, GAUGE_SAVE_PERCENT, GAUGE_LOW_PERCENT, GAUGE_CRITICAL_PERCENT};
+
+uint8_t gaugeSocForMv(uint16_t mv)
+{
+    if (mv <= GAUGE_OCV_MV[0])
+    {
+        return 0;
+    }
+    for (int i = 1; i < GAUGE_CURVE_POINTS; i++)
+    {
+        if (mv < GAUGE_OCV_MV[i])
+        {
+            uint16_t lo = GAUGE_OCV_MV[i - 1];
+            return (i - 1) * 10 + (mv - lo) * 10 / (GAUGE_OCV_MV[i] - lo);
+        }
+    }
+    return 100;
+}
+
+uint16_t gaugeLoadMa(uint16_t cpu_mhz, uint32_t led_ua, bool audio)
+{
+    uint32_t ua = GAUGE_BASE_MA * 1000UL + cpu_mhz * GAUGE_CPU_UA_PER_MHZ + led_ua;
+    if (audio)
+    {
+        ua += GAUGE_AUDIO_MA * 1000UL;
+    }
+    return ua / 1000;
+}
+
+void fuelGaugeInit(FuelGauge *gauge)
+{
+    gauge->mv_q = 0;
+    gauge->soc = 100;
+    gauge->level = BATTERY_OK;
+    gauge->primed = false;
+}
+
+uint16_t fuelGaugeMv(const FuelGauge *gauge)
+{
+    return gauge->mv_q >> GAUGE_FILTER_SHIFT;
+}
+
+static uint8_t levelFor(uint8_t level, uint8_t soc)
+{
+    while (level + 1 < BATTERY_LEVELS && soc < LEVEL_BELOW[level + 1])
+    {
+        level++;
+    }
+    while (level > BATTERY_OK && soc >= LEVEL_BELOW[level] + GAUGE_HYSTERESIS_PERCENT)
+    {
+        level--;
+    }
+    return level;
+}
+
+bool fuelGaugePush(FuelGauge *gauge, uint16_t cell_mv, uint16_t load_ma)
+{
+    // What the cell would read with nothing drawn
+    uint32_t resting = cell_mv + (uint32_t)load_ma * GAUGE_RESISTANCE_MOHM / 1000;
+
+    if (!gauge->primed)
+    {
+        gauge->mv_q = resting << GAUGE_FILTER_SHIFT;
+        gauge->soc = gaugeSocForMv(resting);
+        gauge->primed = true;
+    }
+    else
+    {
+        gauge->mv_q -= gauge->mv_q >> GAUGE_FILTER_SHIFT;
+        gauge->mv_q += resting;
+        uint8_t soc = gaugeSocForMv(fuelGaugeMv(gauge));
+        if (soc < gauge->soc || soc >= gauge->soc + GAUGE_RISE_PERCENT)
+        {
+            gauge->soc = soc;
+        }
+    }
+
+    uint8_t level = levelFor(gauge->level, gauge->soc);
+    bool changed = level != gauge->level;
+    gauge->level = level;
+    return changed;
+}
@@ -0,0 +1,153 @@
+#include <string.h>
+#include "health.h"
+
+void backoffInit(Backoff *backoff, uint32_t now_ms)
+{
+    backoff->next_ms = now_ms;
+    backoff->delay_ms = 0;
+}
+
+bool backoffDue(const Backoff *backoff, uint32_t now_ms)
+{
+    return (int32_t)(now_ms - backoff->next_ms) >= 0;
+}
+
+void backoffFailed(Backoff *backoff, uint32_t now_ms)
+{
+    backoff->delay_ms = backoff->delay_ms == 0 ? HEALTH_RETRY_MIN_MS : backoff->delay_ms * 2;
+    if (backoff->delay_ms > HEALTH_RETRY_MAX_MS)
+    {
+        backoff->delay_ms = HEALTH_RETRY_MAX_MS;
+    }
+    backoff->next_ms = now_ms + backoff->delay_ms;
+}
+
+void healthInit(Health *health, uint8_t reset_reason)
+{
+    memset(health, 0, sizeof(*health));
+    health->reset_reason = reset_reason;
+    for (int t = 0; t < HEALTH_TASKS; t++)
+    {
+        timingReset(&health->tasks[t].gaps);
+    }
+}
+
+void healthWatch(Health *health, uint8_t task, uint32_t period_ms, uint32_t now_ms)
+{
+    TaskHealth *th = &health->tasks[task];
+    th->last_ms = now_ms;
+    th->period_ms = period_ms;
+}
+
+void healthBeat(Health *health, uint8_t task, uint32_t now_ms)
+{
+    TaskHealth *th = &health->tasks[task];
+    uint32_t gap = now_ms - th->last_ms;
+    if (th->beats > 0)
+    {
+        th->max_gap_ms = gap > th->max_gap_ms ? gap : th->max_gap_ms;
+        timingAdd(&th->gaps, gap * 1000);
+    }
+    th->beats++;
+    th->last_ms = now_ms;
+    th->stalled = false;
+}
+
+uint8_t healthCheck(Health *health, uint32_t now_ms)
+{
+    uint8_t stalled = 0;
+    for (int t = 0; t < HEALTH_TASKS; t++)
+    {
+        TaskHealth *th = &health->tasks[t];
+        if (th->period_ms == 0 || th->stalled)
+        {
+            continue;
+        }
+        if (now_ms - th->last_ms > th->period_ms * HEALTH_STALL_PERIODS)
+        {
+            th->stalled = true;
+            th->stalls++;
+            stalled |= 1 << t;
+        }
+    }
+    return stalled;
+}
+
+void healthPeripheralUp(Health *health, uint8_t peripheral)
+{
+    PeripheralHealth *ph = &health->peripherals[peripheral];
+    if (!ph->up && ph->failures > 0)
+    {
+        ph->recoveries++;
+    }
+    ph->up = true;
+    ph->retry.delay_ms = 0;
+}
+
+void healthPeripheralFailed(Health *health, uint8_t peripheral, uint32_t now_ms)
+{
+    PeripheralHealth *ph = &health->peripherals[peripheral];
+    if (ph->up || ph->failures == 0)
+    {
+        // Newly down, retries that fail again aren't new failures
+        ph->failures++;
+        ph->retry.delay_ms = 0;
+    }
+    ph->up = false;
+    backoffFailed(&ph->retry, now_ms);
+}
+
+bool healthRetryDue(const Health *health, uint8_t peripheral, uint32_t now_ms)
+{
+    const PeripheralHealth *ph = &health->peripherals[peripheral];
+    return !ph->up && backoffDue(&ph->retry, now_ms);
+}
+
+bool healthNoteworthy(const Health *health)
+{
+    if (health->reset_reason >= USAGE_RESET_WATCHDOG)
+    {
+        return true;
+    }
+    for (int t = 0; t < HEALTH_TASKS; t++)
+    {
+        if (health->tasks[t].stalls > 0)
+        {
+            return true;
+        }
+    }
+    for (int p = 0; p < HEALTH_PERIPHERALS; p++)
+    {
+        if (health->peripherals[p].failures > 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint16_t clamp16(uint32_t v)
+{
+    return v > 0xFFFF ? 0xFFFF : v;
+}
+
+void healthRecord(const Health *health, uint32_t uptime_ms, UsageHealth *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->reset_reason = health->reset_reason;
+    out->uptime_ms = uptime_ms;
+    for (int p = 0; p < HEALTH_PERIPHERALS; p++)
+    {
+        const PeripheralHealth *ph = &health->peripherals[p];
+        out->down |= !ph->up && ph->failures > 0 ? 1 << p : 0;
+        out->failures[p] = ph->failures;
+        out->recoveries[p] = ph->recoveries;
+    }
+    for (int t = 0; t < HEALTH_TASKS; t++)
+    {
+        uint8_t slot = t == HEALTH_TASK_I2S ? HEALTH_TASK_AUDIO : t;
+        uint16_t gap = clamp16(health->tasks[t].max_gap_ms);
+        out->stalls[slot] += health->tasks[t].stalls;
+        out->max_gap_ms[slot] = gap > out->max_gap_ms[slot] ? gap : out->max_gap_ms[slot];
+    }
+}
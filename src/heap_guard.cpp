@@ -0,0 +1,93 @@
+#include <atomic>
+#include "heap_guard.h"
+
+static std::atomic<bool> armed(false);
+// The tasks inside heapGuardExpect(), 0 for a free slot, and how deep.
+//   A slot's depth is only touched by the task that holds it.
+static std::atomic<uintptr_t> expecting_task[HEAP_GUARD_TASKS];
+static int32_t expecting_depth[HEAP_GUARD_TASKS];
+static std::atomic<uint32_t> unexpected(0);
+static std::atomic<uint32_t> unexpected_bytes(0);
+static std::atomic<uint32_t> expected(0);
+// Only for the log, a torn pair of these doesn't matter
+static volatile uint32_t last_size = 0;
+static volatile uintptr_t last_from = 0;
+
+void heapGuardArm()
+{
+    armed = true;
+}
+
+bool heapGuardArmed()
+{
+    return armed;
+}
+
+static int findTask(uintptr_t task)
+{
+    for (int i = 0; i < HEAP_GUARD_TASKS; i++)
+    {
+        if (expecting_task[i].load(std::memory_order_relaxed) == task)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void heapGuardExpect(bool expect)
+{
+    uintptr_t task = heapGuardTask();
+    int slot = findTask(task);
+    if (!expect)
+    {
+        if (slot >= 0 && --expecting_depth[slot] == 0)
+        {
+            expecting_task[slot].store(0, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    if (slot >= 0)
+    {
+        expecting_depth[slot]++;
+        return;
+    }
+    for (int i = 0; i < HEAP_GUARD_TASKS; i++)
+    {
+        uintptr_t none = 0;
+        if (expecting_task[i].compare_exchange_strong(none, task, std::memory_order_relaxed))
+        {
+            expecting_depth[i] = 1;
+            return;
+        }
+    }
+}
+
+void heapGuardNote(size_t size, uintptr_t from)
+{
+    if (!armed.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    if (findTask(heapGuardTask()) >= 0)
+    {
+        expected.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    unexpected_bytes.fetch_add(size, std::memory_order_relaxed);
+    last_size = size;
+    last_from = from;
+    unexpected.fetch_add(1, std::memory_order_relaxed);
+}
+
+HeapGuardStats heapGuardStats()
+{
+    HeapGuardStats stats;
+    stats.unexpected = unexpected;
+    stats.unexpected_bytes = unexpected_bytes;
+    stats.expected = expected;
+    stats.last_size = last_size;
+    stats.last_from = last_from;
+    return stats;
+}
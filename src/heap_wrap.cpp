@@ -0,0 +1,37 @@
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "heap_guard.h"
+
+uintptr_t heapGuardTask()
+{
+    return (uintptr_t)xTaskGetCurrentTaskHandle();
+}
+
+// The firmware links with -Wl,--wrap=malloc and the rest (platformio.ini),
+//   so every call to them, from the libraries and the core as well as
+//   from here, comes through these. operator new goes through malloc().
+extern "C"
+{
+    void *__real_malloc(size_t size);
+    void *__real_calloc(size_t n, size_t size);
+    void *__real_realloc(void *ptr, size_t size);
+
+    void *__wrap_malloc(size_t size)
+    {
+        heapGuardNote(size, (uintptr_t)__builtin_return_address(0));
+        return __real_malloc(size);
+    }
+
+    void *__wrap_calloc(size_t n, size_t size)
+    {
+        heapGuardNote(n * size, (uintptr_t)__builtin_return_address(0));
+        return __real_calloc(n, size);
+    }
+
+    void *__wrap_realloc(void *ptr, size_t size)
+    {
+        heapGuardNote(size, (uintptr_t)__builtin_return_address(0));
+        return __real_realloc(ptr, size);
+    }
+}
@@ -0,0 +1,31 @@
+#include "holder.h"
+
+void holderWatchInit(HolderWatch *watch, uint16_t threshold)
+{
+    watch->rest = threshold;
+    watch->lift = threshold > HOLDER_HYSTERESIS ? threshold - HOLDER_HYSTERESIS : 0;
+    watch->confirm = HOLDER_CONFIRM_SAMPLES;
+    watch->armed = false;
+    watch->count = 0;
+}
+
+bool holderWatchSample(HolderWatch *watch, uint16_t reading)
+{
+    if (reading > watch->rest)
+    {
+        watch->armed = true;
+        watch->count = 0;
+        return false;
+    }
+    if (!watch->armed)
+    {
+        return false;
+    }
+    // In between, not clearly out, start counting again
+    if (reading >= watch->lift)
+    {
+        watch->count = 0;
+        return false;
+    }
+    return ++watch->count >= watch->confirm;
+}
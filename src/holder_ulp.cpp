@@ -0,0 +1,106 @@
+#include <Arduino.h>
+#include "holder.h"
+#include "holder_ulp.h"
+#include "esp_sleep.h"
+#include "esp32/ulp.h"
+#include "hal/adc_ll.h"
+
+// The program's variables, words at the start of RTC slow memory, with
+//   the program after them. The ULP only sees the low 16 bits of a word.
+enum HolderUlpVar
+{
+    VAR_REST = 0, // threshold + 1, in the holder from this reading up
+    VAR_LIFT,
+    VAR_CONFIRM,
+    VAR_ARMED,
+    VAR_COUNT,
+    VAR_READING, // the last one, for debugging
+    VAR_SAMPLES,
+    HOLDER_ULP_VARS,
+};
+
+enum HolderUlpLabel
+{
+    LABEL_OUT = 1,
+    LABEL_LIFTED,
+    LABEL_HALT,
+};
+
+// holderWatchSample() for the ULP, once every HOLDER_SAMPLE_MS. The reading
+//   stays in R2, R3 points at the variables and the branches compare R0.
+//   SUBR sets the overflow flag when the result goes below zero, that's
+//   how two registers are compared.
+static const ulp_insn_t HOLDER_PROGRAM[] = {
+    I_ADC(R2, 1, HOLDER_ADC2_CHANNEL),
+    I_MOVI(R3, 0),
+    I_ST(R2, R3, VAR_READING),
+    I_LD(R0, R3, VAR_SAMPLES),
+    I_ADDI(R0, R0, 1),
+    I_ST(R0, R3, VAR_SAMPLES),
+
+    // In the holder: armed, and nothing counted
+    I_LD(R1, R3, VAR_REST),
+    I_SUBR(R0, R2, R1),
+    M_BXF(LABEL_OUT),
+    I_MOVI(R0, 1),
+    I_ST(R0, R3, VAR_ARMED),
+    I_MOVI(R0, 0),
+    I_ST(R0, R3, VAR_COUNT),
+    I_HALT(),
+
+    // Out, but it has to have been in first
+    M_LABEL(LABEL_OUT),
+    I_LD(R0, R3, VAR_ARMED),
+    M_BL(LABEL_HALT, 1),
+    I_LD(R1, R3, VAR_LIFT),
+    I_SUBR(R0, R2, R1),
+    M_BXF(LABEL_LIFTED),
+    // In between, start counting again
+    I_MOVI(R0, 0),
+    I_ST(R0, R3, VAR_COUNT),
+    I_HALT(),
+
+    // Lifted, wake once it's stayed lifted long enough, and stop the ULP
+    //   timer so it doesn't go on waking
+    M_LABEL(LABEL_LIFTED),
+    I_LD(R0, R3, VAR_COUNT),
+    I_ADDI(R0, R0, 1),
+    I_ST(R0, R3, VAR_COUNT),
+    I_LD(R1, R3, VAR_CONFIRM),
+    I_SUBR(R0, R0, R1),
+    M_BXF(LABEL_HALT),
+    I_WAKE(),
+    I_END(),
+    M_LABEL(LABEL_HALT),
+    I_HALT(),
+};
+
+bool holderUlpArm(uint16_t threshold)
+{
+    HolderWatch watch;
+    holderWatchInit(&watch, threshold);
+    RTC_SLOW_MEM[VAR_REST] = watch.rest + 1;
+    RTC_SLOW_MEM[VAR_LIFT] = watch.lift;
+    RTC_SLOW_MEM[VAR_CONFIRM] = watch.confirm;
+    RTC_SLOW_MEM[VAR_ARMED] = 0;
+    RTC_SLOW_MEM[VAR_COUNT] = 0;
+    RTC_SLOW_MEM[VAR_SAMPLES] = 0;
+
+    size_t size = sizeof(HOLDER_PROGRAM) / sizeof(ulp_insn_t);
+    if (ulp_process_macros_and_load(HOLDER_ULP_VARS, HOLDER_PROGRAM, &size) != ESP_OK)
+    {
+        return false;
+    }
+
+    // A read through the driver leaves the width and attenuation set, then
+    //   the ULP takes over the ADC, as adc1_ulp_enable() does for ADC1
+    analogRead(HOLDER_PIN);
+    adc_ll_set_controller(ADC_UNIT_2, ADC_LL_CTRL_ULP);
+
+    if (ulp_set_wakeup_period(0, HOLDER_SAMPLE_MS * 1000) != ESP_OK ||
+        esp_sleep_enable_ulp_wakeup() != ESP_OK)
+    {
+        return false;
+    }
+    return ulp_run(HOLDER_ULP_VARS) == ESP_OK;
+}
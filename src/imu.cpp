@@ -0,0 +1,244 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include "imu.h"
+#include "ring_buffer.h"
+#include "supervisor.h"
+#include "clock.h"
+#include "static_task.h"
+
+// *** MPU-6050 registers *** //
+#define MPU6050_ADDR 0x68
+#define MPU6050_REG_SMPLRT_DIV 0x19
+#define MPU6050_REG_CONFIG 0x1A
+#define MPU6050_REG_GYRO_CONFIG 0x1B
+#define MPU6050_REG_ACCEL_CONFIG 0x1C
+#define MPU6050_REG_ACCEL_XOUT_H 0x3B
+#define MPU6050_REG_PWR_MGMT_1 0x6B
+#define MPU6050_REG_WHO_AM_I 0x75
+
+// *** Sampling task *** //
+#define IMU_TASK_STACK 3072
+#define IMU_TASK_PRIORITY 3
+#define IMU_TASK_CORE 0
+// Process the ring once this many samples have piled up
+#define IMU_PROCESS_BATCH 16
+// The sensor is taken as gone after this many failed reads in a row
+#define IMU_FAILED_READS 10
+// Longest the task may go between heartbeats
+#define IMU_HEARTBEAT_MS 50
+
+static StaticTask<IMU_TASK_STACK> imu_task;
+static RingBuffer<ImuSample, 128> imu_ring;
+static BrushMotion imu_motion;
+
+static portMUX_TYPE imu_state_mux = portMUX_INITIALIZER_UNLOCKED;
+static BrushState imu_state;
+
+static volatile uint32_t imu_dropped = 0;
+static volatile uint16_t imu_load_permille = 0;
+static bool imu_up = false;
+static uint16_t imu_failed_reads = 0;
+
+static bool writeRegister(uint8_t reg, uint8_t value)
+{
+    Wire.beginTransmission(MPU6050_ADDR);
+    Wire.write(reg);
+    Wire.write(value);
+    return Wire.endTransmission() == 0;
+}
+
+static bool readRegisters(uint8_t reg, uint8_t *buf, size_t len)
+{
+    Wire.beginTransmission(MPU6050_ADDR);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0)
+    {
+        return false;
+    }
+    if (Wire.requestFrom((uint8_t)MPU6050_ADDR, len) != len)
+    {
+        return false;
+    }
+    Wire.readBytes(buf, len);
+    return true;
+}
+
+static bool readSample(ImuSample *s)
+{
+    // accel xyz, temperature, gyro xyz, all big-endian int16
+    uint8_t raw[14];
+    if (!readRegisters(MPU6050_REG_ACCEL_XOUT_H, raw, sizeof(raw)))
+    {
+        return false;
+    }
+    s->ax = (int16_t)((raw[0] << 8) | raw[1]);
+    s->ay = (int16_t)((raw[2] << 8) | raw[3]);
+    s->az = (int16_t)((raw[4] << 8) | raw[5]);
+    s->gx = (int16_t)((raw[8] << 8) | raw[9]);
+    s->gy = (int16_t)((raw[10] << 8) | raw[11]);
+    s->gz = (int16_t)((raw[12] << 8) | raw[13]);
+    return true;
+}
+
+// Drain everything in the ring through the feature extractor
+static void processSamples()
+{
+    ImuSample s;
+    bool updated = false;
+    while (imu_ring.pop(s))
+    {
+#ifdef DEBUG_IMU
+        Serial.printf("%lu,%d,%d,%d,%d,%d,%d\n", (unsigned long)clockMs32(), s.ax, s.ay, s.az, s.gx, s.gy, s.gz);
+#endif
+        updated |= brushMotionPush(&imu_motion, &s);
+    }
+
+    if (updated)
+    {
+        portENTER_CRITICAL(&imu_state_mux);
+        imu_state = imu_motion.state;
+        portEXIT_CRITICAL(&imu_state_mux);
+    }
+}
+
+// Wake up on the gyro X clock, 1 kHz internal rate with the 44 Hz low-pass
+//   so the 100 Hz sampling doesn't alias, +-250 dps and +-2 g
+static bool configure()
+{
+    uint8_t who = 0;
+    if (!readRegisters(MPU6050_REG_WHO_AM_I, &who, 1) || who != MPU6050_ADDR)
+    {
+        return false;
+    }
+
+    return writeRegister(MPU6050_REG_PWR_MGMT_1, 0x01) &&
+           writeRegister(MPU6050_REG_CONFIG, 0x03) &&
+           writeRegister(MPU6050_REG_SMPLRT_DIV, 9) &&
+           writeRegister(MPU6050_REG_GYRO_CONFIG, 0x00) &&
+           writeRegister(MPU6050_REG_ACCEL_CONFIG, 0x00);
+}
+
+// A sensor that stops answering reads as "not brushing", so the phases
+//   fall back to their time limits, until it's set up again
+static void sampleFailed()
+{
+    if (!imu_up || ++imu_failed_reads < IMU_FAILED_READS)
+    {
+        return;
+    }
+
+    imu_up = false;
+    supervisorPeripheralFailed(HEALTH_IMU);
+    brushMotionInit(&imu_motion);
+    portENTER_CRITICAL(&imu_state_mux);
+    imu_state = imu_motion.state;
+    portEXIT_CRITICAL(&imu_state_mux);
+}
+
+static void retry()
+{
+    if (!supervisorRetryDue(HEALTH_IMU))
+    {
+        return;
+    }
+    if (configure())
+    {
+        imu_up = true;
+        imu_failed_reads = 0;
+        supervisorPeripheralUp(HEALTH_IMU);
+    }
+    else
+    {
+        supervisorPeripheralFailed(HEALTH_IMU);
+    }
+}
+
+static void imuTask(void *arg)
+{
+    const TickType_t period = pdMS_TO_TICKS(1000 / BRUSH_SAMPLE_HZ);
+    TickType_t last_wake = xTaskGetTickCount();
+
+    uint32_t busy_us = 0;
+    int64_t window_start = clockUs();
+
+    supervisorWatch(HEALTH_TASK_IMU, IMU_HEARTBEAT_MS);
+    while (true)
+    {
+        vTaskDelayUntil(&last_wake, period);
+        supervisorBeat(HEALTH_TASK_IMU);
+
+        if (!imu_up)
+        {
+            retry();
+            continue;
+        }
+
+        int64_t t0 = clockUs();
+
+        ImuSample s;
+        if (!readSample(&s))
+        {
+            sampleFailed();
+        }
+        else
+        {
+            imu_failed_reads = 0;
+            if (!imu_ring.push(s))
+            {
+                imu_dropped++;
+            }
+        }
+
+        if (imu_ring.count() >= IMU_PROCESS_BATCH)
+        {
+            processSamples();
+        }
+
+        busy_us += clockUs() - t0;
+
+        // Report the load about once a second
+        uint32_t elapsed = clockUs() - window_start;
+        if (elapsed >= 1000000)
+        {
+            imu_load_permille = (uint16_t)((uint64_t)busy_us * 1000 / elapsed);
+            busy_us = 0;
+            window_start = clockUs();
+        }
+    }
+}
+
+bool imuBegin()
+{
+    brushMotionInit(&imu_motion);
+    imu_state = imu_motion.state;
+
+    Wire.begin(IMU_SDA, IMU_SCL, IMU_I2C_HZ);
+
+    // Not fitted, rather than failed: nothing to retry
+    if (!configure())
+    {
+        return false;
+    }
+    imu_up = true;
+    supervisorPeripheralUp(HEALTH_IMU);
+
+    return imu_task.start(imuTask, "imu", IMU_TASK_PRIORITY, IMU_TASK_CORE);
+}
+
+BrushState imuGetState()
+{
+    portENTER_CRITICAL(&imu_state_mux);
+    BrushState st = imu_state;
+    portEXIT_CRITICAL(&imu_state_mux);
+    return st;
+}
+
+uint32_t imuDroppedSamples()
+{
+    return imu_dropped;
+}
+
+uint16_t imuCpuLoadPermille()
+{
+    return imu_load_permille;
+}
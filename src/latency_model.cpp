@@ -0,0 +1,136 @@
+#include <string.h>
+#include "heap_guard.h"
+#include "latency_model.h"
+
+void latencyStatsInit(LatencyStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->min_ms = 0xFFFF;
+}
+
+// Halve everything so the histogram can keep counting
+static void ageStats(LatencyStats *stats)
+{
+    stats->count = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        stats->buckets[i] /= 2;
+        stats->count += stats->buckets[i];
+    }
+    stats->sum_ms /= 2;
+}
+
+void latencyStatsAdd(LatencyStats *stats, uint32_t ms)
+{
+    if (ms > 0xFFFF)
+    {
+        ms = 0xFFFF;
+    }
+
+    uint32_t bucket = ms / LATENCY_BUCKET_MS;
+    if (bucket >= LATENCY_BUCKETS)
+    {
+        bucket = LATENCY_BUCKETS - 1;
+    }
+
+    if (stats->buckets[bucket] == 0xFFFF)
+    {
+        ageStats(stats);
+    }
+
+    stats->buckets[bucket]++;
+    stats->count++;
+    stats->sum_ms += ms;
+    if (ms < stats->min_ms)
+    {
+        stats->min_ms = (uint16_t)ms;
+    }
+    if (ms > stats->max_ms)
+    {
+        stats->max_ms = (uint16_t)ms;
+    }
+}
+
+uint32_t latencyStatsMean(const LatencyStats *stats)
+{
+    return stats->count == 0 ? 0 : stats->sum_ms / stats->count;
+}
+
+uint32_t latencyStatsPercentile(const LatencyStats *stats, uint8_t percentile)
+{
+    if (stats->count == 0)
+    {
+        return 0;
+    }
+
+    uint32_t target = (stats->count * percentile + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        seen += stats->buckets[i];
+        if (seen >= target)
+        {
+            uint32_t upper = (i + 1) * LATENCY_BUCKET_MS;
+            return upper < stats->max_ms ? upper : stats->max_ms;
+        }
+    }
+    return stats->max_ms;
+}
+
+void latencyModelInit(LatencyModel *model)
+{
+    model->version = LATENCY_MODEL_VERSION;
+    latencyStatsInit(&model->rtt);
+    latencyStatsInit(&model->ack);
+    latencyStatsInit(&model->onset);
+    latencyStatsInit(&model->block);
+}
+
+bool latencyModelValid(const LatencyModel *model)
+{
+    return model->version == LATENCY_MODEL_VERSION;
+}
+
+uint32_t latencyModelLeadMs(const LatencyModel *model, uint32_t fallback_ms)
+{
+    // Best case we have actually heard the player start
+    if (model->onset.count >= LATENCY_MIN_ONSET_SAMPLES)
+    {
+        return latencyStatsPercentile(&model->onset, LATENCY_LEAD_PERCENTILE);
+    }
+
+    // Otherwise the ACK at least tells us how slow the link and module are
+    if (model->ack.count > 0)
+    {
+        return latencyStatsPercentile(&model->ack, LATENCY_LEAD_PERCENTILE) + LATENCY_DECODE_ESTIMATE_MS;
+    }
+
+    return fallback_ms;
+}
+
+bool latencyModelStart(LatencyModel *model, LatencyPlayer *player)
+{
+    // NVS allocates its handle, and this runs again when the supervisor
+    //   brings the player back
+    heapGuardExpect(true);
+    bool loaded = player->load(model);
+    heapGuardExpect(false);
+    if (loaded && latencyModelValid(model) && model->ack.count > 0)
+    {
+        // Sessions keep adding samples, no need to hold up every wake
+        return false;
+    }
+
+    latencyModelInit(model);
+    player->calibrate(model);
+    latencyModelSave(model, player);
+    return true;
+}
+
+void latencyModelSave(const LatencyModel *model, LatencyPlayer *player)
+{
+    // NVS allocates its handle and the entries it writes
+    heapGuardExpect(true);
+    player->save(model);
+    heapGuardExpect(false);
+}
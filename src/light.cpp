@@ -0,0 +1,86 @@
+#include <Arduino.h>
+#include "light.h"
+#include "supervisor.h"
+#include "static_task.h"
+
+// *** Sampling task *** //
+#define LIGHT_TASK_STACK 2048
+#define LIGHT_TASK_PRIORITY 1
+#define LIGHT_TASK_CORE 0
+#define LIGHT_SAMPLE_HZ 20
+// Readings averaged per sample, spread over a mains cycle so lamp flicker
+//   doesn't alias into the level
+#define LIGHT_BURST 8
+#define LIGHT_BURST_GAP_US 1250
+// Longest the task may go between heartbeats
+#define LIGHT_HEARTBEAT_MS 100
+
+static StaticTask<LIGHT_TASK_STACK> light_task;
+static AmbientFilter light_filter;
+static volatile uint8_t light_target = BRIGHTNESS_DEFAULT;
+static volatile uint16_t light_level = 0;
+
+#ifdef LIGHT_SENSOR_PIN
+
+static uint16_t readLight()
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < LIGHT_BURST; i++)
+    {
+        if (i > 0)
+        {
+            delayMicroseconds(LIGHT_BURST_GAP_US);
+        }
+        sum += analogRead(LIGHT_SENSOR_PIN);
+    }
+    return sum / LIGHT_BURST;
+}
+
+static void sample()
+{
+    ambientFilterPush(&light_filter, readLight());
+    light_level = ambientFilterLevel(&light_filter);
+    light_target = light_filter.target;
+}
+
+static void lightTask(void *arg)
+{
+    const TickType_t period = pdMS_TO_TICKS(1000 / LIGHT_SAMPLE_HZ);
+    TickType_t last_wake = xTaskGetTickCount();
+
+    supervisorWatch(HEALTH_TASK_LIGHT, LIGHT_HEARTBEAT_MS);
+    while (true)
+    {
+        vTaskDelayUntil(&last_wake, period);
+        supervisorBeat(HEALTH_TASK_LIGHT);
+        sample();
+    }
+}
+
+bool lightBegin()
+{
+    ambientFilterInit(&light_filter);
+    analogSetPinAttenuation(LIGHT_SENSOR_PIN, ADC_11db);
+    sample();
+
+    return light_task.start(lightTask, "light", LIGHT_TASK_PRIORITY, LIGHT_TASK_CORE);
+}
+
+#else
+
+bool lightBegin()
+{
+    return false;
+}
+
+#endif
+
+uint8_t lightTargetIntensity()
+{
+    return light_target;
+}
+
+uint16_t lightLevel()
+{
+    return light_level;
+}
@@ -1,204 +1,270 @@
 #include <Arduino.h>
-#include <LedControl.h>
-#include "DFRobotDFPlayerMini.h"
 #include "anims.h"
+#include "present.h"
+#include "max7219.h"
+#include "imu.h"
+#include "light.h"
+#include "session.h"
+#include "audio.h"
+#include "usage.h"
+#include "export.h"
+#include "ble.h"
+#include "ota.h"
+#include "config_store.h"
+#include "diag.h"
+#include "shell.h"
+#include "supervisor.h"
+#include "holder_ulp.h"
+#include "battery.h"
 #include "driver/rtc_io.h"
+#include "esp_timer.h"
+#include "clock.h"
+#include "heap_guard.h"
 
 // Uncomment this to get debug info in the serial monitor
 // #define DEBUG
-#define DEBUG_MUSIC
 
-// *** Eye LedControl pins *** //
+// *** LED matrix chain pins *** //
 #define DIN_LEFT 23
 #define CS_LEFT 5
 #define CLK_LEFT 18
 
-// *** DF Player Pins *** //
-#define RXD2 16
-#define TXD2 17
+// *** LED matrix chain layout *** //
+// Number of chained MAX7219s, device 0 is the first one after the ESP32
+#define DISPLAY_DEVICES 2
+#define EYE_LEFT 0
+#define EYE_RIGHT 1
 
 // *** Deep Sleep *** //
 #define BUTTON_PIN_BITMASK(GPIO) (1ULL << GPIO)
-#define WAKEUP_GPIO GPIO_NUM_26
+#define WAKEUP_GPIO HOLDER_PIN
 
-long start_time = 0;
+// *** Supervision *** //
+// How often the render loop beats at the slowest tick the settings allow.
+//   The pauses at the end of a session are a couple of these, well short
+//   of a stall (HEALTH_STALL_PERIODS).
+#define RENDER_HEARTBEAT_MS 1000
 
-// *** Eye LedControl objects *** //
-LedControl lc_left = LedControl(DIN_LEFT, CLK_LEFT, CS_LEFT, 2);
+// *** LED matrix objects *** //
+FramePresenter<DISPLAY_DEVICES> presenter;
+Max7219Chain<DISPLAY_DEVICES> display(DIN_LEFT, CLK_LEFT, CS_LEFT);
+BrightnessRamp eye_brightness;
 
-// *** DF Player Serial *** //
-DFRobotDFPlayerMini music;
+bool playing_eyes_close = false;
+AnimPlayer close_player;
+
+// Set from the console: an animation playing over the session (index into
+//   NAMED_ANIMS, -1 for none) and a fixed eye brightness (-1 for none)
+int named_anim = -1;
+AnimPlayer named_player;
+int intensity_override = -1;
+
+// The battery level the power policy was last set for, and how many LEDs
+//   are lit, for the battery's estimate of the load
+uint8_t power_level = BATTERY_OK;
+uint16_t lit_pixels = 0;
+
+// When the frame being prepared is due, in clockMs(). Ticks stay on a
+//   fixed grid so the audio task can tell ahead of time when an upcoming
+//   phase will be shown. The portable modules get its low 32 bits.
+int64_t next_tick = 0;
+
+// *** Frame presentation *** //
+// A one-shot timer puts each frame on the eyes at its deadline, while the
+//   loop prepares the one after it. Without the timer the loop waits for
+//   the deadline and presents the frame itself.
+esp_timer_handle_t present_timer = NULL;
+TaskHandle_t render_task = NULL;
+volatile int64_t present_due_us = 0;
+// How far past its deadline the last frame finished going out
+volatile uint32_t present_late_us = 0;
+
+// Activity for the session's adaptive phase timing comes from the IMU task.
+//   A classification that hasn't moved on for this long is from a task
+//   that's stopped, and counts as not brushing rather than holding the
+//   phase at whatever it last saw.
+#define IMU_STALE_MS (4 * BRUSH_WINDOW * 1000 / BRUSH_SAMPLE_HZ)
+
+uint32_t imu_windows_seen = 0;
+uint32_t imu_windows_ms = 0;
+
+BrushState imuActivity(uint32_t now_ms)
+{
+    BrushState state = imuGetState();
+    if (state.windows != imu_windows_seen)
+    {
+        imu_windows_seen = state.windows;
+        imu_windows_ms = now_ms;
+    }
+    else if (now_ms - imu_windows_ms > IMU_STALE_MS)
+    {
+        state.brushing = false;
+    }
+    return state;
+}
 
-int frame_counter = 0;
+// The room's light decides the brightness, up to the configured limit and
+//   what the battery allows
+uint8_t eyeTargetIntensity()
+{
+    if (intensity_override >= 0)
+    {
+        return intensity_override;
+    }
+    uint8_t limit = config.eye_intensity_max;
+    uint8_t battery_limit = POWER_POLICIES[power_level].intensity_max;
+    if (battery_limit < limit)
+    {
+        limit = battery_limit;
+    }
+    uint8_t target = lightTargetIntensity();
+    return target < limit ? target : limit;
+}
 
-const Anim *current_anim_left;
-const Anim *current_anim_right;
-int current_anim_duration = 0;
-int current_anim_num_frames = 0;
-long current_anim_start_time = 0;
+// Each eye is one 8x8 matrix of the chain. This draws the next frame, it
+//   goes out at its deadline (presentFrame()).
+void drawEyes(const uint8_t *left, const uint8_t *right)
+{
+    presenter.back().setDevice(EYE_LEFT, left);
+    presenter.back().setDevice(EYE_RIGHT, right);
+
+    lit_pixels = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        lit_pixels += __builtin_popcount(left[i]) + __builtin_popcount(right[i]);
+    }
+}
 
-const int NUM_PHASES = 12;
+void startClosingEyes(uint8_t status)
+{
+    audioStop();
+    diagTrace(clockMs32(), DIAG_TRACE_END, status, 0);
+    usageRecordSession(status, sessionStats(clockMs32()));
+    supervisorRecord();
+    // Got through a session, or at least to its end, so a freshly updated
+    //   image is good
+    otaConfirmBoot();
+    blePublishState(clockMs32(), COMPANION_COMPLETED + status);
+    playing_eyes_close = true;
+    animPlayerStart(&close_player, &ANIM_CLOSE_EYES, ANIM_ONCE);
+}
 
-bool playing_eyes_close = false;
+// Rows of drawn animations played outside the session
+uint8_t anim_rows_left[8];
+uint8_t anim_rows_right[8];
 
-// All of the animations, in pairs of two, one for each eye
-const Anim *const ANIM_LIST[24] = {
-    &ANIM_OPEN_EYES,
-    &ANIM_OPEN_EYES,
-    &ANIM_WAIT_LEFT,
-    &ANIM_WAIT_RIGHT,
-    &ANIM_COUNTDOWN,
-    &ANIM_COUNTDOWN,
-    &ANIM_UPPER_LEFT_LEFT,
-    &ANIM_UPPER_LEFT_RIGHT,
-    &ANIM_COUNTDOWN,
-    &ANIM_COUNTDOWN,
-    &ANIM_UPPER_RIGHT_LEFT,
-    &ANIM_UPPER_RIGHT_RIGHT,
-    &ANIM_COUNTDOWN,
-    &ANIM_COUNTDOWN,
-    &ANIM_LOWER_LEFT_LEFT,
-    &ANIM_LOWER_LEFT_RIGHT,
-    &ANIM_COUNTDOWN,
-    &ANIM_COUNTDOWN,
-    &ANIM_LOWER_RIGHT_LEFT,
-    &ANIM_LOWER_RIGHT_RIGHT,
-    &ANIM_COUNTDOWN,
-    &ANIM_COUNTDOWN,
-    &ANIM_EXCITED_EYES,
-    &ANIM_EXCITED_EYES};
-
-// The duration that each animation should play for
-//   0: play once
-//   > 0: play for x number of seconds
-//   < 0: take x seconds to play once
-int ANIM_DURATION[12] = {
-    0,
-    10,
-    -10,
-    20,
-    -10,
-    20,
-    -10,
-    20,
-    -10,
-    20,
-    -10,
-    10,
-};
-
-// Number of frames in each animation in the sequence
-int anim_frame_count[12] = {
-    7,
-    8,
-    40,
-    12,
-    40,
-    12,
-    40,
-    13,
-    40,
-    13,
-    40,
-    8,
-};
-
-// Track the status of each animation phase
-//    0 = not complete
-//    1 = complete
-int phase_complete[12] = {
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-};
-
-// Current phase
-int phase = 0;
-// Current animation (2 per phase)
-int anim_idx = 0;
-
-// Did we just start a new phase?
-bool is_new_phase = false;
-
-// Did we just start running?
-bool just_started = false;
-
-int frame_step = 1;
-
-void printDetail(uint8_t type, int value)
+void playNamedAnim(int index)
 {
-    switch (type) {
-      case TimeOut:
-        Serial.println(F("Time Out!"));
-        break;
-      case WrongStack:
-        Serial.println(F("Stack Wrong!"));
-        break;
-      case DFPlayerCardInserted:
-        Serial.println(F("Card Inserted!"));
-        break;
-      case DFPlayerCardRemoved:
-        Serial.println(F("Card Removed!"));
-        break;
-      case DFPlayerCardOnline:
-        Serial.println(F("Card Online!"));
-        break;
-      case DFPlayerUSBInserted:
-        Serial.println("USB Inserted!");
-        break;
-      case DFPlayerUSBRemoved:
-        Serial.println("USB Removed!");
-        break;
-      case DFPlayerPlayFinished:
-        Serial.print(F("Number:"));
-        Serial.print(value);
-        Serial.println(F(" Play Finished!"));
-        break;
-      case DFPlayerError:
-        Serial.print(F("DFPlayerError:"));
-        switch (value) {
-          case Busy:
-            Serial.println(F("Card not found"));
-            break;
-          case Sleeping:
-            Serial.println(F("Sleeping"));
-            break;
-          case SerialWrongStack:
-            Serial.println(F("Get Wrong Stack"));
+    named_anim = index;
+    animPlayerStart(&named_player, NAMED_ANIMS[index].left, ANIM_ONCE);
+}
+
+// The next frame of the console's animation, which plays once
+void drawNamedAnim()
+{
+    const NamedAnim *anim = &NAMED_ANIMS[named_anim];
+    drawEyes(animPlayerRows(&named_player, anim->left, anim_rows_left),
+             animPlayerRows(&named_player, anim->right, anim_rows_right));
+    animPlayerTick(&named_player);
+    if (named_player.done)
+    {
+        named_anim = -1;
+        // Whatever the session is holding goes back up on the next tick
+        sessionRedraw();
+    }
+}
+
+// Whatever the console asked for since the last tick
+void handleRequests()
+{
+    DiagRequest req;
+    while (diagPollRequest(&req))
+    {
+        diagTrace(next_tick, DIAG_TRACE_REQUEST, req.type, req.value);
+        switch (req.type)
+        {
+        case DIAG_REQ_PHASE:
+            sessionJumpToPhase(req.value);
             break;
-          case CheckSumNotMatch:
-            Serial.println(F("Check Sum Not Match"));
+        case DIAG_REQ_ANIM:
+            playNamedAnim(req.value);
+            diagTrace(next_tick, DIAG_TRACE_ANIM, req.value, 0);
             break;
-          case FileIndexOut:
-            Serial.println(F("File Index Out of Bound"));
+        case DIAG_REQ_INTENSITY:
+            intensity_override = req.value;
             break;
-          case FileMismatch:
-            Serial.println(F("Cannot Find File"));
+        case DIAG_REQ_VOLUME:
+            audioSetVolume(req.value);
             break;
-          case Advertise:
-            Serial.println(F("In Advertise"));
+        case DIAG_REQ_CONFIG:
+        {
+            // Into a local first, a read that overlapped a change is thrown away
+            Config changed;
+            if (diagTakeConfig(&changed))
+            {
+                config = changed;
+            }
             break;
-          default:
+        }
+        default:
             break;
         }
-        break;
-      default:
-        break;
     }
 }
 
-// Setup runs once when the microcontroller first turns on
-void setup()
+void publishStatus()
 {
+    BrushState brush = imuGetState();
+    const PhaseTimer *timer = sessionPhaseTimer();
+    DiagStatus status;
+    status.now_ms = next_tick;
+    status.phase = sessionPhase();
+    status.frame = sessionFrameCounter();
+    status.frames = sessionFrameCount();
+    status.intensity = eye_brightness.current;
+    status.intensity_override = intensity_override;
+    status.quadrant = brush.quadrant;
+    status.brushing = brush.brushing;
+    status.paused = timer->paused;
+    status.light = lightLevel();
+    status.cpu_load_permille = imuCpuLoadPermille();
+    status.battery_mv = batteryMv();
+    status.battery_soc = batterySoc();
+    status.battery_level = power_level;
+    status.effective_ms = timer->effective_ms;
+    status.quota_ms = timer->quota_ms;
+    diagPublish(&status);
+}
+
+// Cut back as the battery runs down: dimmer eyes (eyeTargetIntensity()), a
+//   slower clock, less waiting for brushing, and the low battery glyph over
+//   the session. Too low for a session at all, the glyph plays and the
+//   unit goes back to sleep rather than dying halfway with the player on.
+void applyPowerPolicy()
+{
+    power_level = batteryLevel();
+    const PowerPolicy *policy = &POWER_POLICIES[power_level];
+    setCpuFrequencyMhz(policy->cpu_mhz);
+    sessionSetPhaseLimit(policy->phase_max_multiplier);
+    if (policy->glyph)
+    {
+        playNamedAnim(animByName("battery"));
+    }
+    if (!policy->session)
+    {
+        audioStop();
+    }
+    diagTrace(clockMs32(), DIAG_TRACE_BATTERY, power_level, batterySoc());
+}
+
+// Wake when the brush comes out of the holder. The ULP tells a lift from
+//   a knock, if its program won't load fall back to waking on the pin.
+void armWakeup()
+{
+    if (holderUlpArm(config.pressure_threshold))
+    {
+        return;
+    }
     esp_sleep_enable_ext1_wakeup_io(BUTTON_PIN_BITMASK(WAKEUP_GPIO), ESP_EXT1_WAKEUP_ANY_HIGH);
     /*
       If there are no external pull-up/downs, tie wakeup pins to inactive level with internal pull-up/downs via RTC IO
@@ -208,17 +274,57 @@ void setup()
     */
     rtc_gpio_pulldown_en(WAKEUP_GPIO);  // GPIO33 is tie to GND in order to wake up in HIGH
     rtc_gpio_pullup_dis(WAKEUP_GPIO);  
+}
 
-    pinMode(WAKEUP_GPIO, INPUT);
+// At a frame's deadline, from esp_timer's task: take the frame the loop
+//   prepared, send its changed rows and let the loop start on the next
+void presentFrame(void *arg)
+{
+    int64_t due_us = present_due_us;
+    if (presenter.take())
+    {
+        if (presenter.intensity_changed)
+        {
+            display.setIntensity(presenter.intensity);
+        }
+        display.flush(presenter.front());
+    }
+    int64_t late_us = clockUs() - due_us;
+    present_late_us = late_us > 0 ? late_us : 0;
+    if (render_task != NULL)
+    {
+        xTaskNotifyGive(render_task);
+    }
+}
 
-    start_time = millis();
+// Setup runs once when the microcontroller first turns on
+void setup()
+{
+    // The watchdog before anything that can hang or fail, then the
+    //   settings, everything below reads them
+    supervisorBegin();
+    configLoad();
+
+    pinMode(WAKEUP_GPIO, INPUT);
 
-    // Initialize the LED matrices
-    for (int i = 0; i < lc_left.getDeviceCount(); i++)
+    // The battery first, while nothing else is drawing from it, then the
+    //   power policy for its level. Without one it stays at BATTERY_OK.
+    batteryBegin();
+    applyPowerPolicy();
+
+    // Initialize the LED matrices, blank and already at the right brightness
+    //   for the room if there's a light sensor
+    lightBegin();
+    brightnessRampInit(&eye_brightness, eyeTargetIntensity(), clockMs32());
+    display.begin(eye_brightness.current);
+    presenter.setIntensity(eye_brightness.current);
+    esp_timer_create_args_t present_args = {};
+    present_args.callback = presentFrame;
+    present_args.name = "present";
+    render_task = xTaskGetCurrentTaskHandle();
+    if (esp_timer_create(&present_args, &present_timer) != ESP_OK)
     {
-        lc_left.shutdown(i, false);
-        lc_left.setIntensity(i, 0);
-        lc_left.clearDisplay(i);
+        present_timer = NULL;
     }
 
 #ifdef DEBUG 
@@ -231,214 +337,229 @@ void setup()
     Serial.println("Starting");
 #endif
 
-    Serial2.begin(9600, SERIAL_8N1, RXD2, TXD2);
-    if (!music.begin(Serial2, true, true)) {  //Use serial to communicate with mp3.
-      Serial.println(F("Unable to begin:"));
-      Serial.println(F("1.Please recheck the connection!"));
-      Serial.println(F("2.Please insert the SD card!"));
-      while(true){
-        delay(0); // Code to compatible with ESP8266 watch dog.
-      }
+    // The usage log can be exported over serial whatever else is working
+    Serial.begin(115200);
+    if (!usageBegin()) {
+      Serial.println(F("No usage log partition, sessions won't be recorded."));
+    }
+    exportBegin();
+    shellBegin();
+    if (!bleBegin()) {
+      Serial.println(F("Bluetooth didn't start, no companion app."));
+    }
+
+    // Without audio the eyes still run the session, the audio task keeps
+    //   retrying the player in the background. On a flat battery there's no
+    //   session, so no player either.
+    if (!POWER_POLICIES[power_level].session) {
+      Serial.println(F("Battery too low for a session, going back to sleep."));
+    } else if (audioBegin()) {
+      Serial.print(audioName());
+      Serial.println(F(" online."));
+    } else {
+      Serial.print(audioName());
+      Serial.println(F(" didn't start, carrying on without sound. Check the connection and the SD card."));
     }
-    Serial.println(F("DFPlayer Mini online."));
+#ifdef DEBUG_MUSIC
+    audioPrintLatency(Serial);
+#endif
+
+    // The IMU is optional, without it the phases just run for their fixed durations
+    if (imuBegin()) {
+      sessionSetActivitySource(imuActivity);
+    } else {
+      Serial.println(F("No IMU found, brushing detection disabled."));
+    }
+
+    next_tick = clockMs();
+    sessionBegin(next_tick);
+    audioPhaseStarted(0, next_tick);
+    supervisorWatch(HEALTH_TASK_RENDER, RENDER_HEARTBEAT_MS);
 
-    current_anim_duration = ANIM_DURATION[0];
-    current_anim_left = ANIM_LIST[0];
-    current_anim_right = ANIM_LIST[1];
-    current_anim_start_time = millis();
-    current_anim_num_frames = anim_frame_count[0];
+    // Everything is set up, from here on the heap should be left alone
+    heapGuardArm();
 }
 
-void loop()
+// Everything done once per tick: brightness, the session and the eyes
+void renderTick()
 {
-    // if pressure is above threshold don't do anything
-    if (analogRead(WAKEUP_GPIO) > 4000 && playing_eyes_close == false)
+    // Follow the room's light, a step at a time
+    if (brightnessRampStep(&eye_brightness, eyeTargetIntensity(), next_tick))
     {
-        playing_eyes_close = true;
-        current_anim_num_frames = 7;
-        frame_counter = 0;
-        current_anim_left = &ANIM_CLOSE_EYES;
-        current_anim_right = &ANIM_CLOSE_EYES;
-
-        delay(1000);
+        presenter.setIntensity(eye_brightness.current);
+        diagTrace(next_tick, DIAG_TRACE_INTENSITY, 0, eye_brightness.current);
     }
 
-#ifdef DEBUG_MUSIC
-    if (music.available()) {
-      printDetail(music.readType(), music.read()); //Print the detail message from DFPlayer to handle different errors and states.
-    }
+#ifdef DEBUG
+    BrushState brush = imuGetState();
+    Serial.print("Brushing: ");
+    Serial.print(brush.brushing);
+    Serial.print(" ");
+    Serial.print(quadrantName(brush.quadrant));
+    Serial.print(" energy ");
+    Serial.print(brush.energy);
+    Serial.print(" load ");
+    Serial.print(imuCpuLoadPermille());
+    Serial.print(" light ");
+    Serial.print(lightLevel());
+    Serial.print(" intensity ");
+    Serial.println(eye_brightness.current);
 #endif
 
-    delay(250);
-
+    // Let the battery know what the eyes and the player draw, and follow
+    //   its level
+    uint32_t led_ua = brightnessCurrentUa(eye_brightness.current, lit_pixels);
+    batterySetLoad(gaugeLoadMa(getCpuFrequencyMhz(), led_ua, audioReady()));
+    if (batteryLevel() != power_level && !playing_eyes_close)
+    {
+        applyPowerPolicy();
+    }
 
     if (playing_eyes_close)
     {
-      for (int i = 0; i < 8; i++)
-      {
-          lc_left.setRow(0, i, current_anim_left->anim[(frame_counter * 8) + i]);
-          lc_left.setRow(1, i, current_anim_right->anim[(frame_counter * 8) + i]);
-      }
-
-      // Increment frame_counter
-      if (frame_counter < current_anim_num_frames - 1)
-      {
-          frame_counter++;
-      }
-      else
+      // The last frame went out at the tick before this one
+      if (close_player.done)
       {
         delay(1000);
+        usageFlush(1000);
+        // Don't cut off a host pulling the usage log or sending an update
+        while (exportActive() || otaActive())
+        {
+            supervisorBeat(HEALTH_TASK_RENDER);
+            delay(100);
+        }
+        if (otaRestartPending())
+        {
+            ESP.restart();
+        }
+        armWakeup();
         esp_deep_sleep_start();
       }
-    }
 
+      const uint8_t *rows = animPlayerRows(&close_player, &ANIM_CLOSE_EYES, anim_rows_left);
+      drawEyes(rows, rows);
+      animPlayerTick(&close_player);
+      return;
+    }
 
-    // if phase is complete, move to next phase
-    if (phase_complete[phase])
+    // Too low to carry on: show the glyph, then close
+    if (!POWER_POLICIES[power_level].session)
     {
-        phase++;
-        anim_idx += 2;
-
-        if (phase == 3)
+        if (named_anim >= 0)
         {
-            music.volume(10);
-            Serial.println(music.readVolume());
-            music.playFolder(1, 1);
+            drawNamedAnim();
         }
-
-        // If that was the last phase, reset everything
-        if (phase >= NUM_PHASES)
+        else
         {
-            phase = 0;
-            anim_idx = 0;
+            startClosingEyes(USAGE_STOPPED_BATTERY);
+        }
+        return;
+    }
 
-            for (int i = 0; i < NUM_PHASES; i++)
-            {
-                phase_complete[i] = 0;
-            }
+    SessionFrame frame;
+    uint8_t event = sessionTick(next_tick, &frame);
 
-            playing_eyes_close = true;
-            return;
-        }
+    if (event == SESSION_FINISHED)
+    {
+        startClosingEyes(USAGE_COMPLETED);
+        return;
+    }
 
-        is_new_phase = true;
+    blePublishState(next_tick, COMPANION_RUNNING);
+
+    if (event == SESSION_NEW_PHASE)
+    {
+        audioPhaseStarted(sessionPhase(), next_tick);
+        diagTrace(next_tick, DIAG_TRACE_PHASE, sessionPhase(), 0);
+        otaConfirmBoot();
 
 #ifdef DEBUG
-        Serial.println("Starting phase " + String(phase));
+        Serial.print("Starting phase ");
+        Serial.println(sessionPhase());
 #endif
     }
 
-    if (is_new_phase)
+    // Let the audio task send the next phase's cues early
+    int32_t until_next = sessionMsUntilNextPhase(next_tick, config.tick_ms);
+    if (until_next >= 0)
     {
-        is_new_phase = false;
-
-        // Set up variables for this phase
-        current_anim_duration = ANIM_DURATION[phase];
-        current_anim_left = ANIM_LIST[anim_idx];
-        current_anim_right = ANIM_LIST[anim_idx + 1];
-        current_anim_start_time = millis();
-        current_anim_num_frames = anim_frame_count[phase];
+        audioPredictNextPhase(next_tick + until_next);
+    }
 
-        frame_counter = 0;
+    // One the console asked for plays over the session, which carries on
+    //   underneath
+    if (named_anim >= 0)
+    {
+        drawNamedAnim();
+        return;
     }
 
-    if (current_anim_duration == 0)
+    if (frame.left != NULL)
     {
-        // The anim should be played only once.
 #ifdef DEBUG
-        Serial.println("Frame counter: " + String(frame_counter) + " / " + String(current_anim_num_frames));
+        const PhaseTimer *timer = sessionPhaseTimer();
+        Serial.print("Frame counter: ");
+        Serial.print(sessionFrameCounter());
+        Serial.print(" / ");
+        Serial.println(sessionFrameCount());
+        Serial.print("Brushing time: ");
+        Serial.print(timer->effective_ms);
+        Serial.print(" / ");
+        Serial.print(timer->quota_ms);
+        Serial.println(timer->paused ? " (paused)" : "");
 #endif
-        // It's an 8x8 matrix, so loop through 8 rows and set all the 8 columns in that row
-        //   Do this for both eyes (the first parameter of setRow specifies which eye)
-        for (int i = 0; i < 8; i++)
-        {
-            lc_left.setRow(0, i, current_anim_left->anim[(frame_counter * 8) + i]);
-            lc_left.setRow(1, i, current_anim_right->anim[(frame_counter * 8) + i]);
-        }
-
-        // Increment frame_counter
-        if (frame_counter < current_anim_num_frames - 1)
-        {
-            frame_counter++;
-        }
-        else
-        {
-            phase_complete[phase] = 1;
-        }
+        drawEyes(frame.left, frame.right);
     }
-    else if (current_anim_duration > 0)
+}
+
+void loop()
+{
+    supervisorBeat(HEALTH_TASK_RENDER);
+
+    // if pressure is above threshold don't do anything
+    if (analogRead(WAKEUP_GPIO) > config.pressure_threshold && playing_eyes_close == false)
     {
-        // The anim should be looped for a certain duration
+        startClosingEyes(USAGE_STOPPED_SENSOR);
 
-        long current_time = millis();
+        delay(1000);
+    }
 
-        // Have we been running for longer than the duration?
-        if (current_time - current_anim_start_time > current_anim_duration * 1000)
-        {
-            phase_complete[phase] = 1;
-        }
-        else
-        {
-#ifdef DEBUG
-            Serial.println("Frame counter: " + String(frame_counter) + " / " + String(current_anim_num_frames));
+    // The frame before has to be out before the next can be drawn
+    while (!presenter.ready())
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RENDER_HEARTBEAT_MS));
+    }
 
-            // Print a message about how long we have been looping
-            Serial.println("Current time: " + String(current_time - current_anim_start_time) + " / " + String(current_anim_duration * 1000));
-#endif
-            for (int i = 0; i < 8; i++)
-            {
-                lc_left.setRow(0, i, current_anim_left->anim[(frame_counter * 8) + i]);
-                lc_left.setRow(1, i, current_anim_right->anim[(frame_counter * 8) + i]);
-            }
+    // Prepare the next tick's frame, or catch up if we fell behind
+    next_tick += config.tick_ms;
+    int64_t ahead = next_tick - clockMs();
+    if (ahead < 0)
+    {
+        diagTrace(next_tick, DIAG_TRACE_LATE, 0, -ahead > 0x7FFF ? 0x7FFF : -ahead);
+        next_tick = clockMs();
+    }
 
-            // When we reach the end of the animation, reverse the direction that it's iterating
-            //   and play the animation backwards
-            if (frame_counter == current_anim_num_frames - 1)
-            {
-                frame_step = -1;
-            }
-            else if (frame_counter == 0)
-            {
-                frame_step = 1;
-            }
+    int64_t started_us = clockUs();
+    handleRequests();
+    renderTick();
+    uint32_t work_us = clockUs() - started_us;
 
-            frame_counter += frame_step;
-        }
+    // Out at its deadline, whatever the loop is doing by then
+    presenter.publish();
+    present_due_us = next_tick * 1000;
+    int64_t wait_us = present_due_us - clockUs();
+    if (present_timer != NULL)
+    {
+        esp_timer_start_once(present_timer, wait_us > 0 ? wait_us : 0);
     }
     else
     {
-        // The anim should take a certain duration to play once
-
-        long current_time = millis();
-
-        if (current_time - current_anim_start_time > (-current_anim_duration * 1000))
+        if (wait_us > 0)
         {
-            phase_complete[phase] = 1;
-        }
-        else
-        {
-#ifdef DEBUG
-            Serial.println("Frame counter: " + String(frame_counter) + " / " + String(current_anim_num_frames));
-#endif
-            for (int i = 0; i < 8; i++)
-            {
-                lc_left.setRow(0, i, current_anim_left->anim[(frame_counter * 8) + i]);
-                lc_left.setRow(1, i, current_anim_right->anim[(frame_counter * 8) + i]);
-            }
-
-            // Should this actually be commented out?? 
-            // Should probably double check that
-            // delay((-current_anim_duration) * 100 / current_anim_num_frames);
-
-            if (frame_counter < current_anim_num_frames - 1)
-            {
-                frame_counter++;
-            }
-            else
-            {
-                frame_counter = 0;
-            }
+            delay(wait_us / 1000);
         }
+        presentFrame(NULL);
     }
+    diagTickTimes(present_late_us, work_us);
+    publishStatus();
 }
-
@@ -0,0 +1,96 @@
+#include <Arduino.h>
+#include "esp_ota_ops.h"
+#include "partition_region.h"
+#include "ota.h"
+#include "clock.h"
+
+// Give up on a transfer nobody has sent anything for in this long
+#define OTA_IDLE_TIMEOUT_MS 30000
+
+// Writes go straight to esp_ota_write(), which erases each sector as it
+//   gets to it rather than the whole slot up front. That keeps each stall
+//   of the flash cache (and the eyes) to one sector erase.
+class AppSlot : public OtaSlot
+{
+public:
+    bool begin() override
+    {
+        part = esp_ota_get_next_update_partition(NULL);
+        return part != NULL && esp_ota_begin(part, OTA_WITH_SEQUENTIAL_WRITES, &handle) == ESP_OK;
+    }
+
+    bool write(const uint8_t *data, size_t len) override
+    {
+        return esp_ota_write(handle, data, len) == ESP_OK;
+    }
+
+    // esp_ota_end() checks the image's own SHA-256 too
+    bool finish() override
+    {
+        return esp_ota_end(handle) == ESP_OK && esp_ota_set_boot_partition(part) == ESP_OK;
+    }
+
+    void abort() override
+    {
+        esp_ota_abort(handle);
+    }
+
+private:
+    const esp_partition_t *part = NULL;
+    esp_ota_handle_t handle = 0;
+};
+
+static AppSlot ota_slot;
+static PartitionRegion ota_running;
+static OtaUpdate ota_update;
+static volatile uint32_t ota_last_ms = 0;
+
+// The Arduino core would otherwise mark a new image good as soon as it
+//   starts, before we know it works
+extern "C" bool verifyRollbackLater()
+{
+    return true;
+}
+
+bool otaBegin()
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    if (running == NULL || esp_ota_get_next_update_partition(NULL) == NULL)
+    {
+        return false;
+    }
+    ota_running.setPartition(running);
+    otaUpdateInit(&ota_update, &ota_slot, &ota_running);
+    return true;
+}
+
+size_t otaCommand(const uint8_t *data, size_t len, uint8_t *out)
+{
+    if (ota_running.partition() == NULL)
+    {
+        return otaUpdateStatus(&ota_update, out);
+    }
+    ota_last_ms = clockMs32();
+    return otaUpdateCommand(&ota_update, data, len, out);
+}
+
+bool otaActive()
+{
+    return ota_update.state == OTA_RECEIVING && clockMs32() - ota_last_ms < OTA_IDLE_TIMEOUT_MS;
+}
+
+bool otaRestartPending()
+{
+    return ota_update.state == OTA_READY;
+}
+
+void otaConfirmBoot()
+{
+    esp_ota_img_states_t state;
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    if (running != NULL && esp_ota_get_state_partition(running, &state) == ESP_OK &&
+        state == ESP_OTA_IMG_PENDING_VERIFY)
+    {
+        esp_ota_mark_app_valid_cancel_rollback();
+    }
+}
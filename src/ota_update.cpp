@@ -0,0 +1,166 @@
+#include <string.h>
+#include "crc32.h"
+#include "ota_update.h"
+
+static void putLe32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool readSource(uint32_t offset, void *buf, size_t len, void *ctx)
+{
+    return ((OtaUpdate *)ctx)->source->read(offset, buf, len);
+}
+
+static bool writeSlot(const uint8_t *data, size_t len, void *ctx)
+{
+    return ((OtaUpdate *)ctx)->slot->write(data, len);
+}
+
+static void failUpdate(OtaUpdate *update, uint8_t error)
+{
+    if (update->state == OTA_RECEIVING)
+    {
+        update->slot->abort();
+    }
+    update->state = OTA_FAILED;
+    update->error = error;
+}
+
+void otaUpdateInit(OtaUpdate *update, OtaSlot *slot, FlashRegion *source)
+{
+    memset(update, 0, sizeof(*update));
+    update->slot = slot;
+    update->source = source;
+    update->state = OTA_IDLE;
+}
+
+size_t otaUpdateStatus(const OtaUpdate *update, uint8_t *out)
+{
+    out[0] = update->state;
+    out[1] = update->error;
+    putLe32(out + 2, update->received);
+    putLe32(out + 6, update->applier.written);
+    return OTA_STATUS_SIZE;
+}
+
+static void begin(OtaUpdate *update, const uint8_t *data, size_t len)
+{
+    if (len < 9)
+    {
+        update->error = OTA_ERROR_COMMAND;
+        return;
+    }
+    if (update->state == OTA_RECEIVING)
+    {
+        update->slot->abort();
+    }
+
+    update->size = le32(data + 1);
+    update->crc = le32(data + 5);
+    update->received = 0;
+    update->received_crc = 0;
+    update->error = 0;
+    deltaApplierInit(&update->applier, readSource, writeSlot, update);
+
+    if (!update->slot->begin())
+    {
+        update->state = OTA_FAILED;
+        update->error = OTA_ERROR_SLOT;
+        return;
+    }
+    update->state = OTA_RECEIVING;
+}
+
+static void receive(OtaUpdate *update, const uint8_t *data, size_t len)
+{
+    if (update->state != OTA_RECEIVING || len < 5)
+    {
+        return;
+    }
+
+    // Out of order, the status tells the sender where to carry on
+    uint32_t offset = le32(data + 1);
+    const uint8_t *bytes = data + 5;
+    size_t n = len - 5;
+    if (offset != update->received || n > update->size - update->received)
+    {
+        return;
+    }
+
+    update->received += n;
+    update->received_crc = crc32Update(update->received_crc, bytes, n);
+    uint8_t result = deltaApplierPush(&update->applier, bytes, n);
+    if (result != DELTA_MORE && result != DELTA_DONE)
+    {
+        failUpdate(update, result);
+    }
+}
+
+static void end(OtaUpdate *update)
+{
+    if (update->state != OTA_RECEIVING)
+    {
+        return;
+    }
+    if (update->received != update->size)
+    {
+        failUpdate(update, OTA_ERROR_INCOMPLETE);
+    }
+    else if (update->received_crc != update->crc)
+    {
+        failUpdate(update, OTA_ERROR_PATCH_CRC);
+    }
+    else if (update->applier.result != DELTA_DONE)
+    {
+        failUpdate(update, update->applier.result == DELTA_MORE ? OTA_ERROR_INCOMPLETE : update->applier.result);
+    }
+    else if (!update->slot->finish())
+    {
+        update->state = OTA_FAILED;
+        update->error = OTA_ERROR_SLOT;
+    }
+    else
+    {
+        update->state = OTA_READY;
+    }
+}
+
+size_t otaUpdateCommand(OtaUpdate *update, const uint8_t *data, size_t len, uint8_t *out)
+{
+    if (len > 0)
+    {
+        switch (data[0])
+        {
+        case OTA_BEGIN:
+            begin(update, data, len);
+            break;
+        case OTA_DATA:
+            receive(update, data, len);
+            break;
+        case OTA_END:
+            end(update);
+            break;
+        case OTA_ABORT:
+            if (update->state == OTA_RECEIVING)
+            {
+                update->slot->abort();
+            }
+            update->state = OTA_IDLE;
+            update->error = 0;
+            break;
+        default:
+            update->error = OTA_ERROR_COMMAND;
+            break;
+        }
+    }
+    return otaUpdateStatus(update, out);
+}
@@ -0,0 +1,57 @@
+#include <stddef.h>
+#include "phase_timer.h"
+
+void phaseTimerStartFixed(PhaseTimer *pt, uint32_t now_ms, uint32_t duration_ms)
+{
+    pt->start_ms = now_ms;
+    pt->last_ms = now_ms;
+    pt->nominal_ms = duration_ms;
+    pt->quota_ms = duration_ms;
+    pt->max_ms = duration_ms;
+    pt->effective_ms = 0;
+    pt->quadrant = QUADRANT_UNKNOWN;
+    pt->adaptive = false;
+    pt->paused = false;
+}
+
+void phaseTimerStartBrushing(PhaseTimer *pt, uint32_t now_ms, uint32_t nominal_ms, uint8_t quadrant,
+                             uint8_t max_multiplier)
+{
+    phaseTimerStartFixed(pt, now_ms, nominal_ms);
+    pt->quota_ms = nominal_ms / 100 * PHASE_QUOTA_PERCENT;
+    pt->max_ms = nominal_ms * max_multiplier;
+    pt->quadrant = quadrant;
+    pt->adaptive = true;
+}
+
+bool phaseTimerUpdate(PhaseTimer *pt, uint32_t now_ms, const BrushState *activity)
+{
+    // Unsigned subtraction so this keeps working when now_ms wraps
+    uint32_t dt = now_ms - pt->last_ms;
+    pt->last_ms = now_ms;
+
+    if (activity == NULL || !pt->adaptive)
+    {
+        // No sensing, or not a brushing phase: plain countdown at the
+        //   nominal duration
+        pt->effective_ms += dt;
+        pt->paused = false;
+        return now_ms - pt->start_ms > pt->nominal_ms;
+    }
+
+    if (!activity->brushing)
+    {
+        pt->paused = true;
+    }
+    else
+    {
+        pt->paused = false;
+
+        bool right_place = pt->quadrant == QUADRANT_UNKNOWN ||
+                           activity->quadrant == QUADRANT_UNKNOWN ||
+                           activity->quadrant == pt->quadrant;
+        pt->effective_ms += right_place ? dt : dt * PHASE_WRONG_QUADRANT_PERCENT / 100;
+    }
+
+    return pt->effective_ms >= pt->quota_ms || now_ms - pt->start_ms > pt->max_ms;
+}
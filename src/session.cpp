@@ -0,0 +1,336 @@
+#include <stddef.h>
+#include <string.h>
+#include "session.h"
+#include "anims.h"
+#include "config.h"
+#include "script.h"
+
+// Big enough for the routine's frame, see Script::frameNeeded()
+#define SESSION_SCRIPT_BYTES 128
+
+typedef Script<SESSION_SCRIPT_BYTES> SessionScript;
+
+// The phase the routine is waiting on
+typedef struct SessionStep
+{
+    const Anim *left;
+    const Anim *right;
+    int duration;     // from config.phase_seconds
+    uint8_t quadrant; // to brush, QUADRANT_UNKNOWN for a phase that isn't adaptive
+    bool complete;
+} SessionStep;
+
+static SessionScript script;
+static SessionStep step;
+
+// Current phase, NUM_PHASES once the session is over
+static int phase = 0;
+// The routine passes straight over the phases before this one
+static int skip_to = 0;
+// From sessionJumpToPhase(), -1 if not jumping
+static int jump_to = -1;
+// Of the tick that resumed the routine
+static uint32_t resumed_ms = 0;
+
+// Both eyes follow the left one's frames and timing
+static AnimPlayer player;
+// The current frame has been handed out, the next tick only needs to
+//   hand out a frame if it's a different one
+static bool frame_shown = false;
+
+static PhaseTimer phase_timer;
+static ActivitySource activity_source = NULL;
+static uint8_t phase_max_multiplier = PHASE_MAX_MULTIPLIER;
+
+static SessionStats stats;
+
+// Frames of rendered animations, one for each eye
+static uint8_t rendered_left[8];
+static uint8_t rendered_right[8];
+
+static void startPhase(int to, uint8_t quadrant, const Anim *left, const Anim *right, uint32_t now_ms)
+{
+    phase = to;
+    step.left = left;
+    step.right = right;
+    step.duration = config.phase_seconds[phase];
+    step.quadrant = quadrant;
+    step.complete = false;
+    // A phase without a duration plays its animation once, whatever its mode
+    animPlayerStart(&player, left, step.duration == 0 ? ANIM_ONCE : left->mode);
+    frame_shown = false;
+
+    if (step.duration > 0 && quadrant != QUADRANT_UNKNOWN)
+    {
+        phaseTimerStartBrushing(&phase_timer, now_ms, step.duration * 1000UL, quadrant, phase_max_multiplier);
+    }
+    else if (step.duration > 0)
+    {
+        phaseTimerStartFixed(&phase_timer, now_ms, step.duration * 1000UL);
+    }
+    else
+    {
+        // Negative from before the animations carried their own modes
+        phaseTimerStartFixed(&phase_timer, now_ms, -step.duration * 1000UL);
+    }
+}
+
+// Called on the tick after a phase completes, before moving on
+static void recordPhase(uint32_t now_ms)
+{
+    uint32_t ran_ms = now_ms - phase_timer.start_ms;
+    stats.phase_ms[phase] = ran_ms > 0xFFFF ? 0xFFFF : ran_ms;
+    if (step.quadrant != QUADRANT_UNKNOWN)
+    {
+        uint32_t brushed_ms = phase_timer.effective_ms;
+        stats.brushing_ms[step.quadrant] = brushed_ms > 0xFFFF ? 0xFFFF : brushed_ms;
+    }
+    stats.phases_done++;
+}
+
+// The phase the routine asks for next. play() and brush() fill it in
+//   rather than their awaiter holding it, which keeps the routine's frame
+//   from growing a copy for every co_await.
+typedef struct PhaseSpec
+{
+    int phase;
+    uint8_t quadrant;
+    const Anim *left;
+    const Anim *right;
+} PhaseSpec;
+
+static PhaseSpec next_phase;
+
+// What the routine co_awaits: next_phase starts on the tick that reaches
+//   it, and the routine carries on with the tick after it completes
+typedef struct PhaseAwaiter
+{
+    bool await_ready() const { return next_phase.phase < skip_to; }
+
+    void await_suspend(std::coroutine_handle<>) const
+    {
+        startPhase(next_phase.phase, next_phase.quadrant, next_phase.left, next_phase.right, resumed_ms);
+    }
+
+    void await_resume() const
+    {
+        if (next_phase.phase >= skip_to)
+        {
+            recordPhase(resumed_ms);
+        }
+    }
+} PhaseAwaiter;
+
+// A pair of anims for the phase's duration, or played once if it has none
+static PhaseAwaiter play(int phase, const Anim &left, const Anim &right)
+{
+    next_phase = {phase, QUADRANT_UNKNOWN, &left, &right};
+    return {};
+}
+
+// The same, the duration counting only brushing of the quadrant
+static PhaseAwaiter brush(int phase, uint8_t quadrant, const Anim &left, const Anim &right)
+{
+    next_phase = {phase, quadrant, &left, &right};
+    return {};
+}
+
+// The brushing routine, a phase at a time
+static SessionScript routine()
+{
+    co_await play(0, ANIM_OPEN_EYES, ANIM_OPEN_EYES);
+    co_await play(1, ANIM_WAIT_LEFT, ANIM_WAIT_RIGHT);
+    co_await play(2, ANIM_COUNTDOWN, ANIM_COUNTDOWN);
+    co_await brush(SESSION_PHASE_UPPER_LEFT, QUADRANT_UPPER_LEFT, ANIM_UPPER_LEFT_LEFT, ANIM_UPPER_LEFT_RIGHT);
+    co_await play(4, ANIM_COUNTDOWN, ANIM_COUNTDOWN);
+    co_await brush(SESSION_PHASE_UPPER_RIGHT, QUADRANT_UPPER_RIGHT, ANIM_UPPER_RIGHT_LEFT, ANIM_UPPER_RIGHT_RIGHT);
+    co_await play(6, ANIM_COUNTDOWN, ANIM_COUNTDOWN);
+    co_await brush(SESSION_PHASE_LOWER_LEFT, QUADRANT_LOWER_LEFT, ANIM_LOWER_LEFT_LEFT, ANIM_LOWER_LEFT_RIGHT);
+    co_await play(8, ANIM_COUNTDOWN, ANIM_COUNTDOWN);
+    co_await brush(SESSION_PHASE_LOWER_RIGHT, QUADRANT_LOWER_RIGHT, ANIM_LOWER_RIGHT_LEFT, ANIM_LOWER_RIGHT_RIGHT);
+    co_await play(10, ANIM_COUNTDOWN, ANIM_COUNTDOWN);
+    co_await play(11, ANIM_EXCITED_EYES, ANIM_EXCITED_EYES);
+}
+
+// Run the routine from the start of phase `from` up to its first co_await
+static void startRoutine(int from, uint32_t now_ms)
+{
+    // The old frame has to go before the new one can have the buffer
+    script.destroy();
+    skip_to = from;
+    resumed_ms = now_ms;
+    script = routine();
+    script.resume();
+}
+
+void sessionBegin(uint32_t now_ms)
+{
+    jump_to = -1;
+    memset(&stats, 0, sizeof(stats));
+    stats.start_ms = now_ms;
+
+    startRoutine(0, now_ms);
+}
+
+bool sessionJumpToPhase(int to)
+{
+    if (to < 0 || to >= NUM_PHASES || phase >= NUM_PHASES)
+    {
+        return false;
+    }
+
+    // Phases skipped over aren't recorded, the stats only cover what ran
+    jump_to = to;
+    phase = to;
+    step.complete = false;
+    return true;
+}
+
+void sessionSetActivitySource(ActivitySource source)
+{
+    activity_source = source;
+}
+
+void sessionSetPhaseLimit(uint8_t multiplier)
+{
+    phase_max_multiplier = multiplier;
+}
+
+uint8_t sessionTick(uint32_t now_ms, SessionFrame *frame)
+{
+    uint8_t event = SESSION_RUNNING;
+    frame->left = NULL;
+    frame->right = NULL;
+
+    if (jump_to >= 0)
+    {
+        startRoutine(jump_to, now_ms);
+        jump_to = -1;
+        event = SESSION_NEW_PHASE;
+    }
+    else if (script.done())
+    {
+        // Stays finished until sessionBegin() starts another one
+        return SESSION_FINISHED;
+    }
+    else if (step.complete)
+    {
+        // On to the next phase, or the end of the routine
+        resumed_ms = now_ms;
+        if (!script.resume())
+        {
+            phase = NUM_PHASES;
+            stats.duration_ms = now_ms - stats.start_ms;
+            return SESSION_FINISHED;
+        }
+        event = SESSION_NEW_PHASE;
+    }
+
+    if (!frame_shown)
+    {
+        frame->left = animPlayerRows(&player, step.left, rendered_left);
+        frame->right = animPlayerRows(&player, step.right, rendered_right);
+        frame_shown = true;
+    }
+
+    if (step.duration == 0)
+    {
+        // The anim should be played only once
+        frame_shown = !animPlayerTick(&player);
+        step.complete = player.done;
+        return event;
+    }
+
+    BrushState activity;
+    const BrushState *activity_ptr = NULL;
+    if (activity_source != NULL)
+    {
+        activity = activity_source(now_ms);
+        activity_ptr = &activity;
+    }
+
+    // Have we been running for long enough?
+    if (phaseTimerUpdate(&phase_timer, now_ms, activity_ptr))
+    {
+        step.complete = true;
+        frame->left = NULL;
+        frame->right = NULL;
+        return event;
+    }
+
+    // Loop, ping-pong or stop on the last frame, as the anim says
+    frame_shown = !animPlayerTick(&player);
+    return event;
+}
+
+void sessionRedraw()
+{
+    frame_shown = false;
+}
+
+int32_t sessionMsUntilNextPhase(uint32_t now_ms, uint32_t tick_ms)
+{
+    if (phase >= NUM_PHASES)
+    {
+        return -1;
+    }
+
+    // Already done, the next tick moves on
+    if (step.complete)
+    {
+        return tick_ms;
+    }
+
+    if (step.duration == 0)
+    {
+        // The ticks the remaining frames are held for, plus the tick that
+        //   moves on
+        return (animPlayerTicksLeft(&player) + 1) * tick_ms;
+    }
+
+    if (phase_timer.adaptive && activity_source != NULL)
+    {
+        // Only predictable once the quota will be met on the next tick
+        uint32_t remaining = phase_timer.quota_ms - phase_timer.effective_ms;
+        if (phase_timer.paused || remaining > tick_ms)
+        {
+            return -1;
+        }
+        return 2 * tick_ms;
+    }
+
+    // Fixed duration: the phase completes on the first tick after the
+    //   duration has passed, and the next phase starts on the tick after that
+    uint32_t next_start = phase_timer.start_ms + (phase_timer.nominal_ms / tick_ms + 2) * tick_ms;
+    int32_t until = (int32_t)(next_start - now_ms);
+    return until < 0 ? 0 : until;
+}
+
+int sessionPhase()
+{
+    return phase;
+}
+
+int sessionFrameCounter()
+{
+    return player.frame;
+}
+
+int sessionFrameCount()
+{
+    return step.left->num_frames;
+}
+
+const PhaseTimer *sessionPhaseTimer()
+{
+    return &phase_timer;
+}
+
+const SessionStats *sessionStats(uint32_t now_ms)
+{
+    if (phase < NUM_PHASES)
+    {
+        stats.duration_ms = now_ms - stats.start_ms;
+    }
+    return &stats;
+}
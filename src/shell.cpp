@@ -0,0 +1,64 @@
+#include <Arduino.h>
+#include "shell.h"
+#include "config_store.h"
+#include "console.h"
+#include "diag.h"
+#include "export.h"
+#include "static_task.h"
+
+// *** Console task *** //
+// Below the render loop, the audio and the BLE tasks: typing never gets in
+//   the way of anything else
+#define SHELL_TASK_STACK 4096
+#define SHELL_TASK_PRIORITY 0
+#define SHELL_TASK_CORE 0
+#define SHELL_POLL_MS 20
+
+static StaticTask<SHELL_TASK_STACK> shell_task;
+static ConsoleLine line;
+static char reply[CONSOLE_REPLY_MAX];
+
+static void receive(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (!consoleLinePush(&line, data[i]))
+        {
+            continue;
+        }
+        ConsoleOut out;
+        consoleOutInit(&out, reply, sizeof(reply));
+        consoleRun(DIAG_COMMANDS, DIAG_COMMAND_COUNT, line.buf, &out);
+        Serial.write((const uint8_t *)reply, out.len);
+    }
+}
+
+static void shellTask(void *arg)
+{
+    uint8_t buf[64];
+    while (true)
+    {
+        size_t n = 0;
+        while (n < sizeof(buf) && Serial.available() > 0)
+        {
+            buf[n++] = Serial.read();
+        }
+
+        if (n == 0)
+        {
+            vTaskDelay(pdMS_TO_TICKS(SHELL_POLL_MS));
+            continue;
+        }
+
+        // Frames and text can share the port, each side skips the other's
+        exportReceive(buf, n);
+        receive(buf, n);
+    }
+}
+
+bool shellBegin()
+{
+    consoleLineInit(&line);
+    diagSetSaveHook(configSave);
+    return shell_task.start(shellTask, "shell", SHELL_TASK_PRIORITY, SHELL_TASK_CORE);
+}
@@ -0,0 +1,318 @@
+#include "dfplayer_emu.h"
+
+// Typical of the modules on hand: about 20 ms to acknowledge, sound
+//   60-100 ms after the command, over a second to start up
+const DfTiming DF_TIMING_DEFAULT = {1500000, 2000, 18000, 80000, 20000, 30000};
+
+static uint16_t frameSum(const uint8_t *frame)
+{
+    uint16_t sum = 0;
+    for (int i = 1; i < 7; i++)
+    {
+        sum += frame[i];
+    }
+    return -sum;
+}
+
+void dfEncode(uint8_t cmd, bool feedback, uint16_t param, uint8_t *frame)
+{
+    frame[0] = 0x7E;
+    frame[1] = 0xFF;
+    frame[2] = 0x06;
+    frame[3] = cmd;
+    frame[4] = feedback ? 1 : 0;
+    frame[5] = param >> 8;
+    frame[6] = param & 0xFF;
+    uint16_t sum = frameSum(frame);
+    frame[7] = sum >> 8;
+    frame[8] = sum & 0xFF;
+    frame[9] = 0xEF;
+}
+
+void dfParserInit(DfParser *parser)
+{
+    parser->len = 0;
+}
+
+uint8_t dfParse(DfParser *parser, uint8_t byte)
+{
+    if (parser->len == 0 && byte != 0x7E)
+    {
+        return DF_PARSE_NONE;
+    }
+    parser->buf[parser->len++] = byte;
+    if (parser->len < DF_FRAME_SIZE)
+    {
+        return DF_PARSE_NONE;
+    }
+
+    parser->len = 0;
+    const uint8_t *f = parser->buf;
+    if (f[1] != 0xFF || f[2] != 0x06 || f[9] != 0xEF)
+    {
+        return DF_PARSE_BAD_FRAME;
+    }
+    return (uint16_t)(f[7] << 8 | f[8]) == frameSum(f) ? DF_PARSE_FRAME : DF_PARSE_BAD_SUM;
+}
+
+// *** Module *** //
+
+DfPlayerEmu::DfPlayerEmu(SimSerial *from_host, SimSerial *to_host, const DfTiming &timing, uint32_t seed)
+    : from_host(from_host), to_host(to_host), timing(timing), rng(seed)
+{
+    dfParserInit(&parser);
+}
+
+void DfPlayerEmu::addTrack(uint8_t folder, uint8_t track, uint32_t duration_ms)
+{
+    tracks.push_back({folder, track, duration_ms, (uint16_t)(tracks.size() + adverts.size() + 1)});
+}
+
+void DfPlayerEmu::addAdvert(uint16_t track, uint32_t duration_ms)
+{
+    adverts.push_back({0, track, duration_ms, (uint16_t)(tracks.size() + adverts.size() + 1)});
+}
+
+void DfPlayerEmu::removeCard(uint64_t from_us, uint64_t to_us)
+{
+    at(from_us, [this](uint64_t t) {
+        stopAll();
+        card = false;
+        send(DF_CARD_REMOVED, DF_MEDIUM_SD, t);
+    });
+    at(to_us, [this](uint64_t t) {
+        card = true;
+        send(DF_CARD_INSERTED, DF_MEDIUM_SD, t);
+    });
+}
+
+const DfPlayerEmu::Track *DfPlayerEmu::findTrack(uint8_t folder, uint16_t track) const
+{
+    for (const Track &t : tracks)
+    {
+        if (t.folder == folder && t.track == track)
+        {
+            return &t;
+        }
+    }
+    return NULL;
+}
+
+const DfPlayerEmu::Track *DfPlayerEmu::findAdvert(uint16_t track) const
+{
+    for (const Track &t : adverts)
+    {
+        if (t.track == track)
+        {
+            return &t;
+        }
+    }
+    return NULL;
+}
+
+void DfPlayerEmu::at(uint64_t when_us, std::function<void(uint64_t)> fn)
+{
+    timers.emplace(when_us, fn);
+}
+
+void DfPlayerEmu::send(uint8_t cmd, uint16_t param, uint64_t when_us)
+{
+    uint8_t frame[DF_FRAME_SIZE];
+    dfEncode(cmd, false, param, frame);
+    to_host->write(frame, sizeof(frame), when_us);
+}
+
+uint64_t DfPlayerEmu::onsetDelay()
+{
+    std::uniform_int_distribution<uint32_t> jitter(0, 2 * timing.onset_jitter_us);
+    return timing.onset_us - timing.onset_jitter_us + jitter(rng);
+}
+
+void DfPlayerEmu::stopAll()
+{
+    generation++;
+    bg_playing = false;
+    advert_playing = false;
+}
+
+// Plays from onset_us with remaining_us to go, then reports it finished
+void DfPlayerEmu::startBackground(const Track *track, uint64_t remaining_us, uint64_t onset_us)
+{
+    uint32_t gen = ++generation;
+    at(onset_us, [this, track, remaining_us, gen](uint64_t t) {
+        if (gen != generation)
+        {
+            return;
+        }
+        bg_playing = true;
+        advert_playing = false;
+        bg_track = track;
+        bg_since_us = t;
+        bg_remaining_us = remaining_us;
+        at(t + remaining_us, [this, gen](uint64_t end) {
+            if (gen != generation)
+            {
+                return;
+            }
+            bg_playing = false;
+            // The real module sends this twice
+            send(DF_CARD_FINISHED, bg_track->number, end);
+            send(DF_CARD_FINISHED, bg_track->number, end);
+            finished_sent++;
+        });
+    });
+}
+
+uint8_t DfPlayerEmu::execute(uint8_t cmd, uint16_t param, uint64_t now_us, uint64_t *effect_us)
+{
+    *effect_us = now_us;
+    switch (cmd)
+    {
+    case DF_CMD_VOLUME:
+        vol = param > 30 ? 30 : param;
+        return 0;
+    case DF_CMD_RESET:
+        stopAll();
+        online = false;
+        at(now_us + timing.boot_us, [this](uint64_t t) {
+            online = true;
+            send(DF_ONLINE, card ? DF_MEDIUM_SD : 0, t);
+        });
+        return 0;
+    case DF_CMD_STOP:
+        stopAll();
+        return 0;
+    case DF_CMD_QUERY_VOLUME:
+        return 0;
+    case DF_CMD_PLAY_FOLDER:
+    {
+        if (!card)
+        {
+            return DF_ERR_BUSY;
+        }
+        const Track *track = findTrack(param >> 8, param & 0xFF);
+        if (track == NULL)
+        {
+            return DF_ERR_FILE_MISMATCH;
+        }
+        *effect_us = now_us + onsetDelay();
+        startBackground(track, track->duration_ms * 1000ULL, *effect_us);
+        return 0;
+    }
+    case DF_CMD_ADVERTISE:
+    {
+        if (!card)
+        {
+            return DF_ERR_BUSY;
+        }
+        // Adverts only interrupt a track
+        if (!bg_playing)
+        {
+            return DF_ERR_ADVERTISE;
+        }
+        const Track *advert = findAdvert(param);
+        if (advert == NULL)
+        {
+            return DF_ERR_FILE_MISMATCH;
+        }
+        *effect_us = now_us + onsetDelay();
+        uint32_t gen = ++generation;
+        at(*effect_us, [this, advert, gen](uint64_t t) {
+            if (gen != generation)
+            {
+                return;
+            }
+            // The track pauses where it is, unless an earlier advert
+            //   already paused it
+            if (!advert_playing)
+            {
+                uint64_t played = t - bg_since_us;
+                bg_remaining_us = played < bg_remaining_us ? bg_remaining_us - played : 0;
+            }
+            advert_playing = true;
+            uint32_t advert_gen = ++generation;
+            at(t + advert->duration_ms * 1000ULL, [this, advert_gen](uint64_t end) {
+                if (advert_gen != generation)
+                {
+                    return;
+                }
+                advert_playing = false;
+                startBackground(bg_track, bg_remaining_us, end + timing.resume_us);
+            });
+        });
+        return 0;
+    }
+    default:
+        return 0;
+    }
+}
+
+void DfPlayerEmu::received(uint8_t cmd, uint16_t param, bool feedback, uint64_t now_us)
+{
+    DfLogEntry entry = {cmd, param, now_us, 0, 0};
+
+    // Still starting up, nothing answers
+    if (!online)
+    {
+        entry.error = DF_ERR_BUSY;
+        log.push_back(entry);
+        return;
+    }
+
+    uint64_t effect_us;
+    entry.error = execute(cmd, param, now_us, &effect_us);
+    entry.effect_us = entry.error == 0 ? effect_us : 0;
+    log.push_back(entry);
+
+    uint64_t reply_us = now_us + timing.ack_us;
+    if (entry.error != 0)
+    {
+        send(DF_ERROR, entry.error, reply_us);
+        return;
+    }
+    if (feedback)
+    {
+        send(DF_ACK, 0, reply_us);
+    }
+    if (cmd == DF_CMD_QUERY_VOLUME)
+    {
+        send(DF_VOLUME, vol, reply_us);
+    }
+}
+
+void DfPlayerEmu::poll(uint64_t now_us)
+{
+    while (true)
+    {
+        uint64_t next_timer = timers.empty() ? UINT64_MAX : timers.begin()->first;
+        uint64_t next_byte = from_host->nextArrival();
+        if (next_timer <= next_byte && next_timer <= now_us)
+        {
+            auto it = timers.begin();
+            std::function<void(uint64_t)> fn = it->second;
+            timers.erase(it);
+            fn(next_timer);
+            continue;
+        }
+        if (next_byte > now_us)
+        {
+            return;
+        }
+
+        uint8_t result = dfParse(&parser, from_host->read(now_us));
+        if (result == DF_PARSE_BAD_SUM)
+        {
+            log.push_back({dfCommand(&parser), dfParam(&parser), next_byte, 0, DF_ERR_CHECKSUM});
+            send(DF_ERROR, DF_ERR_CHECKSUM, next_byte + timing.ack_us);
+        }
+        else if (result == DF_PARSE_FRAME)
+        {
+            uint8_t cmd = dfCommand(&parser);
+            uint16_t param = dfParam(&parser);
+            bool feedback = dfFeedback(&parser);
+            at(next_byte + timing.decode_us, [this, cmd, param, feedback](uint64_t t) {
+                received(cmd, param, feedback, t);
+            });
+        }
+    }
+}
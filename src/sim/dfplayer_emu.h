@@ -0,0 +1,173 @@
+#ifndef DFPLAYER_EMU_H
+#define DFPLAYER_EMU_H
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <random>
+#include <vector>
+#include "sim_serial.h"
+
+// The DFPlayer Mini's serial protocol, 9600 8N1, both ways:
+//   7E FF 06 <cmd> <feedback> <param hi> <param lo> <sum hi> <sum lo> EF
+//   where the sum is minus the 16 bit sum of the six bytes after 7E. With
+//   feedback set the player acknowledges the command (0x41) or answers
+//   with an error (0x40).
+#define DF_FRAME_SIZE 10
+#define DF_BAUD 9600
+
+enum DfCommand : uint8_t
+{
+    DF_CMD_VOLUME = 0x06,
+    DF_CMD_RESET = 0x0C,
+    DF_CMD_PLAY_FOLDER = 0x0F, // param: folder << 8 | track
+    DF_CMD_ADVERTISE = 0x13,   // param: track in ADVERT
+    DF_CMD_STOP = 0x16,
+    DF_CMD_QUERY_VOLUME = 0x43,
+};
+
+// What the player sends unasked, or in reply
+enum DfNotify : uint8_t
+{
+    DF_CARD_INSERTED = 0x3A,
+    DF_CARD_REMOVED = 0x3B,
+    DF_CARD_FINISHED = 0x3D, // param: global track number
+    DF_ONLINE = 0x3F,        // param: bit per medium, 0x02 the SD card
+    DF_ERROR = 0x40,
+    DF_ACK = 0x41,
+    DF_VOLUME = 0x43,
+};
+
+// DF_ERROR parameters
+enum DfError : uint8_t
+{
+    DF_ERR_BUSY = 1, // no card, or still starting
+    DF_ERR_SLEEPING,
+    DF_ERR_WRONG_STACK,
+    DF_ERR_CHECKSUM,
+    DF_ERR_FILE_INDEX,
+    DF_ERR_FILE_MISMATCH,
+    DF_ERR_ADVERTISE,
+};
+
+#define DF_MEDIUM_SD 0x02
+
+void dfEncode(uint8_t cmd, bool feedback, uint16_t param, uint8_t *frame);
+
+// Byte at a time, for both ends
+typedef struct DfParser
+{
+    uint8_t buf[DF_FRAME_SIZE];
+    uint8_t len;
+} DfParser;
+
+enum DfParse : uint8_t
+{
+    DF_PARSE_NONE = 0, // need more
+    DF_PARSE_FRAME,
+    DF_PARSE_BAD_SUM,   // framed right, sum doesn't match
+    DF_PARSE_BAD_FRAME, // wrong version, length or end byte
+};
+
+void dfParserInit(DfParser *parser);
+uint8_t dfParse(DfParser *parser, uint8_t byte);
+inline uint8_t dfCommand(const DfParser *parser) { return parser->buf[3]; }
+inline bool dfFeedback(const DfParser *parser) { return parser->buf[4] != 0; }
+inline uint16_t dfParam(const DfParser *parser) { return parser->buf[5] << 8 | parser->buf[6]; }
+
+// How long the module takes over things, in us. Onsets are spread
+//   uniformly over onset +- onset_jitter.
+typedef struct DfTiming
+{
+    uint32_t boot_us;     // reset to DF_ONLINE
+    uint32_t decode_us;   // last byte in to the command taking effect
+    uint32_t ack_us;      // taking effect to the ACK going out
+    uint32_t onset_us;    // taking effect to sound, the BUSY pin going low
+    uint32_t onset_jitter_us;
+    uint32_t resume_us;   // end of an advert to the track carrying on
+} DfTiming;
+
+extern const DfTiming DF_TIMING_DEFAULT;
+
+// One command as the module saw it, in arrival order
+typedef struct DfLogEntry
+{
+    uint8_t cmd;
+    uint16_t param;
+    uint64_t received_us;
+    uint64_t effect_us; // sound started or setting changed, 0 if refused
+    uint8_t error;      // DfError it was refused with, 0 if taken
+} DfLogEntry;
+
+// A DFPlayer Mini with an SD card, on the ends of two serial lines. Plays
+//   tracks of a given length, interrupts them with adverts and resumes
+//   them afterwards, reports finished tracks twice like the real module,
+//   and can have its card pulled and put back. Starts out powered up and
+//   idle, as it is when the ESP32 wakes from deep sleep.
+class DfPlayerEmu
+{
+public:
+    DfPlayerEmu(SimSerial *from_host, SimSerial *to_host, const DfTiming &timing, uint32_t seed);
+
+    // Lengths of what's on the card. Folder tracks are numbered globally
+    //   in the order they were added, like the FAT order on a real card.
+    void addTrack(uint8_t folder, uint8_t track, uint32_t duration_ms);
+    void addAdvert(uint16_t track, uint32_t duration_ms);
+
+    // Pull the card at from_us, put it back at to_us
+    void removeCard(uint64_t from_us, uint64_t to_us);
+
+    // Run everything due by now_us: bytes in, timers, bytes out
+    void poll(uint64_t now_us);
+
+    // The BUSY pin, low while playing
+    bool busyPin() const { return !playing(); }
+    bool playing() const { return bg_playing || advert_playing; }
+    uint8_t volume() const { return vol; }
+
+    std::vector<DfLogEntry> log;
+    uint32_t finished_sent = 0;
+
+private:
+    typedef struct Track
+    {
+        uint8_t folder;
+        uint16_t track;
+        uint32_t duration_ms;
+        uint16_t number;
+    } Track;
+
+    const Track *findTrack(uint8_t folder, uint16_t track) const;
+    const Track *findAdvert(uint16_t track) const;
+    void at(uint64_t when_us, std::function<void(uint64_t)> fn);
+    void send(uint8_t cmd, uint16_t param, uint64_t when_us);
+    void received(uint8_t cmd, uint16_t param, bool feedback, uint64_t now_us);
+    uint8_t execute(uint8_t cmd, uint16_t param, uint64_t now_us, uint64_t *effect_us);
+    void stopAll();
+    void startBackground(const Track *track, uint64_t remaining_us, uint64_t onset_us);
+    uint64_t onsetDelay();
+
+    SimSerial *from_host;
+    SimSerial *to_host;
+    DfTiming timing;
+    std::mt19937 rng;
+    DfParser parser;
+    std::multimap<uint64_t, std::function<void(uint64_t)>> timers;
+    std::vector<Track> tracks;
+    std::vector<Track> adverts;
+
+    bool online = true;
+    bool card = true;
+    uint8_t vol = 30;
+
+    // Every start and stop bumps this, so timers for what was playing
+    //   before go quiet
+    uint32_t generation = 0;
+    bool bg_playing = false;
+    const Track *bg_track = NULL;
+    uint64_t bg_since_us = 0;     // playing since, this stretch
+    uint64_t bg_remaining_us = 0; // left as of bg_since_us
+    bool advert_playing = false;
+};
+
+#endif
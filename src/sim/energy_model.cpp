@@ -0,0 +1,153 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "energy_model.h"
+#include "brightness.h"
+
+const char *const ENERGY_PART_NAMES[ENERGY_PARTS] = {"leds", "display", "spi", "cpu", "idle", "player", "radio", "boot"};
+
+// ESP32 and MAX7219 datasheet typicals. The tasks are the IMU at 100 Hz,
+//   the light sensor's bursts at 20 Hz (busy waits between readings) and
+//   the audio task's 5 ms poll.
+const EnergyModel ENERGY_MODEL_DEFAULT = {
+    3.7,   // cell_v
+    8.0,   // max7219_ma
+    10.0,  // spi_row_us
+    2.0,   // spi_ma
+    20.0,  // cpu_ma_base
+    0.125, // cpu_ma_per_mhz
+    12.0,  // idle_ma_base
+    0.06,  // idle_ma_per_mhz
+    0.8,   // light_sleep_ma
+    500.0, // light_wake_us
+    320.0, // task_wakes_hz
+    400.0, // render_us
+    200.0, // tasks_permille
+    20.0,  // player_idle_ma
+    150.0, // speaker_ma
+    8.0,   // radio_ma
+    3000.0 // boot_ms
+};
+
+typedef struct EnergyField
+{
+    const char *name;
+    size_t offset;
+} EnergyField;
+
+#define ENERGY_FIELD(name) {#name, offsetof(EnergyModel, name)}
+
+static const EnergyField ENERGY_FIELDS[] = {
+    ENERGY_FIELD(cell_v), ENERGY_FIELD(max7219_ma), ENERGY_FIELD(spi_row_us), ENERGY_FIELD(spi_ma),
+    ENERGY_FIELD(cpu_ma_base), ENERGY_FIELD(cpu_ma_per_mhz), ENERGY_FIELD(idle_ma_base),
+    ENERGY_FIELD(idle_ma_per_mhz), ENERGY_FIELD(light_sleep_ma), ENERGY_FIELD(light_wake_us),
+    ENERGY_FIELD(task_wakes_hz), ENERGY_FIELD(render_us), ENERGY_FIELD(tasks_permille),
+    ENERGY_FIELD(player_idle_ma), ENERGY_FIELD(speaker_ma), ENERGY_FIELD(radio_ma), ENERGY_FIELD(boot_ms),
+};
+
+bool energyModelLoad(const char *path, EnergyModel *model)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    bool ok = true;
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        char name[64];
+        double value;
+        if (line[0] == '#' || sscanf(line, "%63s %lf", name, &value) != 2)
+        {
+            continue;
+        }
+        bool found = false;
+        for (const EnergyField &field : ENERGY_FIELDS)
+        {
+            if (strcmp(field.name, name) == 0)
+            {
+                *(double *)((char *)model + field.offset) = value;
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            fprintf(stderr, "%s: no model field %s\n", path, name);
+            ok = false;
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+void energyMeterInit(EnergyMeter *meter, const EnergyModel *model)
+{
+    meter->model = *model;
+    for (int p = 0; p < ENERGY_PARTS; p++)
+    {
+        meter->joules[p] = 0;
+    }
+    meter->seconds = 0;
+}
+
+static void add(EnergyMeter *meter, uint8_t part, double ma, double seconds)
+{
+    meter->joules[part] += ma / 1000.0 * meter->model.cell_v * seconds;
+}
+
+void energyBoot(EnergyMeter *meter, uint16_t cpu_mhz)
+{
+    const EnergyModel *m = &meter->model;
+    double seconds = m->boot_ms / 1000.0;
+    add(meter, ENERGY_BOOT, m->cpu_ma_base + m->cpu_ma_per_mhz * cpu_mhz + m->player_idle_ma + m->radio_ma, seconds);
+    meter->seconds += seconds;
+}
+
+void energyTick(EnergyMeter *meter, const EnergyTick *tick)
+{
+    const EnergyModel *m = &meter->model;
+    double seconds = tick->tick_ms / 1000.0;
+    double cpu_ma = m->cpu_ma_base + m->cpu_ma_per_mhz * tick->cpu_mhz;
+    // Work takes longer at a slower clock
+    double slow = 240.0 / tick->cpu_mhz;
+
+    double spi_s = tick->rows_sent * m->spi_row_us / 1e6;
+    double render_s = m->render_us * slow / 1e6;
+    double tasks_s = m->tasks_permille / 1000.0 * slow * seconds;
+    double idle_s = seconds - spi_s - render_s - tasks_s;
+    idle_s = idle_s > 0 ? idle_s : 0;
+
+    add(meter, ENERGY_LEDS, brightnessCurrentUa(tick->intensity, tick->lit_pixels) / 1000.0, seconds);
+    add(meter, ENERGY_DISPLAY, tick->devices * m->max7219_ma, seconds);
+    add(meter, ENERGY_SPI, cpu_ma + m->spi_ma, spi_s);
+    add(meter, ENERGY_CPU, cpu_ma, render_s + tasks_s);
+    if (tick->light_sleep)
+    {
+        // Every tick and every task period wakes it
+        double wakes = (1000.0 / tick->tick_ms + m->task_wakes_hz) * seconds;
+        double wake_s = wakes * m->light_wake_us / 1e6;
+        wake_s = wake_s < idle_s ? wake_s : idle_s;
+        add(meter, ENERGY_IDLE, cpu_ma, wake_s);
+        add(meter, ENERGY_IDLE, m->light_sleep_ma, idle_s - wake_s);
+    }
+    else
+    {
+        add(meter, ENERGY_IDLE, m->idle_ma_base + m->idle_ma_per_mhz * tick->cpu_mhz, idle_s);
+    }
+    double volume = tick->volume / 30.0;
+    add(meter, ENERGY_PLAYER, m->player_idle_ma + (tick->playing ? m->speaker_ma * volume * volume : 0), seconds);
+    add(meter, ENERGY_RADIO, m->radio_ma, seconds);
+    meter->seconds += seconds;
+}
+
+double energyTotal(const EnergyMeter *meter)
+{
+    double total = 0;
+    for (int p = 0; p < ENERGY_PARTS; p++)
+    {
+        total += meter->joules[p];
+    }
+    return total;
+}
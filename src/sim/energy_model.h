@@ -0,0 +1,79 @@
+#ifndef ENERGY_MODEL_H
+#define ENERGY_MODEL_H
+
+#include <stdint.h>
+
+// Where the energy of a wake goes, for judging a change on battery life
+//   before it reaches a unit. Every part runs off the cell through linear
+//   regulators, so each draws its current at the cell's voltage.
+enum EnergyPart : uint8_t
+{
+    ENERGY_LEDS = 0, // lit segments, from brightnessCurrentUa()
+    ENERGY_DISPLAY,  // the MAX7219s themselves
+    ENERGY_SPI,      // the CPU and SPI peripheral while rows go out
+    ENERGY_CPU,      // tasks running: rendering, the IMU, the light sensor
+    ENERGY_IDLE,     // the CPU with nothing to do, busy or light sleeping
+    ENERGY_PLAYER,   // the DFPlayer and its speaker
+    ENERGY_RADIO,    // BLE advertising and connection events
+    ENERGY_BOOT,     // from the wake to the first frame
+    ENERGY_PARTS,
+};
+
+extern const char *const ENERGY_PART_NAMES[ENERGY_PARTS];
+
+// Per-part figures, typical datasheet values unless calibrated against a
+//   unit on a bench supply (energyModelLoad())
+typedef struct EnergyModel
+{
+    double cell_v;
+    double max7219_ma;        // each, segments off
+    double spi_row_us;        // a row to every device: transaction and bytes
+    double spi_ma;            // on top of the CPU while it does
+    double cpu_ma_base;       // running, at 0 MHz ..
+    double cpu_ma_per_mhz;    // .. plus this per MHz
+    double idle_ma_base;      // waiting in delay(), clocks running, at 0 MHz ..
+    double idle_ma_per_mhz;   // .. plus this per MHz
+    double light_sleep_ma;    // automatic light sleep between ticks
+    double light_wake_us;     // to come out of it, at the running current
+    double task_wakes_hz;     // the tasks' periods, each ends a light sleep
+    double render_us;         // a tick's work in the render loop at 240 MHz
+    double tasks_permille;    // IMU, light and audio tasks, busy at 240 MHz
+    double player_idle_ma;
+    double speaker_ma;        // at full volume, averaged over a track
+    double radio_ma;          // averaged
+    double boot_ms;
+} EnergyModel;
+
+extern const EnergyModel ENERGY_MODEL_DEFAULT;
+
+// "name value" lines, e.g. "speaker_ma 120", over what's in model already.
+//   false if the file can't be read or has a name that isn't a field.
+bool energyModelLoad(const char *path, EnergyModel *model);
+
+typedef struct EnergyMeter
+{
+    EnergyModel model;
+    double joules[ENERGY_PARTS];
+    double seconds;
+} EnergyMeter;
+
+// What the unit is doing over one display tick
+typedef struct EnergyTick
+{
+    uint32_t tick_ms;
+    uint8_t intensity;
+    uint16_t lit_pixels;
+    uint8_t rows_sent;  // rows that changed, each goes to every device
+    uint8_t devices;
+    bool playing;
+    uint8_t volume;     // 0 .. 30
+    uint16_t cpu_mhz;
+    bool light_sleep;   // idle in automatic light sleep rather than delay()
+} EnergyTick;
+
+void energyMeterInit(EnergyMeter *meter, const EnergyModel *model);
+void energyBoot(EnergyMeter *meter, uint16_t cpu_mhz);
+void energyTick(EnergyMeter *meter, const EnergyTick *tick);
+double energyTotal(const EnergyMeter *meter);
+
+#endif
@@ -0,0 +1,35 @@
+#include <stdio.h>
+#include "imu_trace.h"
+
+bool loadImuTrace(const char *path, std::vector<TraceSample> &out)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        if (line[0] == '#')
+        {
+            continue;
+        }
+
+        unsigned long t;
+        int ax, ay, az, gx, gy, gz;
+        if (sscanf(line, "%lu,%d,%d,%d,%d,%d,%d", &t, &ax, &ay, &az, &gx, &gy, &gz) != 7)
+        {
+            continue;
+        }
+
+        TraceSample ts;
+        ts.t_ms = (uint32_t)t;
+        ts.sample = {(int16_t)ax, (int16_t)ay, (int16_t)az, (int16_t)gx, (int16_t)gy, (int16_t)gz};
+        out.push_back(ts);
+    }
+
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,20 @@
+#ifndef IMU_TRACE_H
+#define IMU_TRACE_H
+
+#include <stdint.h>
+#include <vector>
+#include "brush_motion.h"
+
+// One line of a recorded IMU trace, as printed by the firmware with
+//   DEBUG_IMU enabled: t_ms,ax,ay,az,gx,gy,gz
+typedef struct TraceSample
+{
+    uint32_t t_ms;
+    ImuSample sample;
+} TraceSample;
+
+// Load a CSV trace. Blank lines, lines starting with '#' and anything that
+//   doesn't parse (like a header row) are skipped.
+bool loadImuTrace(const char *path, std::vector<TraceSample> &out);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SIM_H
+#define SIM_H
+
+// Native simulator for the hardware-independent parts of the firmware.
+//   Each subcommand replays recorded data or a virtual session through the
+//   same code that runs on the ESP32.
+
+int simImu(int argc, char **argv);
+int simSession(int argc, char **argv);
+int simAudio(int argc, char **argv);
+int simWav(int argc, char **argv);
+int simText(int argc, char **argv);
+int simBrightness(int argc, char **argv);
+int simUsageLog(int argc, char **argv);
+int simExport(int argc, char **argv);
+int simBle(int argc, char **argv);
+int simOta(int argc, char **argv);
+int simConfig(int argc, char **argv);
+int simConsole(int argc, char **argv);
+int simHealth(int argc, char **argv);
+int simDfplayer(int argc, char **argv);
+int simHolder(int argc, char **argv);
+int simBattery(int argc, char **argv);
+int simEnergy(int argc, char **argv);
+int simPresent(int argc, char **argv);
+int simUptime(int argc, char **argv);
+int simHeap(int argc, char **argv);
+
+#endif
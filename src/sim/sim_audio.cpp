@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "session.h"
+#include "audio_cues.h"
+#include "latency_model.h"
+
+#define SIM_TICK_MS 250
+// How often the audio task polls, same as AUDIO_POLL_MS on the device
+#define SIM_AUDIO_POLL_MS 5
+
+// Player model: every command takes latency +- jitter ms to be heard
+static uint32_t sim_latency_ms = 60;
+static uint32_t sim_jitter_ms = 15;
+
+static uint32_t sim_now = 0;
+static uint32_t sim_cues = 0;
+static int32_t sim_worst_error = 0;
+
+// With "auto" lead, every cue's observed latency feeds the model and the
+//   lead follows it, like the onset measurements on the device
+static bool sim_auto_lead = false;
+static LatencyModel sim_latency;
+
+static uint32_t commandLatency()
+{
+    if (sim_jitter_ms == 0)
+    {
+        return sim_latency_ms;
+    }
+    return sim_latency_ms - sim_jitter_ms + (uint32_t)(rand() % (2 * sim_jitter_ms + 1));
+}
+
+// Stands in for the DFPlayer, the timing is checked in the trace hook
+class SimSink : public AudioSink
+{
+public:
+    void playFolder(uint8_t folder, uint8_t track) override {}
+    void advertise(uint16_t track) override {}
+    void volume(uint8_t level) override {}
+    void stop() override {}
+};
+
+static const char *cueName(const AudioCue *cue)
+{
+    if (cue == NULL)
+    {
+        return "next-track";
+    }
+    switch (cue->kind)
+    {
+    case CUE_VOLUME:
+        return "volume";
+    case CUE_BACKGROUND:
+        return "background";
+    case CUE_VOICE:
+        return "voice";
+    default:
+        return "stop";
+    }
+}
+
+static void traceCue(const AudioCue *cue, uint32_t deadline_ms, uint32_t sent_ms)
+{
+    uint32_t heard_ms = sent_ms + commandLatency();
+    int32_t error = (int32_t)(heard_ms - deadline_ms);
+    printf("%s,%d,%u,%u,%u,%d\n", cueName(cue), cue == NULL ? -1 : cue->phase, deadline_ms, sent_ms, heard_ms, error);
+
+    if (sim_auto_lead)
+    {
+        latencyStatsAdd(&sim_latency.onset, heard_ms - sent_ms);
+        audioCuesSetLead(latencyModelLeadMs(&sim_latency, AUDIO_DEFAULT_LEAD_MS));
+    }
+
+    sim_cues++;
+    if (abs(error) > abs(sim_worst_error))
+    {
+        sim_worst_error = error;
+    }
+}
+
+// sim audio [latency_ms] [jitter_ms] [lead_ms | auto]
+//   Run a session with the cue scheduler against a player with the given
+//   command latency, and report how far each cue lands from its animation.
+//   "auto" learns the lead from the observed latencies instead.
+int simAudio(int argc, char **argv)
+{
+    uint32_t lead = AUDIO_DEFAULT_LEAD_MS;
+    if (argc >= 1)
+    {
+        sim_latency_ms = atoi(argv[0]);
+    }
+    if (argc >= 2)
+    {
+        sim_jitter_ms = atoi(argv[1]);
+    }
+    if (argc >= 3 && strcmp(argv[2], "auto") == 0)
+    {
+        sim_auto_lead = true;
+        latencyModelInit(&sim_latency);
+    }
+    else if (argc >= 3)
+    {
+        lead = atoi(argv[2]);
+    }
+    if (sim_jitter_ms > sim_latency_ms)
+    {
+        sim_jitter_ms = sim_latency_ms;
+    }
+
+    SimSink sink;
+    audioCuesBegin(&sink, lead);
+    audioCuesSetTraceHook(traceCue);
+
+    printf("cue,phase,deadline_ms,sent_ms,heard_ms,error_ms\n");
+
+    sim_now = 0;
+    sessionBegin(sim_now);
+    audioCuesPhaseStarted(0, sim_now);
+
+    uint32_t next_tick = SIM_TICK_MS;
+    const uint32_t limit = 60UL * 60UL * 1000UL;
+    for (; sim_now < limit; sim_now += SIM_AUDIO_POLL_MS)
+    {
+        if (sim_now == next_tick)
+        {
+            next_tick += SIM_TICK_MS;
+
+            SessionFrame frame;
+            uint8_t event = sessionTick(sim_now, &frame);
+            if (event == SESSION_FINISHED)
+            {
+                break;
+            }
+            if (event == SESSION_NEW_PHASE)
+            {
+                audioCuesPhaseStarted(sessionPhase(), sim_now);
+            }
+
+            int32_t until_next = sessionMsUntilNextPhase(sim_now, SIM_TICK_MS);
+            if (until_next >= 0)
+            {
+                audioCuesPredictNextPhase(sim_now + until_next);
+            }
+        }
+
+        audioCuesPoll(sim_now);
+    }
+
+    fprintf(stderr, "%u cues, worst error %d ms (latency %u +- %u ms, lead %u ms)\n",
+            sim_cues, sim_worst_error, sim_latency_ms, sim_jitter_ms, audioCuesLead());
+    return 0;
+}
@@ -0,0 +1,335 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "sim.h"
+#include "brightness.h"
+#include "fuel_gauge.h"
+
+// Same as the device, see battery.cpp and main.cpp
+#define SIM_BATTERY_SAMPLE_MS 1000
+#define SIM_BATTERY_TICK_MS 250
+
+// A recorded trace is awake wherever it draws more than this
+#define SIM_BATTERY_AWAKE_MA 5
+
+// The made up cell: a little off the gauge's curve and resistance, with
+//   some polarisation that takes a while to settle after a load, and
+//   noise on the readings
+#define SIM_CELL_MAH 800
+#define SIM_CELL_MOHM 180
+#define SIM_CELL_POLAR_MOHM 40
+#define SIM_CELL_POLAR_S 30.0
+#define SIM_CELL_NOISE_MV 8
+// Below this under load the regulator drops out and the unit browns out
+#define SIM_CELL_BROWNOUT_MV 3350
+
+// The made up unit: a session a day-ish, the room's light asks for this
+//   intensity, the device's load estimate is this far under the real draw
+#define SIM_SESSION_MS 120000
+#define SIM_BOOT_MS 3000
+#define SIM_GLYPH_MS 2000
+#define SIM_SLEEP_MS (8 * 3600 * 1000UL)
+#define SIM_SLEEP_UA 30
+#define SIM_ROOM_INTENSITY 10
+#define SIM_LIT_PIXELS 40
+#define SIM_LOAD_ERROR_PERCENT 10
+
+// The gauge against the truth, and what the policy did
+typedef struct GaugeCheck
+{
+    double error_sum;
+    uint32_t samples;
+    int max_error;
+    uint32_t rises; // level went back up within a wake
+    int reached[BATTERY_LEVELS]; // true charge when each level was first reached, -1 if never
+} GaugeCheck;
+
+static void checkInit(GaugeCheck *check)
+{
+    check->error_sum = 0;
+    check->samples = 0;
+    check->max_error = 0;
+    check->rises = 0;
+    for (int l = 0; l < BATTERY_LEVELS; l++)
+    {
+        check->reached[l] = -1;
+    }
+}
+
+static void checkSample(GaugeCheck *check, const FuelGauge *gauge, uint8_t old_level, double true_soc)
+{
+    int error = abs((int)gauge->soc - (int)lround(true_soc));
+    check->error_sum += error;
+    check->samples++;
+    check->max_error = error > check->max_error ? error : check->max_error;
+    check->rises += gauge->level < old_level;
+    if (check->reached[gauge->level] < 0)
+    {
+        check->reached[gauge->level] = (int)lround(true_soc);
+    }
+}
+
+static void printCheck(const GaugeCheck *check)
+{
+    printf("gauge error mean %.1f%%, max %d%%", check->samples > 0 ? check->error_sum / check->samples : 0.0,
+           check->max_error);
+    static const char *const NAMES[BATTERY_LEVELS] = {"ok", "save", "low", "critical"};
+    for (int l = BATTERY_SAVE; l < BATTERY_LEVELS; l++)
+    {
+        if (check->reached[l] >= 0)
+        {
+            printf(", %s at %d%%", NAMES[l], check->reached[l]);
+        }
+    }
+    printf("\n");
+}
+
+// *** Recorded discharge *** //
+
+typedef struct DischargeSample
+{
+    uint32_t t_ms;
+    uint16_t mv;
+    uint16_t ma;
+} DischargeSample;
+
+static bool loadDischarge(const char *path, std::vector<DischargeSample> &out)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        unsigned long t;
+        unsigned mv, ma;
+        if (sscanf(line, "%lu,%u,%u", &t, &mv, &ma) == 3)
+        {
+            out.push_back({(uint32_t)t, (uint16_t)mv, (uint16_t)ma});
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// The trace runs from full to flat, so the charge at each point is what's
+//   still to be drawn out of it. The gauge starts afresh on each wake, as
+//   on the device, and takes a reading a second while awake.
+static bool replayDischarge(const std::vector<DischargeSample> &trace)
+{
+    std::vector<double> left_mas(trace.size() + 1, 0.0);
+    for (size_t i = trace.size(); i-- > 1;)
+    {
+        left_mas[i - 1] = left_mas[i] + trace[i - 1].ma * (trace[i].t_ms - trace[i - 1].t_ms) / 1000.0;
+    }
+    double total_mas = left_mas[0];
+    if (trace.size() < 2 || total_mas <= 0)
+    {
+        fprintf(stderr, "no discharge in the trace\n");
+        return false;
+    }
+    printf("%zu readings over %.1f h, %.0f mAh\n", trace.size(), trace.back().t_ms / 3600000.0, total_mas / 3600);
+
+    GaugeCheck check;
+    checkInit(&check);
+    FuelGauge gauge;
+    bool awake = false;
+    uint32_t next_ms = 0;
+    uint32_t wakes = 0;
+    for (size_t i = 0; i < trace.size(); i++)
+    {
+        const DischargeSample &s = trace[i];
+        if (s.ma <= SIM_BATTERY_AWAKE_MA)
+        {
+            awake = false;
+            continue;
+        }
+        if (!awake)
+        {
+            awake = true;
+            wakes++;
+            fuelGaugeInit(&gauge);
+            next_ms = s.t_ms;
+        }
+        if (s.t_ms >= next_ms)
+        {
+            uint8_t old_level = gauge.level;
+            fuelGaugePush(&gauge, s.mv, s.ma);
+            checkSample(&check, &gauge, old_level, 100.0 * left_mas[i] / total_mas);
+            next_ms += SIM_BATTERY_SAMPLE_MS;
+        }
+    }
+    printf("%u wakes, ", wakes);
+    printCheck(&check);
+    return check.max_error <= 10 && check.error_sum <= 5.0 * check.samples && check.rises == 0;
+}
+
+// *** Made up discharge *** //
+
+typedef struct SimCell
+{
+    double used_mas;
+    double polar_mv;
+} SimCell;
+
+static double cellSoc(const SimCell *cell)
+{
+    double soc = 100.0 * (1.0 - cell->used_mas / (SIM_CELL_MAH * 3600.0));
+    return soc < 0 ? 0 : soc;
+}
+
+static double cellOcv(const SimCell *cell)
+{
+    double soc = cellSoc(cell);
+    int i = soc >= 100 ? GAUGE_CURVE_POINTS - 2 : (int)(soc / 10);
+    double frac = (soc - i * 10) / 10.0;
+    double ocv = GAUGE_OCV_MV[i] + frac * (GAUGE_OCV_MV[i + 1] - GAUGE_OCV_MV[i]);
+    return ocv + 8.0 * sin(soc / 7.0);
+}
+
+// Draw ma for ms, and return what the cell reads at the end of it
+static double cellDraw(SimCell *cell, double ma, uint32_t ms)
+{
+    cell->used_mas += ma * ms / 1000.0;
+    double settle = 1.0 - exp(-(ms / 1000.0) / SIM_CELL_POLAR_S);
+    cell->polar_mv += (ma * SIM_CELL_POLAR_MOHM / 1000.0 - cell->polar_mv) * settle;
+    return cellOcv(cell) - ma * SIM_CELL_MOHM / 1000.0 - cell->polar_mv;
+}
+
+typedef struct RunResult
+{
+    uint32_t sessions; // started
+    uint32_t refused;  // too low to start, glyph only
+    uint32_t stopped;  // stopped by the gauge partway
+    uint32_t cut_off;  // browned out partway
+    double minutes;    // of sessions in all
+} RunResult;
+
+// Sessions one after another, hours apart, until the cell can't run the
+//   unit any more. With the policy the gauge dims the eyes, slows the CPU
+//   and refuses sessions on a flat cell; without, it runs flat out.
+static RunResult runDischarge(bool policy, GaugeCheck *check)
+{
+    RunResult result = {0, 0, 0, 0, 0};
+    SimCell cell = {0, 0};
+    srand(1);
+
+    while (cellSoc(&cell) > 0)
+    {
+        FuelGauge gauge;
+        fuelGaugeInit(&gauge);
+        uint8_t level = BATTERY_OK;
+        bool audio = true;
+        bool dead = false;
+        bool stopping = false;
+        uint32_t end_ms = SIM_BOOT_MS + SIM_SESSION_MS;
+        uint32_t sample_ms = 0;
+        uint32_t now = 0;
+
+        for (; now < end_ms; now += SIM_BATTERY_TICK_MS)
+        {
+            const PowerPolicy *p = &POWER_POLICIES[policy ? level : BATTERY_OK];
+            uint8_t intensity = SIM_ROOM_INTENSITY < p->intensity_max ? SIM_ROOM_INTENSITY : p->intensity_max;
+            uint32_t led_ua = now < SIM_BOOT_MS ? 0 : brightnessCurrentUa(intensity, SIM_LIT_PIXELS);
+            uint16_t estimate = gaugeLoadMa(p->cpu_mhz, led_ua, audio);
+            double ma = estimate * (100 + SIM_LOAD_ERROR_PERCENT) / 100.0;
+            double mv = cellDraw(&cell, ma, SIM_BATTERY_TICK_MS);
+            if (mv < SIM_CELL_BROWNOUT_MV)
+            {
+                dead = true;
+                break;
+            }
+
+            if (now >= sample_ms)
+            {
+                uint8_t old_level = gauge.level;
+                double reading = mv + (rand() % (2 * SIM_CELL_NOISE_MV + 1) - SIM_CELL_NOISE_MV);
+                fuelGaugePush(&gauge, (uint16_t)reading, estimate);
+                checkSample(check, &gauge, old_level, cellSoc(&cell));
+                sample_ms += SIM_BATTERY_SAMPLE_MS;
+                level = gauge.level;
+            }
+
+            // Too low: the glyph, then back to sleep
+            if (policy && !POWER_POLICIES[level].session && !stopping)
+            {
+                stopping = true;
+                audio = false;
+                end_ms = now + SIM_GLYPH_MS;
+            }
+        }
+
+        if (now <= SIM_BOOT_MS && stopping)
+        {
+            result.refused++;
+        }
+        else
+        {
+            result.sessions++;
+            result.stopped += stopping;
+        }
+        result.minutes += now / 60000.0;
+        if (dead)
+        {
+            result.cut_off++;
+            break;
+        }
+        if (stopping && now <= SIM_BOOT_MS && result.refused >= 3)
+        {
+            break;
+        }
+        cellDraw(&cell, SIM_SLEEP_UA / 1000.0, SIM_SLEEP_MS);
+    }
+    return result;
+}
+
+static void printRun(const char *name, const RunResult *r)
+{
+    printf("%s: %u sessions, %.0f min, %u stopped by the gauge, %u refused, %u cut off\n", name, r->sessions,
+           r->minutes, r->stopped, r->refused, r->cut_off);
+}
+
+// sim battery [discharge.csv]
+//   Check the fuel gauge against a recorded discharge (ms,mV,mA from full
+//   to flat, the unit sleeping where it draws next to nothing): how far its
+//   charge is from what's really left, and where each level is reached.
+//   Without a trace, run a made up cell down session by session with and
+//   without the power policy; with it no session may be cut off.
+int simBattery(int argc, char **argv)
+{
+    if (argc >= 1)
+    {
+        std::vector<DischargeSample> trace;
+        if (!loadDischarge(argv[0], trace))
+        {
+            fprintf(stderr, "can't read %s\n", argv[0]);
+            return 1;
+        }
+        bool ok = replayDischarge(trace);
+        printf("%s\n", ok ? "ok" : "FAILED");
+        return ok ? 0 : 1;
+    }
+
+    GaugeCheck with_check, without_check;
+    checkInit(&with_check);
+    checkInit(&without_check);
+    RunResult with = runDischarge(true, &with_check);
+    RunResult without = runDischarge(false, &without_check);
+    printRun("policy", &with);
+    printCheck(&with_check);
+    printRun("no policy", &without);
+
+    // The gauge tracks the cell, each level comes in order and near its
+    //   threshold, and the policy leaves no session to die halfway
+    bool ok = with_check.max_error <= 10 && with_check.error_sum <= 5.0 * with_check.samples && with_check.rises == 0;
+    ok &= with_check.reached[BATTERY_SAVE] > with_check.reached[BATTERY_LOW];
+    ok &= with_check.reached[BATTERY_LOW] > with_check.reached[BATTERY_CRITICAL];
+    ok &= with_check.reached[BATTERY_CRITICAL] >= 0 && with_check.reached[BATTERY_CRITICAL] <= GAUGE_CRITICAL_PERCENT + 5;
+    ok &= with.cut_off == 0 && with.refused > 0 && without.cut_off == 1;
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#include "sim.h"
+#include "sim_flash.h"
+#include "companion.h"
+#include "session.h"
+
+// Same shape as the usagelog partition
+#define SIM_BLE_SECTORS 32
+#define SIM_BLE_SECTOR_SIZE 4096
+
+// Same as the device, see ble.h
+#define SIM_BLE_TICK_MS 250
+#define SIM_BLE_PUMP_MS 50
+#define SIM_BLE_FAST_INTERVAL_MS 30
+#define SIM_BLE_SLOW_INTERVAL_MS 500
+
+// A phone's controller takes a handful of packets per connection event,
+//   and the stack only buffers so many notifications
+#define SIM_BLE_PACKETS_PER_EVENT 4
+#define SIM_BLE_TX_BUFFERS 8
+
+// When the phone asks for the history
+#define SIM_BLE_HISTORY_AT_MS 5000
+
+typedef struct SimPacket
+{
+    uint8_t characteristic;
+    std::vector<uint8_t> data;
+} SimPacket;
+
+// Notifications queue up like they do in the stack's buffers and go out a
+//   few at a time on each connection event
+class MockLink : public CompanionLink
+{
+public:
+    explicit MockLink(uint16_t mtu) : mtu(mtu) {}
+
+    uint16_t payloadSize() override { return mtu - 3; }
+
+    bool notify(uint8_t characteristic, const uint8_t *data, size_t len) override
+    {
+        if (queue.size() >= SIM_BLE_TX_BUFFERS || len > payloadSize())
+        {
+            busy++;
+            return false;
+        }
+        queue.push_back({characteristic, std::vector<uint8_t>(data, data + len)});
+        return true;
+    }
+
+    void setFast(bool fast) override
+    {
+        this->fast = fast;
+        param_updates++;
+    }
+
+    uint32_t interval() const { return fast ? SIM_BLE_FAST_INTERVAL_MS : SIM_BLE_SLOW_INTERVAL_MS; }
+
+    uint16_t mtu;
+    bool fast = false;
+    std::deque<SimPacket> queue;
+    uint32_t busy = 0;
+    uint32_t param_updates = 0;
+};
+
+// The phone's side, decoding with the same code
+typedef struct Phone
+{
+    CompanionState state;
+    uint32_t states;
+    uint32_t entries;
+    uint32_t next_seq;
+    bool history_done;
+    uint32_t history_done_ms;
+    bool ok;
+} Phone;
+
+static void phoneReceive(Phone *phone, const SimPacket &packet, uint32_t now_ms)
+{
+    if (packet.characteristic == COMPANION_STATE)
+    {
+        phone->ok &= companionDecodeState(packet.data.data(), packet.data.size(), &phone->state);
+        phone->states++;
+        return;
+    }
+
+    uint8_t count = packet.data[0];
+    if (packet.data.size() != 1 + (size_t)count * COMPANION_ENTRY_SIZE)
+    {
+        printf("  history notification of %zu bytes for %u entries\n", packet.data.size(), count);
+        phone->ok = false;
+        return;
+    }
+    if (count == 0)
+    {
+        phone->history_done = true;
+        phone->history_done_ms = now_ms;
+        return;
+    }
+    for (uint8_t i = 0; i < count; i++)
+    {
+        CompanionEntry entry;
+        companionDecodeEntry(&packet.data[1 + i * COMPANION_ENTRY_SIZE], COMPANION_ENTRY_SIZE, &entry);
+        if (entry.seq != phone->next_seq || entry.duration_ds != (entry.seq * 7) % 0xFFFF)
+        {
+            printf("  expected entry %u, got %u (%u ds)\n", phone->next_seq, entry.seq, entry.duration_ds);
+            phone->ok = false;
+        }
+        phone->next_seq = entry.seq + 1;
+        phone->entries++;
+    }
+}
+
+static UsageLog sim_log;
+
+static uint32_t simScan(uint32_t from_seq, UsageLogVisitor visit, void *ctx)
+{
+    return usageLogScan(&sim_log, from_seq, visit, ctx);
+}
+
+// sim ble [records] [mtu]
+//   Run a session with a phone connected over a mock BLE link. The phone
+//   asks for the whole usage history a few seconds in, and follows the
+//   session's state. Checks every entry arrives once, in order, and that
+//   the final state says the session completed. Reports how many
+//   notifications and connection events it took.
+int simBle(int argc, char **argv)
+{
+    uint32_t total = argc >= 1 ? strtoul(argv[0], NULL, 10) : 1500;
+    uint16_t mtu = argc >= 2 ? atoi(argv[1]) : 247;
+    if (mtu < 23)
+    {
+        fprintf(stderr, "the ATT MTU is at least 23\n");
+        return 2;
+    }
+
+    SimFlash flash(SIM_BLE_SECTORS, SIM_BLE_SECTOR_SIZE);
+    usageLogBegin(&sim_log, &flash);
+    for (uint32_t i = 0; i < total; i++)
+    {
+        UsageRecord record;
+        memset(&record, 0, sizeof(record));
+        record.type = USAGE_RECORD_SESSION;
+        record.session.duration_ms = (usageLogNextSeq(&sim_log) * 7 % 0xFFFF) * 100;
+        usageLogAppend(&sim_log, &record);
+    }
+
+    MockLink link(mtu);
+    static Companion companion;
+    companionInit(&companion, &link, simScan);
+    companionConnected(&companion);
+
+    Phone phone;
+    memset(&phone, 0, sizeof(phone));
+    phone.ok = true;
+
+    // The oldest record still in the log
+    uint32_t oldest = 0;
+    usageLogScan(&sim_log, 0, [](const UsageRecord *record, void *ctx) {
+        *(uint32_t *)ctx = record->seq;
+        return false;
+    }, &oldest);
+    phone.next_seq = oldest;
+
+    uint32_t events = 0;
+    uint32_t busy_events = 0;
+    uint32_t next_event = 0;
+    uint8_t status = COMPANION_RUNNING;
+    uint32_t finished_ms = 0;
+    uint32_t history_start_ms = 0;
+
+    sessionSetActivitySource(NULL);
+    sessionBegin(0);
+    const uint32_t limit = 60UL * 60UL * 1000UL;
+    for (uint32_t now = 0; now < limit; now += 10)
+    {
+        if (now % SIM_BLE_TICK_MS == 0 && status == COMPANION_RUNNING)
+        {
+            SessionFrame frame;
+            if (sessionTick(now, &frame) == SESSION_FINISHED)
+            {
+                status = COMPANION_COMPLETED;
+                finished_ms = now;
+            }
+            CompanionState state;
+            companionSessionState(&state, now, status);
+            companionSetState(&companion, &state);
+        }
+
+        if (now == SIM_BLE_HISTORY_AT_MS)
+        {
+            uint8_t from[4] = {1, 0, 0, 0};
+            companionControl(&companion, from, sizeof(from));
+            history_start_ms = now;
+        }
+
+        if (now % SIM_BLE_PUMP_MS == 0)
+        {
+            companionPump(&companion, now);
+        }
+
+        if (now >= next_event)
+        {
+            events++;
+            busy_events += !link.queue.empty();
+            for (int i = 0; i < SIM_BLE_PACKETS_PER_EVENT && !link.queue.empty(); i++)
+            {
+                phoneReceive(&phone, link.queue.front(), now);
+                link.queue.pop_front();
+            }
+            next_event = now + link.interval();
+        }
+
+        if (status != COMPANION_RUNNING && link.queue.empty() && now > finished_ms + 2000)
+        {
+            break;
+        }
+    }
+
+    bool ok = phone.ok && phone.history_done && phone.next_seq == usageLogNextSeq(&sim_log) &&
+              phone.state.status == COMPANION_COMPLETED && phone.state.progress == 1000;
+
+    printf("history: %u entries in %u notifications (%.1f per notification), %.2f s, fast interval %s\n",
+           phone.entries, companion.notifications - phone.states,
+           (double)phone.entries / (companion.notifications - phone.states),
+           (phone.history_done_ms - history_start_ms) / 1000.0, link.fast ? "still on" : "released");
+    printf("state: %u notifications over a %.0f s session, final phase %u/%u, progress %u, %s\n", phone.states,
+           finished_ms / 1000.0, phone.state.phase + 1, phone.state.phases, phone.state.progress,
+           phone.state.status == COMPANION_COMPLETED ? "completed" : "not completed");
+    printf("radio: %u connection events, %u with data, %u parameter updates, %u busy retries\n", events,
+           busy_events, link.param_updates, link.busy);
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
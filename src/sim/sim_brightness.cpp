@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "sim.h"
+#include "brightness.h"
+#include "session.h"
+
+// Same rates as the light task and the display loop
+#define SIM_LIGHT_SAMPLE_MS 50
+#define SIM_TICK_MS 250
+
+typedef struct LightSample
+{
+    uint32_t t_ms;
+    uint16_t raw;
+} LightSample;
+
+static bool loadLightTrace(const char *path, std::vector<LightSample> &out)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        unsigned long t;
+        unsigned raw;
+        if (sscanf(line, "%lu,%u", &t, &raw) == 2)
+        {
+            out.push_back({(uint32_t)t, (uint16_t)raw});
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// A dark room, the light going on, then daylight, with sensor noise
+static void syntheticLight(std::vector<LightSample> &out, uint32_t duration_ms)
+{
+    srand(1);
+    for (uint32_t t = 0; t < duration_ms; t += SIM_LIGHT_SAMPLE_MS)
+    {
+        int level = t < 40000 ? 60 : t < 100000 ? 1400 : 3600;
+        level += rand() % 81 - 40;
+        out.push_back({t, (uint16_t)(level < 0 ? 0 : level)});
+    }
+}
+
+static uint16_t litPixels(const uint8_t *rows)
+{
+    uint16_t n = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        n += __builtin_popcount(rows[i]);
+    }
+    return n;
+}
+
+// sim brightness [light.csv]
+//   Run a session's frames with the brightness following a light trace
+//   (t_ms,raw per line, or a built-in dark/lit/daylight sequence) and
+//   compare the LED current with fixed intensities
+int simBrightness(int argc, char **argv)
+{
+    std::vector<LightSample> trace;
+    if (argc >= 1)
+    {
+        if (!loadLightTrace(argv[0], trace) || trace.empty())
+        {
+            fprintf(stderr, "can't read %s\n", argv[0]);
+            return 1;
+        }
+    }
+    else
+    {
+        syntheticLight(trace, 160000);
+    }
+
+    AmbientFilter filter;
+    ambientFilterInit(&filter);
+    size_t pos = 0;
+    uint32_t t0 = trace[0].t_ms;
+    ambientFilterPush(&filter, trace[pos++].raw);
+
+    BrightnessRamp ramp;
+    brightnessRampInit(&ramp, filter.target, 0);
+
+    sessionBegin(0);
+    SessionFrame frame;
+    uint16_t lit = 0;
+
+    uint64_t auto_ua_ticks = 0;
+    uint64_t min_ua_ticks = 0;
+    uint64_t max_ua_ticks = 0;
+    uint32_t ticks = 0;
+
+    printf("t_s,level,intensity\n");
+    uint32_t end = trace.back().t_ms - t0;
+    for (uint32_t now = 0; now <= end; now += SIM_TICK_MS)
+    {
+        while (pos < trace.size() && trace[pos].t_ms - t0 <= now)
+        {
+            ambientFilterPush(&filter, trace[pos++].raw);
+        }
+
+        if (brightnessRampStep(&ramp, filter.target, now))
+        {
+            printf("%.2f,%u,%u\n", now / 1000.0, ambientFilterLevel(&filter), ramp.current);
+        }
+
+        // Keep showing the last frame while nothing changes, and start
+        //   another session when one finishes
+        uint8_t event = sessionTick(now, &frame);
+        if (event == SESSION_FINISHED)
+        {
+            sessionBegin(now);
+        }
+        else if (frame.left != NULL)
+        {
+            lit = litPixels(frame.left) + litPixels(frame.right);
+        }
+
+        auto_ua_ticks += brightnessCurrentUa(ramp.current, lit);
+        min_ua_ticks += brightnessCurrentUa(BRIGHTNESS_MIN, lit);
+        max_ua_ticks += brightnessCurrentUa(BRIGHTNESS_MAX, lit);
+        ticks++;
+    }
+
+    printf("average LED current: auto %.2f mA, always %d %.2f mA, always %d %.2f mA\n",
+           auto_ua_ticks / 1000.0 / ticks, BRIGHTNESS_MIN, min_ua_ticks / 1000.0 / ticks,
+           BRIGHTNESS_MAX, max_ua_ticks / 1000.0 / ticks);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#include <atomic>
+#include "sim_clock.h"
+
+static std::atomic<int64_t> sim_clock_us(0);
+
+int64_t clockUs()
+{
+    return sim_clock_us.load(std::memory_order_relaxed);
+}
+
+void simClockSet(int64_t us)
+{
+    sim_clock_us.store(us, std::memory_order_relaxed);
+}
+
+void simClockAdvance(int64_t us)
+{
+    sim_clock_us.fetch_add(us, std::memory_order_relaxed);
+}
@@ -0,0 +1,12 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+#include "clock.h"
+
+// The simulator's clockUs(): it starts at 0 and only moves when a sim
+//   moves it, in one step or a tick at a time, from any thread
+void simClockSet(int64_t us);
+void simClockAdvance(int64_t us);
+
+#endif
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+#include "config.h"
+#include "crc32.h"
+
+static bool sameConfig(const Config *a, const Config *b)
+{
+    return memcmp(a, b, sizeof(Config)) == 0;
+}
+
+// Re-seal a hand-edited blob
+static void fixCrc(uint8_t *buf, size_t len)
+{
+    uint32_t crc = crc32(buf, len - 4);
+    for (int i = 0; i < 4; i++)
+    {
+        buf[len - 4 + i] = (crc >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint8_t last_action;
+// What the console edits, as diag.cpp keeps its copy
+static Config edited;
+
+static void configHandler(int argc, char **argv, ConsoleOut *out)
+{
+    last_action = configCommand(argc, argv, &edited, out);
+}
+
+static const ConsoleCommand CONFIG_ONLY[] = {
+    {"config", "", "", configHandler},
+};
+
+static uint8_t run(const char *text)
+{
+    char line[CONSOLE_LINE_MAX];
+    char reply[CONSOLE_REPLY_MAX];
+    ConsoleOut out;
+    snprintf(line, sizeof(line), "%s", text);
+    consoleOutInit(&out, reply, sizeof(reply));
+    last_action = CONFIG_NONE;
+    consoleRun(CONFIG_ONLY, 1, line, &out);
+    printf("> %s\n%s", text, reply);
+    return last_action;
+}
+
+// sim config [line...]
+//   Check that saved settings survive the round trip, that settings from
+//   an older or newer schema load with defaults for what's missing, and
+//   that damaged ones, or ones from a version this build doesn't know,
+//   fall back to the defaults. Then run each line as if
+//   typed on the serial console.
+int simConfig(int argc, char **argv)
+{
+    bool ok = true;
+    Config defaults;
+    configDefaults(&defaults);
+    ok &= sameConfig(&config, &defaults);
+
+    // Round trip with every field changed
+    Config cfg = defaults;
+    cfg.tick_ms = 200;
+    cfg.pressure_threshold = 3500;
+    cfg.phase_seconds[3] = 30;
+    cfg.phase_seconds[4] = -5;
+    cfg.volume = 22;
+    cfg.eye_intensity_max = 8;
+    uint8_t buf[CONFIG_MAX_ENCODED];
+    size_t len = configEncode(&cfg, buf, sizeof(buf));
+    Config loaded;
+    bool same = len > 0 && configDecode(buf, len, &loaded) && sameConfig(&loaded, &cfg);
+    printf("round trip: %zu bytes, %s\n", len, same ? "same" : "DIFFERENT");
+    ok &= same;
+
+    // Written by a build without the last field (eye_intensity_max, 1 byte)
+    //   and with one this build doesn't know
+    uint8_t other[CONFIG_MAX_ENCODED];
+    size_t n = len - 4 - 4;
+    memcpy(other, buf, n);
+    const uint8_t unknown[] = {99, CONFIG_U16, 2, 0x34, 0x12, 0x78, 0x56};
+    memcpy(other + n, unknown, sizeof(unknown));
+    n += sizeof(unknown) + 4;
+    fixCrc(other, n);
+    Config expect = cfg;
+    expect.eye_intensity_max = defaults.eye_intensity_max;
+    same = configDecode(other, n, &loaded) && sameConfig(&loaded, &expect);
+    printf("other schema: %s\n", same ? "known fields kept, missing one at its default" : "WRONG");
+    ok &= same;
+
+    // From a version this build doesn't know, newer or broken: none of it
+    //   can be trusted
+    int rejected = 0;
+    const uint16_t versions[] = {0, CONFIG_VERSION_OLDEST - 1, CONFIG_VERSION + 1, 0xFFFF};
+    for (size_t i = 0; i < sizeof(versions) / sizeof(versions[0]); i++)
+    {
+        memcpy(other, buf, len);
+        other[0] = versions[i] & 0xFF;
+        other[1] = versions[i] >> 8;
+        fixCrc(other, len);
+        rejected += !configDecode(other, len, &loaded) && sameConfig(&loaded, &defaults);
+    }
+    same = rejected == (int)(sizeof(versions) / sizeof(versions[0]));
+    printf("unknown version: %d of %zu fell back to the defaults\n", rejected, sizeof(versions) / sizeof(versions[0]));
+    ok &= same;
+
+    // A value out of range takes the default, the rest still load. tick_ms
+    //   is the first field, its value is right after the version and
+    //   (id, type, count).
+    memcpy(other, buf, len);
+    other[5] = 10;
+    other[6] = 0;
+    fixCrc(other, len);
+    expect = cfg;
+    expect.tick_ms = defaults.tick_ms;
+    same = configDecode(other, len, &loaded) && sameConfig(&loaded, &expect);
+    printf("out of range: %s\n", same ? "that field at its default" : "WRONG");
+    ok &= same;
+
+    // Damage anywhere throws the lot away
+    int damaged = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        memcpy(other, buf, len);
+        other[i] ^= 0x04;
+        damaged += !configDecode(other, len, &loaded) && sameConfig(&loaded, &defaults);
+    }
+    same = damaged == (int)len && !configDecode(buf, 0, &loaded) && sameConfig(&loaded, &defaults);
+    printf("damaged: %d of %zu flipped bits fell back to the defaults\n", damaged, len);
+    ok &= same;
+
+    // The console, changing its copy of the settings and never the live
+    //   ones, which the render loop replaces whole
+    edited = config;
+    ok &= run("config volume 25") == CONFIG_CHANGED && edited.volume == 25;
+    ok &= run("config phase_seconds[5] 15") == CONFIG_CHANGED && edited.phase_seconds[5] == 15;
+    ok &= run("config tick_ms 5") == CONFIG_NONE && edited.tick_ms == defaults.tick_ms;
+    ok &= run("config brightness 3") == CONFIG_NONE;
+    ok &= run("config save") == CONFIG_SAVE;
+    ok &= sameConfig(&config, &defaults) && !sameConfig(&edited, &defaults);
+    ok &= run("config reset") == CONFIG_SAVE && sameConfig(&edited, &defaults);
+
+    for (int i = 0; i < argc; i++)
+    {
+        run(argv[i]);
+    }
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
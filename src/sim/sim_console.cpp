@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "sim.h"
+#include "anims.h"
+#include "config.h"
+#include "console.h"
+#include "diag.h"
+#include "frame.h"
+#include "seqlock.h"
+#include "session.h"
+#include "trace_log.h"
+
+// How long the writer and the readers hammer the lock-free parts for
+#define SIM_STRESS_MS 500
+
+typedef struct ScriptLine
+{
+    uint32_t at_ms;
+    const char *line;
+} ScriptLine;
+
+// What gets typed, and when
+static const ScriptLine SCRIPT[] = {
+    {1000, "status"},
+    {2000, "phase 7"},
+    {3000, "anim blink"},
+    {3000, "bright 3"},
+    {5000, "volume 25"},
+    {5000, "tick 100"},
+    {6000, "phase 12"},
+    {6000, "dance"},
+    {7000, "status"},
+    {7000, "trace 8"},
+    {7000, "stats"},
+};
+
+#define SCRIPT_LEN (sizeof(SCRIPT) / sizeof(SCRIPT[0]))
+
+// The parts of the render loop in main.cpp the console reaches into
+typedef struct SimLoop
+{
+    int named_anim;
+    AnimPlayer named_player;
+    int intensity_override;
+    int volume_sent;
+    int anim_frames_drawn;
+} SimLoop;
+
+static void handleRequests(SimLoop *loop, uint32_t now)
+{
+    DiagRequest req;
+    while (diagPollRequest(&req))
+    {
+        diagTrace(now, DIAG_TRACE_REQUEST, req.type, req.value);
+        switch (req.type)
+        {
+        case DIAG_REQ_PHASE:
+            sessionJumpToPhase(req.value);
+            break;
+        case DIAG_REQ_ANIM:
+            loop->named_anim = req.value;
+            animPlayerStart(&loop->named_player, NAMED_ANIMS[req.value].left, ANIM_ONCE);
+            diagTrace(now, DIAG_TRACE_ANIM, req.value, 0);
+            break;
+        case DIAG_REQ_INTENSITY:
+            loop->intensity_override = req.value;
+            break;
+        case DIAG_REQ_VOLUME:
+            loop->volume_sent = req.value;
+            break;
+        case DIAG_REQ_CONFIG:
+        {
+            Config changed;
+            if (diagTakeConfig(&changed))
+            {
+                config = changed;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+static void tick(SimLoop *loop, uint32_t now)
+{
+    auto start = std::chrono::steady_clock::now();
+    handleRequests(loop, now);
+
+    SessionFrame frame;
+    if (sessionTick(now, &frame) == SESSION_NEW_PHASE)
+    {
+        diagTrace(now, DIAG_TRACE_PHASE, sessionPhase(), 0);
+    }
+    if (loop->named_anim >= 0)
+    {
+        loop->anim_frames_drawn++;
+        animPlayerTick(&loop->named_player);
+        if (loop->named_player.done)
+        {
+            loop->named_anim = -1;
+            sessionRedraw();
+        }
+    }
+
+    uint32_t work_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    diagTickTimes(now % 3 == 0 ? 150 : 20, work_us);
+
+    const PhaseTimer *timer = sessionPhaseTimer();
+    DiagStatus status;
+    memset(&status, 0, sizeof(status));
+    status.now_ms = now;
+    status.phase = sessionPhase();
+    status.frame = sessionFrameCounter();
+    status.frames = sessionFrameCount();
+    status.intensity = loop->intensity_override >= 0 ? loop->intensity_override : 15;
+    status.intensity_override = loop->intensity_override;
+    status.paused = timer->paused;
+    status.effective_ms = timer->effective_ms;
+    status.quota_ms = timer->quota_ms;
+    diagPublish(&status);
+}
+
+// Type a line on the "serial port", with an export frame in front of it
+//   like a host pulling the log at the same time would send
+static bool type(ConsoleLine *line, const char *text, bool print)
+{
+    uint8_t frame[FRAME_MAX_SIZE];
+    uint8_t payload[6] = {0, 0, 0, 0, 8, 0};
+    size_t n = frameEncode(1, payload, sizeof(payload), frame);
+    bool ran = false;
+    for (size_t i = 0; i < n; i++)
+    {
+        ran |= consoleLinePush(line, frame[i]);
+    }
+
+    char reply[CONSOLE_REPLY_MAX];
+    size_t len = strlen(text);
+    for (size_t i = 0; i <= len; i++)
+    {
+        if (!consoleLinePush(line, i < len ? text[i] : '\n'))
+        {
+            continue;
+        }
+        ConsoleOut out;
+        consoleOutInit(&out, reply, sizeof(reply));
+        ran |= consoleRun(DIAG_COMMANDS, DIAG_COMMAND_COUNT, line->buf, &out);
+        if (print)
+        {
+            printf("> %s\n%s", text, reply);
+        }
+    }
+    return ran;
+}
+
+// The render loop publishing and tracing flat out on one thread, and the
+//   supervisor tracing on another, while others copy: every copy must be
+//   one a writer made whole, and each writer's entries in the order it
+//   added them
+static bool stress()
+{
+    typedef struct Stamp
+    {
+        uint32_t a;
+        uint32_t b[15];
+    } Stamp;
+    typedef struct TraceStamp
+    {
+        uint32_t writer;
+        uint32_t n;
+        uint32_t check;
+    } TraceStamp;
+    static Seqlock<Stamp> lock;
+    static TraceLog<TraceStamp, 64> log;
+    std::atomic<bool> stop(false);
+    std::atomic<uint32_t> torn(0);
+    std::atomic<uint32_t> reads(0);
+
+    std::thread writer([&]() {
+        Stamp s;
+        for (uint32_t i = 1; !stop.load(std::memory_order_relaxed); i++)
+        {
+            s.a = i;
+            for (int k = 0; k < 15; k++)
+            {
+                s.b[k] = i * 31 + k;
+            }
+            lock.write(s);
+            log.add({0, i, i * 31});
+        }
+    });
+    std::thread tracer([&]() {
+        for (uint32_t i = 1; !stop.load(std::memory_order_relaxed); i++)
+        {
+            log.add({1, i, i * 31 + 1});
+        }
+    });
+
+    auto reader = [&]() {
+        Stamp s;
+        TraceStamp recent[64];
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            if (lock.read(s))
+            {
+                for (int k = 0; k < 15; k++)
+                {
+                    torn += s.b[k] != s.a * 31 + k;
+                }
+            }
+            uint16_t n = log.recent(recent, 64);
+            uint32_t last[2] = {0, 0};
+            for (uint16_t i = 0; i < n; i++)
+            {
+                const TraceStamp *t = &recent[i];
+                bool whole = t->writer < 2 && t->check == t->n * 31 + t->writer;
+                torn += !whole || t->n <= last[t->writer & 1];
+                last[t->writer & 1] = t->n;
+            }
+            reads++;
+        }
+    };
+    std::thread r1(reader), r2(reader);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(SIM_STRESS_MS));
+    stop = true;
+    writer.join();
+    tracer.join();
+    r1.join();
+    r2.join();
+
+    printf("stress: %u reads against %u writes, %u torn\n", reads.load(), log.total(), torn.load());
+    return torn == 0 && reads > 0;
+}
+
+// sim console [quiet]
+//   Run a session with the console typing into it the way the serial port
+//   would, through the same command table and mailbox as the device, and
+//   check each command did what it said. Then stress the lock-free parts
+//   the render loop and the console share.
+int simConsole(int argc, char **argv)
+{
+    bool print = argc < 1 || strcmp(argv[0], "quiet") != 0;
+    bool ok = true;
+    SimLoop loop = {-1, {}, -1, -1, 0};
+    ConsoleLine line;
+    consoleLineInit(&line);
+
+    uint32_t now = 0;
+    sessionBegin(now);
+    size_t next = 0;
+    bool jumped = false;
+    for (; now < 10000; now += config.tick_ms)
+    {
+        for (; next < SCRIPT_LEN && SCRIPT[next].at_ms <= now; next++)
+        {
+            bool known = type(&line, SCRIPT[next].line, print);
+            ok &= known == (strcmp(SCRIPT[next].line, "dance") != 0);
+        }
+        tick(&loop, now);
+        jumped |= now >= 2000 && now < 2500 && sessionPhase() == 7;
+    }
+
+    printf("jumped to phase 7: %s\n", jumped ? "yes" : "NO");
+    printf("animation frames drawn: %d of %d\n", loop.anim_frames_drawn, ANIM_EYE_BLINK.num_frames);
+    printf("brightness fixed at %d, volume %d sent, tick %u ms\n", loop.intensity_override, loop.volume_sent,
+           config.tick_ms);
+    ok &= jumped && loop.anim_frames_drawn == ANIM_EYE_BLINK.num_frames;
+    ok &= loop.intensity_override == 3 && loop.volume_sent == 25 && config.volume == 25 && config.tick_ms == 100;
+
+    // Nothing the console sent could go through once the queue was full
+    for (int i = 0; i < 20; i++)
+    {
+        type(&line, "bright auto", false);
+    }
+    int drained = 0;
+    DiagRequest req;
+    while (diagPollRequest(&req))
+    {
+        drained++;
+    }
+    printf("20 requests between ticks, %d got through\n", drained);
+    ok &= drained > 0 && drained < 20;
+
+    configDefaults(&config);
+    ok &= stress();
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,610 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "sim.h"
+#include "sim_serial.h"
+#include "dfplayer_emu.h"
+#include "audio_cues.h"
+#include "config.h"
+#include "latency_model.h"
+#include "session.h"
+
+#define SIM_TICK_MS 250
+// Same as the device, see audio.cpp and audio_dfplayer.cpp
+#define SIM_AUDIO_POLL_MS 5
+#define SIM_CALIBRATION_ROUNDS 4
+#define SIM_ONSET_TIMEOUT_MS 1000
+// How long a busy-wait in the library lets the clock run per spin
+#define SIM_SPIN_US 250
+
+// What's on the card: a background track shorter than a session, so it
+//   has to be followed up, and the voice prompts
+#define SIM_TRACK_MS 40000
+#define SIM_ADVERT_MS 1800
+
+// The card is out from SIM_PULL_MS to SIM_BACK_MS into the session, over
+//   one voice prompt, and one byte of the SIM_CORRUPT_FRAME'th command of
+//   the session is damaged
+#define SIM_PULL_MS 110000
+#define SIM_BACK_MS 125000
+#define SIM_CORRUPT_FRAME 3
+
+// *** The wire and the module *** //
+
+static uint64_t sim_us = 0;
+static SimSerial to_player(DF_BAUD);
+static SimSerial from_player(DF_BAUD);
+static DfPlayerEmu *player = NULL;
+
+static uint32_t millis()
+{
+    return sim_us / 1000;
+}
+
+static void delayUs(uint64_t us)
+{
+    sim_us += us;
+    player->poll(sim_us);
+}
+
+// *** Host side *** //
+
+// DFRobotDFPlayerMini's message types, as printDetail() in
+//   audio_dfplayer.cpp sees them
+enum SimDfType : uint8_t
+{
+    TimeOut = 0,
+    WrongStack,
+    DFPlayerCardInserted,
+    DFPlayerCardRemoved,
+    DFPlayerCardOnline,
+    DFPlayerPlayFinished,
+    DFPlayerError,
+    DFPlayerUSBInserted,
+    DFPlayerUSBRemoved,
+    DFPlayerUSBOnline,
+    DFPlayerCardUSBOnline,
+    DFPlayerFeedBack,
+    SIM_DF_TYPES,
+};
+
+static const char *TYPE_NAMES[SIM_DF_TYPES] = {"timeout", "wrong-stack", "card-inserted", "card-removed",
+                                               "card-online", "finished", "error", "usb-inserted",
+                                               "usb-removed", "usb-online", "card-usb-online", "feedback"};
+
+// Behaves like the DFRobotDFPlayerMini library (1.0.6) the device uses,
+//   with ACKs on: a command waits for the previous one's ACK, and only the
+//   last message that came in is kept for readType() / read()
+class SimDfPlayer
+{
+public:
+    bool begin()
+    {
+        sendStack(DF_CMD_RESET, 0);
+        waitAvailable(2000);
+        delayUs(200000);
+        return readType() == DFPlayerCardOnline || readType() == DFPlayerUSBOnline;
+    }
+
+    void playFolder(uint8_t folder, uint8_t track) { sendStack(DF_CMD_PLAY_FOLDER, folder << 8 | track); }
+    void advertise(uint16_t track) { sendStack(DF_CMD_ADVERTISE, track); }
+    void volume(uint8_t level) { sendStack(DF_CMD_VOLUME, level); }
+    void stop() { sendStack(DF_CMD_STOP, 0); }
+
+    int readVolume()
+    {
+        sendStack(DF_CMD_QUERY_VOLUME, 0);
+        if (waitAvailable(0))
+        {
+            return readType() == DFPlayerFeedBack ? read() : -1;
+        }
+        return -1;
+    }
+
+    bool available()
+    {
+        int b;
+        while ((b = from_player.read(sim_us)) >= 0)
+        {
+            uint8_t result = dfParse(&parser, b);
+            if (result == DF_PARSE_BAD_SUM || result == DF_PARSE_BAD_FRAME)
+            {
+                return handleError(WrongStack, 0);
+            }
+            if (result == DF_PARSE_FRAME)
+            {
+                parseStack();
+                return is_available;
+            }
+        }
+        if (is_sending && millis() - sent_ms >= timeout_ms)
+        {
+            return handleError(TimeOut, 0);
+        }
+        return is_available;
+    }
+
+    uint8_t readType()
+    {
+        is_available = false;
+        return handle_type;
+    }
+
+    uint16_t read()
+    {
+        is_available = false;
+        return handle_param;
+    }
+
+    // Frames written so far
+    uint32_t sent = 0;
+
+private:
+    void sendStack(uint8_t cmd, uint16_t param)
+    {
+        while (is_sending)
+        {
+            delayUs(SIM_SPIN_US);
+            available();
+        }
+        uint8_t frame[DF_FRAME_SIZE];
+        dfEncode(cmd, true, param, frame);
+        to_player.write(frame, sizeof(frame), sim_us);
+        sent++;
+        sent_ms = millis();
+        is_sending = true;
+    }
+
+    bool waitAvailable(uint32_t duration_ms)
+    {
+        uint32_t start = millis();
+        if (duration_ms == 0)
+        {
+            duration_ms = timeout_ms;
+        }
+        while (!available())
+        {
+            if (millis() - start > duration_ms)
+            {
+                return handleError(TimeOut, 0);
+            }
+            delayUs(SIM_SPIN_US);
+        }
+        return true;
+    }
+
+    void parseStack()
+    {
+        uint8_t cmd = dfCommand(&parser);
+        uint16_t param = dfParam(&parser);
+        switch (cmd)
+        {
+        case DF_ACK:
+            is_sending = false;
+            break;
+        case DF_CARD_FINISHED:
+            handleMessage(DFPlayerPlayFinished, param);
+            break;
+        case DF_ONLINE:
+            handleMessage(param & 0x01 ? DFPlayerUSBOnline : param & 0x02 ? DFPlayerCardOnline : DFPlayerCardUSBOnline,
+                          param);
+            break;
+        case DF_CARD_INSERTED:
+            handleMessage(param & 0x01 ? DFPlayerUSBInserted : DFPlayerCardInserted, param);
+            break;
+        case DF_CARD_REMOVED:
+            handleMessage(param & 0x01 ? DFPlayerUSBRemoved : DFPlayerCardRemoved, param);
+            break;
+        case DF_ERROR:
+            handleError(DFPlayerError, param);
+            break;
+        default:
+            if (cmd >= 0x42 && cmd <= 0x4F)
+            {
+                handleMessage(DFPlayerFeedBack, param);
+            }
+            else
+            {
+                handleError(WrongStack, 0);
+            }
+            break;
+        }
+    }
+
+    bool handleMessage(uint8_t type, uint16_t param)
+    {
+        dfParserInit(&parser);
+        handle_type = type;
+        handle_param = param;
+        is_available = true;
+        return true;
+    }
+
+    bool handleError(uint8_t type, uint16_t param)
+    {
+        handleMessage(type, param);
+        is_sending = false;
+        return false;
+    }
+
+    DfParser parser = {{0}, 0};
+    bool is_sending = false;
+    bool is_available = false;
+    uint8_t handle_type = 0;
+    uint16_t handle_param = 0;
+    uint32_t sent_ms = 0;
+    uint32_t timeout_ms = 500;
+};
+
+static SimDfPlayer music;
+static LatencyModel latency;
+
+// Same as DFPlayerSink in audio_dfplayer.cpp
+class SimDfSink : public AudioSink
+{
+public:
+    void playFolder(uint8_t folder, uint8_t track) override
+    {
+        uint64_t t0 = sim_us;
+        music.playFolder(folder, track);
+        finish(t0);
+    }
+    void advertise(uint16_t track) override
+    {
+        uint64_t t0 = sim_us;
+        music.advertise(track);
+        finish(t0);
+    }
+    void volume(uint8_t level) override
+    {
+        uint64_t t0 = sim_us;
+        music.volume(level);
+        finish(t0);
+    }
+    void stop() override
+    {
+        uint64_t t0 = sim_us;
+        music.stop();
+        finish(t0);
+    }
+
+private:
+    void finish(uint64_t t0) { latencyStatsAdd(&latency.block, (sim_us - t0) / 1000); }
+};
+
+// false to leave the BUSY pin unwired, reading idle like its pull-up
+static bool busy_wired = true;
+
+static bool waitForBusy(bool busy, uint32_t timeout_ms)
+{
+    uint32_t start = millis();
+    while ((busy_wired && player->playing()) != busy)
+    {
+        if (millis() - start > timeout_ms)
+        {
+            return false;
+        }
+        delayUs(1000);
+    }
+    return true;
+}
+
+// Same as DFPlayerLatency in audio_dfplayer.cpp, with a variable for NVS
+class SimDfLatency : public LatencyPlayer
+{
+public:
+    bool load(LatencyModel *model) override
+    {
+        *model = stored;
+        return has_stored;
+    }
+
+    void save(const LatencyModel *model) override
+    {
+        stored = *model;
+        has_stored = true;
+    }
+
+    void calibrate(LatencyModel *model) override
+    {
+        int vol = 0;
+        for (int i = 0; i < SIM_CALIBRATION_ROUNDS; i++)
+        {
+            uint64_t t0 = sim_us;
+            vol = music.readVolume();
+            latencyStatsAdd(&model->rtt, (sim_us - t0) / 1000);
+        }
+        if (vol < 0)
+        {
+            vol = config.volume;
+        }
+
+        for (int i = 0; i < SIM_CALIBRATION_ROUNDS; i++)
+        {
+            music.volume(vol);
+            uint64_t t1 = sim_us;
+            music.volume(vol);
+            latencyStatsAdd(&model->ack, (sim_us - t1) / 1000);
+        }
+
+        music.volume(0);
+        for (int i = 0; i < SIM_CALIBRATION_ROUNDS; i++)
+        {
+            if (!waitForBusy(false, SIM_ONSET_TIMEOUT_MS))
+            {
+                break;
+            }
+            music.playFolder(1, 1);
+            uint64_t t0 = sim_us;
+            bool heard = waitForBusy(true, SIM_ONSET_TIMEOUT_MS);
+            if (heard)
+            {
+                latencyStatsAdd(&model->onset, (sim_us - t0) / 1000);
+            }
+            music.stop();
+            if (!heard)
+            {
+                break;
+            }
+        }
+        music.volume(vol);
+    }
+
+    LatencyModel stored;
+    bool has_stored = false;
+};
+
+// *** Session *** //
+
+typedef struct SimCue
+{
+    const AudioCue *cue; // NULL for the next background track
+    uint32_t deadline_ms;
+    uint32_t sent_ms;
+    uint32_t frame; // index of its command in what was sent
+} SimCue;
+
+static std::vector<SimCue> sim_cues;
+static uint32_t sim_events[SIM_DF_TYPES];
+static uint32_t sim_errors[DF_ERR_ADVERTISE + 1];
+static bool sim_print = true;
+
+static void traceCue(const AudioCue *cue, uint32_t deadline_ms, uint32_t sent_ms)
+{
+    sim_cues.push_back({cue, deadline_ms, sent_ms, music.sent});
+}
+
+// Same as audioBackendPoll() in audio_dfplayer.cpp
+static void poll(uint32_t now_ms)
+{
+    if (music.available())
+    {
+        uint8_t type = music.readType();
+        int value = music.read();
+        sim_events[type]++;
+        if (type == DFPlayerError && value <= DF_ERR_ADVERTISE)
+        {
+            sim_errors[value]++;
+        }
+        if (sim_print)
+        {
+            printf("%8.3f  %s %d\n", now_ms / 1000.0, TYPE_NAMES[type], value);
+        }
+        if (type == DFPlayerPlayFinished)
+        {
+            audioCuesTrackFinished(now_ms);
+        }
+        else if (type == DFPlayerCardInserted || type == DFPlayerCardOnline)
+        {
+            audioCuesPlayerReset(now_ms);
+        }
+    }
+}
+
+static const char *cueName(const AudioCue *cue)
+{
+    if (cue == NULL)
+    {
+        return "next-track";
+    }
+    switch (cue->kind)
+    {
+    case CUE_VOLUME:
+        return "volume";
+    case CUE_BACKGROUND:
+        return "background";
+    case CUE_VOICE:
+        return "voice";
+    default:
+        return "stop";
+    }
+}
+
+// sim dfplayer [quiet]
+//   Run a session's audio through the DFPlayer's serial protocol to an
+//   emulated module on a 9600 baud line: the same library calls, ACK
+//   waits, calibration and event handling as the device. Later wakes load
+//   the latency model instead of measuring again, and without the BUSY pin
+//   the onset is given up after one timeout. On the way a command is
+//   damaged on the wire and the SD card is pulled and put back.
+//   Checks when each cue is heard against its animation, that a finished
+//   track is followed up once and, its length known from then on, the next
+//   one goes out ahead of its end, and that sound comes back with the card.
+int simDfplayer(int argc, char **argv)
+{
+    sim_print = argc < 1 || strcmp(argv[0], "quiet") != 0;
+    bool ok = true;
+
+    DfPlayerEmu emu(&to_player, &from_player, DF_TIMING_DEFAULT, 1);
+    player = &emu;
+    emu.addTrack(1, 1, SIM_TRACK_MS);
+    for (uint16_t advert = VOICE_UPPER_LEFT; advert <= VOICE_GREAT_JOB; advert++)
+    {
+        emu.addAdvert(advert, SIM_ADVERT_MS);
+    }
+
+    // Boot, as in audioBackendBegin()
+    bool began = music.begin();
+    printf("begin: %s after %u ms\n", began ? "online" : "FAILED", millis());
+    ok &= began;
+
+    // Measured on the first boot only, each later one loads what was saved.
+    //   Without the BUSY pin it gives up on the onset after one timeout.
+    SimDfLatency nvs;
+    uint32_t t0 = millis();
+    bool measured = latencyModelStart(&latency, &nvs);
+    uint32_t lead = latencyModelLeadMs(&latency, AUDIO_DEFAULT_LEAD_MS);
+    printf("calibrated in %u ms: rtt %u, ack %u, onset %u ms mean, lead %u ms\n", millis() - t0,
+           latencyStatsMean(&latency.rtt), latencyStatsMean(&latency.ack), latencyStatsMean(&latency.onset), lead);
+    ok &= measured && latency.onset.count == SIM_CALIBRATION_ROUNDS;
+
+    t0 = millis();
+    bool again = latencyModelStart(&latency, &nvs);
+    uint32_t wake_ms = millis() - t0;
+    ok &= !again && latencyModelLeadMs(&latency, AUDIO_DEFAULT_LEAD_MS) == lead;
+
+    busy_wired = false;
+    SimDfLatency unwired;
+    LatencyModel unwired_model;
+    t0 = millis();
+    latencyModelStart(&unwired_model, &unwired);
+    uint32_t unwired_ms = millis() - t0;
+    busy_wired = true;
+    printf("next wake: %u ms, without the BUSY pin: %u ms\n", wake_ms, unwired_ms);
+    ok &= wake_ms == 0 && unwired_model.onset.count == 0 && unwired_ms < 2 * SIM_ONSET_TIMEOUT_MS;
+    int vol = music.readVolume();
+    printf("volume read back: %d\n", vol);
+    ok &= vol == emu.volume();
+
+    SimDfSink sink;
+    audioCuesBegin(&sink, lead);
+    audioCuesSetTraceHook(traceCue);
+
+    uint32_t start_ms = (millis() / SIM_TICK_MS + 1) * SIM_TICK_MS;
+    to_player.corrupt(to_player.written + SIM_CORRUPT_FRAME * DF_FRAME_SIZE + 5, 0x10);
+    emu.removeCard((start_ms + SIM_PULL_MS) * 1000ULL, (start_ms + SIM_BACK_MS) * 1000ULL);
+    uint32_t finished_before = emu.finished_sent;
+
+    while (millis() < start_ms)
+    {
+        delayUs(1000);
+        poll(millis());
+    }
+    sessionBegin(start_ms);
+    audioCuesPhaseStarted(0, start_ms);
+
+    uint32_t next_tick = start_ms + SIM_TICK_MS;
+    bool playing_after_card = false;
+    uint32_t now = start_ms;
+    while (true)
+    {
+        // A command held up by the library waiting for an ACK holds up the
+        //   whole audio task, the clock carries on from where it got to
+        now = millis() > now ? (millis() + SIM_AUDIO_POLL_MS - 1) / SIM_AUDIO_POLL_MS * SIM_AUDIO_POLL_MS : now;
+        if ((int32_t)(now - next_tick) >= 0)
+        {
+            next_tick += SIM_TICK_MS;
+
+            SessionFrame frame;
+            uint8_t event = sessionTick(now, &frame);
+            if (event == SESSION_FINISHED)
+            {
+                break;
+            }
+            if (event == SESSION_NEW_PHASE)
+            {
+                audioCuesPhaseStarted(sessionPhase(), now);
+            }
+
+            int32_t until_next = sessionMsUntilNextPhase(now, SIM_TICK_MS);
+            if (until_next >= 0)
+            {
+                audioCuesPredictNextPhase(now + until_next);
+            }
+        }
+
+        poll(now);
+        audioCuesPoll(now);
+        if (now - start_ms == SIM_BACK_MS + 2000)
+        {
+            playing_after_card = emu.playing();
+        }
+
+        now += SIM_AUDIO_POLL_MS;
+        if (now * 1000ULL > sim_us)
+        {
+            delayUs(now * 1000ULL - sim_us);
+        }
+    }
+    audioCuesStop();
+
+    // Each cue against when the module actually started it
+    if (sim_print)
+    {
+        printf("cue,phase,deadline_ms,sent_ms,heard_ms,error_ms\n");
+    }
+    int32_t worst = 0;
+    uint32_t heard = 0;
+    uint32_t refused = 0;
+    uint32_t restarts = 0;
+    uint32_t ahead = 0;
+    int32_t worst_gap = 0;
+    int32_t worst_ahead = 0;
+    for (const SimCue &c : sim_cues)
+    {
+        const DfLogEntry *entry = c.frame < emu.log.size() ? &emu.log[c.frame] : NULL;
+        bool taken = entry != NULL && entry->error == 0;
+        int32_t error = taken ? (int32_t)(entry->effect_us / 1000 - c.deadline_ms) : 0;
+        restarts += c.cue == NULL;
+        // Sent before the end of the one playing, its length being known
+        bool queued = c.cue == NULL && (int32_t)(c.deadline_ms - c.sent_ms) > 0;
+        ahead += queued;
+        // Volume changes aren't heard by themselves, and the next track
+        //   can only start once the last one has been reported finished
+        bool synced = c.cue != NULL && c.cue->kind != CUE_VOLUME;
+        if (sim_print)
+        {
+            printf("%s,%d,%u,%u,", cueName(c.cue), c.cue == NULL ? -1 : c.cue->phase, c.deadline_ms - start_ms,
+                   c.sent_ms - start_ms);
+            if (taken)
+            {
+                printf("%u,%d\n", (uint32_t)(entry->effect_us / 1000) - start_ms, error);
+            }
+            else
+            {
+                printf("refused %u\n", entry == NULL ? 0 : entry->error);
+            }
+        }
+        if (!taken)
+        {
+            refused++;
+            continue;
+        }
+        heard += synced;
+        worst = synced && abs(error) > abs(worst) ? error : worst;
+        worst_gap = c.cue == NULL && error > worst_gap ? error : worst_gap;
+        worst_ahead = queued && abs(error) > abs(worst_ahead) ? error : worst_ahead;
+    }
+
+    uint32_t finished = emu.finished_sent - finished_before;
+    printf("%u cues heard, worst %d ms from the animation, %u commands refused\n", heard, worst, refused);
+    printf("%u tracks finished, %u followed up, %u of them ahead of the end within %d ms, longest gap %d ms\n",
+           finished, restarts, ahead, worst_ahead, worst_gap);
+    printf("events: %u finished, %u removed, %u inserted, %u checksum, %u no card, %u timeouts\n",
+           sim_events[DFPlayerPlayFinished], sim_events[DFPlayerCardRemoved], sim_events[DFPlayerCardInserted],
+           sim_errors[DF_ERR_CHECKSUM], sim_errors[DF_ERR_BUSY], sim_events[TimeOut]);
+    printf("playing again after the card went back: %s\n", playing_after_card ? "yes" : "NO");
+
+    ok &= abs(worst) <= (int32_t)(DF_TIMING_DEFAULT.onset_jitter_us / 1000 + SIM_AUDIO_POLL_MS + 10);
+    // The background track's length is learnt the first time it finishes,
+    //   after that the next one goes out ahead of the end
+    ok &= restarts == finished + ahead && ahead > 0;
+    ok &= abs(worst_ahead) <= (int32_t)(DF_TIMING_DEFAULT.onset_jitter_us / 1000 + SIM_AUDIO_POLL_MS + 10);
+    ok &= sim_errors[DF_ERR_CHECKSUM] == 1 && sim_errors[DF_ERR_BUSY] == 1 && sim_events[DFPlayerCardRemoved] == 1 &&
+          sim_events[DFPlayerCardInserted] == 1;
+    ok &= playing_after_card && emu.volume() == config.volume;
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
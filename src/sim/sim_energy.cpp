@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "energy_model.h"
+#include "config.h"
+#include "framebuffer.h"
+#include "fuel_gauge.h"
+#include "session.h"
+
+// Same as the device, see main.cpp
+#define SIM_ENERGY_DEVICES 2
+
+// The variants compared against the one asked for
+static const uint32_t SIM_ENERGY_TICKS[] = {100, 250, 500};
+static const uint8_t SIM_ENERGY_INTENSITIES[] = {3, 8, 15};
+
+typedef struct EnergyRun
+{
+    uint32_t tick_ms;
+    uint8_t intensity;
+    bool light_sleep;
+} EnergyRun;
+
+// One session from the wake to its last frame, the phases running for
+//   their fixed durations. The frames go through a framebuffer like the
+//   device's, so only the rows that change count as sent.
+static void runSession(EnergyMeter *meter, const EnergyRun *run)
+{
+    Framebuffer<SIM_ENERGY_DEVICES> fb;
+    fb.markAllDirty();
+    uint16_t cpu_mhz = POWER_POLICIES[BATTERY_OK].cpu_mhz;
+    energyBoot(meter, cpu_mhz);
+
+    sessionBegin(0);
+    const uint32_t limit = 60UL * 60UL * 1000UL;
+    for (uint32_t now = 0; now < limit; now += run->tick_ms)
+    {
+        SessionFrame frame;
+        if (sessionTick(now, &frame) == SESSION_FINISHED)
+        {
+            break;
+        }
+        if (frame.left != NULL && frame.right != NULL)
+        {
+            fb.setDevice(0, frame.left);
+            fb.setDevice(1, frame.right);
+        }
+
+        EnergyTick tick;
+        tick.tick_ms = run->tick_ms;
+        tick.intensity = run->intensity;
+        tick.lit_pixels = 0;
+        tick.rows_sent = __builtin_popcount(fb.dirtyRows());
+        for (uint8_t r = 0; r < 8; r++)
+        {
+            tick.lit_pixels += __builtin_popcount(fb.getRow(0, r)) + __builtin_popcount(fb.getRow(1, r));
+        }
+        tick.devices = SIM_ENERGY_DEVICES;
+        tick.playing = true;
+        tick.volume = config.volume;
+        tick.cpu_mhz = cpu_mhz;
+        tick.light_sleep = run->light_sleep;
+        energyTick(meter, &tick);
+        fb.markClean();
+    }
+}
+
+static void printBreakdown(const EnergyMeter *meter)
+{
+    double total = energyTotal(meter);
+    printf("part,J,percent,mean_mA\n");
+    for (int p = 0; p < ENERGY_PARTS; p++)
+    {
+        double ma = meter->joules[p] / meter->model.cell_v / meter->seconds * 1000.0;
+        printf("%s,%.2f,%.1f,%.1f\n", ENERGY_PART_NAMES[p], meter->joules[p], 100.0 * meter->joules[p] / total, ma);
+    }
+    double mah = total / meter->model.cell_v / 3.6;
+    printf("session %.0f s, %.1f J, %.2f mAh\n", meter->seconds, total, mah);
+}
+
+// sim energy [tick_ms] [intensity] [busy|sleep] [model.txt]
+//   Run a session through the energy model and print where its joules go:
+//   LEDs from the lit pixels and intensity of each frame, the MAX7219s,
+//   SPI for the rows that changed, the CPU working and idling, the player
+//   and the radio. Then the same session at other tick rates, intensities
+//   and with the CPU light sleeping when idle, each of which has to move
+//   its own parts the right way. The figures are datasheet typicals unless
+//   a model file calibrated on a bench supply replaces them.
+int simEnergy(int argc, char **argv)
+{
+    EnergyRun run = {config.tick_ms, 8, false};
+    EnergyModel model = ENERGY_MODEL_DEFAULT;
+    if (argc >= 1)
+    {
+        run.tick_ms = atoi(argv[0]);
+    }
+    if (argc >= 2)
+    {
+        run.intensity = atoi(argv[1]);
+    }
+    if (argc >= 3)
+    {
+        run.light_sleep = strcmp(argv[2], "sleep") == 0;
+    }
+    if (argc >= 4 && !energyModelLoad(argv[3], &model))
+    {
+        fprintf(stderr, "can't use %s\n", argv[3]);
+        return 1;
+    }
+    if (run.tick_ms == 0 || run.intensity > 15)
+    {
+        fprintf(stderr, "tick_ms must be above 0, intensity 0 .. 15\n");
+        return 1;
+    }
+
+    EnergyMeter meter;
+    energyMeterInit(&meter, &model);
+    runSession(&meter, &run);
+    printBreakdown(&meter);
+
+    bool ok = meter.seconds > 0 && energyTotal(&meter) > 0;
+    for (int p = 0; p < ENERGY_PARTS; p++)
+    {
+        ok &= meter.joules[p] >= 0;
+    }
+
+    // The other variants, each against the one before it
+    printf("\ntick_ms,intensity,idle,J,leds_J,spi_J,cpu_J,idle_J\n");
+    double last_leds = -1, last_spi = -1;
+    for (uint32_t tick_ms : SIM_ENERGY_TICKS)
+    {
+        double last_idle = -1;
+        for (int sleep = 0; sleep < 2; sleep++)
+        {
+            for (uint8_t intensity : SIM_ENERGY_INTENSITIES)
+            {
+                EnergyRun v = {tick_ms, intensity, sleep == 1};
+                EnergyMeter m;
+                energyMeterInit(&m, &model);
+                runSession(&m, &v);
+                printf("%u,%u,%s,%.1f,%.2f,%.3f,%.2f,%.2f\n", tick_ms, intensity, sleep ? "sleep" : "busy",
+                       energyTotal(&m), m.joules[ENERGY_LEDS], m.joules[ENERGY_SPI], m.joules[ENERGY_CPU],
+                       m.joules[ENERGY_IDLE]);
+
+                // Brighter costs more in the LEDs, sleeping less while idle
+                ok &= intensity == SIM_ENERGY_INTENSITIES[0] || m.joules[ENERGY_LEDS] > last_leds;
+                ok &= !sleep || intensity != SIM_ENERGY_INTENSITIES[0] || m.joules[ENERGY_IDLE] < last_idle;
+                last_leds = m.joules[ENERGY_LEDS];
+                if (!sleep && intensity == SIM_ENERGY_INTENSITIES[0])
+                {
+                    last_idle = m.joules[ENERGY_IDLE];
+                    // Slower ticks send fewer rows
+                    ok &= last_spi < 0 || m.joules[ENERGY_SPI] < last_spi;
+                    last_spi = m.joules[ENERGY_SPI];
+                }
+            }
+        }
+    }
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
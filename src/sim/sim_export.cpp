@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "sim.h"
+#include "sim_flash.h"
+#include "usage_export.h"
+
+#define SIM_EXPORT_SECTORS 32
+#define SIM_EXPORT_SECTOR_SIZE 4096
+#define SIM_EXPORT_MAX_ROUNDS 2000
+
+static UsageLog sim_log;
+static std::vector<uint8_t> sim_wire;
+
+static uint32_t simScan(uint32_t from_seq, UsageLogVisitor visit, void *ctx)
+{
+    return usageLogScan(&sim_log, from_seq, visit, ctx);
+}
+
+static void simWrite(const uint8_t *data, size_t len)
+{
+    sim_wire.insert(sim_wire.end(), data, data + len);
+}
+
+typedef struct Received
+{
+    std::vector<uint32_t> seqs;
+} Received;
+
+static bool receive(const UsageRecord *record, void *ctx)
+{
+    ((Received *)ctx)->seqs.push_back(record->seq);
+    return true;
+}
+
+// Flip a byte now and then, and cut the link after `cut` bytes if >= 0
+static void corrupt(std::vector<uint8_t> &wire, double error_rate, long cut)
+{
+    for (uint8_t &b : wire)
+    {
+        if (rand() < error_rate * RAND_MAX)
+        {
+            b ^= 1 << (rand() % 8);
+        }
+    }
+    if (cut >= 0 && (size_t)cut < wire.size())
+    {
+        wire.resize(cut);
+    }
+}
+
+// sim export [records] [byte_error_rate]
+//   Export a simulated usage log through a noisy serial link. The first
+//   connection drops partway through and a second one resumes from the
+//   last record the host has. Every record must arrive exactly once, in
+//   order.
+int simExport(int argc, char **argv)
+{
+    uint32_t total = argc >= 1 ? strtoul(argv[0], NULL, 10) : 3000;
+    double error_rate = argc >= 2 ? atof(argv[1]) : 1e-4;
+
+    srand(1);
+    SimFlash flash(SIM_EXPORT_SECTORS, SIM_EXPORT_SECTOR_SIZE);
+    usageLogBegin(&sim_log, &flash);
+    for (uint32_t i = 0; i < total; i++)
+    {
+        UsageRecord record;
+        memset(&record, 0, sizeof(record));
+        record.type = USAGE_RECORD_SESSION;
+        usageLogAppend(&sim_log, &record);
+    }
+
+    static UsageExporter exporter;
+    usageExporterInit(&exporter, 0x1234567890ULL, simScan, simWrite);
+
+    Received received;
+    uint32_t from = 1;
+    uint8_t request[FRAME_MAX_SIZE];
+    size_t wire_bytes = 0;
+    int rounds = 0;
+
+    for (int connection = 0; connection < 2; connection++)
+    {
+        static UsageImporter importer;
+        usageImporterBegin(&importer, from, receive, &received);
+
+        // First time round the cable gets pulled partway through
+        long cut = connection == 0 ? (long)(total * sizeof(UsageRecord) / 3) : -1;
+        long sent = 0;
+
+        do
+        {
+            size_t len = usageImporterRequest(&importer, request);
+            sim_wire.clear();
+            usageExporterReceive(&exporter, request, len);
+            corrupt(sim_wire, error_rate, cut >= 0 ? cut - sent : -1);
+            sent += sim_wire.size();
+            wire_bytes += sim_wire.size();
+            usageImporterPush(&importer, sim_wire.data(), sim_wire.size());
+            rounds++;
+        } while (!importer.done && (cut < 0 || sent < cut) && rounds < SIM_EXPORT_MAX_ROUNDS);
+
+        printf("connection %d: unit %llx, %u records, %u bad frames, %s\n", connection + 1,
+               (unsigned long long)importer.hello.unit_id, importer.records, importer.decoder.bad,
+               importer.done ? "done" : "cut off");
+        from = importer.expected;
+    }
+
+    bool ok = !received.seqs.empty() && received.seqs.back() == usageLogNextSeq(&sim_log) - 1;
+    for (size_t i = 1; i < received.seqs.size(); i++)
+    {
+        ok &= received.seqs[i] == received.seqs[i - 1] + 1;
+    }
+
+    printf("%zu records (%u..%u) in %d requests, %zu bytes on the wire, %.1f%% overhead\n",
+           received.seqs.size(), received.seqs.empty() ? 0 : received.seqs.front(),
+           received.seqs.empty() ? 0 : received.seqs.back(), rounds, wire_bytes,
+           100.0 * wire_bytes / (received.seqs.size() * sizeof(UsageRecord)) - 100.0);
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+#ifndef SIM_FLASH_H
+#define SIM_FLASH_H
+
+#include <string.h>
+#include <vector>
+#include "flash_region.h"
+
+// NOR flash in memory. A power cut can be armed to hit after a number of
+//   bytes have been programmed or erased; from then on nothing reaches the
+//   flash until it's "powered" again.
+class SimFlash : public FlashRegion
+{
+public:
+    SimFlash(uint32_t sectors, uint32_t sector_size)
+        : data(sectors * sector_size, 0xFF), erases(sectors, 0), sector_size(sector_size) {}
+
+    uint32_t size() const override { return data.size(); }
+    uint32_t sectorSize() const override { return sector_size; }
+
+    bool read(uint32_t offset, void *buf, size_t len) override
+    {
+        if (offset + len > data.size())
+        {
+            return false;
+        }
+        memcpy(buf, &data[offset], len);
+        return true;
+    }
+
+    bool write(uint32_t offset, const void *buf, size_t len) override
+    {
+        if (offset + len > data.size())
+        {
+            return false;
+        }
+        const uint8_t *p = (const uint8_t *)buf;
+        for (size_t i = 0; i < len; i++)
+        {
+            if (!tick())
+            {
+                return false;
+            }
+            data[offset + i] &= p[i];
+        }
+        return true;
+    }
+
+    bool eraseSector(uint32_t sector) override
+    {
+        if (sector >= erases.size())
+        {
+            return false;
+        }
+        erases[sector]++;
+        for (uint32_t i = 0; i < sector_size; i++)
+        {
+            if (!tick())
+            {
+                return false;
+            }
+            data[sector * sector_size + i] = 0xFF;
+        }
+        return true;
+    }
+
+    // Lose power after this many more bytes, -1 never
+    void cutAfter(long bytes) { budget = bytes; }
+
+    std::vector<uint8_t> data;
+    std::vector<uint32_t> erases;
+
+private:
+    bool tick()
+    {
+        if (budget == 0)
+        {
+            return false;
+        }
+        if (budget > 0)
+        {
+            budget--;
+        }
+        return true;
+    }
+
+    uint32_t sector_size;
+    long budget = -1;
+};
+
+#endif
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "sim.h"
+#include "sim_flash.h"
+#include "health.h"
+
+// Same shape as the usagelog partition
+#define SIM_HEALTH_SECTORS 32
+#define SIM_HEALTH_SECTOR_SIZE 4096
+
+// Same as the device, see main.cpp, audio.cpp, imu.cpp and supervisor.h
+#define SIM_HEALTH_RENDER_MS 250
+#define SIM_HEALTH_RENDER_HEARTBEAT_MS 1000
+#define SIM_HEALTH_AUDIO_POLL_MS 5
+#define SIM_HEALTH_AUDIO_HEARTBEAT_MS 1000
+#define SIM_HEALTH_IMU_MS 10
+#define SIM_HEALTH_IMU_HEARTBEAT_MS 50
+#define SIM_HEALTH_IMU_FAILED_READS 10
+#define SIM_HEALTH_CHECK_MS 250
+
+// The virtual wake: the player only answers from 20 s on, the render loop
+//   hangs for 8 s from 40 s, the IMU drops off the bus between 60 and 62 s
+#define SIM_HEALTH_PLAYER_FROM_MS 20000
+#define SIM_HEALTH_HANG_FROM_MS 40000
+#define SIM_HEALTH_HANG_MS 8000
+#define SIM_HEALTH_IMU_GONE_MS 60000
+#define SIM_HEALTH_IMU_BACK_MS 62000
+#define SIM_HEALTH_END_MS 90000
+
+static bool checkBackoff()
+{
+    // Doubling from the minimum, then held at the maximum
+    std::vector<uint32_t> expect = {1000, 2000, 4000, 8000, 16000, 32000, 60000, 60000};
+    Backoff backoff;
+    backoffInit(&backoff, 0);
+    bool ok = backoffDue(&backoff, 0);
+    uint32_t now = 0;
+    printf("backoff:");
+    for (uint32_t delay : expect)
+    {
+        backoffFailed(&backoff, now);
+        ok &= !backoffDue(&backoff, now + delay - 1) && backoffDue(&backoff, now + delay);
+        printf(" %u", backoff.delay_ms);
+        now += delay;
+    }
+    printf(" ms\n");
+
+    // And across the millis() wrap
+    backoffInit(&backoff, 0xFFFFFF00);
+    backoffFailed(&backoff, 0xFFFFFF00);
+    ok &= !backoffDue(&backoff, 0xFFFFFFFF) && !backoffDue(&backoff, 800 - 257) && backoffDue(&backoff, 1000 - 256);
+    return ok;
+}
+
+static void printRecord(const UsageHealth *h)
+{
+    printf("record: reset %u, up %.1f s, down 0x%x\n", h->reset_reason, h->uptime_ms / 1000.0, h->down);
+    printf("  player: %u failures, %u recoveries\n", h->failures[HEALTH_PLAYER], h->recoveries[HEALTH_PLAYER]);
+    printf("  imu:    %u failures, %u recoveries\n", h->failures[HEALTH_IMU], h->recoveries[HEALTH_IMU]);
+    for (int t = 0; t < USAGE_HEALTH_TASKS; t++)
+    {
+        printf("  task %d: %u stalls, longest gap %u ms\n", t, h->stalls[t], h->max_gap_ms[t]);
+    }
+}
+
+// sim health
+//   Check the retry backoff, then run a wake on a virtual clock with the
+//   device's task periods where the player doesn't answer at first, the
+//   render loop hangs and the IMU drops off the bus, and check each is
+//   counted once, retried on schedule and recovered from. The health
+//   record written at the end must come back out of the usage log intact.
+int simHealth(int argc, char **argv)
+{
+    bool ok = checkBackoff();
+
+    static Health health;
+    healthInit(&health, USAGE_RESET_DEEP_SLEEP);
+    healthWatch(&health, HEALTH_TASK_RENDER, SIM_HEALTH_RENDER_HEARTBEAT_MS, 0);
+    healthWatch(&health, HEALTH_TASK_AUDIO, SIM_HEALTH_AUDIO_HEARTBEAT_MS, 0);
+    healthWatch(&health, HEALTH_TASK_IMU, SIM_HEALTH_IMU_HEARTBEAT_MS, 0);
+
+    // Boot: the IMU answers, the player doesn't
+    healthPeripheralUp(&health, HEALTH_IMU);
+    healthPeripheralFailed(&health, HEALTH_PLAYER, 0);
+    std::vector<uint32_t> player_tries = {0};
+    std::vector<uint32_t> imu_tries;
+    uint32_t player_back_ms = 0;
+    uint32_t imu_down_ms = 0;
+    uint32_t imu_back_ms = 0;
+    uint16_t failed_reads = 0;
+    std::vector<uint32_t> stalls_seen;
+
+    for (uint32_t now = 1; now <= SIM_HEALTH_END_MS; now++)
+    {
+        bool hung = now >= SIM_HEALTH_HANG_FROM_MS && now < SIM_HEALTH_HANG_FROM_MS + SIM_HEALTH_HANG_MS;
+        if (now % SIM_HEALTH_RENDER_MS == 0 && !hung)
+        {
+            healthBeat(&health, HEALTH_TASK_RENDER, now);
+        }
+
+        if (now % SIM_HEALTH_AUDIO_POLL_MS == 0)
+        {
+            healthBeat(&health, HEALTH_TASK_AUDIO, now);
+            if (healthRetryDue(&health, HEALTH_PLAYER, now))
+            {
+                player_tries.push_back(now);
+                if (now >= SIM_HEALTH_PLAYER_FROM_MS)
+                {
+                    healthPeripheralUp(&health, HEALTH_PLAYER);
+                    player_back_ms = now;
+                }
+                else
+                {
+                    healthPeripheralFailed(&health, HEALTH_PLAYER, now);
+                }
+            }
+        }
+
+        if (now % SIM_HEALTH_IMU_MS == 0)
+        {
+            healthBeat(&health, HEALTH_TASK_IMU, now);
+            bool answers = now < SIM_HEALTH_IMU_GONE_MS || now >= SIM_HEALTH_IMU_BACK_MS;
+            if (!health.peripherals[HEALTH_IMU].up)
+            {
+                if (healthRetryDue(&health, HEALTH_IMU, now))
+                {
+                    imu_tries.push_back(now);
+                    if (answers)
+                    {
+                        healthPeripheralUp(&health, HEALTH_IMU);
+                        imu_back_ms = now;
+                        failed_reads = 0;
+                    }
+                    else
+                    {
+                        healthPeripheralFailed(&health, HEALTH_IMU, now);
+                    }
+                }
+            }
+            else if (answers)
+            {
+                failed_reads = 0;
+            }
+            else if (++failed_reads >= SIM_HEALTH_IMU_FAILED_READS)
+            {
+                healthPeripheralFailed(&health, HEALTH_IMU, now);
+                imu_down_ms = now;
+            }
+        }
+
+        if (now % SIM_HEALTH_CHECK_MS == 0 && healthCheck(&health, now) != 0)
+        {
+            stalls_seen.push_back(now);
+        }
+    }
+
+    printf("player tried at");
+    for (uint32_t t : player_tries)
+    {
+        printf(" %.0f", t / 1000.0);
+    }
+    printf(" s, back at %.0f s\n", player_back_ms / 1000.0);
+    std::vector<uint32_t> expect = {0, 1000, 3000, 7000, 15000, 31000};
+    ok &= player_tries == expect && player_back_ms == 31000;
+
+    printf("imu gone at %u ms, tried", imu_down_ms);
+    for (uint32_t t : imu_tries)
+    {
+        printf(" %u", t);
+    }
+    printf(" ms, back at %u ms\n", imu_back_ms);
+    ok &= imu_down_ms == SIM_HEALTH_IMU_GONE_MS + (SIM_HEALTH_IMU_FAILED_READS - 1) * SIM_HEALTH_IMU_MS;
+    ok &= imu_back_ms >= SIM_HEALTH_IMU_BACK_MS && imu_back_ms <= imu_down_ms + HEALTH_RETRY_MIN_MS * 3;
+
+    uint32_t stall_limit = SIM_HEALTH_RENDER_HEARTBEAT_MS * HEALTH_STALL_PERIODS;
+    printf("stalls seen at");
+    for (uint32_t t : stalls_seen)
+    {
+        printf(" %u", t);
+    }
+    printf(" ms\n");
+    ok &= stalls_seen.size() == 1 && stalls_seen[0] > SIM_HEALTH_HANG_FROM_MS + stall_limit - SIM_HEALTH_RENDER_MS &&
+          stalls_seen[0] <= SIM_HEALTH_HANG_FROM_MS + stall_limit + SIM_HEALTH_CHECK_MS;
+
+    // Into the usage log and back
+    ok &= healthNoteworthy(&health);
+    SimFlash flash(SIM_HEALTH_SECTORS, SIM_HEALTH_SECTOR_SIZE);
+    static UsageLog log;
+    usageLogBegin(&log, &flash);
+    UsageRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = USAGE_RECORD_HEALTH;
+    healthRecord(&health, SIM_HEALTH_END_MS, &record.health);
+    UsageHealth written = record.health;
+    usageLogAppend(&log, &record);
+
+    UsageLog reopened;
+    usageLogBegin(&reopened, &flash);
+    UsageRecord read;
+    memset(&read, 0, sizeof(read));
+    usageLogScan(&reopened, 0, [](const UsageRecord *r, void *ctx) {
+        *(UsageRecord *)ctx = *r;
+        return false;
+    }, &read);
+    bool same = read.type == USAGE_RECORD_HEALTH && memcmp(&read.health, &written, sizeof(written)) == 0;
+    printRecord(&read.health);
+    ok &= same && read.health.failures[HEALTH_PLAYER] == 1 && read.health.recoveries[HEALTH_PLAYER] == 1;
+    ok &= read.health.failures[HEALTH_IMU] == 1 && read.health.recoveries[HEALTH_IMU] == 1 && read.health.down == 0;
+    ok &= read.health.stalls[HEALTH_TASK_RENDER] == 1 && read.health.max_gap_ms[HEALTH_TASK_RENDER] >= SIM_HEALTH_HANG_MS;
+
+    // A quiet wake isn't worth a record, one after a crash is
+    healthInit(&health, USAGE_RESET_DEEP_SLEEP);
+    ok &= !healthNoteworthy(&health);
+    healthInit(&health, USAGE_RESET_WATCHDOG);
+    ok &= healthNoteworthy(&health);
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
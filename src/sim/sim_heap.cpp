@@ -0,0 +1,343 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include "sim.h"
+#include "sim_flash.h"
+#include "audio_cues.h"
+#include "brightness.h"
+#include "companion.h"
+#include "config.h"
+#include "console.h"
+#include "diag.h"
+#include "health.h"
+#include "heap_guard.h"
+#include "latency_model.h"
+#include "session.h"
+#include "usage_log.h"
+
+// The simulator's allocator: glibc's, with every call reported to the
+//   guard like heap_wrap.cpp does on the device. Only sim heap arms it,
+//   everything else here is free to use the heap.
+uintptr_t heapGuardTask()
+{
+    return (uintptr_t)pthread_self();
+}
+
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t n, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+
+    void *malloc(size_t size)
+    {
+        heapGuardNote(size, (uintptr_t)__builtin_return_address(0));
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t n, size_t size)
+    {
+        heapGuardNote(n * size, (uintptr_t)__builtin_return_address(0));
+        return __libc_calloc(n, size);
+    }
+
+    void *realloc(void *ptr, size_t size)
+    {
+        heapGuardNote(size, (uintptr_t)__builtin_return_address(0));
+        return __libc_realloc(ptr, size);
+    }
+}
+
+// Same shape as the usagelog partition
+#define SIM_HEAP_SECTORS 32
+#define SIM_HEAP_SECTOR_SIZE 4096
+
+#define SIM_HEAP_PUMP_MS 50
+
+// Into the second session
+#define SIM_HEAP_PLAYER_LOST_MS 20000
+
+// Allocated by another thread at the end
+#define SIM_HEAP_OTHER_SIZE 4321
+
+typedef struct ScriptLine
+{
+    uint32_t at_ms;
+    const char *line;
+} ScriptLine;
+
+// What gets typed on the console during the first session
+static const ScriptLine SCRIPT[] = {
+    {1000, "status"},  {2000, "phase 7"}, {3000, "anim blink"}, {3000, "bright 3"},
+    {4000, "health"},  {5000, "trace 8"}, {6000, "stats"},      {7000, "config volume 25"},
+};
+
+#define SCRIPT_LEN (sizeof(SCRIPT) / sizeof(SCRIPT[0]))
+
+class QuietSink : public AudioSink
+{
+public:
+    void playFolder(uint8_t folder, uint8_t track) override { commands++; }
+    void advertise(uint16_t track) override { commands++; }
+    void volume(uint8_t level) override { commands++; }
+    void stop() override { commands++; }
+
+    uint32_t commands = 0;
+};
+
+// A phone that takes every notification straight away
+class QuietLink : public CompanionLink
+{
+public:
+    uint16_t payloadSize() override { return 244; }
+    bool notify(uint8_t characteristic, const uint8_t *data, size_t len) override
+    {
+        notifications++;
+        return true;
+    }
+    void setFast(bool fast) override {}
+
+    uint32_t notifications = 0;
+};
+
+// The DFPlayer's latency model kept in a variable, with the allocations
+//   NVS makes on every open and for the entries it writes
+class NvsLatency : public LatencyPlayer
+{
+public:
+    bool load(LatencyModel *model) override
+    {
+        free(malloc(64));
+        *model = stored;
+        return has_stored;
+    }
+
+    void save(const LatencyModel *model) override
+    {
+        free(malloc(64));
+        stored = *model;
+        has_stored = true;
+    }
+
+    void calibrate(LatencyModel *model) override
+    {
+        latencyStatsAdd(&model->rtt, 12);
+        latencyStatsAdd(&model->ack, 8);
+    }
+
+    LatencyModel stored;
+    bool has_stored = false;
+};
+
+static NvsLatency nvs;
+static LatencyModel latency;
+static uint32_t player_starts = 0;
+
+// audio.cpp's startPlayer(), with audioBackendBegin() as the DFPlayer's
+static void startPlayer(AudioSink *sink, Health *health)
+{
+    latencyModelStart(&latency, &nvs);
+    audioCuesBegin(sink, latencyModelLeadMs(&latency, AUDIO_DEFAULT_LEAD_MS));
+    audioCuesSetVolume(config.volume);
+    healthPeripheralUp(health, HEALTH_PLAYER);
+    player_starts++;
+}
+
+static LatencyModel simLatency()
+{
+    return latency;
+}
+
+static UsageLog sim_log;
+
+static uint32_t simScan(uint32_t from_seq, UsageLogVisitor visit, void *ctx)
+{
+    return usageLogScan(&sim_log, from_seq, visit, ctx);
+}
+
+static void type(ConsoleLine *line, const char *text)
+{
+    char reply[CONSOLE_REPLY_MAX];
+    size_t len = strlen(text);
+    for (size_t i = 0; i <= len; i++)
+    {
+        if (consoleLinePush(line, i < len ? text[i] : '\n'))
+        {
+            ConsoleOut out;
+            consoleOutInit(&out, reply, sizeof(reply));
+            consoleRun(DIAG_COMMANDS, DIAG_COMMAND_COUNT, line->buf, &out);
+        }
+    }
+}
+
+// sim heap [sessions]
+//   Set up the portable parts of the firmware the way setup() does, arm the
+//   heap guard, then run sessions through them the way the render loop,
+//   the audio, BLE and usage tasks and the console do: cues, brightness,
+//   heartbeats, the companion following along and pulling the history,
+//   a record per session, console commands, the player dropping out and
+//   being started again, the latency model saved after each session. Not
+//   one allocation is allowed once armed, other than the NVS ones the
+//   firmware expects, and those only let the task expecting them through.
+int simHeap(int argc, char **argv)
+{
+    int sessions = argc >= 1 ? atoi(argv[0]) : 3;
+
+    // *** setup() *** //
+    SimFlash flash(SIM_HEAP_SECTORS, SIM_HEAP_SECTOR_SIZE);
+    usageLogBegin(&sim_log, &flash);
+    static Health health;
+    healthInit(&health, USAGE_RESET_POWER_ON);
+    QuietSink sink;
+    startPlayer(&sink, &health);
+    QuietLink link;
+    static Companion companion;
+    companionInit(&companion, &link, simScan);
+    companionConnected(&companion);
+    diagSetHealth(&health);
+    diagSetLatencySource(simLatency);
+    ConsoleLine line;
+    consoleLineInit(&line);
+    BrightnessRamp ramp;
+    brightnessRampInit(&ramp, 0, 0);
+    printf("set up, arming\n");
+    fflush(stdout);
+
+    heapGuardArm();
+    uint32_t now = 0;
+    uint32_t ticks = 0;
+    size_t next = 0;
+    for (int s = 0; s < sessions; s++)
+    {
+        sessionBegin(now);
+        audioCuesPhaseStarted(0, now);
+        healthWatch(&health, HEALTH_TASK_RENDER, config.tick_ms, now);
+        uint32_t start = now;
+        uint32_t pumped = now;
+        bool player_up = true;
+        bool player_lost = false;
+        for (;; now += config.tick_ms, ticks++)
+        {
+            for (; s == 0 && next < SCRIPT_LEN && SCRIPT[next].at_ms <= now - start; next++)
+            {
+                type(&line, SCRIPT[next].line);
+            }
+            DiagRequest req;
+            while (diagPollRequest(&req))
+            {
+                Config changed;
+                if (req.type == DIAG_REQ_PHASE)
+                {
+                    sessionJumpToPhase(req.value);
+                }
+                else if (req.type == DIAG_REQ_CONFIG && diagTakeConfig(&changed))
+                {
+                    config = changed;
+                }
+                diagTrace(now, DIAG_TRACE_REQUEST, req.type, req.value);
+            }
+
+            SessionFrame frame;
+            uint8_t event = sessionTick(now, &frame);
+            if (event == SESSION_FINISHED)
+            {
+                break;
+            }
+            if (event == SESSION_NEW_PHASE)
+            {
+                audioCuesPhaseStarted(sessionPhase(), now);
+                diagTrace(now, DIAG_TRACE_PHASE, sessionPhase(), 0);
+            }
+            // The player drops out halfway through the second session and the
+            //   audio task brings it back when the supervisor says so
+            if (s == 1 && !player_lost && now - start >= SIM_HEAP_PLAYER_LOST_MS)
+            {
+                player_lost = true;
+                player_up = false;
+                healthPeripheralFailed(&health, HEALTH_PLAYER, now);
+            }
+            if (!player_up && healthRetryDue(&health, HEALTH_PLAYER, now))
+            {
+                startPlayer(&sink, &health);
+                player_up = true;
+            }
+            if (player_up)
+            {
+                int32_t until_next = sessionMsUntilNextPhase(now, config.tick_ms);
+                audioCuesPredictNextPhase(until_next >= 0 ? now + until_next : AUDIO_TIME_UNKNOWN);
+                audioCuesPoll(now);
+            }
+            if (brightnessRampStep(&ramp, (now / 4000) % 2 ? 12 : 4, now))
+            {
+                diagTrace(now, DIAG_TRACE_INTENSITY, 0, ramp.current);
+            }
+            healthBeat(&health, HEALTH_TASK_RENDER, now);
+            healthCheck(&health, now);
+            diagTickTimes(120, 900);
+            DiagStatus status;
+            memset(&status, 0, sizeof(status));
+            status.now_ms = now;
+            status.phase = sessionPhase();
+            diagPublish(&status);
+
+            CompanionState state;
+            companionSessionState(&state, now, COMPANION_RUNNING);
+            companionSetState(&companion, &state);
+            for (; pumped + SIM_HEAP_PUMP_MS <= now; pumped += SIM_HEAP_PUMP_MS)
+            {
+                companionPump(&companion, pumped);
+            }
+        }
+
+        audioCuesStop();
+        // audioBackendSessionEnded(), the player having been measured again
+        latencyStatsAdd(&latency.block, 3);
+        latencyModelSave(&latency, &nvs);
+        UsageRecord record;
+        memset(&record, 0, sizeof(record));
+        record.type = USAGE_RECORD_SESSION;
+        const SessionStats *stats = sessionStats(now);
+        record.session.duration_ms = stats->duration_ms;
+        record.session.phases_done = stats->phases_done;
+        usageLogAppend(&sim_log, &record);
+        diagTrace(now, DIAG_TRACE_END, USAGE_COMPLETED, 0);
+
+        // The phone pulls the history after each session
+        uint8_t from[4] = {1, 0, 0, 0};
+        companionControl(&companion, from, sizeof(from));
+        for (uint32_t t = 0; t < 2000; t += SIM_HEAP_PUMP_MS)
+        {
+            companionPump(&companion, now + t);
+        }
+        now += 60000;
+    }
+
+    HeapGuardStats heap = heapGuardStats();
+
+    // Another task allocating while this one expects to is still counted
+    heapGuardExpect(true);
+    std::thread other([]() { free(malloc(SIM_HEAP_OTHER_SIZE)); });
+    other.join();
+    heapGuardExpect(false);
+    HeapGuardStats after = heapGuardStats();
+    bool other_counted = after.unexpected_bytes - heap.unexpected_bytes >= SIM_HEAP_OTHER_SIZE;
+
+    printf("%d sessions, %u ticks, %u player commands, %u notifications, %u records\n", sessions, ticks,
+           sink.commands, link.notifications, usageLogNextSeq(&sim_log) - 1);
+    printf("player started %u times, latency saved after each session\n", player_starts);
+    printf("heap after setup: %u allocations, %u bytes, %u expected", heap.unexpected, heap.unexpected_bytes,
+           heap.expected);
+    if (heap.unexpected > 0)
+    {
+        printf(", last %u from %p", heap.last_size, (void *)heap.last_from);
+    }
+    printf("\n");
+    printf("another thread's allocation inside an expected one: %s\n", other_counted ? "counted" : "LET THROUGH");
+
+    bool ok = other_counted && heap.unexpected == 0 && ticks > 0 && link.notifications > 0 && sink.commands > 0;
+    ok &= player_starts == 2 && heap.expected > 0;
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "sim.h"
+#include "holder.h"
+
+// The device's defaults, see config.cpp
+#define SIM_HOLDER_THRESHOLD 4000
+
+// Awake for the boot and setup (the player starting and calibrating),
+//   then the session until the brush goes back or it finishes, then the
+//   eyes closing. A wake with the brush still in the holder is just the
+//   boot and the close.
+#define SIM_HOLDER_BOOT_MS 3000
+#define SIM_HOLDER_SESSION_MS 120000
+#define SIM_HOLDER_CLOSE_MS 2000
+
+// Rough current draw. Asleep the RTC timer and memory take about 10 uA
+//   either way. The ULP and the ADC draw about 9 mA while it runs, going by
+//   the datasheet's 100 uA for a sensor watched at a 1% duty cycle, and a
+//   run with its ADC conversion takes about 200 us.
+#define SIM_HOLDER_AWAKE_MA 120
+#define SIM_HOLDER_SLEEP_UA 10
+#define SIM_HOLDER_ULP_UA 9000
+#define SIM_HOLDER_ULP_RUN_US 200
+
+// The synthetic night
+#define SIM_HOLDER_NIGHT_MS (12 * 3600 * 1000UL)
+#define SIM_HOLDER_IN 4060
+#define SIM_HOLDER_OUT 250
+#define SIM_HOLDER_NOISE 30
+#define SIM_HOLDER_KNOCKS 60
+
+typedef struct HolderSample
+{
+    uint32_t t_ms;
+    uint16_t reading;
+} HolderSample;
+
+static bool loadHolderTrace(const char *path, std::vector<HolderSample> &out)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        unsigned long t;
+        unsigned reading;
+        if (sscanf(line, "%lu,%u", &t, &reading) == 2)
+        {
+            out.push_back({(uint32_t)t, (uint16_t)reading});
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+typedef struct Lift
+{
+    uint32_t from_ms;
+    uint32_t to_ms;
+} Lift;
+
+// The brush in its holder all night, knocked now and then (a reading or
+//   two well down), and lifted out four times. The third time it stays
+//   out long after the session has finished, and goes back before it's
+//   lifted for the fourth.
+static void syntheticNight(std::vector<HolderSample> &out, std::vector<Lift> &lifts)
+{
+    lifts = {{3600000, 3750000}, {21600000, 22200000}, {22800000, 22950000}, {39600000, 39750000}};
+
+    srand(1);
+    std::vector<uint32_t> knocks;
+    for (int i = 0; i < SIM_HOLDER_KNOCKS; i++)
+    {
+        knocks.push_back((uint32_t)(rand() % (SIM_HOLDER_NIGHT_MS / HOLDER_SAMPLE_MS)) * HOLDER_SAMPLE_MS);
+    }
+
+    for (uint32_t t = 0; t < SIM_HOLDER_NIGHT_MS; t += HOLDER_SAMPLE_MS)
+    {
+        int level = SIM_HOLDER_IN;
+        for (const Lift &lift : lifts)
+        {
+            if (t >= lift.from_ms && t < lift.to_ms)
+            {
+                level = SIM_HOLDER_OUT;
+            }
+        }
+        for (uint32_t knock : knocks)
+        {
+            // One or two readings, somewhere between out and in
+            if (t >= knock && t < knock + (1 + knock / HOLDER_SAMPLE_MS % 2) * HOLDER_SAMPLE_MS)
+            {
+                level = 500 + knock % 2500;
+            }
+        }
+        level += rand() % (2 * SIM_HOLDER_NOISE + 1) - SIM_HOLDER_NOISE;
+        out.push_back({t, (uint16_t)(level < 0 ? 0 : level > 4095 ? 4095 : level)});
+    }
+}
+
+typedef struct WakeStats
+{
+    std::vector<uint32_t> wakes;
+    uint32_t awake_ms;
+    uint32_t asleep_ms;
+} WakeStats;
+
+// Sleep and wake through the trace. Asleep, the ULP's steps or a pin wake
+//   on the first reading on the lifted side; awake, the session ends when
+//   the brush is back or it has run its course.
+static WakeStats runNight(const std::vector<HolderSample> &trace, bool ulp)
+{
+    WakeStats stats = {{}, 0, 0};
+    HolderWatch watch;
+    holderWatchInit(&watch, SIM_HOLDER_THRESHOLD);
+    uint32_t awake_until = 0;
+    uint32_t session_from = 0;
+    uint32_t session_end = 0;
+    bool awake = false;
+    uint32_t last_ms = trace.empty() ? 0 : trace[0].t_ms;
+
+    for (const HolderSample &s : trace)
+    {
+        uint32_t step = s.t_ms - last_ms;
+        last_ms = s.t_ms;
+        if (awake)
+        {
+            stats.awake_ms += step;
+            bool back = s.reading > SIM_HOLDER_THRESHOLD;
+            if (session_end != 0 && s.t_ms >= session_from && (back || s.t_ms >= session_end))
+            {
+                awake_until = s.t_ms + SIM_HOLDER_CLOSE_MS;
+                session_end = 0;
+            }
+            if (session_end == 0 && s.t_ms >= awake_until)
+            {
+                awake = false;
+                holderWatchInit(&watch, SIM_HOLDER_THRESHOLD);
+            }
+            continue;
+        }
+
+        stats.asleep_ms += step;
+        bool wake = ulp ? holderWatchSample(&watch, s.reading) : s.reading <= SIM_HOLDER_THRESHOLD;
+        if (wake)
+        {
+            stats.wakes.push_back(s.t_ms);
+            awake = true;
+            session_from = s.t_ms + SIM_HOLDER_BOOT_MS;
+            session_end = session_from + SIM_HOLDER_SESSION_MS;
+            awake_until = 0;
+        }
+    }
+    return stats;
+}
+
+// Average over the trace, in uA
+static double averageCurrent(const WakeStats &stats, bool ulp)
+{
+    double sleep_ua = SIM_HOLDER_SLEEP_UA;
+    if (ulp)
+    {
+        sleep_ua += (double)SIM_HOLDER_ULP_UA * SIM_HOLDER_ULP_RUN_US / (HOLDER_SAMPLE_MS * 1000.0);
+    }
+    double total = (double)stats.awake_ms + stats.asleep_ms;
+    return (stats.awake_ms * SIM_HOLDER_AWAKE_MA * 1000.0 + stats.asleep_ms * sleep_ua) / total;
+}
+
+static void printStats(const char *name, const WakeStats &stats, bool ulp)
+{
+    printf("%s: %zu wakes, awake %.0f s, average %.1f uA\n", name, stats.wakes.size(), stats.awake_ms / 1000.0,
+           averageCurrent(stats, ulp));
+}
+
+// sim holder [trace.csv]
+//   Run a night of pressure sensor readings (ms,reading, one every
+//   HOLDER_SAMPLE_MS) past the ULP's holder watch and past a pin wake
+//   that takes the first reading it sees, and compare the wakes and the
+//   standby current. Without a trace, a made up night with knocks and four
+//   lifts, where the ULP has to wake for each lift and nothing else.
+//   Knocks are sampled here, a real pin wake also sees ones shorter than
+//   a reading.
+int simHolder(int argc, char **argv)
+{
+    std::vector<HolderSample> trace;
+    std::vector<Lift> lifts;
+    if (argc >= 1)
+    {
+        if (!loadHolderTrace(argv[0], trace))
+        {
+            fprintf(stderr, "can't read %s\n", argv[0]);
+            return 1;
+        }
+    }
+    else
+    {
+        syntheticNight(trace, lifts);
+    }
+
+    WakeStats pin = runNight(trace, false);
+    WakeStats ulp = runNight(trace, true);
+    printStats("pin", pin, false);
+    printStats("ulp", ulp, true);
+    printf("ulp woke at");
+    for (uint32_t t : ulp.wakes)
+    {
+        printf(" %.1f", t / 1000.0);
+    }
+    printf(" s\n");
+
+    if (lifts.empty())
+    {
+        return 0;
+    }
+
+    // Each lift from the holder wakes it, within the readings it takes to
+    //   confirm, and nothing else does. The brush left out after a session
+    //   doesn't wake it until it's been put back and lifted again.
+    bool ok = ulp.wakes.size() == lifts.size();
+    for (size_t i = 0; ok && i < lifts.size(); i++)
+    {
+        uint32_t latency = ulp.wakes[i] - lifts[i].from_ms;
+        ok &= ulp.wakes[i] >= lifts[i].from_ms && latency <= HOLDER_CONFIRM_SAMPLES * HOLDER_SAMPLE_MS;
+    }
+    ok &= pin.wakes.size() > lifts.size();
+    ok &= averageCurrent(ulp, true) < averageCurrent(pin, false);
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
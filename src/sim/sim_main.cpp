@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+
+typedef struct SimCommand
+{
+    const char *name;
+    int (*run)(int argc, char **argv);
+    const char *help;
+} SimCommand;
+
+static const SimCommand COMMANDS[] = {
+    {"imu", simImu, "imu <trace.csv>            classify a recorded IMU trace"},
+    {"session", simSession, "session [trace.csv]        run a session, optionally driven by a trace"},
+    {"audio", simAudio, "audio [lat] [jitter] [lead|auto] check cue timing against a player model"},
+    {"wav", simWav, "wav <clips_dir> <out.wav>  render a session through the I2S audio engine"},
+    {"text", simText, "text <message> [quiet]     scroll a message across the eyes"},
+    {"brightness", simBrightness, "brightness [light.csv]     follow a light trace, compare LED current"},
+    {"usagelog", simUsageLog, "usagelog [records] [cuts]  fill the usage log, cutting the power at random"},
+    {"export", simExport, "export [records] [errors]  pull the usage log over a noisy, interrupted link"},
+    {"ble", simBle, "ble [records] [mtu]        follow a session and fetch history over a mock BLE link"},
+    {"ota", simOta, "ota <old.bin> <patch> [new.bin] apply a delta patch over a lossy link"},
+    {"config", simConfig, "config [line...]           check stored settings, run console lines"},
+    {"console", simConsole, "console [quiet]            type console commands into a running session"},
+    {"health", simHealth, "health                     fail and recover peripherals and tasks, check the health record"},
+    {"dfplayer", simDfplayer, "dfplayer [quiet]           play a session through an emulated DFPlayer, pull its card"},
+    {"holder", simHolder, "holder [trace.csv]         watch the brush holder through a night, compare wakes"},
+    {"battery", simBattery, "battery [discharge.csv]    check the fuel gauge on a discharge, run the power policy"},
+    {"energy", simEnergy, "energy [tick] [intensity] [busy|sleep] [model.txt] break a session's energy down by part"},
+    {"present", simPresent, "present [tick_ms] [busy_ms]  time frames out by the loop and by a timer, race the double buffer"},
+    {"uptime", simUptime, "uptime [days]  fast-forward days of sessions across the 32-bit ms wrap"},
+    {"heap", simHeap, "heap [sessions]  run sessions after setup without touching the heap"},
+};
+
+static void usage()
+{
+    fprintf(stderr, "usage: program <command> [args]\n");
+    for (const SimCommand &cmd : COMMANDS)
+    {
+        fprintf(stderr, "  %s\n", cmd.help);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        usage();
+        return 2;
+    }
+
+    for (const SimCommand &cmd : COMMANDS)
+    {
+        if (strcmp(argv[1], cmd.name) == 0)
+        {
+            return cmd.run(argc - 2, argv + 2);
+        }
+    }
+
+    usage();
+    return 2;
+}
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "sim.h"
+#include "sim_flash.h"
+#include "crc32.h"
+#include "ota_update.h"
+
+// DATA commands as big as fit in a BLE write at the MTU we ask for
+#define SIM_OTA_CHUNK 240
+
+typedef std::vector<uint8_t> Bytes;
+
+static bool readFile(const char *path, Bytes &out)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    {
+        out.insert(out.end(), buf, buf + n);
+    }
+    fclose(f);
+    return true;
+}
+
+// The other app slot, in memory
+class SimSlot : public OtaSlot
+{
+public:
+    bool begin() override
+    {
+        image.clear();
+        open = true;
+        return true;
+    }
+
+    bool write(const uint8_t *data, size_t len) override
+    {
+        image.insert(image.end(), data, data + len);
+        return open;
+    }
+
+    bool finish() override
+    {
+        open = false;
+        booted = true;
+        return true;
+    }
+
+    void abort() override
+    {
+        open = false;
+        aborts++;
+    }
+
+    Bytes image;
+    bool open = false;
+    bool booted = false;
+    int aborts = 0;
+};
+
+typedef struct Transfer
+{
+    uint32_t commands;
+    uint32_t dropped;
+    uint32_t restarts;
+} Transfer;
+
+static uint32_t statusReceived(const uint8_t *status)
+{
+    return (uint32_t)status[2] | ((uint32_t)status[3] << 8) | ((uint32_t)status[4] << 16) | ((uint32_t)status[5] << 24);
+}
+
+static void command(OtaUpdate *update, const Bytes &cmd, uint8_t *status, Transfer *transfer)
+{
+    otaUpdateCommand(update, cmd.data(), cmd.size(), status);
+    transfer->commands++;
+}
+
+// Send the patch like the phone app would. Every drop_every'th DATA is
+//   lost, and the link goes down once at cut_at bytes, after which the
+//   transfer starts over with BEGIN.
+static uint8_t sendPatch(OtaUpdate *update, const Bytes &patch, uint32_t drop_every, long cut_at, Transfer *transfer)
+{
+    uint32_t crc = crc32(patch.data(), patch.size());
+    uint8_t status[OTA_STATUS_SIZE];
+
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        Bytes begin = {OTA_BEGIN};
+        for (int i = 0; i < 4; i++)
+        {
+            begin.push_back((patch.size() >> (8 * i)) & 0xFF);
+        }
+        for (int i = 0; i < 4; i++)
+        {
+            begin.push_back((crc >> (8 * i)) & 0xFF);
+        }
+        command(update, begin, status, transfer);
+
+        uint32_t offset = 0;
+        bool cut = false;
+        while (offset < patch.size() && status[0] == OTA_RECEIVING)
+        {
+            if (attempt == 0 && cut_at >= 0 && offset >= (uint32_t)cut_at)
+            {
+                cut = true;
+                break;
+            }
+
+            size_t n = patch.size() - offset < SIM_OTA_CHUNK ? patch.size() - offset : SIM_OTA_CHUNK;
+            Bytes data = {OTA_DATA, (uint8_t)offset, (uint8_t)(offset >> 8), (uint8_t)(offset >> 16),
+                          (uint8_t)(offset >> 24)};
+            data.insert(data.end(), patch.begin() + offset, patch.begin() + offset + n);
+
+            if (drop_every > 0 && (transfer->commands + 1) % drop_every == 0)
+            {
+                // Lost on the way, the next one arrives out of order and
+                //   the status says where to go back to
+                transfer->commands++;
+                transfer->dropped++;
+                offset += n;
+                continue;
+            }
+
+            command(update, data, status, transfer);
+            offset = statusReceived(status);
+        }
+        if (!cut)
+        {
+            break;
+        }
+        transfer->restarts++;
+    }
+
+    Bytes end = {OTA_END};
+    command(update, end, status, transfer);
+    return status[0] == OTA_READY ? 0 : status[1];
+}
+
+// sim ota <old.bin> <patch> [new.bin]
+//   Apply a delta patch from tools/delta_patch.cpp through the OTA command
+//   handler, the way it arrives over BLE: with lost writes and a dropped
+//   connection. The result must match new.bin if given. Then check a
+//   corrupted patch and a patch for the wrong image are both refused
+//   without switching the boot slot.
+int simOta(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: ota <old.bin> <patch> [new.bin]\n");
+        return 2;
+    }
+
+    Bytes old_image, patch, new_image;
+    if (!readFile(argv[0], old_image) || !readFile(argv[1], patch) || (argc >= 3 && !readFile(argv[2], new_image)))
+    {
+        fprintf(stderr, "can't read the images or the patch\n");
+        return 1;
+    }
+
+    // The running slot
+    SimFlash running(old_image.size() / 4096 + 1, 4096);
+    running.write(0, old_image.data(), old_image.size());
+
+    bool ok = true;
+    SimSlot slot;
+    static OtaUpdate update;
+
+    otaUpdateInit(&update, &slot, &running);
+    Transfer transfer = {0, 0, 0};
+    uint8_t error = sendPatch(&update, patch, 7, patch.size() / 2, &transfer);
+    printf("patch %zu bytes: %u commands, %u lost, %u restarts, %s\n", patch.size(), transfer.commands,
+           transfer.dropped, transfer.restarts, error == 0 ? "ready to boot" : "failed");
+    ok &= error == 0 && slot.booted;
+    if (!new_image.empty())
+    {
+        bool same = slot.image == new_image;
+        printf("image %zu bytes, %s new.bin\n", slot.image.size(), same ? "same as" : "DIFFERENT from");
+        ok &= same;
+    }
+
+    // One flipped bit in the middle of the patch
+    Bytes corrupt = patch;
+    corrupt[DELTA_HEADER_SIZE + (corrupt.size() - DELTA_HEADER_SIZE) / 2] ^= 0x10;
+    SimSlot slot2;
+    otaUpdateInit(&update, &slot2, &running);
+    transfer = {0, 0, 0};
+    error = sendPatch(&update, corrupt, 0, -1, &transfer);
+    printf("corrupted patch: error %u, %s\n", error, slot2.booted ? "BOOTED" : "not booted");
+    ok &= error != 0 && !slot2.booted;
+
+    // A unit running something else, one byte cleared. A full image
+    //   patch doesn't care what's running.
+    if (old_image.empty())
+    {
+        printf("%s\n", ok ? "ok" : "FAILED");
+        return ok ? 0 : 1;
+    }
+    size_t changed = old_image.size() / 3;
+    while (changed < old_image.size() - 1 && old_image[changed] == 0)
+    {
+        changed++;
+    }
+    uint8_t zero = 0;
+    running.write(changed, &zero, 1);
+    SimSlot slot3;
+    otaUpdateInit(&update, &slot3, &running);
+    transfer = {0, 0, 0};
+    error = sendPatch(&update, patch, 0, -1, &transfer);
+    printf("wrong source: error %u, %s\n", error, slot3.booted ? "BOOTED" : "not booted");
+    ok &= error == DELTA_WRONG_SOURCE && !slot3.booted;
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
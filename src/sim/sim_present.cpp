@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "sim.h"
+#include "config.h"
+#include "present.h"
+#include "session.h"
+
+// Same as the device, see main.cpp
+#define SIM_PRESENT_DEVICES 2
+
+// What a tick's work takes on the device: reading the sensors and the
+//   battery, the session, the brightness ramp. Now and then it also waits
+//   on the DFPlayer or the console for up to busy_ms.
+#define SIM_PRESENT_WORK_US 3000
+#define SIM_PRESENT_BUSY_PERMILLE 100
+
+// esp_timer's task wakes this long after the deadline, give or take the
+//   jitter, and a row takes this long on the wire (see energy_model.cpp)
+#define SIM_PRESENT_DISPATCH_US 50
+#define SIM_PRESENT_DISPATCH_JITTER_US 30
+#define SIM_PRESENT_ROW_US 10
+
+typedef struct PresentStats
+{
+    uint32_t frames;
+    uint32_t missed; // went out a tick or more late
+    double late_sum_us;
+    uint32_t late_max_us;
+} PresentStats;
+
+static void addLate(PresentStats *stats, int64_t late_us, uint32_t tick_us)
+{
+    late_us = late_us > 0 ? late_us : 0;
+    stats->frames++;
+    stats->late_sum_us += late_us;
+    stats->late_max_us = late_us > stats->late_max_us ? late_us : stats->late_max_us;
+    stats->missed += late_us >= tick_us;
+}
+
+static uint32_t workUs(uint32_t busy_ms)
+{
+    uint32_t us = SIM_PRESENT_WORK_US;
+    if (busy_ms > 0 && rand() % 1000 < SIM_PRESENT_BUSY_PERMILLE)
+    {
+        us += rand() % (busy_ms * 1000);
+    }
+    return us;
+}
+
+static uint32_t dispatchUs()
+{
+    return SIM_PRESENT_DISPATCH_US - SIM_PRESENT_DISPATCH_JITTER_US +
+           rand() % (2 * SIM_PRESENT_DISPATCH_JITTER_US + 1);
+}
+
+// Draw the session's frame for now_ms into back(), false once it's over
+static bool prepare(FramePresenter<SIM_PRESENT_DEVICES> *presenter, uint32_t now_ms)
+{
+    SessionFrame frame;
+    if (sessionTick(now_ms, &frame) == SESSION_FINISHED)
+    {
+        return false;
+    }
+    if (frame.left != NULL)
+    {
+        presenter->back().setDevice(0, frame.left);
+        presenter->back().setDevice(1, frame.right);
+    }
+    return true;
+}
+
+// Send what take() brought in, in us
+static uint32_t send(FramePresenter<SIM_PRESENT_DEVICES> *presenter)
+{
+    uint32_t us = __builtin_popcount(presenter->front().dirtyRows()) * SIM_PRESENT_ROW_US;
+    presenter->front().markClean();
+    return us;
+}
+
+// A session on virtual time, the way the loop used to do it: wait for the
+//   deadline, do the tick's work, send the frame at the end of it
+static PresentStats runLoopDriven(uint32_t tick_ms, uint32_t busy_ms)
+{
+    PresentStats stats = {0, 0, 0, 0};
+    FramePresenter<SIM_PRESENT_DEVICES> presenter;
+    srand(1);
+    sessionBegin(0);
+    int64_t now_us = 0;
+    for (uint32_t due = tick_ms;; due += tick_ms)
+    {
+        int64_t due_us = (int64_t)due * 1000;
+        now_us = now_us > due_us ? now_us : due_us;
+        now_us += workUs(busy_ms);
+        if (!prepare(&presenter, due))
+        {
+            break;
+        }
+        presenter.publish();
+        presenter.take();
+        now_us += send(&presenter);
+        addLate(&stats, now_us - due_us, tick_ms * 1000);
+    }
+    return stats;
+}
+
+// The same with the timer: the loop prepares each frame a tick ahead, as
+//   soon as the one before has gone out, and the timer sends it at its
+//   deadline
+static PresentStats runTimerDriven(uint32_t tick_ms, uint32_t busy_ms)
+{
+    PresentStats stats = {0, 0, 0, 0};
+    FramePresenter<SIM_PRESENT_DEVICES> presenter;
+    srand(1);
+    sessionBegin(0);
+    int64_t ready_us = 0;
+    for (uint32_t due = tick_ms;; due += tick_ms)
+    {
+        int64_t due_us = (int64_t)due * 1000;
+        int64_t published_us = ready_us + workUs(busy_ms);
+        if (!prepare(&presenter, due))
+        {
+            break;
+        }
+        presenter.publish();
+        int64_t fire_us = (published_us > due_us ? published_us : due_us) + dispatchUs();
+        presenter.take();
+        ready_us = fire_us + send(&presenter);
+        addLate(&stats, ready_us - due_us, tick_ms * 1000);
+    }
+    return stats;
+}
+
+static void printStats(const char *name, const PresentStats *s)
+{
+    printf("%s: %u frames, late mean %.0f us, max %u us, %u a tick or more late\n", name, s->frames,
+           s->frames > 0 ? s->late_sum_us / s->frames : 0.0, s->late_max_us, s->missed);
+}
+
+// The render side and the presenting side on two threads as fast as they
+//   go. Every frame is one number in every row, the intensity its low bits,
+//   so a frame taken half drawn or one skipped shows.
+static bool stress()
+{
+    static FramePresenter<SIM_PRESENT_DEVICES> presenter;
+    std::atomic<bool> stop(false);
+    uint32_t taken = 0, torn = 0, skipped = 0;
+
+    std::thread renderer([&]() {
+        for (uint32_t i = 1; !stop.load(std::memory_order_relaxed);)
+        {
+            if (!presenter.ready())
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            for (uint8_t r = 0; r < 8; r++)
+            {
+                for (uint8_t d = 0; d < SIM_PRESENT_DEVICES; d++)
+                {
+                    presenter.back().setRow(d, r, (uint8_t)i);
+                }
+            }
+            presenter.setIntensity(i & 0x0F);
+            presenter.publish();
+            i++;
+        }
+    });
+
+    uint8_t last = 0;
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        if (!presenter.take())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        uint8_t v = presenter.front().getRow(0, 0);
+        for (uint8_t r = 0; r < 8; r++)
+        {
+            for (uint8_t d = 0; d < SIM_PRESENT_DEVICES; d++)
+            {
+                torn += presenter.front().getRow(d, r) != v;
+            }
+        }
+        torn += presenter.intensity != (v & 0x0F);
+        skipped += v != (uint8_t)(last + 1);
+        last = v;
+        taken++;
+    }
+    stop = true;
+    renderer.join();
+
+    printf("stress: %u frames taken, %u torn, %u skipped\n", taken, torn, skipped);
+    return taken > 0 && torn == 0 && skipped == 0;
+}
+
+// sim present [tick_ms] [busy_ms]
+//   Run a session's frames out to the eyes the way the loop used to, each
+//   at the end of its tick's work, and the way the timer does, at its
+//   deadline with the frame prepared a tick ahead, and compare how late
+//   they go out. Ticks sometimes wait on the player or the console for up
+//   to busy_ms. With the timer, work that fits in a tick mustn't make a
+//   frame late by more than the timer's own dispatch. Then race the double
+//   buffer's two sides on threads.
+int simPresent(int argc, char **argv)
+{
+    uint32_t tick_ms = argc >= 1 ? atoi(argv[0]) : config.tick_ms;
+    uint32_t busy_ms = argc >= 2 ? atoi(argv[1]) : 120;
+    if (tick_ms == 0)
+    {
+        fprintf(stderr, "tick_ms must be above 0\n");
+        return 1;
+    }
+
+    PresentStats loop = runLoopDriven(tick_ms, busy_ms);
+    PresentStats timer = runTimerDriven(tick_ms, busy_ms);
+    printStats("loop", &loop);
+    printStats("timer", &timer);
+    bool ok = stress();
+
+    uint32_t worst_us = SIM_PRESENT_WORK_US + busy_ms * 1000;
+    if (worst_us < tick_ms * 1000UL)
+    {
+        ok &= timer.late_max_us < 1000 && timer.missed == 0 && timer.late_max_us < loop.late_max_us;
+    }
+    ok &= timer.frames == loop.frames;
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
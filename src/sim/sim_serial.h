@@ -0,0 +1,68 @@
+#ifndef SIM_SERIAL_H
+#define SIM_SERIAL_H
+
+#include <stdint.h>
+#include <deque>
+
+// One direction of a UART, 8N1, on the simulator's clock in us. Bytes
+//   arrive one after the other at the baud rate, however fast they were
+//   written. A byte can be set to arrive damaged.
+class SimSerial
+{
+public:
+    explicit SimSerial(uint32_t baud) : byte_us((10 * 1000000UL + baud / 2) / baud) {}
+
+    void write(const uint8_t *data, size_t len, uint64_t at_us)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            free_us = (at_us > free_us ? at_us : free_us) + byte_us;
+            uint8_t b = data[i];
+            if (written == corrupt_at)
+            {
+                b ^= corrupt_mask;
+            }
+            written++;
+            bytes.push_back({free_us, b});
+        }
+    }
+
+    // When the next byte arrives, UINT64_MAX if nothing is on the way
+    uint64_t nextArrival() const { return bytes.empty() ? UINT64_MAX : bytes.front().at_us; }
+
+    // The next byte if it has arrived by now_us, else -1
+    int read(uint64_t now_us)
+    {
+        if (bytes.empty() || bytes.front().at_us > now_us)
+        {
+            return -1;
+        }
+        uint8_t b = bytes.front().value;
+        bytes.pop_front();
+        return b;
+    }
+
+    // Flip mask in the index'th byte written from now on (counting from 0)
+    void corrupt(uint64_t index, uint8_t mask)
+    {
+        corrupt_at = index;
+        corrupt_mask = mask;
+    }
+
+    const uint32_t byte_us;
+    uint64_t written = 0;
+
+private:
+    typedef struct Byte
+    {
+        uint64_t at_us;
+        uint8_t value;
+    } Byte;
+
+    std::deque<Byte> bytes;
+    uint64_t free_us = 0;
+    uint64_t corrupt_at = UINT64_MAX;
+    uint8_t corrupt_mask = 0;
+};
+
+#endif
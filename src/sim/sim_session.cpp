@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "sim.h"
+#include "imu_trace.h"
+#include "session.h"
+
+// Display tick, same as the delay() in loop()
+#define SIM_TICK_MS 250
+
+// Replay state for the trace-driven activity source
+static std::vector<TraceSample> sim_trace;
+static size_t sim_trace_pos = 0;
+static uint32_t sim_trace_offset = 0;
+static BrushMotion sim_motion;
+
+// Feed the detector every trace sample up to the current virtual time.
+//   Past the end of the trace the brush is considered put down.
+static BrushState traceActivity(uint32_t now_ms)
+{
+    while (sim_trace_pos < sim_trace.size() && sim_trace[sim_trace_pos].t_ms - sim_trace_offset <= now_ms)
+    {
+        brushMotionPush(&sim_motion, &sim_trace[sim_trace_pos].sample);
+        sim_trace_pos++;
+    }
+
+    BrushState st = sim_motion.state;
+    if (sim_trace_pos >= sim_trace.size())
+    {
+        st.brushing = false;
+    }
+    return st;
+}
+
+// sim session [trace.csv]
+//   Run one brushing session on virtual time and print when each phase
+//   starts. With a trace, the brushing phases are timed from the replayed
+//   activity, otherwise every phase runs for its fixed duration.
+int simSession(int argc, char **argv)
+{
+    if (argc >= 1)
+    {
+        if (!loadImuTrace(argv[0], sim_trace) || sim_trace.empty())
+        {
+            fprintf(stderr, "can't read %s\n", argv[0]);
+            return 1;
+        }
+        sim_trace_offset = sim_trace[0].t_ms;
+        brushMotionInit(&sim_motion);
+        sessionSetActivitySource(traceActivity);
+    }
+
+    uint32_t now = 0;
+    sessionBegin(now);
+    printf("t_s,phase\n%.2f,0\n", 0.0);
+
+    // A session can't take longer than every phase at its maximum
+    const uint32_t limit = 60UL * 60UL * 1000UL;
+    for (; now < limit; now += SIM_TICK_MS)
+    {
+        SessionFrame frame;
+        uint8_t event = sessionTick(now, &frame);
+
+        if (event == SESSION_NEW_PHASE)
+        {
+            printf("%.2f,%d\n", now / 1000.0, sessionPhase());
+        }
+        else if (event == SESSION_FINISHED)
+        {
+            printf("%.2f,done\n", now / 1000.0);
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "session didn't finish\n");
+    return 1;
+}
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "sim.h"
+#include "framebuffer.h"
+#include "text.h"
+
+// The eyes, two matrices side by side
+#define SIM_TEXT_DEVICES 2
+// Frame rate the cost is reported against
+#define SIM_TEXT_FPS 30
+
+static void printFramebuffer(const Framebuffer<SIM_TEXT_DEVICES> &fb)
+{
+    for (uint8_t r = 0; r < 8; r++)
+    {
+        for (uint16_t x = 0; x < fb.WIDTH; x++)
+        {
+            putchar(fb.getPixel(x, r) ? '#' : '.');
+        }
+        putchar('\n');
+    }
+    putchar('\n');
+}
+
+// sim text <message> [quiet]
+//   Scroll a message across the eyes in the 3x5 font, printing every frame,
+//   then time the scroll without printing and report the cost per frame
+int simText(int argc, char **argv)
+{
+    if (argc < 1)
+    {
+        fprintf(stderr, "usage: text <message> [quiet]\n");
+        return 2;
+    }
+    bool quiet = argc >= 2;
+
+    static TextScroller scroller;
+    Framebuffer<SIM_TEXT_DEVICES> fb;
+
+    // Vertically centred
+    int16_t y = (8 - FONT_3X5.height) / 2;
+
+    int frames = 0;
+    textScrollBegin(&scroller, &FONT_3X5, argv[0], y, fb.WIDTH);
+    do
+    {
+        textScrollDraw(&scroller, fb);
+        if (!quiet)
+        {
+            printFramebuffer(fb);
+        }
+        frames++;
+    } while (textScrollStep(&scroller));
+
+    const int repeats = 10000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+    {
+        textScrollBegin(&scroller, &FONT_3X5, argv[0], y, fb.WIDTH);
+        do
+        {
+            textScrollDraw(&scroller, fb);
+            fb.markClean();
+        } while (textScrollStep(&scroller));
+    }
+    double total_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    double frame_us = total_us / repeats / frames;
+
+    printf("%d frames, %.3f us per frame on this host, %.4f%% of a %d fps frame\n",
+           frames, frame_us, frame_us * SIM_TEXT_FPS / 1e4, SIM_TEXT_FPS);
+    return 0;
+}
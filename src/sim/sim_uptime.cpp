@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "sim.h"
+#include "sim_clock.h"
+#include "brightness.h"
+#include "config.h"
+#include "health.h"
+#include "session.h"
+
+// A session this often, the clock jumping over the hours between
+#define SIM_UPTIME_SESSION_EVERY_MS (12 * 3600 * 1000LL)
+
+// The session in the middle starts this long before 32-bit milliseconds
+//   wrap, so the wrap falls partway through it
+#define SIM_UPTIME_WRAP_LEAD_MS 60000LL
+#define SIM_UPTIME_WRAP_MS (1LL << 32)
+
+// How a session went, every time relative to its start
+typedef struct UptimeSession
+{
+    std::vector<uint32_t> phase_ms; // each phase's first frame
+    uint32_t frames;
+    uint32_t duration_ms;
+    uint32_t ramped_ms; // the brightness ramp reaching full
+} UptimeSession;
+
+static bool sameSession(const UptimeSession *a, const UptimeSession *b)
+{
+    return a->phase_ms == b->phase_ms && a->frames == b->frames && a->duration_ms == b->duration_ms &&
+           a->ramped_ms == b->ramped_ms;
+}
+
+// One session from wherever the clock is, ticking like the device's loop:
+//   the session, the brightness ramp and the render task's heartbeat all on
+//   clockMs32(), the clock a tick on each time round
+static UptimeSession runSession(Health *health, uint32_t tick_ms)
+{
+    UptimeSession s = {{}, 0, 0, 0};
+    uint32_t start = clockMs32();
+    BrightnessRamp ramp;
+    brightnessRampInit(&ramp, 0, start);
+    healthWatch(health, HEALTH_TASK_RENDER, tick_ms, start);
+    sessionBegin(start);
+
+    for (;;)
+    {
+        uint32_t now = clockMs32();
+        SessionFrame frame;
+        uint8_t result = sessionTick(now, &frame);
+        if (result == SESSION_FINISHED)
+        {
+            break;
+        }
+        if (result == SESSION_NEW_PHASE)
+        {
+            s.phase_ms.push_back(now - start);
+        }
+        s.frames += frame.left != NULL;
+        if (brightnessRampStep(&ramp, 15, now) && ramp.current == 15)
+        {
+            s.ramped_ms = now - start;
+        }
+        healthBeat(health, HEALTH_TASK_RENDER, now);
+        healthCheck(health, now);
+        simClockAdvance(tick_ms * 1000LL);
+    }
+    s.duration_ms = sessionStats(clockMs32())->duration_ms;
+    healthWatch(health, HEALTH_TASK_RENDER, 0, clockMs32());
+    return s;
+}
+
+// sim uptime [days]
+//   Fast-forward the clock through days of uptime with a session every 12
+//   hours. The clock starts so that the session in the middle (or at 49
+//   days in a longer run) runs across the wrap of 32-bit milliseconds,
+//   the sign bit having gone over days before. Every session has to come out the same as the first, to the
+//   millisecond, with no stall taken for the render task, and the 64-bit
+//   clock has to end up exactly where it should.
+int simUptime(int argc, char **argv)
+{
+    int days = argc >= 1 ? atoi(argv[0]) : 60;
+    if (days <= 0)
+    {
+        fprintf(stderr, "days must be above 0\n");
+        return 1;
+    }
+
+    int64_t span_ms = days * 24 * 3600 * 1000LL;
+    int sessions = (int)(span_ms / SIM_UPTIME_SESSION_EVERY_MS);
+    // The wrap in the middle session, or as far in as the clock starting
+    //   at 0 allows
+    int64_t wrap_at_ms = SIM_UPTIME_WRAP_MS - SIM_UPTIME_WRAP_LEAD_MS;
+    int64_t middle = sessions / 2 < wrap_at_ms / SIM_UPTIME_SESSION_EVERY_MS ? sessions / 2
+                                                                             : wrap_at_ms / SIM_UPTIME_SESSION_EVERY_MS;
+    int64_t start_ms = wrap_at_ms - middle * SIM_UPTIME_SESSION_EVERY_MS;
+    simClockSet(start_ms * 1000);
+
+    Health health;
+    healthInit(&health, 0);
+    UptimeSession first;
+    bool ok = true;
+    int differ = 0, wrapped_in = -1;
+    int64_t last_ms = clockMs();
+    for (int i = 0; i < sessions; i++)
+    {
+        int64_t at_ms = start_ms + i * SIM_UPTIME_SESSION_EVERY_MS;
+        simClockSet(at_ms * 1000);
+        UptimeSession s = runSession(&health, config.tick_ms);
+        if (at_ms < SIM_UPTIME_WRAP_MS && clockMs() >= SIM_UPTIME_WRAP_MS)
+        {
+            wrapped_in = i;
+        }
+        if (i == 0)
+        {
+            first = s;
+        }
+        else if (!sameSession(&s, &first))
+        {
+            differ++;
+            printf("session %d at %.2f days differs: %zu phases, %u frames, %u ms\n", i, at_ms / 86400000.0,
+                   s.phase_ms.size(), s.frames, s.duration_ms);
+        }
+        ok &= clockMs() > last_ms && clockMs() - at_ms == (int64_t)s.duration_ms;
+        last_ms = clockMs();
+    }
+    simClockSet((start_ms + span_ms) * 1000);
+
+    const TaskHealth *render = &health.tasks[HEALTH_TASK_RENDER];
+    printf("%d days from %.2f days of uptime: %d sessions of %u ms, %zu phases, %u frames\n", days,
+           start_ms / 86400000.0, sessions, first.duration_ms, first.phase_ms.size(), first.frames);
+    printf("32-bit ms wrapped during session %d; %d sessions differ, %u stalls, longest beat gap %u ms\n", wrapped_in,
+           differ, render->stalls, render->max_gap_ms);
+    printf("clock at %.2f days\n", clockMs() / 86400000.0);
+
+    ok &= sessions > 0 && differ == 0 && render->stalls == 0 && render->max_gap_ms <= config.tick_ms;
+    ok &= wrapped_in == middle;
+    ok &= clockMs() == start_ms + span_ms;
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
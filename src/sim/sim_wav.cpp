@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+#include "session.h"
+#include "audio_cues.h"
+#include "audio_engine.h"
+
+#define SIM_TICK_MS 250
+#define SIM_AUDIO_POLL_MS 5
+#define SIM_FRAMES_PER_POLL (AUDIO_ENGINE_RATE * SIM_AUDIO_POLL_MS / 1000)
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, v & 0xFFFF);
+    put16(p + 2, v >> 16);
+}
+
+static void writeWavHeader(FILE *f, uint32_t samples)
+{
+    uint8_t h[44];
+    uint32_t data_bytes = samples * 2;
+    memcpy(h, "RIFF", 4);
+    put32(h + 4, 36 + data_bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put32(h + 16, 16);
+    put16(h + 20, 1); // PCM
+    put16(h + 22, 1); // mono
+    put32(h + 24, AUDIO_ENGINE_RATE);
+    put32(h + 28, AUDIO_ENGINE_RATE * 2);
+    put16(h + 32, 2);
+    put16(h + 34, 16);
+    memcpy(h + 36, "data", 4);
+    put32(h + 40, data_bytes);
+    fwrite(h, 1, sizeof(h), f);
+}
+
+// sim wav <clips_dir> <out.wav>
+//   Run a session with the onboard audio engine playing the clips in
+//   clips_dir (same layout as the LittleFS image) and render what the I2S
+//   output would play into a WAV file. Each poll's audio is rendered right
+//   after the poll, so commands are heard within one poll interval.
+int simWav(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: wav <clips_dir> <out.wav>\n");
+        return 2;
+    }
+
+    FILE *out = fopen(argv[1], "wb");
+    if (out == NULL)
+    {
+        fprintf(stderr, "can't write %s\n", argv[1]);
+        return 1;
+    }
+    writeWavHeader(out, 0);
+
+    AudioEngine engine(argv[0]);
+    audioCuesBegin(&engine, SIM_AUDIO_POLL_MS);
+
+    uint32_t now = 0;
+    sessionBegin(now);
+    audioCuesPhaseStarted(0, now);
+
+    int16_t buf[SIM_FRAMES_PER_POLL];
+    uint32_t samples = 0;
+    uint32_t next_tick = SIM_TICK_MS;
+    const uint32_t limit = 60UL * 60UL * 1000UL;
+    for (; now < limit; now += SIM_AUDIO_POLL_MS)
+    {
+        if (now == next_tick)
+        {
+            next_tick += SIM_TICK_MS;
+
+            SessionFrame frame;
+            uint8_t event = sessionTick(now, &frame);
+            if (event == SESSION_FINISHED)
+            {
+                break;
+            }
+            if (event == SESSION_NEW_PHASE)
+            {
+                audioCuesPhaseStarted(sessionPhase(), now);
+                printf("%.3f s phase %d\n", now / 1000.0, sessionPhase());
+            }
+
+            int32_t until_next = sessionMsUntilNextPhase(now, SIM_TICK_MS);
+            if (until_next >= 0)
+            {
+                audioCuesPredictNextPhase(now + until_next);
+            }
+        }
+
+        while (engine.popFinished())
+        {
+            audioCuesTrackFinished(now);
+        }
+        audioCuesPoll(now);
+
+        engine.render(buf, SIM_FRAMES_PER_POLL);
+        fwrite(buf, sizeof(int16_t), SIM_FRAMES_PER_POLL, out);
+        samples += SIM_FRAMES_PER_POLL;
+    }
+
+    fseek(out, 0, SEEK_SET);
+    writeWavHeader(out, samples);
+    fclose(out);
+
+    fprintf(stderr, "%u samples (%.1f s), %u clips missing\n", samples, (double)samples / AUDIO_ENGINE_RATE,
+            engine.missingClips());
+    return 0;
+}
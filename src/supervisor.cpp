@@ -0,0 +1,135 @@
+#include <Arduino.h>
+#include "esp_system.h"
+#include "esp_task_wdt.h"
+#include "supervisor.h"
+#include "diag.h"
+#include "usage.h"
+#include "clock.h"
+#include "heap_guard.h"
+#include "static_task.h"
+
+// *** Supervisor task *** //
+// Above everything it watches, so it still runs when they don't
+#define SUPERVISOR_TASK_STACK 2048
+#define SUPERVISOR_TASK_PRIORITY 4
+#define SUPERVISOR_TASK_CORE 0
+
+static StaticTask<SUPERVISOR_TASK_STACK> supervisor_task;
+static Health health;
+
+static uint8_t resetReason()
+{
+    switch (esp_reset_reason())
+    {
+    case ESP_RST_POWERON:
+        return USAGE_RESET_POWER_ON;
+    case ESP_RST_DEEPSLEEP:
+        return USAGE_RESET_DEEP_SLEEP;
+    case ESP_RST_SW:
+        return USAGE_RESET_SOFTWARE;
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+        return USAGE_RESET_WATCHDOG;
+    case ESP_RST_PANIC:
+        return USAGE_RESET_PANIC;
+    case ESP_RST_BROWNOUT:
+        return USAGE_RESET_BROWNOUT;
+    default:
+        return USAGE_RESET_OTHER;
+    }
+}
+
+static void supervisorTask(void *arg)
+{
+    const TickType_t period = pdMS_TO_TICKS(SUPERVISOR_CHECK_MS);
+    TickType_t last_wake = xTaskGetTickCount();
+    uint32_t heap_seen = 0;
+
+    while (true)
+    {
+        vTaskDelayUntil(&last_wake, period);
+
+        uint32_t now = clockMs32();
+        uint8_t stalled = healthCheck(&health, now);
+        for (int t = 0; t < HEALTH_TASKS; t++)
+        {
+            if (stalled & (1 << t))
+            {
+                diagTrace(now, DIAG_TRACE_STALL, t, 0);
+            }
+        }
+
+        // Something took from the heap since the last check
+        HeapGuardStats heap = heapGuardStats();
+        if (heap.unexpected != heap_seen)
+        {
+            heap_seen = heap.unexpected;
+            diagTrace(now, DIAG_TRACE_HEAP, 0, heap.last_size > INT16_MAX ? INT16_MAX : heap.last_size);
+        }
+    }
+}
+
+bool supervisorBegin()
+{
+    healthInit(&health, resetReason());
+    diagSetHealth(&health);
+
+    // Arduino starts the watchdog watching the idle task on core 0, keep
+    //   that and give it our timeout
+    esp_task_wdt_config_t wdt = {SUPERVISOR_WDT_TIMEOUT_MS, 1 << 0, true};
+    if (esp_task_wdt_reconfigure(&wdt) == ESP_ERR_INVALID_STATE)
+    {
+        esp_task_wdt_init(&wdt);
+    }
+
+    return supervisor_task.start(supervisorTask, "supervisor", SUPERVISOR_TASK_PRIORITY, SUPERVISOR_TASK_CORE);
+}
+
+void supervisorWatch(uint8_t task, uint32_t period_ms)
+{
+    esp_task_wdt_add(NULL);
+    healthWatch(&health, task, period_ms, clockMs32());
+}
+
+void supervisorBeat(uint8_t task)
+{
+    esp_task_wdt_reset();
+    healthBeat(&health, task, clockMs32());
+}
+
+void supervisorPeripheralUp(uint8_t peripheral)
+{
+    bool was_up = health.peripherals[peripheral].up;
+    healthPeripheralUp(&health, peripheral);
+    if (!was_up)
+    {
+        diagTrace(clockMs32(), DIAG_TRACE_PERIPHERAL, peripheral, 1);
+    }
+}
+
+void supervisorPeripheralFailed(uint8_t peripheral)
+{
+    const PeripheralHealth *ph = &health.peripherals[peripheral];
+    bool newly = ph->up || ph->failures == 0;
+    healthPeripheralFailed(&health, peripheral, clockMs32());
+    if (newly)
+    {
+        diagTrace(clockMs32(), DIAG_TRACE_PERIPHERAL, peripheral, 0);
+    }
+}
+
+bool supervisorRetryDue(uint8_t peripheral)
+{
+    return healthRetryDue(&health, peripheral, clockMs32());
+}
+
+void supervisorRecord()
+{
+    if (healthNoteworthy(&health))
+    {
+        UsageHealth record;
+        healthRecord(&health, clockMs32(), &record);
+        usageRecordHealth(&record);
+    }
+}
@@ -0,0 +1,100 @@
+#include <string.h>
+#include "text.h"
+
+// Index of the byte holding pixel x, rounding down for negative x
+static int16_t byteIndex(int16_t x)
+{
+    return x >= 0 ? x / 8 : -((7 - x) / 8);
+}
+
+static void orByte(uint8_t *row, uint8_t stride, int16_t i, uint8_t value)
+{
+    if (i >= 0 && i < stride)
+    {
+        row[i] |= value;
+    }
+}
+
+uint16_t textWidth(const Font *font, const char *s)
+{
+    uint16_t width = 0;
+    for (; *s != '\0'; s++)
+    {
+        uint8_t w = FONT_GLYPH_WIDTH(fontGlyph(font, *s));
+        if (w > 0)
+        {
+            width += w + font->spacing;
+        }
+    }
+    return width > 0 ? width - font->spacing : 0;
+}
+
+int16_t textDraw(const Font *font, const char *s, int16_t x, int16_t y, uint8_t *rows, uint8_t stride, uint8_t height)
+{
+    for (; *s != '\0'; s++)
+    {
+        uint32_t glyph = fontGlyph(font, *s);
+        uint8_t w = FONT_GLYPH_WIDTH(glyph);
+        if (w == 0)
+        {
+            continue;
+        }
+
+        int16_t i = byteIndex(x);
+        uint8_t shift = x - i * 8;
+        for (uint8_t r = 0; r < font->height; r++)
+        {
+            int16_t row_y = y + r;
+            if (row_y < 0 || row_y >= height)
+            {
+                continue;
+            }
+
+            // Line the glyph row up with the top of 16 bits, then move it
+            //   right to where x falls in the first byte
+            uint16_t bits = (uint16_t)(fontGlyphRow(font, glyph, r) << (16 - font->width)) >> shift;
+            uint8_t *row = rows + row_y * stride;
+            orByte(row, stride, i, bits >> 8);
+            orByte(row, stride, i + 1, bits & 0xFF);
+        }
+
+        x += w + font->spacing;
+    }
+    return x;
+}
+
+uint8_t textWindow(const uint8_t *row, uint8_t stride, int16_t x)
+{
+    int16_t i = byteIndex(x);
+    uint8_t shift = x - i * 8;
+
+    uint8_t hi = (i >= 0 && i < stride) ? row[i] : 0;
+    if (shift == 0)
+    {
+        return hi;
+    }
+    uint8_t lo = (i + 1 >= 0 && i + 1 < stride) ? row[i + 1] : 0;
+    return (uint8_t)(hi << shift) | (lo >> (8 - shift));
+}
+
+void textScrollBegin(TextScroller *scroller, const Font *font, const char *s, int16_t y, uint16_t view_width)
+{
+    memset(scroller->rows, 0, sizeof(scroller->rows));
+    textDraw(font, s, 0, y, &scroller->rows[0][0], sizeof(scroller->rows[0]), 8);
+
+    scroller->width = textWidth(font, s);
+    if (scroller->width > TEXT_SCROLL_MAX_WIDTH)
+    {
+        scroller->width = TEXT_SCROLL_MAX_WIDTH;
+    }
+    scroller->x = -(int16_t)view_width;
+}
+
+bool textScrollStep(TextScroller *scroller)
+{
+    if (scroller->x < (int16_t)scroller->width)
+    {
+        scroller->x++;
+    }
+    return scroller->x < (int16_t)scroller->width;
+}
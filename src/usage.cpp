@@ -0,0 +1,167 @@
+#include <Arduino.h>
+#include <string.h>
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_sleep.h"
+#include "partition_region.h"
+#include "usage.h"
+#include "clock.h"
+#include "static_task.h"
+
+// *** Writer task *** //
+#define USAGE_TASK_STACK 3072
+#define USAGE_TASK_PRIORITY 1
+#define USAGE_TASK_CORE 0
+#define USAGE_QUEUE_LENGTH 4
+
+// Flash writes stall both cores while the cache is off, a few ms per record
+//   and around 45 ms for a sector erase, so records are only written at the
+//   end of a session while the eyes close rather than mid-animation.
+
+static PartitionRegion usage_flash;
+static UsageLog usage_log;
+static SemaphoreHandle_t usage_mutex = NULL;
+static QueueHandle_t usage_queue = NULL;
+static StaticMutex usage_mutex_mem;
+static StaticQueue<UsageRecord, USAGE_QUEUE_LENGTH> usage_queue_mem;
+static StaticTask<USAGE_TASK_STACK> usage_task;
+
+static volatile uint32_t usage_queued = 0;
+static volatile uint32_t usage_written = 0;
+static uint8_t usage_wake = USAGE_WAKE_POWER_ON;
+
+static void usageTask(void *arg)
+{
+    while (true)
+    {
+        UsageRecord record;
+        if (xQueueReceive(usage_queue, &record, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+
+        xSemaphoreTake(usage_mutex, portMAX_DELAY);
+        usageLogAppend(&usage_log, &record);
+        xSemaphoreGive(usage_mutex);
+
+        usage_written++;
+    }
+}
+
+static uint8_t wakeReason()
+{
+    switch (esp_sleep_get_wakeup_cause())
+    {
+    case ESP_SLEEP_WAKEUP_UNDEFINED:
+        return USAGE_WAKE_POWER_ON;
+    case ESP_SLEEP_WAKEUP_ULP:
+    case ESP_SLEEP_WAKEUP_EXT1:
+        return USAGE_WAKE_SENSOR;
+    default:
+        return USAGE_WAKE_OTHER;
+    }
+}
+
+bool usageBegin()
+{
+    usage_wake = wakeReason();
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           (esp_partition_subtype_t)USAGE_PARTITION_SUBTYPE,
+                                                           USAGE_PARTITION_LABEL);
+    if (part == NULL)
+    {
+        return false;
+    }
+
+    usage_flash.setPartition(part);
+    if (!usageLogBegin(&usage_log, &usage_flash))
+    {
+        return false;
+    }
+
+    usage_mutex = usage_mutex_mem.create();
+    usage_queue = usage_queue_mem.create();
+    return usage_task.start(usageTask, "usage", USAGE_TASK_PRIORITY, USAGE_TASK_CORE);
+}
+
+static void queueRecord(UsageRecord *record)
+{
+    if (xQueueSend(usage_queue, record, 0) == pdTRUE)
+    {
+        usage_queued++;
+    }
+}
+
+void usageRecordSession(uint8_t status, const SessionStats *stats)
+{
+    if (usage_queue == NULL)
+    {
+        return;
+    }
+
+    UsageRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = USAGE_RECORD_SESSION;
+    record.session.status = status;
+    record.session.wake_reason = usage_wake;
+    record.session.phases_done = stats->phases_done;
+    record.session.start_ms = stats->start_ms;
+    record.session.duration_ms = stats->duration_ms;
+    for (int i = 0; i < USAGE_PHASES && i < NUM_PHASES; i++)
+    {
+        record.session.phase_ms[i] = stats->phase_ms[i];
+    }
+    for (int q = 0; q < USAGE_QUADRANTS; q++)
+    {
+        record.session.brushing_ms[q] = stats->brushing_ms[q];
+    }
+
+    queueRecord(&record);
+}
+
+void usageRecordHealth(const UsageHealth *health)
+{
+    if (usage_queue == NULL)
+    {
+        return;
+    }
+
+    UsageRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = USAGE_RECORD_HEALTH;
+    record.health = *health;
+    queueRecord(&record);
+}
+
+bool usageFlush(uint32_t timeout_ms)
+{
+    int64_t start = clockMs();
+    while (usage_written != usage_queued)
+    {
+        if (clockMs() - start >= timeout_ms)
+        {
+            return false;
+        }
+        delay(5);
+    }
+    return true;
+}
+
+uint32_t usageScan(uint32_t from_seq, UsageLogVisitor visit, void *ctx)
+{
+    if (usage_mutex == NULL)
+    {
+        return 0;
+    }
+
+    xSemaphoreTake(usage_mutex, portMAX_DELAY);
+    uint32_t visited = usageLogScan(&usage_log, from_seq, visit, ctx);
+    xSemaphoreGive(usage_mutex);
+    return visited;
+}
+
+uint8_t usageWakeReason()
+{
+    return usage_wake;
+}
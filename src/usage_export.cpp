@@ -0,0 +1,228 @@
+#include <string.h>
+#include "usage_export.h"
+
+static uint16_t le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void putLe32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+// *** Device side *** //
+
+static void sendFrame(UsageExporter *exporter, uint8_t type, const void *payload, uint16_t len)
+{
+    size_t size = frameEncode(type, payload, len, exporter->frame);
+    exporter->write(exporter->frame, size);
+}
+
+static void flushBatch(UsageExporter *exporter)
+{
+    if (exporter->batched > 0)
+    {
+        sendFrame(exporter, EXPORT_FRAME_RECORDS, exporter->batch, exporter->batched * sizeof(UsageRecord));
+        exporter->batched = 0;
+    }
+}
+
+static bool batchRecord(const UsageRecord *record, void *ctx)
+{
+    UsageExporter *exporter = (UsageExporter *)ctx;
+    if (exporter->left == 0)
+    {
+        exporter->more = true;
+        return false;
+    }
+    exporter->left--;
+    exporter->batch[exporter->batched++] = *record;
+    exporter->next_seq = record->seq + 1;
+    if (exporter->batched == EXPORT_BATCH)
+    {
+        flushBatch(exporter);
+    }
+    return true;
+}
+
+static bool firstSeq(const UsageRecord *record, void *ctx)
+{
+    *(uint32_t *)ctx = record->seq;
+    return false;
+}
+
+static void runExport(UsageExporter *exporter, uint32_t from_seq, uint16_t count)
+{
+    ExportHello hello;
+    memset(&hello, 0, sizeof(hello));
+    hello.unit_id = exporter->unit_id;
+    hello.record_size = sizeof(UsageRecord);
+    hello.record_version = USAGE_RECORD_VERSION;
+    hello.first_seq = from_seq;
+    exporter->scan(from_seq, firstSeq, &hello.first_seq);
+    sendFrame(exporter, EXPORT_FRAME_HELLO, &hello, sizeof(hello));
+
+    exporter->batched = 0;
+    exporter->left = count;
+    exporter->more = false;
+    exporter->next_seq = from_seq;
+    exporter->scan(from_seq, batchRecord, exporter);
+    flushBatch(exporter);
+
+    uint8_t end[5];
+    putLe32(end, exporter->next_seq);
+    end[4] = exporter->more ? 1 : 0;
+    sendFrame(exporter, EXPORT_FRAME_END, end, sizeof(end));
+}
+
+void usageExporterInit(UsageExporter *exporter, uint64_t unit_id, UsageScanFunc scan, ExportWriteFunc write)
+{
+    exporter->unit_id = unit_id;
+    exporter->scan = scan;
+    exporter->write = write;
+    exporter->batched = 0;
+    exporter->next_seq = 0;
+    frameDecoderInit(&exporter->decoder);
+}
+
+bool usageExporterReceive(UsageExporter *exporter, const uint8_t *data, size_t len)
+{
+    bool ran = false;
+    for (size_t i = 0; i < len; i++)
+    {
+        FrameDecoder *decoder = &exporter->decoder;
+        if (frameDecoderPush(decoder, data[i]) == FRAME_READY &&
+            decoder->type == EXPORT_FRAME_EXPORT && decoder->len == 6)
+        {
+            runExport(exporter, le32(decoder->payload), le16(decoder->payload + 4));
+            ran = true;
+        }
+    }
+    return ran;
+}
+
+// *** Host side *** //
+
+void usageImporterBegin(UsageImporter *importer, uint32_t from_seq, UsageLogVisitor visit, void *ctx)
+{
+    frameDecoderInit(&importer->decoder);
+    memset(&importer->hello, 0, sizeof(importer->hello));
+    importer->have_hello = false;
+    importer->expected = from_seq;
+    importer->window = EXPORT_MIN_WINDOW;
+    importer->lost = false;
+    importer->ended = true;
+    importer->done = false;
+    importer->records = 0;
+    importer->requests = 0;
+    importer->visit = visit;
+    importer->ctx = ctx;
+}
+
+static void takeRecords(UsageImporter *importer, const uint8_t *payload, uint16_t len)
+{
+    for (uint16_t off = 0; off + sizeof(UsageRecord) <= len; off += sizeof(UsageRecord))
+    {
+        UsageRecord record;
+        memcpy(&record, payload + off, sizeof(record));
+        if (!usageRecordValid(&record) || record.seq < importer->expected)
+        {
+            continue;
+        }
+
+        // Anything after a gap is no use until the missing records are
+        //   sent again, the frame with them may not even have been noticed
+        if (record.seq > importer->expected)
+        {
+            importer->lost = true;
+            return;
+        }
+
+        importer->expected = record.seq + 1;
+        importer->records++;
+        importer->visit(&record, importer->ctx);
+    }
+}
+
+void usageImporterPush(UsageImporter *importer, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        FrameDecoder *decoder = &importer->decoder;
+        uint8_t result = frameDecoderPush(decoder, data[i]);
+        if (result == FRAME_BAD)
+        {
+            importer->lost = true;
+            continue;
+        }
+        if (result != FRAME_READY)
+        {
+            continue;
+        }
+
+        switch (decoder->type)
+        {
+        case EXPORT_FRAME_HELLO:
+            if (decoder->len >= sizeof(ExportHello))
+            {
+                memcpy(&importer->hello, decoder->payload, sizeof(ExportHello));
+                importer->have_hello = true;
+
+                // Older records were dropped from the log to make room
+                if (importer->hello.first_seq > importer->expected)
+                {
+                    importer->expected = importer->hello.first_seq;
+                }
+            }
+            break;
+        case EXPORT_FRAME_RECORDS:
+            takeRecords(importer, decoder->payload, decoder->len);
+            break;
+        case EXPORT_FRAME_END:
+            if (decoder->len == 5)
+            {
+                importer->ended = true;
+                importer->lost |= importer->expected < le32(decoder->payload);
+                importer->done = !importer->lost && decoder->payload[4] == 0;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+size_t usageImporterRequest(UsageImporter *importer, uint8_t *out)
+{
+    // A window that lost frames or never ended was too big for the link
+    if (importer->requests > 0)
+    {
+        if (importer->lost || !importer->ended)
+        {
+            importer->window = importer->window / 2 > EXPORT_MIN_WINDOW ? importer->window / 2 : EXPORT_MIN_WINDOW;
+        }
+        else
+        {
+            importer->window = importer->window * 2 < EXPORT_MAX_WINDOW ? importer->window * 2 : EXPORT_MAX_WINDOW;
+        }
+    }
+    importer->lost = false;
+    importer->ended = false;
+    importer->done = false;
+    importer->requests++;
+
+    uint8_t request[6];
+    putLe32(request, importer->expected);
+    request[4] = importer->window & 0xFF;
+    request[5] = importer->window >> 8;
+    return frameEncode(EXPORT_FRAME_EXPORT, request, sizeof(request), out);
+}
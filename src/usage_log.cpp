@@ -0,0 +1,210 @@
+#include <string.h>
+#include "usage_log.h"
+#include "crc32.h"
+
+// Slots read at a time when scanning
+#define USAGE_LOG_READ_BATCH 8
+
+#define CRC_OFFSET (USAGE_RECORD_SIZE - sizeof(uint32_t))
+
+static bool isErased(const UsageRecord *record)
+{
+    const uint8_t *p = (const uint8_t *)record;
+    for (size_t i = 0; i < sizeof(UsageRecord); i++)
+    {
+        if (p[i] != 0xFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool usageRecordValid(const UsageRecord *record)
+{
+    return record->seq != 0 && record->seq != 0xFFFFFFFF && record->crc == crc32(record, CRC_OFFSET);
+}
+
+static uint32_t slotOffset(const UsageLog *log, uint16_t sector, uint16_t slot)
+{
+    return (uint32_t)sector * log->flash->sectorSize() + (uint32_t)slot * USAGE_RECORD_SIZE;
+}
+
+static bool readSlots(UsageLog *log, uint16_t sector, uint16_t slot, UsageRecord *records, uint16_t count)
+{
+    return log->flash->read(slotOffset(log, sector, slot), records, count * sizeof(UsageRecord));
+}
+
+// Seq of the first valid record in a sector, 0 if there isn't one. Slots
+//   are filled in order, so an erased slot means the rest are too.
+static uint32_t firstSeq(UsageLog *log, uint16_t sector)
+{
+    UsageRecord record;
+    for (uint16_t slot = 0; slot < log->slots; slot++)
+    {
+        if (!readSlots(log, sector, slot, &record, 1) || isErased(&record))
+        {
+            return 0;
+        }
+        if (usageRecordValid(&record))
+        {
+            return record.seq;
+        }
+    }
+    return 0;
+}
+
+bool usageLogBegin(UsageLog *log, FlashRegion *flash)
+{
+    log->flash = flash;
+    log->slots = flash->sectorSize() / USAGE_RECORD_SIZE;
+    log->sectors = flash->size() / flash->sectorSize();
+    if (log->sectors > USAGE_LOG_MAX_SECTORS)
+    {
+        log->sectors = USAGE_LOG_MAX_SECTORS;
+    }
+    if (log->sectors < 2 || log->slots == 0)
+    {
+        return false;
+    }
+
+    // The sector that starts with the newest record is the one being written
+    uint32_t newest = 0;
+    log->head_sector = 0;
+    for (uint16_t s = 0; s < log->sectors; s++)
+    {
+        log->first_seq[s] = firstSeq(log, s);
+        if (log->first_seq[s] > newest)
+        {
+            newest = log->first_seq[s];
+            log->head_sector = s;
+        }
+    }
+
+    // Carry on after the last slot that has anything in it, torn or not
+    log->head_slot = 0;
+    log->next_seq = 1;
+    UsageRecord record;
+    for (uint16_t slot = 0; slot < log->slots; slot++)
+    {
+        if (!readSlots(log, log->head_sector, slot, &record, 1))
+        {
+            return false;
+        }
+        if (isErased(&record))
+        {
+            continue;
+        }
+        log->head_slot = slot + 1;
+        if (usageRecordValid(&record) && record.seq >= log->next_seq)
+        {
+            log->next_seq = record.seq + 1;
+        }
+    }
+    return true;
+}
+
+bool usageLogAppend(UsageLog *log, UsageRecord *record)
+{
+    if (log->head_slot >= log->slots)
+    {
+        uint16_t next = (log->head_sector + 1) % log->sectors;
+        log->first_seq[next] = 0;
+        if (!log->flash->eraseSector(next))
+        {
+            return false;
+        }
+        log->head_sector = next;
+        log->head_slot = 0;
+    }
+
+    record->seq = log->next_seq;
+    record->version = USAGE_RECORD_VERSION;
+    record->crc = crc32(record, CRC_OFFSET);
+
+    // The slot is used up whatever happens, never write to it twice
+    uint32_t offset = slotOffset(log, log->head_sector, log->head_slot);
+    log->head_slot++;
+
+    if (!log->flash->write(offset, record, CRC_OFFSET) ||
+        !log->flash->write(offset + CRC_OFFSET, &record->crc, sizeof(record->crc)))
+    {
+        return false;
+    }
+
+    if (log->first_seq[log->head_sector] == 0)
+    {
+        log->first_seq[log->head_sector] = record->seq;
+    }
+    log->next_seq++;
+    return true;
+}
+
+uint32_t usageLogScan(UsageLog *log, uint32_t from_seq, UsageLogVisitor visit, void *ctx)
+{
+    uint32_t visited = 0;
+    UsageRecord batch[USAGE_LOG_READ_BATCH];
+
+    // Oldest sector first, the one after the head
+    for (uint16_t i = 1; i <= log->sectors; i++)
+    {
+        uint16_t sector = (log->head_sector + i) % log->sectors;
+
+        // Nothing wanted here if the next sector already starts at or
+        //   before from_seq
+        if (i < log->sectors)
+        {
+            uint32_t next_first = log->first_seq[(sector + 1) % log->sectors];
+            if (next_first != 0 && next_first <= from_seq)
+            {
+                continue;
+            }
+        }
+
+        for (uint16_t slot = 0; slot < log->slots; slot += USAGE_LOG_READ_BATCH)
+        {
+            uint16_t count = log->slots - slot;
+            if (count > USAGE_LOG_READ_BATCH)
+            {
+                count = USAGE_LOG_READ_BATCH;
+            }
+            if (!readSlots(log, sector, slot, batch, count))
+            {
+                return visited;
+            }
+
+            bool sector_done = false;
+            for (uint16_t k = 0; k < count; k++)
+            {
+                if (isErased(&batch[k]))
+                {
+                    sector_done = true;
+                    break;
+                }
+                if (usageRecordValid(&batch[k]) && batch[k].seq >= from_seq)
+                {
+                    visited++;
+                    if (!visit(&batch[k], ctx))
+                    {
+                        return visited;
+                    }
+                }
+            }
+            if (sector_done)
+            {
+                break;
+            }
+        }
+    }
+    return visited;
+}
+
+uint32_t usageLogNextSeq(const UsageLog *log)
+{
+    return log->next_seq;
+}
+
+uint32_t usageLogCapacity(const UsageLog *log)
+{
+    return (uint32_t)(log->sectors - 1) * log->slots;
+}
@@ -0,0 +1,321 @@
+// Makes and applies the delta patches in include/delta.h.
+//
+//   delta_patch make <old.bin> <new.bin> <out.patch>
+//   delta_patch apply <old.bin> <patch> <out.bin>
+//
+// old.bin is the firmware the unit is running now, i.e. the
+//   .pio/build/esp32/firmware.bin it was flashed with; keep a copy of each
+//   release. With /dev/null as old.bin the patch is the whole new image.
+//
+// Build from the repo root with
+//   g++ -std=gnu++17 -O2 -Iinclude tools/delta_patch.cpp src/delta.cpp src/crc32.cpp -o delta_patch
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "crc32.h"
+#include "delta.h"
+
+// Exact matches shorter than this go in as new bytes
+#define MATCH_MIN 12
+// Bytes hashed to find match candidates, and how many to try per position
+#define HASH_BYTES 8
+#define HASH_BITS 20
+#define CHAIN_MAX 32
+// Extending a match past its end: each differing byte costs this many
+//   equal ones, and the extension stops when it's this far behind its best
+#define MISMATCH_COST 4
+#define EXTEND_SLACK 64
+
+typedef std::vector<uint8_t> Bytes;
+
+static bool readFile(const char *path, Bytes &out)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return false;
+    }
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    {
+        out.insert(out.end(), buf, buf + n);
+    }
+    fclose(f);
+    return true;
+}
+
+static bool writeFile(const char *path, const Bytes &data)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+static void putVarint(Bytes &out, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(v);
+}
+
+static uint32_t hashAt(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return (uint32_t)((v * 0x9E3779B97F4A7C15ULL) >> (64 - HASH_BITS));
+}
+
+// *** make *** //
+
+typedef struct Index
+{
+    std::vector<int32_t> head; // newest source position per hash
+    std::vector<int32_t> prev; // the one before it with the same hash
+} Index;
+
+static void buildIndex(const Bytes &src, Index &index)
+{
+    index.head.assign(1 << HASH_BITS, -1);
+    index.prev.assign(src.size(), -1);
+    for (size_t i = 0; i + HASH_BYTES <= src.size(); i++)
+    {
+        uint32_t h = hashAt(&src[i]);
+        index.prev[i] = index.head[h];
+        index.head[h] = i;
+    }
+}
+
+// Longest exact match for dst[pos...] in the source
+static size_t findMatch(const Bytes &src, const Index &index, const Bytes &dst, size_t pos, size_t *src_pos)
+{
+    if (pos + HASH_BYTES > dst.size() || src.size() < HASH_BYTES)
+    {
+        return 0;
+    }
+
+    size_t best = 0;
+    int32_t cand = index.head[hashAt(&dst[pos])];
+    for (int tries = 0; cand >= 0 && tries < CHAIN_MAX; tries++, cand = index.prev[cand])
+    {
+        size_t len = 0;
+        while (cand + len < src.size() && pos + len < dst.size() && src[cand + len] == dst[pos + len])
+        {
+            len++;
+        }
+        if (len > best)
+        {
+            best = len;
+            *src_pos = cand;
+        }
+    }
+    return best;
+}
+
+// How far past an exact match the same alignment is still worth following,
+//   with a few bytes changed here and there
+static size_t extendMatch(const Bytes &src, const Bytes &dst, size_t src_pos, size_t pos, size_t len)
+{
+    long score = 0;
+    long best = 0;
+    size_t best_len = len;
+    for (size_t k = len; src_pos + k < src.size() && pos + k < dst.size(); k++)
+    {
+        score += src[src_pos + k] == dst[pos + k] ? 1 : -MISMATCH_COST;
+        if (score > best)
+        {
+            best = score;
+            best_len = k + 1;
+        }
+        else if (score < best - EXTEND_SLACK)
+        {
+            break;
+        }
+    }
+    return best_len;
+}
+
+static void emitInsert(Bytes &patch, const Bytes &dst, size_t from, size_t to)
+{
+    if (to > from)
+    {
+        patch.push_back(DELTA_OP_INSERT);
+        putVarint(patch, to - from);
+        patch.insert(patch.end(), dst.begin() + from, dst.begin() + to);
+    }
+}
+
+// COPY if nothing differs, otherwise ADD with the deltas as runs
+static void emitAligned(Bytes &patch, const Bytes &src, const Bytes &dst, size_t src_pos, size_t pos, size_t len)
+{
+    bool same = memcmp(&src[src_pos], &dst[pos], len) == 0;
+    patch.push_back(same ? DELTA_OP_COPY : DELTA_OP_ADD);
+    putVarint(patch, src_pos);
+    putVarint(patch, len);
+    if (same)
+    {
+        return;
+    }
+
+    size_t k = 0;
+    while (k < len)
+    {
+        size_t zeros = 0;
+        while (k + zeros < len && src[src_pos + k + zeros] == dst[pos + k + zeros])
+        {
+            zeros++;
+        }
+        putVarint(patch, zeros);
+        k += zeros;
+        if (k == len)
+        {
+            break;
+        }
+
+        // A lone equal byte costs less as a zero delta than as a new run
+        size_t count = 0;
+        while (k + count < len && (src[src_pos + k + count] != dst[pos + k + count] ||
+                                   (k + count + 1 < len && src[src_pos + k + count + 1] != dst[pos + k + count + 1])))
+        {
+            count++;
+        }
+        putVarint(patch, count);
+        for (size_t i = 0; i < count; i++)
+        {
+            patch.push_back((uint8_t)(dst[pos + k + i] - src[src_pos + k + i]));
+        }
+        k += count;
+    }
+}
+
+static Bytes makePatch(const Bytes &src, const Bytes &dst)
+{
+    Index index;
+    buildIndex(src, index);
+
+    Bytes patch(DELTA_HEADER_SIZE);
+    DeltaHeader header = {(uint32_t)src.size(), crc32(src.data(), src.size()), (uint32_t)dst.size(),
+                          crc32(dst.data(), dst.size())};
+    deltaEncodeHeader(&header, patch.data());
+
+    size_t pos = 0;
+    size_t literal = 0;
+    while (pos < dst.size())
+    {
+        size_t src_pos = 0;
+        size_t len = findMatch(src, index, dst, pos, &src_pos);
+        if (len < MATCH_MIN)
+        {
+            pos++;
+            continue;
+        }
+
+        emitInsert(patch, dst, literal, pos);
+        len = extendMatch(src, dst, src_pos, pos, len);
+        emitAligned(patch, src, dst, src_pos, pos, len);
+        pos += len;
+        literal = pos;
+    }
+    emitInsert(patch, dst, literal, dst.size());
+    return patch;
+}
+
+// *** apply *** //
+
+typedef struct ApplyCtx
+{
+    const Bytes *src;
+    Bytes *out;
+} ApplyCtx;
+
+static bool readSource(uint32_t offset, void *buf, size_t len, void *ctx)
+{
+    const Bytes *src = ((ApplyCtx *)ctx)->src;
+    if (offset + len > src->size())
+    {
+        return false;
+    }
+    memcpy(buf, src->data() + offset, len);
+    return true;
+}
+
+static bool writeTarget(const uint8_t *data, size_t len, void *ctx)
+{
+    Bytes *out = ((ApplyCtx *)ctx)->out;
+    out->insert(out->end(), data, data + len);
+    return true;
+}
+
+static uint8_t applyPatch(const Bytes &src, const Bytes &patch, Bytes &out)
+{
+    ApplyCtx ctx = {&src, &out};
+    static DeltaApplier applier;
+    deltaApplierInit(&applier, readSource, writeTarget, &ctx);
+    return deltaApplierPush(&applier, patch.data(), patch.size());
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 5 || (strcmp(argv[1], "make") != 0 && strcmp(argv[1], "apply") != 0))
+    {
+        fprintf(stderr, "usage: %s make <old.bin> <new.bin> <out.patch>\n"
+                        "       %s apply <old.bin> <patch> <out.bin>\n",
+                argv[0], argv[0]);
+        return 2;
+    }
+
+    Bytes src, in;
+    if (!readFile(argv[2], src) || !readFile(argv[3], in))
+    {
+        fprintf(stderr, "can't read %s or %s\n", argv[2], argv[3]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (strcmp(argv[1], "make") == 0)
+    {
+        Bytes patch = makePatch(src, in);
+
+        // Never ship a patch that doesn't reproduce the image
+        Bytes check;
+        if (applyPatch(src, patch, check) != DELTA_DONE || check != in)
+        {
+            fprintf(stderr, "patch doesn't apply, not written\n");
+            return 1;
+        }
+        if (!writeFile(argv[4], patch))
+        {
+            fprintf(stderr, "can't write %s\n", argv[4]);
+            return 1;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("%zu -> %zu bytes, patch %zu bytes (%.1f%% of the image), %.0f ms\n", src.size(), in.size(),
+               patch.size(), 100.0 * patch.size() / in.size(), ms);
+        return 0;
+    }
+
+    Bytes out;
+    uint8_t result = applyPatch(src, in, out);
+    if (result != DELTA_DONE)
+    {
+        fprintf(stderr, "patch failed: %u\n", result);
+        return 1;
+    }
+    if (!writeFile(argv[4], out))
+    {
+        fprintf(stderr, "can't write %s\n", argv[4]);
+        return 1;
+    }
+    printf("%zu bytes written\n", out.size());
+    return 0;
+}
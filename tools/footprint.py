@@ -0,0 +1,353 @@
+# Flash and RAM taken by each part of the esp32 image, checked against the
+# budgets in tools/footprint.txt. PlatformIO runs it after every link of the
+# esp32 environments (extra_scripts in platformio.ini) and the build fails
+# if anything is over. It also runs on its own, e.g. to list the biggest
+# symbols in each part:
+#
+#   python3 tools/footprint.py .pio/build/esp32/firmware.elf --symbols 10
+#
+# The linker map says which object each input section came from and which
+# output section it went into, and the output section says where it lives:
+#
+#   flash  what it adds to the app image: code and constants that run from
+#          flash, and the contents IRAM code and initialised DRAM data are
+#          loaded with
+#   iram   code in internal RAM, IRAM_ATTR functions and the like
+#   dram   static RAM, initialised or not. Task stacks are in here (see
+#          include/static_task.h), the heap is whatever's left.
+#
+# RTC memory only counts towards flash. Parts made of objects (our modules,
+# the libraries) take every section of the objects they match; assets take
+# the symbols they match in the ELF symbol table wherever they were
+# compiled, so a const array that ends up in DRAM shows up. One compiled
+# into several objects, e.g. defined in a header without inline, fails the
+# check whatever its budget.
+
+import argparse
+import bisect
+import fnmatch
+import os
+import re
+import struct
+import sys
+
+REGIONS = ("flash", "iram", "dram")
+
+# Output section: the RAM it takes and whether its contents are in the
+#   image. The first pattern that matches, sections matching none (debug
+#   info, .comment, ...) aren't counted.
+OUTPUT_SECTIONS = [
+    (".iram0.bss", "iram", False),
+    (".iram0.*", "iram", True),
+    (".dram0.bss", "dram", False),
+    (".noinit", "dram", False),
+    (".dram0.*", "dram", True),
+    (".flash.rodata_noload", None, False),
+    (".flash_rodata_dummy", None, False),
+    (".flash.*", None, True),
+    (".rtc*bss", None, False),
+    (".rtc_noinit", None, False),
+    (".rtc*", None, True),
+]
+
+OUTPUT_RE = re.compile(r"^(\.\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+INPUT_RE = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+FILL_RE = re.compile(r"^ \*fill\*\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+ALONE_RE = re.compile(r"^ ?(\.\S+|COMMON)$")
+
+# Static variables' names, which GCC mangles as _ZL<length><name>
+STATIC_RE = re.compile(r"^_ZL(\d+)(\w+)$")
+
+ELF_SYMTAB = 2
+ELF_OBJECT = 1
+ELF_FUNC = 2
+ELF_UNIQUE = 10  # what the host's GCC makes inline variables
+ELF_SPECIAL = 0xFF00  # section indexes from here on are absolute, common, ...
+
+
+class Part:
+    def __init__(self, name, kind, budget, patterns):
+        self.name = name
+        self.kind = kind  # "objects" or "symbols"
+        self.budget = budget
+        self.patterns = patterns
+        self.used = dict.fromkeys(REGIONS, 0)
+        self.symbols = []  # (size, name, region)
+        self.copies = 0  # symbols also compiled into another object
+        self.copied_bytes = 0
+
+    def add(self, size, ram, image):
+        if ram is not None:
+            self.used[ram] += size
+        if image:
+            self.used["flash"] += size
+
+
+def parseSize(text, partition=None):
+    if text == "-":
+        return None
+    if text == "partition":
+        return partition
+    scale = {"K": 1024, "M": 1024 * 1024}.get(text[-1].upper(), 1)
+    return int(text[:-1] if scale > 1 else text, 0) * scale
+
+
+def appPartitionSize(path):
+    """The first app partition in a partitions.csv, None without one"""
+    if path is None or not os.path.exists(path):
+        return None
+    with open(path) as f:
+        for line in f:
+            fields = [field.strip() for field in line.split("#")[0].split(",")]
+            if len(fields) >= 5 and fields[1] == "app":
+                return parseSize(fields[4])
+    return None
+
+
+def readBudget(path, partition):
+    """Parts in the order they're listed, and the total's budget"""
+    parts = []
+    total = dict.fromkeys(REGIONS)
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            line = line.split("#")[0].rstrip()
+            if not line.strip():
+                continue
+            # Indented lines carry on the patterns of the part above
+            if line[0].isspace() and parts:
+                parts[-1].patterns += line.split()
+                continue
+            fields = line.split()
+            if len(fields) < 5 or fields[1] not in ("objects", "symbols", "total"):
+                raise ValueError("%s:%d: expected name, objects|symbols|total, flash, iram, dram, patterns" % (path, number))
+            budget = dict(zip(REGIONS, [parseSize(field, partition) for field in fields[2:5]]))
+            if fields[1] == "total":
+                total = budget
+            else:
+                parts.append(Part(fields[0], fields[1], budget, fields[5:]))
+    return parts, total
+
+
+def outputSection(name):
+    for pattern, ram, image in OUTPUT_SECTIONS:
+        if fnmatch.fnmatchcase(name, pattern):
+            return ram, image
+    return None
+
+
+def readMap(path):
+    """Output sections as (name, size, ram, image) and the input sections in
+       them as (address, size, object, ram, image), padding's object being
+       None"""
+    outputs = []
+    inputs = []
+    with open(path, errors="replace") as f:
+        for line in f:
+            if line.startswith("Linker script and memory map"):
+                break
+        current = None
+        alone = None
+        for line in f:
+            line = line.rstrip("\n")
+            # A long section name is on a line of its own, with the rest
+            #   on the next
+            if alone is not None:
+                if line[:1].isspace() and "0x" in line:
+                    line = alone + line
+                alone = None
+            if line.startswith("."):
+                m = OUTPUT_RE.match(line)
+                if m:
+                    current = outputSection(m.group(1))
+                    if current is not None:
+                        outputs.append((m.group(1), int(m.group(3), 16)) + current)
+                elif ALONE_RE.match(line):
+                    alone = line
+                continue
+            if current is None or not line.startswith(" "):
+                continue
+            m = FILL_RE.match(line)
+            if m:
+                inputs.append((int(m.group(1), 16), int(m.group(2), 16), None) + current)
+                continue
+            m = INPUT_RE.match(line)
+            if m:
+                size = int(m.group(3), 16)
+                if size > 0:
+                    inputs.append((int(m.group(2), 16), size, m.group(4).strip()) + current)
+            elif ALONE_RE.match(line):
+                alone = line
+    return outputs, inputs
+
+
+def readSymbols(path):
+    """The ELF's functions and variables as (name, address, size)"""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF":
+        raise ValueError("%s isn't an ELF file" % path)
+    wide = data[4] == 2
+    order = "<" if data[5] == 1 else ">"
+    if wide:
+        (shoff,) = struct.unpack_from(order + "Q", data, 0x28)
+        shentsize, shnum = struct.unpack_from(order + "HH", data, 0x3A)
+        section_format, symbol_format = order + "IIQQQQIIQQ", order + "IBBHQQ"
+    else:
+        (shoff,) = struct.unpack_from(order + "I", data, 0x20)
+        shentsize, shnum = struct.unpack_from(order + "HH", data, 0x2E)
+        section_format, symbol_format = order + "10I", order + "IIIBBH"
+
+    sections = [struct.unpack_from(section_format, data, shoff + i * shentsize) for i in range(shnum)]
+    symbols = []
+    for section in sections:
+        if section[1] != ELF_SYMTAB:
+            continue
+        offset, size = section[4], section[5]
+        strings = sections[section[6]][4]
+        for entry in struct.iter_unpack(symbol_format, data[offset : offset + size]):
+            if wide:
+                name, info, _, shndx, value, length = entry
+            else:
+                name, value, length, info, _, shndx = entry
+            if info & 0xF not in (ELF_OBJECT, ELF_FUNC, ELF_UNIQUE) or length == 0 or shndx == 0 or shndx >= ELF_SPECIAL:
+                continue
+            end = data.index(b"\0", strings + name)
+            text = data[strings + name : end].decode(errors="replace")
+            m = STATIC_RE.match(text)
+            if m and int(m.group(1)) == len(m.group(2)):
+                text = m.group(2)
+            symbols.append((text, value, length))
+    return symbols
+
+
+def matches(text, patterns):
+    return any(fnmatch.fnmatchcase(text, pattern) for pattern in patterns)
+
+
+def measure(elf_path, map_path, parts):
+    """Fills in the parts, returns what's used in all"""
+    outputs, inputs = readMap(map_path)
+    objects = [part for part in parts if part.kind == "objects"]
+    assets = [part for part in parts if part.kind == "symbols"]
+    other = Part("other", "objects", dict.fromkeys(REGIONS), [])
+    parts.append(other)
+
+    owner = {None: other}
+    for address, size, obj, ram, image in inputs:
+        if obj not in owner:
+            owner[obj] = next((part for part in objects if matches(obj, part.patterns)), other)
+        owner[obj].add(size, ram, image)
+
+    inputs.sort()
+    starts = [section[0] for section in inputs]
+    seen = {}
+    for name, address, size in readSymbols(elf_path):
+        i = bisect.bisect_right(starts, address) - 1
+        if i < 0 or address >= inputs[i][0] + inputs[i][1]:
+            continue
+        _, _, obj, ram, image = inputs[i]
+        region = ram if ram is not None else "flash"
+        owner.get(obj, other).symbols.append((size, name, region))
+        asset = next((part for part in assets if matches(name, part.patterns)), None)
+        if asset is None:
+            continue
+        asset.add(size, ram, image)
+        asset.symbols.append((size, name, region))
+        if name in seen:
+            asset.copies += 1
+            asset.copied_bytes += size
+        seen[name] = True
+
+    total = Part("total", "objects", dict.fromkeys(REGIONS), [])
+    for name, size, ram, image in outputs:
+        total.add(size, ram, image)
+    return total
+
+
+def kb(size):
+    if size < 1024:
+        return "%d" % size
+    return "%dK" % (size // 1024) if size % 1024 == 0 else "%.1fK" % (size / 1024.0)
+
+
+def report(parts, total, total_budget, symbols):
+    """Prints the table, returns what's over budget"""
+    over = []
+    print("%-12s %20s %20s %20s" % ("", "flash", "iram", "dram"))
+
+    def row(part, budget):
+        cells = []
+        for region in REGIONS:
+            used, limit = part.used[region], budget[region]
+            if limit is None:
+                cells.append(kb(used))
+                continue
+            flag = ""
+            if used > limit:
+                flag = "!"
+                over.append("%s %s %s > %s" % (part.name, region, kb(used), kb(limit)))
+            cells.append("%s%s / %s" % (flag, kb(used), kb(limit)))
+        line = "%-12s %20s %20s %20s" % ((part.name,) + tuple(cells))
+        # An asset is defined once; a copy is flash spent on nothing
+        if part.copies:
+            line += "  !%d copies, %s" % (part.copies, kb(part.copied_bytes))
+            over.append("%s %d copies %s" % (part.name, part.copies, kb(part.copied_bytes)))
+        print(line)
+        for size, name, region in sorted(part.symbols, reverse=True)[:symbols]:
+            print("    %8d %-5s %s" % (size, region, name))
+
+    for part in parts:
+        if part.kind == "objects":
+            row(part, part.budget)
+    row(total, total_budget)
+    print("assets")
+    for part in parts:
+        if part.kind == "symbols":
+            row(part, part.budget)
+    return over
+
+
+def footprint(elf_path, map_path, budget_path, partitions_path, symbols):
+    if not os.path.exists(map_path):
+        print("footprint: no linker map at %s" % map_path)
+        return 1
+    partition = appPartitionSize(partitions_path)
+    parts, total_budget = readBudget(budget_path, partition)
+    total = measure(elf_path, map_path, parts)
+    print("Footprint of %s, budgets from %s" % (elf_path, budget_path))
+    over = report(parts, total, total_budget, symbols)
+    if over:
+        print("Over budget: " + ", ".join(over))
+        return 1
+    return 0
+
+
+def main(args):
+    repo = os.path.dirname(os.path.dirname(os.path.abspath(sys.argv[0])))
+    parser = argparse.ArgumentParser(description="Flash and RAM footprint of the firmware against its budgets")
+    parser.add_argument("elf")
+    parser.add_argument("--map", help="the linker map, by default next to the ELF")
+    parser.add_argument("--budget", default=os.path.join(repo, "tools", "footprint.txt"))
+    parser.add_argument("--partitions", default=os.path.join(repo, "partitions.csv"))
+    parser.add_argument("--symbols", type=int, default=0, help="list this many of the biggest symbols in each part")
+    options = parser.parse_args(args)
+    map_path = options.map or os.path.splitext(options.elf)[0] + ".map"
+    return footprint(options.elf, map_path, options.budget, options.partitions, options.symbols)
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
+else:
+    Import("env")  # noqa: F821, PlatformIO runs this as an SCons script
+
+    project_dir = env.subst("$PROJECT_DIR")  # noqa: F821
+    elf_path = "$BUILD_DIR/${PROGNAME}.elf"
+    map_path = env.subst("$BUILD_DIR/${PROGNAME}.map")  # noqa: F821
+    env.Append(LINKFLAGS=["-Wl,-Map=" + map_path])  # noqa: F821
+    budget_path = os.path.join(project_dir, env.GetProjectOption("custom_footprint_budget"))  # noqa: F821
+    partitions_path = os.path.join(project_dir, env.GetProjectOption("board_build.partitions"))  # noqa: F821
+
+    def checkFootprint(target, source, env):
+        return footprint(str(target[0]), map_path, budget_path, partitions_path, 0)
+
+    env.AddPostAction(elf_path, checkFootprint)  # noqa: F821
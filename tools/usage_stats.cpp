@@ -0,0 +1,470 @@
+// Host tool for usage logs pulled off Brush-E Bots over USB serial.
+//
+//   usage_stats pull <port> <dir>           append new records to <dir>/<unit>.usage
+//   usage_stats report <file.usage>...      per-unit and fleet statistics
+//   usage_stats fake <dir> <units> <sessions>  made up dumps, for trying report out
+//
+// A dump is the 8 byte magic "BRUSHLOG", the unit id (u64 little endian)
+//   and then raw UsageRecords in seq order, as they are in flash.
+//
+// Build from the repo root with
+//   g++ -std=gnu++17 -O2 -Iinclude tools/usage_stats.cpp src/frame.cpp src/crc32.cpp src/usage_export.cpp src/usage_log.cpp -o usage_stats
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "crc32.h"
+#include "usage_export.h"
+#include "usage_log.h"
+
+#define DUMP_MAGIC "BRUSHLOG"
+#define DUMP_MAGIC_SIZE 8
+#define DUMP_HEADER_SIZE (DUMP_MAGIC_SIZE + 8)
+
+// How long to wait for the next byte before asking again
+#define PULL_TIMEOUT_MS 1000
+#define PULL_MAX_REQUESTS 10000
+
+// Records read from a dump at a time
+#define REPORT_CHUNK 65536
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string dumpPath(const char *dir, uint64_t unit_id)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%012llx.usage", (unsigned long long)unit_id);
+    return std::string(dir) + name;
+}
+
+static bool writeHeader(FILE *f, uint64_t unit_id)
+{
+    uint8_t header[DUMP_HEADER_SIZE];
+    memcpy(header, DUMP_MAGIC, DUMP_MAGIC_SIZE);
+    for (int i = 0; i < 8; i++)
+    {
+        header[DUMP_MAGIC_SIZE + i] = (unit_id >> (8 * i)) & 0xFF;
+    }
+    return fwrite(header, 1, sizeof(header), f) == sizeof(header);
+}
+
+static bool readHeader(FILE *f, uint64_t *unit_id)
+{
+    uint8_t header[DUMP_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), f) != sizeof(header) || memcmp(header, DUMP_MAGIC, DUMP_MAGIC_SIZE) != 0)
+    {
+        return false;
+    }
+    *unit_id = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        *unit_id |= (uint64_t)header[DUMP_MAGIC_SIZE + i] << (8 * i);
+    }
+    return true;
+}
+
+// *** pull *** //
+
+static int openPort(const char *port)
+{
+    int fd = open(port, O_RDWR | O_NOCTTY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, B115200);
+    cfsetospeed(&tty, B115200);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSANOW, &tty) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+// Send the next request and push what comes back until its END, or until
+//   the link goes quiet
+static void exchange(int fd, UsageImporter *importer)
+{
+    uint8_t request[FRAME_MAX_SIZE];
+    size_t len = usageImporterRequest(importer, request);
+    if (write(fd, request, len) != (ssize_t)len)
+    {
+        return;
+    }
+
+    uint8_t buf[4096];
+    struct pollfd pfd = {fd, POLLIN, 0};
+    while (!importer->ended && poll(&pfd, 1, PULL_TIMEOUT_MS) > 0)
+    {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            break;
+        }
+        usageImporterPush(importer, buf, n);
+    }
+}
+
+static bool appendRecord(const UsageRecord *record, void *ctx)
+{
+    return fwrite(record, sizeof(*record), 1, (FILE *)ctx) == 1;
+}
+
+static bool ignoreRecord(const UsageRecord *record, void *ctx)
+{
+    return true;
+}
+
+// The seq after the last record in an existing dump, 1 if there isn't one
+static uint32_t resumeSeq(const std::string &path, uint64_t unit_id)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == NULL)
+    {
+        return 1;
+    }
+
+    uint64_t file_unit;
+    uint32_t seq = 1;
+    UsageRecord last;
+    if (readHeader(f, &file_unit) && file_unit == unit_id && fseek(f, 0, SEEK_END) == 0)
+    {
+        long records = (ftell(f) - DUMP_HEADER_SIZE) / (long)sizeof(UsageRecord);
+        if (records > 0 && fseek(f, DUMP_HEADER_SIZE + (records - 1) * (long)sizeof(UsageRecord), SEEK_SET) == 0 &&
+            fread(&last, sizeof(last), 1, f) == 1 && usageRecordValid(&last))
+        {
+            seq = last.seq + 1;
+        }
+    }
+    fclose(f);
+    return seq;
+}
+
+static int pull(const char *port, const char *dir)
+{
+    int fd = openPort(port);
+    if (fd < 0)
+    {
+        fprintf(stderr, "can't open %s: %s\n", port, strerror(errno));
+        return 1;
+    }
+
+    // Ask for nothing to find out which unit this is
+    static UsageImporter importer;
+    usageImporterBegin(&importer, 0xFFFFFFFF, ignoreRecord, NULL);
+    for (int i = 0; i < 5 && !importer.have_hello; i++)
+    {
+        exchange(fd, &importer);
+    }
+    if (!importer.have_hello)
+    {
+        fprintf(stderr, "no answer from %s\n", port);
+        close(fd);
+        return 1;
+    }
+    if (importer.hello.record_size != sizeof(UsageRecord) || importer.hello.record_version != USAGE_RECORD_VERSION)
+    {
+        fprintf(stderr, "unit has record format %u/%u, this tool knows %u/%u\n", importer.hello.record_size,
+                importer.hello.record_version, (unsigned)sizeof(UsageRecord), USAGE_RECORD_VERSION);
+        close(fd);
+        return 1;
+    }
+
+    uint64_t unit_id = importer.hello.unit_id;
+    std::string path = dumpPath(dir, unit_id);
+    uint32_t from = resumeSeq(path, unit_id);
+    FILE *f = fopen(path.c_str(), "ab");
+    if (f == NULL)
+    {
+        fprintf(stderr, "can't write %s: %s\n", path.c_str(), strerror(errno));
+        close(fd);
+        return 1;
+    }
+    if (ftell(f) == 0)
+    {
+        writeHeader(f, unit_id);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    usageImporterBegin(&importer, from, appendRecord, f);
+    while (!importer.done && importer.requests < PULL_MAX_REQUESTS)
+    {
+        exchange(fd, &importer);
+    }
+    fclose(f);
+    close(fd);
+
+    printf("%012llx: %u new records from seq %u in %.1f s, %u requests, %u bad frames%s\n",
+           (unsigned long long)unit_id, importer.records, from, secondsSince(start), importer.requests,
+           importer.decoder.bad, importer.done ? "" : ", gave up");
+    return importer.done ? 0 : 1;
+}
+
+// *** report *** //
+
+typedef struct Stats
+{
+    uint64_t sessions;
+    uint64_t completed;
+    uint64_t stopped_sensor;
+    uint64_t stopped_battery;
+    uint64_t invalid;
+    uint64_t duration_ms;
+    uint64_t brushing_ms[USAGE_QUADRANTS];
+    uint64_t wakes[USAGE_WAKE_OTHER + 1];
+    uint64_t crashes;  // wakes after a watchdog, panic or brownout reset
+    uint64_t stalls;   // missed task heartbeats
+    uint64_t failures; // peripherals that stopped working
+} Stats;
+
+static void addSession(Stats *stats, const UsageSession *session)
+{
+    stats->sessions++;
+    stats->completed += session->status == USAGE_COMPLETED;
+    stats->stopped_sensor += session->status == USAGE_STOPPED_SENSOR;
+    stats->stopped_battery += session->status == USAGE_STOPPED_BATTERY;
+    stats->duration_ms += session->duration_ms;
+    for (int q = 0; q < USAGE_QUADRANTS; q++)
+    {
+        stats->brushing_ms[q] += session->brushing_ms[q];
+    }
+    stats->wakes[session->wake_reason <= USAGE_WAKE_OTHER ? session->wake_reason : USAGE_WAKE_OTHER]++;
+}
+
+static void addHealth(Stats *stats, const UsageHealth *health)
+{
+    stats->crashes += health->reset_reason >= USAGE_RESET_WATCHDOG && health->reset_reason < USAGE_RESET_OTHER;
+    for (int t = 0; t < USAGE_HEALTH_TASKS; t++)
+    {
+        stats->stalls += health->stalls[t];
+    }
+    for (int p = 0; p < USAGE_HEALTH_PERIPHERALS; p++)
+    {
+        stats->failures += health->failures[p];
+    }
+}
+
+static void addStats(Stats *total, const Stats *stats)
+{
+    total->sessions += stats->sessions;
+    total->completed += stats->completed;
+    total->stopped_sensor += stats->stopped_sensor;
+    total->stopped_battery += stats->stopped_battery;
+    total->invalid += stats->invalid;
+    total->duration_ms += stats->duration_ms;
+    for (int q = 0; q < USAGE_QUADRANTS; q++)
+    {
+        total->brushing_ms[q] += stats->brushing_ms[q];
+    }
+    for (int w = 0; w <= USAGE_WAKE_OTHER; w++)
+    {
+        total->wakes[w] += stats->wakes[w];
+    }
+    total->crashes += stats->crashes;
+    total->stalls += stats->stalls;
+    total->failures += stats->failures;
+}
+
+static void printStats(const char *name, const Stats *stats)
+{
+    double n = stats->sessions > 0 ? (double)stats->sessions : 1.0;
+    printf("%-14s %9llu %6.1f%% %6.1f%% %6.1f%% %6.1f  %5.1f %5.1f %5.1f %5.1f  %7llu %7llu %7llu %6llu  %6llu %6llu %6llu\n",
+           name, (unsigned long long)stats->sessions, 100.0 * stats->completed / n, 100.0 * stats->stopped_sensor / n,
+           100.0 * stats->stopped_battery / n, stats->duration_ms / n / 1000.0, stats->brushing_ms[0] / n / 1000.0,
+           stats->brushing_ms[1] / n / 1000.0, stats->brushing_ms[2] / n / 1000.0, stats->brushing_ms[3] / n / 1000.0,
+           (unsigned long long)stats->wakes[USAGE_WAKE_POWER_ON], (unsigned long long)stats->wakes[USAGE_WAKE_SENSOR],
+           (unsigned long long)stats->wakes[USAGE_WAKE_OTHER], (unsigned long long)stats->invalid,
+           (unsigned long long)stats->crashes, (unsigned long long)stats->stalls, (unsigned long long)stats->failures);
+}
+
+static bool readDump(const char *path, std::map<uint64_t, Stats> &units, uint64_t *records)
+{
+    FILE *f = fopen(path, "rb");
+    uint64_t unit_id;
+    if (f == NULL || !readHeader(f, &unit_id))
+    {
+        fprintf(stderr, "%s: not a usage dump\n", path);
+        if (f != NULL)
+        {
+            fclose(f);
+        }
+        return false;
+    }
+
+    Stats &stats = units[unit_id];
+    static std::vector<UsageRecord> chunk(REPORT_CHUNK);
+    size_t n;
+    while ((n = fread(chunk.data(), sizeof(UsageRecord), chunk.size(), f)) > 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            const UsageRecord *record = &chunk[i];
+            if (!usageRecordValid(record))
+            {
+                stats.invalid++;
+            }
+            else if (record->type == USAGE_RECORD_SESSION)
+            {
+                addSession(&stats, &record->session);
+            }
+            else if (record->type == USAGE_RECORD_HEALTH)
+            {
+                addHealth(&stats, &record->health);
+            }
+        }
+        *records += n;
+    }
+    fclose(f);
+    return true;
+}
+
+static int report(int count, char **paths)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::map<uint64_t, Stats> units;
+    uint64_t records = 0;
+    int failed = 0;
+    for (int i = 0; i < count; i++)
+    {
+        failed += !readDump(paths[i], units, &records);
+    }
+    double elapsed = secondsSince(start);
+
+    printf("%-14s %9s %7s %7s %7s %6s  %5s %5s %5s %5s  %7s %7s %7s %6s  %6s %6s %6s\n", "unit", "sessions", "done",
+           "sensor", "battery", "mean s", "q1 s", "q2 s", "q3 s", "q4 s", "power", "sensor", "other", "bad", "crash", "stall",
+           "fault");
+    Stats fleet;
+    memset(&fleet, 0, sizeof(fleet));
+    for (auto &unit : units)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%012llx", (unsigned long long)unit.first);
+        printStats(name, &unit.second);
+        addStats(&fleet, &unit.second);
+    }
+    printStats("fleet", &fleet);
+
+    printf("%zu units, %llu records in %.2f s, %.1f M records/s\n", units.size(), (unsigned long long)records,
+           elapsed, elapsed > 0 ? records / elapsed / 1e6 : 0.0);
+    return failed > 0 ? 1 : 0;
+}
+
+// *** fake *** //
+
+static int fake(const char *dir, int units, int sessions)
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::normal_distribution<double> quadrant_s(28.0, 6.0);
+
+    for (int u = 0; u < units; u++)
+    {
+        uint64_t unit_id = 0x24A160000000ULL + u;
+        FILE *f = fopen(dumpPath(dir, unit_id).c_str(), "wb");
+        if (f == NULL || !writeHeader(f, unit_id))
+        {
+            fprintf(stderr, "can't write to %s\n", dir);
+            return 1;
+        }
+
+        std::vector<UsageRecord> records;
+        records.reserve(sessions + sessions / 20);
+        for (int s = 0; s < sessions; s++)
+        {
+            records.emplace_back();
+            UsageRecord *record = &records.back();
+            memset(record, 0, sizeof(*record));
+            record->seq = records.size();
+            record->type = USAGE_RECORD_SESSION;
+            record->version = USAGE_RECORD_VERSION;
+
+            UsageSession *session = &record->session;
+            int end = percent(rng);
+            bool stopped = end < 16;
+            session->status = end < 15 ? USAGE_STOPPED_SENSOR : end < 16 ? USAGE_STOPPED_BATTERY : USAGE_COMPLETED;
+            session->wake_reason = percent(rng) < 90 ? USAGE_WAKE_SENSOR : USAGE_WAKE_POWER_ON;
+            session->phases_done = stopped ? percent(rng) % USAGE_PHASES : USAGE_PHASES;
+            session->start_ms = 1500;
+            for (int q = 0; q < USAGE_QUADRANTS; q++)
+            {
+                double ms = quadrant_s(rng) * 1000.0 * (stopped ? session->phases_done / (double)USAGE_PHASES : 1.0);
+                session->brushing_ms[q] = ms < 0 ? 0 : ms > 65535 ? 65535 : (uint16_t)ms;
+            }
+            for (int p = 0; p < session->phases_done; p++)
+            {
+                session->phase_ms[p] = 10000;
+                session->duration_ms += session->phase_ms[p];
+            }
+            record->crc = crc32(record, offsetof(UsageRecord, crc));
+
+            // Now and then the player didn't answer for a while
+            if (percent(rng) < 2)
+            {
+                records.emplace_back();
+                record = &records.back();
+                memset(record, 0, sizeof(*record));
+                record->seq = records.size();
+                record->type = USAGE_RECORD_HEALTH;
+                record->version = USAGE_RECORD_VERSION;
+                record->health.reset_reason = percent(rng) < 10 ? USAGE_RESET_WATCHDOG : USAGE_RESET_DEEP_SLEEP;
+                record->health.uptime_ms = session->duration_ms + 3000;
+                record->health.failures[0] = 1;
+                record->health.recoveries[0] = percent(rng) < 80;
+                record->health.down = !record->health.recoveries[0];
+                record->crc = crc32(record, offsetof(UsageRecord, crc));
+            }
+        }
+        fwrite(records.data(), sizeof(UsageRecord), records.size(), f);
+        fclose(f);
+    }
+    printf("%d units, %d sessions each\n", units, sessions);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && strcmp(argv[1], "pull") == 0)
+    {
+        return pull(argv[2], argv[3]);
+    }
+    if (argc >= 3 && strcmp(argv[1], "report") == 0)
+    {
+        return report(argc - 2, argv + 2);
+    }
+    if (argc == 5 && strcmp(argv[1], "fake") == 0)
+    {
+        return fake(argv[2], atoi(argv[3]), atoi(argv[4]));
+    }
+
+    fprintf(stderr, "usage: %s pull <port> <dir>\n"
+                    "       %s report <file.usage>...\n"
+                    "       %s fake <dir> <units> <sessions>\n",
+            argv[0], argv[0], argv[0]);
+    return 2;
+}